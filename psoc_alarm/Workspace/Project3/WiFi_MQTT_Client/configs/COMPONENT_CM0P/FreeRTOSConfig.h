@@ -87,8 +87,13 @@ extern uint32_t SystemCoreClock;
 #define configUSE_MALLOC_FAILED_HOOK            1
 #define configUSE_DAEMON_TASK_STARTUP_HOOK      0
 
-/* Run time and task stats gathering related definitions. */
-#define configGENERATE_RUN_TIME_STATS           0
+/* Run time and task stats gathering related definitions. The run time
+counter is a hardware timer, see sys_stats.c. */
+#define configGENERATE_RUN_TIME_STATS           1
+extern void sys_stats_timer_init(void);
+extern uint32_t sys_stats_timer_read(void);
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS() sys_stats_timer_init()
+#define portGET_RUN_TIME_COUNTER_VALUE()        sys_stats_timer_read()
 #define configUSE_TRACE_FACILITY                1
 #define configUSE_STATS_FORMATTING_FUNCTIONS    0
 
@@ -114,7 +119,7 @@ to exclude the API function. */
 #define INCLUDE_vTaskDelay                      1
 #define INCLUDE_xTaskGetSchedulerState          1
 #define INCLUDE_xTaskGetCurrentTaskHandle       1
-#define INCLUDE_uxTaskGetStackHighWaterMark     0
+#define INCLUDE_uxTaskGetStackHighWaterMark     1
 #define INCLUDE_xTaskGetIdleTaskHandle          0
 #define INCLUDE_eTaskGetState                   0
 #define INCLUDE_xEventGroupSetBitFromISR        1
@@ -79,15 +79,22 @@ extern uint32_t SystemCoreClock;
 #define configTOTAL_HEAP_SIZE                   10240
 #define configAPPLICATION_ALLOCATED_HEAP        0
 
-/* Hook function related definitions. */
+/* Hook function related definitions. The tick hook checks the deadlines,
+see source/deadline.c; DEADLINE_ENABLE comes from log_config.h, included
+with trace.h below. */
 #define configUSE_IDLE_HOOK                     0
-#define configUSE_TICK_HOOK                     0
+#define configUSE_TICK_HOOK                     DEADLINE_ENABLE
 #define configCHECK_FOR_STACK_OVERFLOW          2
 #define configUSE_MALLOC_FAILED_HOOK            1
 #define configUSE_DAEMON_TASK_STARTUP_HOOK      0
 
-/* Run time and task stats gathering related definitions. */
-#define configGENERATE_RUN_TIME_STATS           0
+/* Run time and task stats gathering related definitions. The run time
+counter is a hardware timer, see sys_stats.c. */
+#define configGENERATE_RUN_TIME_STATS           1
+extern void sys_stats_timer_init(void);
+extern uint32_t sys_stats_timer_read(void);
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS() sys_stats_timer_init()
+#define portGET_RUN_TIME_COUNTER_VALUE()        sys_stats_timer_read()
 #define configUSE_TRACE_FACILITY                1
 #define configUSE_STATS_FORMATTING_FUNCTIONS    0
 
@@ -157,7 +164,7 @@ to exclude the API function. */
 #define INCLUDE_vTaskDelay                      1
 #define INCLUDE_xTaskGetSchedulerState          1
 #define INCLUDE_xTaskGetCurrentTaskHandle       1
-#define INCLUDE_uxTaskGetStackHighWaterMark     0
+#define INCLUDE_uxTaskGetStackHighWaterMark     1
 #define INCLUDE_xTaskGetIdleTaskHandle          0
 #define INCLUDE_eTaskGetState                   0
 #define INCLUDE_xEventGroupSetBitFromISR        1
@@ -231,4 +238,7 @@ extern void vApplicationSleep( uint32_t xExpectedIdleTime );
  */
 #define configUSE_NEWLIB_REENTRANT              1
 
+/* Kernel event trace hooks, see source/trace.c. */
+#include "trace.h"
+
 #endif /* FREERTOS_CONFIG_H */
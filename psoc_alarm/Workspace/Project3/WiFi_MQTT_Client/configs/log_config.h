@@ -0,0 +1,162 @@
+/******************************************************************************
+* File Name: log_config.h
+*
+* Description: This file contains the configuration macros of the deferred
+*              logger (see source/log.c), of the console (source/console.c),
+*              of the heap instrumentation (source/heap_stats.c) and of the
+*              kernel event trace (source/trace.c).
+*
+* Related Document: See README.md
+*
+*******************************************************************************/
+
+#ifndef LOG_CONFIG_H_
+#define LOG_CONFIG_H_
+
+/*******************************************************************************
+* Macros
+********************************************************************************/
+/* Set to 1 to store log records in a ring and print them from the logger
+ * task. Set to 0 to print each record synchronously from the caller, as
+ * printf() did, to compare the callback timings.
+ */
+#define LOG_DEFERRED_ENABLE               (1)
+
+/* Number of records in the ring. A record takes 40 bytes. Records written
+ * while the ring is full are dropped and counted.
+ */
+#define LOG_RING_RECORDS                  (64u)
+
+/* Level of every module at boot, see log_level_t in log.h. Can be changed
+ * per module at runtime with log_set_level() or the LOGLEVEL command.
+ */
+#define LOG_DEFAULT_LEVEL                 (LOG_LEVEL_INFO)
+
+/* Interval of the callback timing report in milliseconds, 0 to disable. */
+#define LOG_TIMING_REPORT_MS              (30000u)
+
+/* Set to 1 to send console output through a TX ring drained by DMA. Output
+ * that does not fit is dropped and counted instead of blocking the caller.
+ * Set to 0 to write each byte synchronously, as retarget-io does.
+ */
+#define CONSOLE_DMA_ENABLE                (1)
+
+/* Size of the console TX ring in bytes, a power of two. */
+#define CONSOLE_TX_BUFFER_SIZE            (4096u)
+
+/* Set to 1 to count the allocations of the FreeRTOS heap and of malloc() per
+ * call site. The allocators are wrapped at link time, so the Makefile sets it
+ * together with the linker flags, in all but Release builds.
+ */
+#ifndef HEAP_STATS_ENABLE
+#define HEAP_STATS_ENABLE                 (0)
+#endif
+
+/* Number of call sites tracked. Allocations from further sites are counted
+ * together.
+ */
+#define HEAP_STATS_MAX_SITES              (32u)
+
+/* Set to 1 for the TLSF heap of source/heap.c in place of heap_3 and the
+ * newlib-nano allocator. heap_3.c must then be left out of the build, so the
+ * Makefile sets it.
+ */
+#ifndef HEAP_TLSF_ENABLE
+#define HEAP_TLSF_ENABLE                  (0)
+#endif
+
+/* Set to 1 to record the first HEAP_TRACE_EVENTS operations of the TLSF heap
+ * for the soak test of the host build, published by the HEAPTRACE command.
+ * An event takes 12 bytes.
+ */
+#ifndef HEAP_TRACE_ENABLE
+#define HEAP_TRACE_ENABLE                 (0)
+#endif
+
+#define HEAP_TRACE_EVENTS                 (2048u)
+
+/* Set to 1 to record task switches, queue operations and interrupts in a
+ * RAM ring with the FreeRTOS trace hooks. Included by FreeRTOSConfig.h.
+ */
+#ifndef TRACE_ENABLE
+#define TRACE_ENABLE                      (1)
+#endif
+
+/* Number of records in the trace ring, a power of two. A record takes 12
+ * bytes.
+ */
+#define TRACE_BUFFER_EVENTS               (512u)
+
+/* A Bluetooth or MQTT callback slower than this, in microseconds, freezes the
+ * trace ring shortly after and prints it on the console. 0 to disable.
+ */
+#define TRACE_TRIGGER_LATENCY_US          (20000u)
+
+/* Set to 1 to record the inputs and the publishes of the state task in a RAM
+ * ring that survives a warm reset, for replay on the host build.
+ */
+#ifndef RECORDER_ENABLE
+#define RECORDER_ENABLE                   (1)
+#endif
+
+/* Size of the recorder ring in bytes, a power of two. A record takes 6 to 30
+ * bytes.
+ */
+#define RECORDER_BUFFER_SIZE              (4096u)
+
+/* Set to 1 for the microbenchmarks of source/bench.c, run by the BENCH
+ * command. The Makefile sets it to 0 in Release builds.
+ */
+#ifndef BENCH_ENABLE
+#define BENCH_ENABLE                      (1)
+#endif
+
+/* Set to 0 to compile the latency probes of source/probe.h out. */
+#ifndef PROBE_ENABLE
+#define PROBE_ENABLE                      (1)
+#endif
+
+/* Set to 0 to compile the deadline monitor of source/deadline.h out. It
+ * checks the pending deadlines from the FreeRTOS tick hook.
+ */
+#ifndef DEADLINE_ENABLE
+#define DEADLINE_ENABLE                   (1)
+#endif
+
+/* Response-time budgets in milliseconds: button press to the LED turned
+ * off, Bluetooth disconnection to the alarm armed, TRIPALARM to the tripped
+ * state published. The last one ends when cy_mqtt_publish() returns in the
+ * publisher task, so it includes the PUBACK round trip to the broker.
+ */
+#define DEADLINE_BUTTON_LED_MS            (50u)
+#define DEADLINE_DISCONNECT_ARMED_MS      (100u)
+#define DEADLINE_TRIP_PUBLISH_MS          (300u)
+
+/* Misses kept with the task running when their deadline expired. */
+#define DEADLINE_MISS_LOG                 (8u)
+
+/* Set to 1 for the stack profile of source/stack_profile.c, run by the
+ * STACKPROFILE command. The profile reconnects the MQTT client, so the
+ * Makefile sets it only for STACK_PROFILE=1 builds, together with the stack
+ * usage output of the compiler.
+ */
+#ifndef STACK_PROFILE_ENABLE
+#define STACK_PROFILE_ENABLE              (0)
+#endif
+
+/* Stacks are sampled every STACK_PROFILE_SAMPLE_MS for STACK_PROFILE_WINDOW_MS
+ * after the reconnection of a profile.
+ */
+#define STACK_PROFILE_WINDOW_MS           (60000u)
+#define STACK_PROFILE_SAMPLE_MS           (1000u)
+
+/* RAM of the board for the statically allocated tasks, queues and buffers
+ * of the application, see source/memory_plan.h. The CY8CPROTO-062-4343W has
+ * 1 MB; the rest holds the library globals and the heap of the Bluetooth
+ * stack, lwIP and the WCM.
+ */
+#ifndef MEMORY_PLAN_RAM_BUDGET
+#define MEMORY_PLAN_RAM_BUDGET            (160u * 1024u)
+#endif
+
+#endif /* LOG_CONFIG_H_ */
@@ -787,6 +787,93 @@
  */
 #undef MBEDTLS_SSL_KEEP_PEER_CERTIFICATE
 
+/**
+ * \def MBEDTLS_PLATFORM_MEMORY
+ *
+ * Enable the memory allocation layer.
+ *
+ * Required by MBEDTLS_MEMORY_BUFFER_ALLOC_C so that mbedtls_calloc() and
+ * mbedtls_free() can be redirected away from the C library heap.
+ */
+#define MBEDTLS_PLATFORM_MEMORY
+
+/**
+ * \def MBEDTLS_MEMORY_BUFFER_ALLOC_C
+ *
+ * Enable the buffer allocator implementation that makes use of a (stack)
+ * based buffer to 'allocate' dynamic memory. (replaces calloc() and free()
+ * calls)
+ *
+ * Module:  library/memory_buffer_alloc.c
+ *
+ * Requires: MBEDTLS_PLATFORM_C
+ *           MBEDTLS_PLATFORM_MEMORY (to use it within mbed TLS)
+ *
+ * All mbed TLS allocations (record buffers, handshake state, certificates,
+ * bignums) are served from the static arena set up by tls_memory_init() so
+ * they never fragment the heap shared with the BT stack and lwIP.
+ *
+ * \note The allocator is not thread-safe without MBEDTLS_THREADING_C, and the
+ * TLS context is used from several tasks. tls_memory.c wraps it in its own
+ * lock instead.
+ */
+#define MBEDTLS_MEMORY_BUFFER_ALLOC_C
+
+/**
+ * \def MBEDTLS_MEMORY_DEBUG
+ *
+ * Enable debugging of buffer allocator memory issues. Automatically prints
+ * (to stderr) all (fatal) messages on memory allocation issues. Enables
+ * function for 'debug output' of allocated memory.
+ *
+ * Requires: MBEDTLS_MEMORY_BUFFER_ALLOC_C
+ *
+ * Needed for the current/peak usage counters reported per connection by
+ * tls_memory_report().
+ */
+#define MBEDTLS_MEMORY_DEBUG
+
+/**
+ * \def MBEDTLS_SSL_IN_CONTENT_LEN
+ *
+ * Maximum length (in bytes) of incoming plaintext fragments.
+ *
+ * Kept at the default of 16384 bytes. The peer may send records of up to
+ * 16 KB unless max_fragment_length is negotiated, and the cy_mqtt port has
+ * no hook for mbedtls_ssl_conf_max_frag_len(): a smaller buffer aborts the
+ * connection on the first larger record, e.g. a longer certificate chain of
+ * the local broker or a large retained message. Reduce it only together
+ * with a record size limit on every broker the board connects to.
+ */
+#define MBEDTLS_SSL_IN_CONTENT_LEN              16384
+
+/**
+ * \def MBEDTLS_SSL_OUT_CONTENT_LEN
+ *
+ * Maximum length (in bytes) of outgoing plaintext fragments.
+ *
+ * The client controls its own record size. The largest records are the
+ * client certificate during the handshake and the MQTT network buffer
+ * (MQTT_NETWORK_BUFFER_SIZE) afterwards; larger writes are split into
+ * several records by mbed TLS.
+ */
+#define MBEDTLS_SSL_OUT_CONTENT_LEN             2048
+
+/**
+ * \def MBEDTLS_PEM_PARSE_C
+ *
+ * Enable PEM decoding / parsing.
+ *
+ * Module:  library/pem.c
+ *
+ * The MQTT credentials are stored DER-encoded (see mqtt_client_config.c) and
+ * no other certificate or key is parsed at runtime, so the PEM decoder is not
+ * needed.
+ *
+ * Comment this macro to enable PEM parsing again.
+ */
+#undef MBEDTLS_PEM_PARSE_C
+
 /**
  * \def MBEDTLS_DEPRECATED_REMOVED
  *
@@ -65,4 +65,47 @@
 /* Wi-Fi re-connection time interval in milliseconds. */
 #define WIFI_CONN_RETRY_INTERVAL_MS       (5000)
 
+/* Fast reconnect cache (see net_cache.c). When enabled, the last AP
+ * (BSSID/channel) and the resolved broker address are kept in flash and used
+ * to skip the scan and the DNS lookup. The DHCP lease is reused on
+ * reconnects within the same boot. Every hint falls back to the slow path
+ * when it fails.
+ */
+#define NET_CACHE_ENABLE                  (1)
+
+/* How long a resolved broker address is trusted before it is looked up
+ * again, in milliseconds.
+ */
+#define NET_CACHE_DNS_TTL_MS              (60u * 60u * 1000u)
+
+/* A cached DHCP lease is only reused while more than this percentage of it
+ * is left. The connection is renewed through DHCP at the same point.
+ */
+#define NET_CACHE_LEASE_MARGIN_PERCENT    (50u)
+
+/* Link monitor (see link_monitor.c). When enabled, RSSI and TX retries of
+ * the association are sampled in the background. A weak link triggers a
+ * scan for the same SSID, and the client roams to a clearly better BSSID
+ * before the link fails. Roaming uses the AP hint of the net cache.
+ */
+#define LINK_MONITOR_ENABLE               (1)
+
+/* Sampling interval of RSSI and TX statistics in milliseconds. */
+#define LINK_MONITOR_INTERVAL_MS          (2000u)
+
+/* The link counts as weak below this averaged RSSI (dBm) or above this
+ * share of retried TX frames (percent).
+ */
+#define LINK_WEAK_RSSI_DBM                (-72)
+#define LINK_WEAK_RETRY_PERCENT           (30u)
+
+/* Minimum time between two scans while the link stays weak. */
+#define LINK_SCAN_INTERVAL_MS             (30000u)
+
+/* A candidate BSSID must beat the current RSSI by this margin (dB). */
+#define LINK_ROAM_HYSTERESIS_DB           (8)
+
+/* No new scan or roam for this long after a roam, in milliseconds. */
+#define LINK_ROAM_HOLDOFF_MS              (60000u)
+
 #endif /* WIFI_CONFIG_H_ */
@@ -0,0 +1,119 @@
+/*
+ * FreeRTOSConfig.h
+ *
+ * Kernel configuration of the host build, on the FreeRTOS POSIX port. It
+ * follows configs/COMPONENT_CM4/FreeRTOSConfig.h so that scheduling matches
+ * the target: same tick rate, priorities and timer task, and static
+ * allocation for the tasks, queues and timers of the application. Tasks are
+ * pthreads, so the stack checks are off and the kernel event trace hooks are
+ * not included.
+ *
+ * The simulation build (HOST_SIM) runs on virtual time: tickless idle jumps
+ * the tick straight to the next timeout, see source/sim.c.
+ */
+
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+#include <stdint.h>
+
+#include "cy_utils.h"
+#include "log_config.h"
+
+#ifndef HOST_SIM
+#define HOST_SIM                                0
+#endif
+
+#define configUSE_PREEMPTION                    1
+#define configUSE_PORT_OPTIMISED_TASK_SELECTION 0
+extern uint32_t SystemCoreClock;
+#define configCPU_CLOCK_HZ                      SystemCoreClock
+#define configTICK_RATE_HZ                      1000u
+#define configMAX_PRIORITIES                    7
+#define configMINIMAL_STACK_SIZE                1024
+#define configMAX_TASK_NAME_LEN                 16
+#define configUSE_16_BIT_TICKS                  0
+#define configIDLE_SHOULD_YIELD                 1
+#define configUSE_TASK_NOTIFICATIONS            1
+#define configUSE_MUTEXES                       1
+#define configUSE_RECURSIVE_MUTEXES             1
+#define configUSE_COUNTING_SEMAPHORES           1
+#define configQUEUE_REGISTRY_SIZE               10
+#define configUSE_QUEUE_SETS                    0
+#define configUSE_TIME_SLICING                  1
+#define configENABLE_BACKWARD_COMPATIBILITY     0
+#define configNUM_THREAD_LOCAL_STORAGE_POINTERS 16
+/* Stack size type of vApplicationGetIdleTaskMemory() in every kernel
+version. */
+#define configSTACK_DEPTH_TYPE                  uint32_t
+
+/* Memory allocation related definitions. heap_3 as on the target, for the
+stand-ins. */
+#define configSUPPORT_STATIC_ALLOCATION         1
+#define configSUPPORT_DYNAMIC_ALLOCATION        1
+#define configTOTAL_HEAP_SIZE                   10240
+#define configAPPLICATION_ALLOCATED_HEAP        0
+
+/* Hook function related definitions. The simulation steps the tick from
+the idle hook, the tick hook checks the deadlines of source/deadline.c. */
+#define configUSE_IDLE_HOOK                     HOST_SIM
+#define configUSE_TICK_HOOK                     DEADLINE_ENABLE
+#define configCHECK_FOR_STACK_OVERFLOW          0
+#define configUSE_MALLOC_FAILED_HOOK            0
+#define configUSE_DAEMON_TASK_STARTUP_HOOK      0
+
+/* Low power support related definitions. In the simulation build the idle
+time is skipped instead of slept. */
+#if HOST_SIM
+#define configUSE_TICKLESS_IDLE                 1
+#define configEXPECTED_IDLE_TIME_BEFORE_SLEEP   2
+extern void sim_sleep(uint32_t expected_idle_ticks);
+#define portSUPPRESS_TICKS_AND_SLEEP( x )       sim_sleep( x )
+#else
+#define configUSE_TICKLESS_IDLE                 0
+#endif
+
+/* Run time and task stats gathering related definitions. The run time
+counter is the stand-in timer of hal_host.c, see sys_stats.c. */
+#define configGENERATE_RUN_TIME_STATS           1
+extern void sys_stats_timer_init(void);
+extern uint32_t sys_stats_timer_read(void);
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS() sys_stats_timer_init()
+#define portGET_RUN_TIME_COUNTER_VALUE()        sys_stats_timer_read()
+#define configUSE_TRACE_FACILITY                1
+#define configUSE_STATS_FORMATTING_FUNCTIONS    0
+
+/* Co-routine related definitions. */
+#define configUSE_CO_ROUTINES                   0
+#define configMAX_CO_ROUTINE_PRIORITIES         2
+
+/* Software timer related definitions. */
+#define configUSE_TIMERS                        1
+#define configTIMER_TASK_PRIORITY               2
+#define configTIMER_QUEUE_LENGTH                10
+#define configTIMER_TASK_STACK_DEPTH            ( configMINIMAL_STACK_SIZE * 2 )
+
+/* Set the following definitions to 1 to include the API function, or zero
+to exclude the API function. */
+#define INCLUDE_vTaskPrioritySet                1
+#define INCLUDE_uxTaskPriorityGet               1
+#define INCLUDE_vTaskDelete                     1
+#define INCLUDE_vTaskSuspend                    1
+#define INCLUDE_xResumeFromISR                  1
+#define INCLUDE_vTaskDelayUntil                 1
+#define INCLUDE_vTaskDelay                      1
+#define INCLUDE_xTaskGetSchedulerState          1
+#define INCLUDE_xTaskGetCurrentTaskHandle       1
+#define INCLUDE_uxTaskGetStackHighWaterMark     1
+#define INCLUDE_xTaskGetIdleTaskHandle          0
+#define INCLUDE_eTaskGetState                   0
+#define INCLUDE_xEventGroupSetBitFromISR        1
+#define INCLUDE_xTimerPendFunctionCall          1
+#define INCLUDE_xTaskAbortDelay                 0
+#define INCLUDE_xTaskGetHandle                  0
+#define INCLUDE_xTaskResumeFromISR              1
+
+/* A failed assertion aborts the process, so that it shows up in CI. */
+#define configASSERT( x ) CY_ASSERT( x )
+
+#endif /* FREERTOS_CONFIG_H */
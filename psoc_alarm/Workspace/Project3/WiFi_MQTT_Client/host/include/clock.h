@@ -0,0 +1,14 @@
+/*
+ * clock.h
+ *
+ * Host stand-in of the clock of the MQTT library port.
+ */
+
+#ifndef HOST_CLOCK_H_
+#define HOST_CLOCK_H_
+
+#include <stdint.h>
+
+uint32_t Clock_GetTimeMs(void);
+
+#endif /* HOST_CLOCK_H_ */
@@ -0,0 +1,147 @@
+/*
+ * cy_mqtt_api.h
+ *
+ * Host stand-in of the MQTT client library, implemented over libmosquitto
+ * in mqtt_host.c. Same API and semantics as the target library: publish
+ * and subscribe return once the broker acknowledged them, and the event
+ * callback runs in the receive task of the library.
+ */
+
+#ifndef HOST_CY_MQTT_API_H_
+#define HOST_CY_MQTT_API_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cy_result.h"
+
+/*******************************************************************************
+ * Macros
+ ******************************************************************************/
+#define CY_MQTT_MIN_NETWORK_BUFFER_SIZE (256u)
+
+#define CY_RSLT_MODULE_MQTT_ERROR ((cy_rslt_t)0x0B000001u)
+#define CY_RSLT_MODULE_MQTT_BADARG ((cy_rslt_t)0x0B000002u)
+#define CY_RSLT_MODULE_MQTT_TIMEOUT ((cy_rslt_t)0x0B000003u)
+#define CY_RSLT_MODULE_MQTT_NOT_CONNECTED ((cy_rslt_t)0x0B000004u)
+
+/*******************************************************************************
+ * Data Types
+ ******************************************************************************/
+typedef void *cy_mqtt_t;
+
+typedef enum {
+  CY_MQTT_QOS0 = 0,
+  CY_MQTT_QOS1 = 1,
+  CY_MQTT_QOS2 = 2,
+  CY_MQTT_QOS_INVALID = 0xFF
+} cy_mqtt_qos_t;
+
+typedef enum {
+  CY_MQTT_EVENT_TYPE_SUBSCRIPTION_MESSAGE_RECEIVE,
+  CY_MQTT_EVENT_TYPE_DISCONNECT
+} cy_mqtt_event_type_t;
+
+typedef enum {
+  CY_MQTT_DISCONN_TYPE_BROKER_DOWN,
+  CY_MQTT_DISCONN_TYPE_NETWORK_DOWN,
+  CY_MQTT_DISCONN_TYPE_BAD_RESPONSE,
+  CY_MQTT_DISCONN_TYPE_SND_RCV_FAIL
+} cy_mqtt_disconn_type_t;
+
+typedef struct {
+  cy_mqtt_qos_t qos;
+  bool retain;
+  bool dup;
+  const char *topic;
+  uint16_t topic_len;
+  const char *payload;
+  size_t payload_len;
+} cy_mqtt_publish_info_t;
+
+typedef struct {
+  cy_mqtt_qos_t qos;
+  const char *topic;
+  uint16_t topic_len;
+  cy_mqtt_qos_t allocated_qos;
+} cy_mqtt_subscribe_info_t;
+
+typedef cy_mqtt_subscribe_info_t cy_mqtt_unsubscribe_info_t;
+
+typedef struct {
+  uint16_t packet_id;
+  cy_mqtt_publish_info_t received_message;
+} cy_mqtt_received_msg_info_t;
+
+typedef struct {
+  cy_mqtt_event_type_t type;
+  union {
+    cy_mqtt_disconn_type_t reason;
+    cy_mqtt_received_msg_info_t pub_msg;
+  } data;
+} cy_mqtt_event_t;
+
+typedef struct {
+  const char *hostname;
+  uint16_t hostname_len;
+  uint16_t port;
+} cy_mqtt_broker_info_t;
+
+typedef struct {
+  const char *client_id;
+  uint16_t client_id_len;
+  const char *username;
+  uint16_t username_len;
+  const char *password;
+  uint16_t password_len;
+  bool clean_session;
+  uint16_t keep_alive_sec;
+  cy_mqtt_publish_info_t *will_info;
+} cy_mqtt_connect_info_t;
+
+/* TLS credentials, unused by the host build. */
+typedef struct {
+  const char *client_cert;
+  uint32_t client_cert_size;
+  const char *private_key;
+  uint32_t private_key_size;
+  const char *root_ca;
+  uint32_t root_ca_size;
+  const char *username;
+  uint32_t username_size;
+  const char *password;
+  uint32_t password_size;
+  const char *alpnprotos;
+  uint32_t alpnprotoslen;
+  const char *sni_host_name;
+  uint32_t sni_host_name_size;
+} cy_awsport_ssl_credentials_t;
+
+typedef void (*cy_mqtt_callback_t)(cy_mqtt_t mqtt_handle, cy_mqtt_event_t event,
+                                   void *user_data);
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+cy_rslt_t cy_mqtt_init(void);
+cy_rslt_t cy_mqtt_create(uint8_t *buffer, uint32_t buff_len,
+                         cy_awsport_ssl_credentials_t *security,
+                         cy_mqtt_broker_info_t *broker_info,
+                         cy_mqtt_callback_t event_callback, void *user_data,
+                         cy_mqtt_t *mqtt_handle);
+cy_rslt_t cy_mqtt_connect(cy_mqtt_t mqtt_handle,
+                          cy_mqtt_connect_info_t *connect_info);
+cy_rslt_t cy_mqtt_publish(cy_mqtt_t mqtt_handle,
+                          cy_mqtt_publish_info_t *pub_msg);
+cy_rslt_t cy_mqtt_subscribe(cy_mqtt_t mqtt_handle,
+                            cy_mqtt_subscribe_info_t *sub_info,
+                            uint8_t sub_count);
+cy_rslt_t cy_mqtt_unsubscribe(cy_mqtt_t mqtt_handle,
+                              cy_mqtt_unsubscribe_info_t *unsub_info,
+                              uint8_t unsub_count);
+cy_rslt_t cy_mqtt_disconnect(cy_mqtt_t mqtt_handle);
+cy_rslt_t cy_mqtt_delete(cy_mqtt_t mqtt_handle);
+cy_rslt_t cy_mqtt_deinit(void);
+
+#endif /* HOST_CY_MQTT_API_H_ */
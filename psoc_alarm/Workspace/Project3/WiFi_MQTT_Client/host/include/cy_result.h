@@ -0,0 +1,18 @@
+/*
+ * cy_result.h
+ *
+ * Host stand-in of the Cypress result codes.
+ */
+
+#ifndef HOST_CY_RESULT_H_
+#define HOST_CY_RESULT_H_
+
+#include <stdint.h>
+
+typedef uint32_t cy_rslt_t;
+
+#define CY_RSLT_SUCCESS ((cy_rslt_t)0x00000000u)
+#define CY_RSLT_TYPE_WARNING ((cy_rslt_t)0x00010000u)
+#define CY_RSLT_TYPE_ERROR ((cy_rslt_t)0x00020000u)
+
+#endif /* HOST_CY_RESULT_H_ */
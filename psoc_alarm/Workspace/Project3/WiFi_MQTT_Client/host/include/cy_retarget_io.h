@@ -0,0 +1,12 @@
+/*
+ * cy_retarget_io.h
+ *
+ * Host stand-in of retarget-io: printf() goes to stdout.
+ */
+
+#ifndef HOST_CY_RETARGET_IO_H_
+#define HOST_CY_RETARGET_IO_H_
+
+#include <stdio.h>
+
+#endif /* HOST_CY_RETARGET_IO_H_ */
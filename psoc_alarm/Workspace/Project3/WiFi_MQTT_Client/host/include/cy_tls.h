@@ -0,0 +1,19 @@
+/*
+ * cy_tls.h
+ *
+ * Host stand-in of the TLS library. The host build connects to the broker
+ * without TLS (MQTT_SECURE_CONNECTION 0).
+ */
+
+#ifndef HOST_CY_TLS_H_
+#define HOST_CY_TLS_H_
+
+#include <stdint.h>
+
+#include "cy_result.h"
+
+cy_rslt_t cy_tls_load_global_root_ca_certificates(const char *trusted_ca_certs,
+                                                  const uint32_t cert_length);
+cy_rslt_t cy_tls_release_global_root_ca_certificates(void);
+
+#endif /* HOST_CY_TLS_H_ */
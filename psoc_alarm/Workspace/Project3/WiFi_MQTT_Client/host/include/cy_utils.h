@@ -0,0 +1,34 @@
+/*
+ * cy_utils.h
+ *
+ * Host stand-in of the Cypress utility macros.
+ */
+
+#ifndef HOST_CY_UTILS_H_
+#define HOST_CY_UTILS_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cy_result.h"
+
+#define CY_UNUSED_PARAMETER(x) ((void)(x))
+
+#define CY_SECTION(name) __attribute__((section(name)))
+
+/* Memory of the host does not survive a reset. */
+#define CY_NOINIT
+
+#define CY_HALT() abort()
+
+#define CY_ASSERT(x)                                                           \
+  do {                                                                         \
+    if (!(x)) {                                                                \
+      fprintf(stderr, "%s:%d: assertion '%s' failed\n", __FILE__, __LINE__,    \
+              #x);                                                             \
+      abort();                                                                 \
+    }                                                                          \
+  } while (0)
+
+#endif /* HOST_CY_UTILS_H_ */
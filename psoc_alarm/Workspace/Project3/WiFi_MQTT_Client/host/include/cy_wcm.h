@@ -0,0 +1,154 @@
+/*
+ * cy_wcm.h
+ *
+ * Host stand-in of the Wi-Fi Connection Manager. The host joins one strong
+ * access point right away, so the link monitor never roams.
+ */
+
+#ifndef HOST_CY_WCM_H_
+#define HOST_CY_WCM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cy_result.h"
+
+/*******************************************************************************
+ * Macros
+ ******************************************************************************/
+#define CY_WCM_MAX_SSID_LEN (32u)
+#define CY_WCM_MAX_PASSPHRASE_LEN (63u)
+
+#define CY_RSLT_WCM_ERROR ((cy_rslt_t)0x04020001u)
+#define CY_RSLT_WCM_NOT_CONNECTED ((cy_rslt_t)0x04020002u)
+
+/*******************************************************************************
+ * Data Types
+ ******************************************************************************/
+typedef uint8_t cy_wcm_mac_t[6];
+typedef uint8_t cy_wcm_ssid_t[CY_WCM_MAX_SSID_LEN + 1];
+typedef uint8_t cy_wcm_passphrase_t[CY_WCM_MAX_PASSPHRASE_LEN + 1];
+
+typedef enum {
+  CY_WCM_INTERFACE_TYPE_STA,
+  CY_WCM_INTERFACE_TYPE_AP,
+  CY_WCM_INTERFACE_TYPE_AP_STA
+} cy_wcm_interface_t;
+
+typedef enum {
+  CY_WCM_SECURITY_OPEN,
+  CY_WCM_SECURITY_WPA2_AES_PSK,
+  CY_WCM_SECURITY_WPA3_SAE,
+  CY_WCM_SECURITY_UNKNOWN
+} cy_wcm_security_t;
+
+typedef enum {
+  CY_WCM_WIFI_BAND_ANY,
+  CY_WCM_WIFI_BAND_5GHZ,
+  CY_WCM_WIFI_BAND_2_4GHZ
+} cy_wcm_wifi_band_t;
+
+typedef enum { CY_WCM_IP_VER_V4 = 4, CY_WCM_IP_VER_V6 = 6 } cy_wcm_ip_version_t;
+
+typedef struct {
+  cy_wcm_interface_t interface;
+} cy_wcm_config_t;
+
+typedef struct {
+  cy_wcm_ip_version_t version;
+  union {
+    uint32_t v4;
+    uint32_t v6[4];
+  } ip;
+} cy_wcm_ip_address_t;
+
+typedef struct {
+  cy_wcm_ip_address_t ip_address;
+  cy_wcm_ip_address_t gateway;
+  cy_wcm_ip_address_t netmask;
+} cy_wcm_ip_setting_t;
+
+typedef struct {
+  cy_wcm_ssid_t SSID;
+  cy_wcm_passphrase_t password;
+  cy_wcm_security_t security;
+} cy_wcm_ap_credentials_t;
+
+typedef struct {
+  cy_wcm_ap_credentials_t ap_credentials;
+  cy_wcm_mac_t BSSID;
+  cy_wcm_ip_setting_t *static_ip_settings;
+  cy_wcm_wifi_band_t band;
+  uint8_t channel;
+} cy_wcm_connect_params_t;
+
+typedef struct {
+  cy_wcm_ssid_t SSID;
+  cy_wcm_mac_t BSSID;
+  int16_t signal_strength;
+  uint8_t channel;
+  uint16_t channel_width;
+  cy_wcm_security_t security;
+} cy_wcm_associated_ap_info_t;
+
+typedef struct {
+  uint32_t rx_bytes;
+  uint32_t tx_bytes;
+  uint32_t rx_packets;
+  uint32_t tx_packets;
+  uint32_t tx_failed;
+  uint32_t tx_retries;
+  uint32_t tx_total_retries;
+} cy_wcm_wlan_statistics_t;
+
+typedef enum {
+  CY_WCM_SCAN_FILTER_TYPE_SSID,
+  CY_WCM_SCAN_FILTER_TYPE_MAC,
+  CY_WCM_SCAN_FILTER_TYPE_BAND,
+  CY_WCM_SCAN_FILTER_TYPE_RSSI
+} cy_wcm_scan_filter_type_t;
+
+typedef struct {
+  cy_wcm_scan_filter_type_t mode;
+  union {
+    cy_wcm_ssid_t SSID;
+    cy_wcm_mac_t BSSID;
+    cy_wcm_wifi_band_t band;
+  } param;
+} cy_wcm_scan_filter_t;
+
+typedef struct {
+  cy_wcm_ssid_t SSID;
+  cy_wcm_mac_t BSSID;
+  int16_t signal_strength;
+  uint8_t channel;
+  cy_wcm_security_t security;
+} cy_wcm_scan_result_t;
+
+typedef enum {
+  CY_WCM_SCAN_INCOMPLETE,
+  CY_WCM_SCAN_COMPLETE
+} cy_wcm_scan_status_t;
+
+typedef void (*cy_wcm_scan_result_callback_t)(cy_wcm_scan_result_t *result_ptr,
+                                              void *user_data,
+                                              cy_wcm_scan_status_t status);
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+cy_rslt_t cy_wcm_init(cy_wcm_config_t *config);
+cy_rslt_t cy_wcm_deinit(void);
+cy_rslt_t cy_wcm_connect_ap(cy_wcm_connect_params_t *connect_params,
+                            cy_wcm_ip_address_t *ip_addr);
+cy_rslt_t cy_wcm_disconnect_ap(void);
+uint8_t cy_wcm_is_connected_to_ap(void);
+cy_rslt_t cy_wcm_get_associated_ap_info(cy_wcm_associated_ap_info_t *ap_info);
+cy_rslt_t cy_wcm_get_wlan_statistics(cy_wcm_interface_t interface,
+                                     cy_wcm_wlan_statistics_t *stat);
+cy_rslt_t cy_wcm_start_scan(cy_wcm_scan_result_callback_t callback,
+                            void *user_data,
+                            cy_wcm_scan_filter_t *scan_filter);
+cy_rslt_t cy_wcm_stop_scan(void);
+
+#endif /* HOST_CY_WCM_H_ */
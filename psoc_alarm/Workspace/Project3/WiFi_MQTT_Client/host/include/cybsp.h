@@ -0,0 +1,13 @@
+/*
+ * cybsp.h
+ *
+ * Host stand-in of the board support package of the CY8CPROTO-062-4343W.
+ */
+
+#ifndef HOST_CYBSP_H_
+#define HOST_CYBSP_H_
+
+#include "cybsp_types.h"
+#include "cyhal.h"
+
+#endif /* HOST_CYBSP_H_ */
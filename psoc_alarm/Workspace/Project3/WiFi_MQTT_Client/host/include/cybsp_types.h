@@ -0,0 +1,25 @@
+/*
+ * cybsp_types.h
+ *
+ * Host stand-in of the pins of the board, numbered in the GPIO table of
+ * hal_host.c. Like the board header it pulls in the HAL, and with it the C
+ * library headers the application relies on.
+ */
+
+#ifndef HOST_CYBSP_TYPES_H_
+#define HOST_CYBSP_TYPES_H_
+
+#include "cyhal.h"
+
+#define CYBSP_USER_LED (0u)
+#define CYBSP_USER_BTN (1u)
+
+#define CYBSP_LED_STATE_ON (0u)
+#define CYBSP_LED_STATE_OFF (1u)
+
+#define CYBSP_BTN_PRESSED (0u)
+#define CYBSP_BTN_OFF (1u)
+
+#define CYBSP_USER_BTN_DRIVE CYHAL_GPIO_DRIVE_PULLUP
+
+#endif /* HOST_CYBSP_TYPES_H_ */
@@ -0,0 +1,10 @@
+/*
+ * cybt_platform_trace.h
+ *
+ * Host stand-in, nothing of it is used by the application.
+ */
+
+#ifndef HOST_CYBT_PLATFORM_TRACE_H_
+#define HOST_CYBT_PLATFORM_TRACE_H_
+
+#endif /* HOST_CYBT_PLATFORM_TRACE_H_ */
@@ -0,0 +1,120 @@
+/*
+ * cyhal.h
+ *
+ * Host stand-in of the HAL: GPIOs, timer and critical sections used by the
+ * application. Button presses are injected with host_gpio_event(), see
+ * host.h.
+ */
+
+#ifndef HOST_CYHAL_H_
+#define HOST_CYHAL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cy_result.h"
+#include "cy_utils.h"
+
+/*******************************************************************************
+ * Macros
+ ******************************************************************************/
+#define NC ((cyhal_gpio_t)0xFFFFFFFFu)
+
+/* Pins of the host board, see cybsp.h. */
+#define HOST_GPIO_COUNT (8u)
+
+/*******************************************************************************
+ * Data Types
+ ******************************************************************************/
+typedef uint32_t cyhal_gpio_t;
+
+typedef enum {
+  CYHAL_GPIO_DIR_INPUT,
+  CYHAL_GPIO_DIR_OUTPUT,
+  CYHAL_GPIO_DIR_BIDIRECTIONAL
+} cyhal_gpio_direction_t;
+
+typedef enum {
+  CYHAL_GPIO_DRIVE_NONE,
+  CYHAL_GPIO_DRIVE_ANALOG,
+  CYHAL_GPIO_DRIVE_PULLUP,
+  CYHAL_GPIO_DRIVE_PULLDOWN,
+  CYHAL_GPIO_DRIVE_OPENDRAINDRIVESLOW,
+  CYHAL_GPIO_DRIVE_OPENDRAINDRIVESHIGH,
+  CYHAL_GPIO_DRIVE_STRONG,
+  CYHAL_GPIO_DRIVE_PULLUPDOWN
+} cyhal_gpio_drive_mode_t;
+
+typedef enum {
+  CYHAL_GPIO_IRQ_NONE = 0,
+  CYHAL_GPIO_IRQ_RISE = 1,
+  CYHAL_GPIO_IRQ_FALL = 2,
+  CYHAL_GPIO_IRQ_BOTH = 3
+} cyhal_gpio_event_t;
+
+typedef void (*cyhal_gpio_event_callback_t)(void *callback_arg,
+                                            cyhal_gpio_event_t event);
+
+typedef struct cyhal_gpio_callback_data_s {
+  cyhal_gpio_event_callback_t callback;
+  void *callback_arg;
+  struct cyhal_gpio_callback_data_s *next;
+  cyhal_gpio_t pin;
+} cyhal_gpio_callback_data_t;
+
+typedef struct cyhal_clock_s cyhal_clock_t;
+
+typedef enum {
+  CYHAL_TIMER_DIR_UP,
+  CYHAL_TIMER_DIR_DOWN,
+  CYHAL_TIMER_DIR_UP_DOWN
+} cyhal_timer_direction_t;
+
+typedef struct {
+  bool is_continuous;
+  cyhal_timer_direction_t direction;
+  bool is_compare;
+  uint32_t period;
+  uint32_t compare_value;
+  uint32_t value;
+} cyhal_timer_cfg_t;
+
+/* Counts the monotonic clock of the host at the configured frequency. */
+typedef struct {
+  uint32_t frequency_hz;
+  uint64_t start_ns;
+  bool running;
+} cyhal_timer_t;
+
+/*******************************************************************************
+ * Global Variables
+ ******************************************************************************/
+/* 1 MHz on the host, so the cycle to microsecond conversions of log.c do not
+ * divide by zero. */
+extern uint32_t SystemCoreClock;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+uint32_t cyhal_system_critical_section_enter(void);
+void cyhal_system_critical_section_exit(uint32_t old_state);
+
+cy_rslt_t cyhal_gpio_init(cyhal_gpio_t pin, cyhal_gpio_direction_t direction,
+                          cyhal_gpio_drive_mode_t drive_mode, bool init_val);
+void cyhal_gpio_free(cyhal_gpio_t pin);
+void cyhal_gpio_write(cyhal_gpio_t pin, bool value);
+bool cyhal_gpio_read(cyhal_gpio_t pin);
+void cyhal_gpio_register_callback(cyhal_gpio_t pin,
+                                  cyhal_gpio_callback_data_t *callback_data);
+void cyhal_gpio_enable_event(cyhal_gpio_t pin, cyhal_gpio_event_t event,
+                             uint8_t intr_priority, bool enable);
+
+cy_rslt_t cyhal_timer_init(cyhal_timer_t *obj, cyhal_gpio_t pin,
+                           const cyhal_clock_t *clk);
+cy_rslt_t cyhal_timer_configure(cyhal_timer_t *obj,
+                                const cyhal_timer_cfg_t *cfg);
+cy_rslt_t cyhal_timer_set_frequency(cyhal_timer_t *obj, uint32_t hz);
+cy_rslt_t cyhal_timer_start(cyhal_timer_t *obj);
+uint32_t cyhal_timer_read(const cyhal_timer_t *obj);
+
+#endif /* HOST_CYHAL_H_ */
@@ -0,0 +1,44 @@
+/*
+ * host.h
+ *
+ * Event injection into the host build. The scenarios of scenario.c drive the
+ * application through these calls only, the way the radio, the button and
+ * the broker drive it on the board.
+ */
+
+#ifndef HOST_HOST_H_
+#define HOST_HOST_H_
+
+#include <stdint.h>
+
+#include "cy_mqtt_api.h"
+#include "cyhal.h"
+#include "wiced_bt_dev.h"
+#include "wiced_bt_gatt.h"
+
+/*******************************************************************************
+ * Data Types
+ ******************************************************************************/
+/* Called after every acknowledged publish of the application. */
+typedef void (*host_publish_hook_t)(const cy_mqtt_publish_info_t *info);
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+/* Monotonic time, for latencies. */
+uint64_t host_time_us(void);
+
+/* Runs the registered GPIO callback, with interrupts masked as in an ISR. */
+void host_gpio_event(cyhal_gpio_t pin, cyhal_gpio_event_t event);
+
+/* Calls the callbacks registered with the Bluetooth stack stand-in. */
+wiced_result_t host_bt_management_event(wiced_bt_management_evt_t event,
+                                        wiced_bt_management_evt_data_t *data);
+wiced_bt_gatt_status_t host_bt_gatt_event(wiced_bt_gatt_evt_t event,
+                                          wiced_bt_gatt_event_data_t *data);
+
+/* Publish hook, and commands sent through the broker like a remote client. */
+void host_mqtt_set_publish_hook(host_publish_hook_t hook);
+cy_rslt_t host_mqtt_publish_command(const char *topic, const char *payload);
+
+#endif /* HOST_HOST_H_ */
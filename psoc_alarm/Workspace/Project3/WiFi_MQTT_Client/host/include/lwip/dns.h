@@ -0,0 +1,21 @@
+/*
+ * lwip/dns.h
+ *
+ * Host stand-in of the lwIP resolver, for the failback probe of the
+ * secondary broker. The host build has a single broker, so the probe never
+ * runs and every lookup fails.
+ */
+
+#ifndef HOST_LWIP_DNS_H_
+#define HOST_LWIP_DNS_H_
+
+#include "lwip/err.h"
+#include "lwip/ip_addr.h"
+
+typedef void (*dns_found_callback)(const char *name, const ip_addr_t *ipaddr,
+                                   void *callback_arg);
+
+err_t dns_gethostbyname(const char *hostname, ip_addr_t *addr,
+                        dns_found_callback found, void *callback_arg);
+
+#endif /* HOST_LWIP_DNS_H_ */
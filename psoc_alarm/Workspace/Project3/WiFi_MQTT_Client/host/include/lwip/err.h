@@ -0,0 +1,19 @@
+/*
+ * lwip/err.h
+ *
+ * Host stand-in of the lwIP error codes used by the failback probe.
+ */
+
+#ifndef HOST_LWIP_ERR_H_
+#define HOST_LWIP_ERR_H_
+
+#include <stdint.h>
+
+typedef int8_t err_t;
+
+#define ERR_OK (0)
+#define ERR_INPROGRESS (-5)
+#define ERR_ARG (-16)
+#define ERR_ABRT (-13)
+
+#endif /* HOST_LWIP_ERR_H_ */
@@ -0,0 +1,16 @@
+/*
+ * lwip/ip_addr.h
+ *
+ * Host stand-in of the lwIP address type used by the failback probe.
+ */
+
+#ifndef HOST_LWIP_IP_ADDR_H_
+#define HOST_LWIP_IP_ADDR_H_
+
+#include <stdint.h>
+
+typedef struct {
+  uint32_t addr;
+} ip_addr_t;
+
+#endif /* HOST_LWIP_IP_ADDR_H_ */
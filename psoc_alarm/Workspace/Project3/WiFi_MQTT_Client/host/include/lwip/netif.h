@@ -0,0 +1,23 @@
+/*
+ * lwip/netif.h
+ *
+ * Host stand-in of the lwIP address helpers used to print the IP address.
+ */
+
+#ifndef HOST_LWIP_NETIF_H_
+#define HOST_LWIP_NETIF_H_
+
+#include <stdint.h>
+
+typedef struct {
+  uint32_t addr;
+} ip4_addr_t;
+
+typedef struct {
+  uint32_t addr[4];
+} ip6_addr_t;
+
+char *ip4addr_ntoa(const ip4_addr_t *addr);
+char *ip6addr_ntoa(const ip6_addr_t *addr);
+
+#endif /* HOST_LWIP_NETIF_H_ */
@@ -0,0 +1,29 @@
+/*
+ * lwip/tcp.h
+ *
+ * Host stand-in of the lwIP raw TCP API used by the failback probe, see
+ * lwip/dns.h.
+ */
+
+#ifndef HOST_LWIP_TCP_H_
+#define HOST_LWIP_TCP_H_
+
+#include <stdint.h>
+
+#include "lwip/err.h"
+#include "lwip/ip_addr.h"
+
+struct tcp_pcb;
+
+typedef err_t (*tcp_connected_fn)(void *arg, struct tcp_pcb *tpcb, err_t err);
+typedef void (*tcp_err_fn)(void *arg, err_t err);
+
+struct tcp_pcb *tcp_new(void);
+void tcp_arg(struct tcp_pcb *pcb, void *arg);
+void tcp_err(struct tcp_pcb *pcb, tcp_err_fn err);
+err_t tcp_connect(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, uint16_t port,
+                  tcp_connected_fn connected);
+err_t tcp_close(struct tcp_pcb *pcb);
+void tcp_abort(struct tcp_pcb *pcb);
+
+#endif /* HOST_LWIP_TCP_H_ */
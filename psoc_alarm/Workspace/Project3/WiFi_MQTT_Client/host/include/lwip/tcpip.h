@@ -0,0 +1,17 @@
+/*
+ * lwip/tcpip.h
+ *
+ * Host stand-in of the lwIP thread. There is none on the host: a callback
+ * runs at once, in the calling task.
+ */
+
+#ifndef HOST_LWIP_TCPIP_H_
+#define HOST_LWIP_TCPIP_H_
+
+#include "lwip/err.h"
+
+typedef void (*tcpip_callback_fn)(void *ctx);
+
+err_t tcpip_callback(tcpip_callback_fn function, void *ctx);
+
+#endif /* HOST_LWIP_TCPIP_H_ */
@@ -0,0 +1,43 @@
+/*
+ * wiced_bt_ble.h
+ *
+ * Host stand-in of the LE advertising and security API of the Bluetooth
+ * stack.
+ */
+
+#ifndef HOST_WICED_BT_BLE_H_
+#define HOST_WICED_BT_BLE_H_
+
+#include "wiced_bt_types.h"
+
+typedef enum {
+  BTM_BLE_ADVERT_OFF,
+  BTM_BLE_ADVERT_DIRECTED_HIGH,
+  BTM_BLE_ADVERT_DIRECTED_LOW,
+  BTM_BLE_ADVERT_UNDIRECTED_HIGH,
+  BTM_BLE_ADVERT_UNDIRECTED_LOW,
+  BTM_BLE_ADVERT_NONCONN_HIGH,
+  BTM_BLE_ADVERT_NONCONN_LOW,
+  BTM_BLE_ADVERT_DISCOVERABLE_HIGH,
+  BTM_BLE_ADVERT_DISCOVERABLE_LOW
+} wiced_bt_ble_advert_mode_t;
+
+typedef uint8_t wiced_bt_ble_privacy_mode_t;
+
+typedef struct {
+  uint8_t *p_data;
+  uint16_t len;
+  uint8_t advert_type;
+} wiced_bt_ble_advert_elem_t;
+
+wiced_result_t
+wiced_bt_ble_set_raw_advertisement_data(uint8_t num_elem,
+                                        wiced_bt_ble_advert_elem_t *p_data);
+wiced_result_t wiced_bt_start_advertisements(
+    wiced_bt_ble_advert_mode_t advert_mode,
+    wiced_bt_ble_address_type_t directed_advertisement_bdaddr_type,
+    wiced_bt_device_address_ptr_t directed_advertisement_bdaddr_ptr);
+void wiced_bt_ble_security_grant(wiced_bt_device_address_t bd_addr,
+                                 uint8_t res);
+
+#endif /* HOST_WICED_BT_BLE_H_ */
@@ -0,0 +1,168 @@
+/*
+ * wiced_bt_dev.h
+ *
+ * Host stand-in of the management events of the Bluetooth stack. Only the
+ * members read by bt.c are declared. Events are injected with
+ * host_bt_management_event(), see host.h.
+ */
+
+#ifndef HOST_WICED_BT_DEV_H_
+#define HOST_WICED_BT_DEV_H_
+
+#include "wiced_bt_ble.h"
+#include "wiced_bt_types.h"
+
+/*******************************************************************************
+ * Macros
+ ******************************************************************************/
+#define BTM_IO_CAPABILITIES_DISPLAY_AND_YES_NO_INPUT (1u)
+#define BTM_LE_AUTH_REQ_SC_MITM_BOND (0x0Du)
+#define BTM_LE_KEY_PENC (1u << 0)
+#define BTM_LE_KEY_PID (1u << 1)
+
+/*******************************************************************************
+ * Data Types
+ ******************************************************************************/
+typedef wiced_result_t wiced_bt_dev_status_t;
+
+typedef enum {
+  BTM_ENABLED_EVT,
+  BTM_DISABLED_EVT,
+  BTM_POWER_MANAGEMENT_STATUS_EVT,
+  BTM_PIN_REQUEST_EVT,
+  BTM_USER_CONFIRMATION_REQUEST_EVT,
+  BTM_PASSKEY_NOTIFICATION_EVT,
+  BTM_PASSKEY_REQUEST_EVT,
+  BTM_KEYPRESS_NOTIFICATION_EVT,
+  BTM_PAIRING_IO_CAPABILITIES_BR_EDR_REQUEST_EVT,
+  BTM_PAIRING_IO_CAPABILITIES_BR_EDR_RESPONSE_EVT,
+  BTM_PAIRING_IO_CAPABILITIES_BLE_REQUEST_EVT,
+  BTM_PAIRING_COMPLETE_EVT,
+  BTM_ENCRYPTION_STATUS_EVT,
+  BTM_SECURITY_REQUEST_EVT,
+  BTM_SECURITY_FAILED_EVT,
+  BTM_SECURITY_ABORTED_EVT,
+  BTM_READ_LOCAL_OOB_DATA_COMPLETE_EVT,
+  BTM_REMOTE_OOB_DATA_REQUEST_EVT,
+  BTM_PAIRED_DEVICE_LINK_KEYS_UPDATE_EVT,
+  BTM_PAIRED_DEVICE_LINK_KEYS_REQUEST_EVT,
+  BTM_LOCAL_IDENTITY_KEYS_UPDATE_EVT,
+  BTM_LOCAL_IDENTITY_KEYS_REQUEST_EVT,
+  BTM_BLE_SCAN_STATE_CHANGED_EVT,
+  BTM_BLE_ADVERT_STATE_CHANGED_EVT,
+  BTM_SMP_REMOTE_OOB_DATA_REQUEST_EVT,
+  BTM_SMP_SC_REMOTE_OOB_DATA_REQUEST_EVT,
+  BTM_SMP_SC_LOCAL_OOB_DATA_NOTIFICATION_EVT,
+  BTM_SCO_CONNECTED_EVT,
+  BTM_SCO_DISCONNECTED_EVT,
+  BTM_SCO_CONNECTION_REQUEST_EVT,
+  BTM_SCO_CONNECTION_CHANGE_EVT,
+  BTM_BLE_CONNECTION_PARAM_UPDATE,
+  BTM_BLE_PHY_UPDATE_EVT,
+  BTM_LPM_STATE_LOW_POWER,
+  BTM_MULTI_ADVERT_RESP_EVENT,
+  BTM_BLE_DATA_LENGTH_UPDATE_EVENT
+} wiced_bt_management_evt_t;
+
+typedef uint8_t wiced_bt_smp_status_t;
+
+typedef struct {
+  wiced_result_t status;
+} wiced_bt_dev_enabled_t;
+
+typedef struct {
+  wiced_bt_device_address_t bd_addr;
+  uint32_t passkey;
+} wiced_bt_dev_user_key_notif_t;
+
+typedef struct {
+  wiced_bt_device_address_t bd_addr;
+} wiced_bt_dev_security_request_t;
+
+typedef struct {
+  wiced_bt_device_address_t bd_addr;
+  uint8_t local_io_cap;
+  uint8_t oob_data;
+  uint8_t auth_req;
+  uint8_t max_key_size;
+  uint8_t init_keys;
+  uint8_t resp_keys;
+} wiced_bt_dev_ble_io_caps_req_t;
+
+typedef struct {
+  wiced_bt_device_address_t bd_addr;
+  uint8_t status;
+  uint16_t conn_interval;
+  uint16_t conn_latency;
+  uint16_t supervision_timeout;
+} wiced_bt_ble_connection_param_update_t;
+
+typedef struct {
+  uint8_t status;
+  wiced_bt_smp_status_t reason;
+  uint8_t sec_level;
+  wiced_bool_t is_pair_cancel;
+  wiced_bt_device_address_t resolved_bd_addr;
+  wiced_bt_ble_address_type_t resolved_bd_addr_type;
+} wiced_bt_dev_ble_pairing_info_t;
+
+typedef struct {
+  wiced_bt_device_address_t bd_addr;
+  wiced_bt_transport_t transport;
+  union {
+    wiced_bt_dev_ble_pairing_info_t ble;
+  } pairing_complete_info;
+} wiced_bt_dev_pairing_cplt_t;
+
+typedef struct {
+  wiced_bt_device_address_t bd_addr;
+  wiced_bt_transport_t transport;
+  void *p_ref_data;
+  wiced_result_t result;
+} wiced_bt_dev_encryption_status_t;
+
+typedef struct {
+  uint8_t irk[16];
+  uint8_t ltk[16];
+  uint8_t ble_addr_type;
+} wiced_bt_device_sec_keys_t;
+
+typedef struct {
+  wiced_bt_device_address_t bd_addr;
+  wiced_bt_device_address_t conn_addr;
+  wiced_bt_device_sec_keys_t key_data;
+} wiced_bt_device_link_keys_t;
+
+typedef struct {
+  uint8_t local_key_data[80];
+} wiced_bt_local_identity_keys_t;
+
+typedef union {
+  wiced_bt_dev_enabled_t enabled;
+  wiced_bt_dev_user_key_notif_t user_passkey_notification;
+  wiced_bt_dev_security_request_t security_request;
+  wiced_bt_dev_ble_io_caps_req_t pairing_io_capabilities_ble_request;
+  wiced_bt_ble_connection_param_update_t ble_connection_param_update;
+  wiced_bt_dev_pairing_cplt_t pairing_complete;
+  wiced_bt_dev_encryption_status_t encryption_status;
+  wiced_bt_device_link_keys_t paired_device_link_keys_update;
+  wiced_bt_device_link_keys_t paired_device_link_keys_request;
+  wiced_bt_local_identity_keys_t local_identity_keys_update;
+  wiced_bt_local_identity_keys_t local_identity_keys_request;
+  wiced_bt_ble_advert_mode_t ble_advert_state_changed;
+} wiced_bt_management_evt_data_t;
+
+typedef wiced_result_t(wiced_bt_management_cback_t)(
+    wiced_bt_management_evt_t event,
+    wiced_bt_management_evt_data_t *p_event_data);
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+void wiced_bt_set_pairable_mode(uint8_t allow_pairing,
+                                uint8_t connect_only_paired);
+void wiced_bt_dev_read_local_addr(wiced_bt_device_address_t bd_addr);
+void wiced_bt_dev_confirm_req_reply(wiced_result_t res_code,
+                                    wiced_bt_device_address_t bd_addr);
+
+#endif /* HOST_WICED_BT_DEV_H_ */
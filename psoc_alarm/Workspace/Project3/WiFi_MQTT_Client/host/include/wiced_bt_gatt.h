@@ -0,0 +1,66 @@
+/*
+ * wiced_bt_gatt.h
+ *
+ * Host stand-in of the GATT server API of the Bluetooth stack. Connection
+ * events are injected with host_bt_gatt_event(), see host.h.
+ */
+
+#ifndef HOST_WICED_BT_GATT_H_
+#define HOST_WICED_BT_GATT_H_
+
+#include "wiced_bt_types.h"
+
+typedef enum {
+  WICED_BT_GATT_SUCCESS = 0x00,
+  WICED_BT_GATT_INVALID_HANDLE = 0x01,
+  WICED_BT_GATT_INSUF_AUTHENTICATION = 0x05,
+  WICED_BT_GATT_INSUF_RESOURCE = 0x11,
+  WICED_BT_GATT_ERROR = 0x85
+} wiced_bt_gatt_status_t;
+
+typedef enum {
+  GATT_CONNECTION_STATUS_EVT,
+  GATT_OPERATION_CPLT_EVT,
+  GATT_DISCOVERY_RESULT_EVT,
+  GATT_DISCOVERY_CPLT_EVT,
+  GATT_ATTRIBUTE_REQUEST_EVT,
+  GATT_CONGESTION_EVT
+} wiced_bt_gatt_evt_t;
+
+typedef enum {
+  GATT_CONN_UNKNOWN = 0,
+  GATT_CONN_L2C_FAILURE = 1,
+  GATT_CONN_TIMEOUT = 0x08,
+  GATT_CONN_TERMINATE_PEER_USER = 0x13,
+  GATT_CONN_TERMINATE_LOCAL_HOST = 0x16,
+  GATT_CONN_FAIL_ESTABLISH = 0x3E,
+  GATT_CONN_LMP_TIMEOUT = 0x22,
+  GATT_CONN_CANCEL = 0x0100
+} wiced_bt_gatt_disconn_reason_t;
+
+typedef uint8_t wiced_bt_db_hash_t[16];
+
+typedef struct {
+  uint8_t *bd_addr;
+  wiced_bt_ble_address_type_t addr_type;
+  uint16_t conn_id;
+  wiced_bool_t connected;
+  wiced_bt_gatt_disconn_reason_t reason;
+  wiced_bt_transport_t transport;
+  uint8_t link_role;
+} wiced_bt_gatt_connection_status_t;
+
+typedef union {
+  wiced_bt_gatt_connection_status_t connection_status;
+} wiced_bt_gatt_event_data_t;
+
+typedef wiced_bt_gatt_status_t(wiced_bt_gatt_cback_t)(
+    wiced_bt_gatt_evt_t event, wiced_bt_gatt_event_data_t *p_event_data);
+
+wiced_bt_gatt_status_t
+wiced_bt_gatt_register(wiced_bt_gatt_cback_t *p_gatt_cback);
+wiced_bt_gatt_status_t wiced_bt_gatt_db_init(const uint8_t *p_gatt_db,
+                                             uint32_t db_size,
+                                             wiced_bt_db_hash_t hash);
+
+#endif /* HOST_WICED_BT_GATT_H_ */
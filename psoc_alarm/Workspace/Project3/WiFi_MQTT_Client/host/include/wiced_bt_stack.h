@@ -0,0 +1,21 @@
+/*
+ * wiced_bt_stack.h
+ *
+ * Host stand-in of the Bluetooth stack initialization. The stand-in stack
+ * reports BTM_ENABLED_EVT from its own task, as the target stack does.
+ */
+
+#ifndef HOST_WICED_BT_STACK_H_
+#define HOST_WICED_BT_STACK_H_
+
+#include "wiced_bt_dev.h"
+
+typedef struct {
+  const char *device_name;
+} wiced_bt_cfg_settings_t;
+
+wiced_result_t
+wiced_bt_stack_init(wiced_bt_management_cback_t *p_bt_management_cback,
+                    const wiced_bt_cfg_settings_t *p_bt_cfg_settings);
+
+#endif /* HOST_WICED_BT_STACK_H_ */
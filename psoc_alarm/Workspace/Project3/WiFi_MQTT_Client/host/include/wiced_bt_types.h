@@ -0,0 +1,25 @@
+/*
+ * wiced_bt_types.h
+ *
+ * Host stand-in of the Bluetooth stack types and result codes.
+ */
+
+#ifndef HOST_WICED_BT_TYPES_H_
+#define HOST_WICED_BT_TYPES_H_
+
+#include "wiced_data_types.h"
+
+#define BD_ADDR_LEN (6u)
+
+#define WICED_SUCCESS (0u)
+#define WICED_BT_SUCCESS (0u)
+#define WICED_BT_PENDING (0x8001u)
+#define WICED_BT_ERROR (0x8009u)
+
+typedef uint32_t wiced_result_t;
+typedef uint8_t wiced_bt_device_address_t[BD_ADDR_LEN];
+typedef uint8_t *wiced_bt_device_address_ptr_t;
+typedef uint8_t wiced_bt_ble_address_type_t;
+typedef uint8_t wiced_bt_transport_t;
+
+#endif /* HOST_WICED_BT_TYPES_H_ */
@@ -0,0 +1,25 @@
+/*
+ * wiced_data_types.h
+ *
+ * Host stand-in of the basic types of the Bluetooth stack.
+ */
+
+#ifndef HOST_WICED_DATA_TYPES_H_
+#define HOST_WICED_DATA_TYPES_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef uint8_t wiced_bool_t;
+
+#define WICED_FALSE (0u)
+#define WICED_TRUE (1u)
+
+#ifndef FALSE
+#define FALSE (0u)
+#endif
+#ifndef TRUE
+#define TRUE (1u)
+#endif
+
+#endif /* HOST_WICED_DATA_TYPES_H_ */
@@ -0,0 +1,10 @@
+/*
+ * wiced_memory.h
+ *
+ * Host stand-in, nothing of it is used by the application.
+ */
+
+#ifndef HOST_WICED_MEMORY_H_
+#define HOST_WICED_MEMORY_H_
+
+#endif /* HOST_WICED_MEMORY_H_ */
@@ -0,0 +1,266 @@
+/**
+ * This file implements the Bluetooth stack stand-in of the host build.
+ *
+ * The stack calls nothing on its own besides BTM_ENABLED_EVT after
+ * wiced_bt_stack_init(), from a task of its own like the stack task of the
+ * board. Every later management or GATT event comes from the scenarios
+ * through host_bt_management_event() and host_bt_gatt_event(), besides the
+ * advertising timeouts: like the stack configured by the Bluetooth
+ * Configurator, fast advertising falls back to slow advertising and then
+ * stops, each change reported by BTM_BLE_ADVERT_STATE_CHANGED_EVT, and a
+ * connection stops advertising. The other calls of bt.c into the stack
+ * succeed without effect.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+/* FreeRTOS header files */
+#include <FreeRTOS.h>
+#include "task.h"
+#include "timers.h"
+
+#include "GeneratedSource/cycfg_bt_settings.h"
+#include "GeneratedSource/cycfg_gap.h"
+#include "GeneratedSource/cycfg_gatt_db.h"
+#include "host.h"
+#include "sim.h"
+#include "wiced_bt_ble.h"
+#include "wiced_bt_dev.h"
+#include "wiced_bt_gatt.h"
+#include "wiced_bt_stack.h"
+
+/******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Task parameters of the stack task, above the application tasks. */
+#define BT_HOST_TASK_PRIORITY (configMAX_PRIORITIES - 2)
+#define BT_HOST_TASK_STACK_SIZE (configMINIMAL_STACK_SIZE)
+
+/* Advertising durations of the Bluetooth Configurator defaults. */
+#define BT_HOST_ADV_HIGH_DURATION_MS (30000u)
+#define BT_HOST_ADV_LOW_DURATION_MS (30000u)
+#define BT_HOST_ADV_DIRECTED_HIGH_DURATION_MS (1280u)
+#define BT_HOST_ADV_DIRECTED_LOW_DURATION_MS (30000u)
+
+/******************************************************************************
+ * Global Variables
+ ******************************************************************************/
+const wiced_bt_cfg_settings_t wiced_bt_cfg_settings = {.device_name = "Alarm"};
+
+static uint8_t adv_flags[] = {0x06};
+static uint8_t adv_name[] = {'A', 'l', 'a', 'r', 'm'};
+wiced_bt_ble_advert_elem_t cy_bt_adv_packet_data[CY_BT_ADV_PACKET_DATA_SIZE] = {
+    {.p_data = adv_flags, .len = sizeof(adv_flags), .advert_type = 0x01},
+    {.p_data = adv_name, .len = sizeof(adv_name), .advert_type = 0x09}};
+
+/* No attribute is read or written on the host, the database stays empty. */
+const uint8_t gatt_database[] = {0};
+const uint16_t gatt_database_len = 0u;
+uint8_t app_wicedbutton_mb1_client_char_config[2];
+
+static const wiced_bt_device_address_t local_bd_addr = {0x02, 0x00, 0x00,
+                                                        0x00, 0x00, 0x02};
+
+static wiced_bt_management_cback_t *management_callback;
+static wiced_bt_gatt_cback_t *gatt_callback;
+
+static TimerHandle_t adv_timer;
+static wiced_bt_ble_advert_mode_t adv_mode = BTM_BLE_ADVERT_OFF;
+
+/******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+static void adv_set_mode(wiced_bt_ble_advert_mode_t mode);
+static void adv_timeout(TimerHandle_t timer);
+static void adv_report(void *parameter1, uint32_t parameter2);
+
+/******************************************************************************
+ * Function Name: bt_host_task
+ ******************************************************************************
+ * Summary:
+ *  Reports the stack as enabled, once the scheduler runs.
+ *
+ * Parameters:
+ *  void *pvParameters : Task parameter (unused)
+ *
+ ******************************************************************************/
+static void bt_host_task(void *pvParameters) {
+  wiced_bt_management_evt_data_t event_data;
+
+  (void)pvParameters;
+
+  memset(&event_data, 0, sizeof(event_data));
+  event_data.enabled.status = WICED_BT_SUCCESS;
+  host_bt_management_event(BTM_ENABLED_EVT, &event_data);
+  vTaskDelete(NULL);
+}
+
+wiced_result_t
+wiced_bt_stack_init(wiced_bt_management_cback_t *p_bt_management_cback,
+                    const wiced_bt_cfg_settings_t *p_bt_cfg_settings) {
+  (void)p_bt_cfg_settings;
+
+  management_callback = p_bt_management_cback;
+  adv_timer = xTimerCreate("Advert", 1, pdFALSE, NULL, adv_timeout);
+  if ((adv_timer == NULL) ||
+      (pdPASS != xTaskCreate(bt_host_task, "BT stack", BT_HOST_TASK_STACK_SIZE,
+                            NULL, BT_HOST_TASK_PRIORITY, NULL))) {
+    return WICED_BT_ERROR;
+  }
+  return WICED_BT_SUCCESS;
+}
+
+wiced_result_t host_bt_management_event(wiced_bt_management_evt_t event,
+                                        wiced_bt_management_evt_data_t *data) {
+  return (management_callback != NULL) ? management_callback(event, data)
+                                        : WICED_BT_ERROR;
+}
+
+wiced_bt_gatt_status_t host_bt_gatt_event(wiced_bt_gatt_evt_t event,
+                                          wiced_bt_gatt_event_data_t *data) {
+  if ((event == GATT_CONNECTION_STATUS_EVT) &&
+      data->connection_status.connected &&
+      (adv_mode != BTM_BLE_ADVERT_OFF)) {
+    adv_set_mode(BTM_BLE_ADVERT_OFF);
+  }
+  return (gatt_callback != NULL) ? gatt_callback(event, data)
+                                 : WICED_BT_GATT_ERROR;
+}
+
+wiced_bt_gatt_status_t
+wiced_bt_gatt_register(wiced_bt_gatt_cback_t *p_gatt_cback) {
+  gatt_callback = p_gatt_cback;
+  return WICED_BT_GATT_SUCCESS;
+}
+
+wiced_bt_gatt_status_t wiced_bt_gatt_db_init(const uint8_t *p_gatt_db,
+                                             uint32_t db_size,
+                                             wiced_bt_db_hash_t hash) {
+  (void)p_gatt_db;
+  (void)db_size;
+  (void)hash;
+  return WICED_BT_GATT_SUCCESS;
+}
+
+void wiced_bt_set_pairable_mode(uint8_t allow_pairing,
+                                uint8_t connect_only_paired) {
+  (void)allow_pairing;
+  (void)connect_only_paired;
+}
+
+void wiced_bt_dev_read_local_addr(wiced_bt_device_address_t bd_addr) {
+  memcpy(bd_addr, local_bd_addr, sizeof(wiced_bt_device_address_t));
+}
+
+void wiced_bt_dev_confirm_req_reply(wiced_result_t res_code,
+                                    wiced_bt_device_address_t bd_addr) {
+  (void)res_code;
+  (void)bd_addr;
+}
+
+wiced_result_t
+wiced_bt_ble_set_raw_advertisement_data(uint8_t num_elem,
+                                        wiced_bt_ble_advert_elem_t *p_data) {
+  (void)num_elem;
+  (void)p_data;
+  return WICED_BT_SUCCESS;
+}
+
+wiced_result_t wiced_bt_start_advertisements(
+    wiced_bt_ble_advert_mode_t advert_mode,
+    wiced_bt_ble_address_type_t directed_advertisement_bdaddr_type,
+    wiced_bt_device_address_ptr_t directed_advertisement_bdaddr_ptr) {
+  (void)directed_advertisement_bdaddr_type;
+  (void)directed_advertisement_bdaddr_ptr;
+
+  switch (advert_mode) {
+  case BTM_BLE_ADVERT_OFF:
+  case BTM_BLE_ADVERT_DIRECTED_HIGH:
+  case BTM_BLE_ADVERT_DIRECTED_LOW:
+  case BTM_BLE_ADVERT_UNDIRECTED_HIGH:
+  case BTM_BLE_ADVERT_UNDIRECTED_LOW:
+    adv_set_mode(advert_mode);
+    return WICED_BT_SUCCESS;
+  default:
+    /* Not used by bt.c. */
+    return WICED_BT_ERROR;
+  }
+}
+
+/******************************************************************************
+ * Function Name: adv_set_mode
+ ******************************************************************************
+ * Summary:
+ *  Changes the advertising mode, arms the timeout of the new mode and
+ *  reports the change. The report goes through the timer task, not from
+ *  the caller, as the stack reports it from its own task. Nothing blocks:
+ *  this also runs on the timer task.
+ *
+ * Parameters:
+ *  wiced_bt_ble_advert_mode_t mode : New mode
+ *
+ ******************************************************************************/
+static void adv_set_mode(wiced_bt_ble_advert_mode_t mode) {
+  uint32_t duration_ms;
+
+  switch (mode) {
+  case BTM_BLE_ADVERT_UNDIRECTED_HIGH:
+    duration_ms = BT_HOST_ADV_HIGH_DURATION_MS;
+    break;
+  case BTM_BLE_ADVERT_UNDIRECTED_LOW:
+    duration_ms = BT_HOST_ADV_LOW_DURATION_MS;
+    break;
+  case BTM_BLE_ADVERT_DIRECTED_HIGH:
+    duration_ms = BT_HOST_ADV_DIRECTED_HIGH_DURATION_MS;
+    break;
+  case BTM_BLE_ADVERT_DIRECTED_LOW:
+    duration_ms = BT_HOST_ADV_DIRECTED_LOW_DURATION_MS;
+    break;
+  default:
+    duration_ms = 0u;
+    break;
+  }
+
+  adv_mode = mode;
+  if (duration_ms == 0u) {
+    xTimerStop(adv_timer, 0);
+  } else {
+    xTimerChangePeriod(adv_timer, pdMS_TO_TICKS(duration_ms), 0);
+  }
+  SIM_TIMELINE("BLE advertising mode %d", (int)mode);
+  xTimerPendFunctionCall(adv_report, NULL, (uint32_t)mode, 0);
+}
+
+/* Falls back from fast to slow advertising, and from slow to none. */
+static void adv_timeout(TimerHandle_t timer) {
+  (void)timer;
+
+  switch (adv_mode) {
+  case BTM_BLE_ADVERT_UNDIRECTED_HIGH:
+    adv_set_mode(BTM_BLE_ADVERT_UNDIRECTED_LOW);
+    break;
+  case BTM_BLE_ADVERT_DIRECTED_HIGH:
+    adv_set_mode(BTM_BLE_ADVERT_DIRECTED_LOW);
+    break;
+  default:
+    adv_set_mode(BTM_BLE_ADVERT_OFF);
+    break;
+  }
+}
+
+static void adv_report(void *parameter1, uint32_t parameter2) {
+  /* bt.c keeps a pointer to the event data. */
+  static wiced_bt_management_evt_data_t event_data;
+
+  (void)parameter1;
+
+  event_data.ble_advert_state_changed = (wiced_bt_ble_advert_mode_t)parameter2;
+  host_bt_management_event(BTM_BLE_ADVERT_STATE_CHANGED_EVT, &event_data);
+}
+
+void wiced_bt_ble_security_grant(wiced_bt_device_address_t bd_addr,
+                                 uint8_t res) {
+  (void)bd_addr;
+  (void)res;
+}
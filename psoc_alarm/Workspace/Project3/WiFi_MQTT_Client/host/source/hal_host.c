@@ -0,0 +1,187 @@
+/**
+ * This file implements the HAL stand-in of the host build.
+ *
+ * GPIOs are a table of levels: writes to the LED only update the table, and
+ * host_gpio_event() calls the callback registered on a pin the way the GPIO
+ * interrupt does on the board. The timer counts the monotonic clock of the
+ * host, or the kernel tick in the simulation build. Critical sections are the kernel ones, which mask the signals the
+ * POSIX port uses for its tick.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+/* FreeRTOS header files */
+#include <FreeRTOS.h>
+#include "task.h"
+
+#include "clock.h"
+#include "cyhal.h"
+#include "host.h"
+#include "sim.h"
+
+/******************************************************************************
+ * Global Variables
+ ******************************************************************************/
+uint32_t SystemCoreClock = 1000000u;
+
+static bool gpio_level[HOST_GPIO_COUNT];
+static cyhal_gpio_callback_data_t *gpio_callback[HOST_GPIO_COUNT];
+static cyhal_gpio_event_t gpio_enabled_events[HOST_GPIO_COUNT];
+
+/******************************************************************************
+ * Function Name: host_time_ns
+ ******************************************************************************
+ * Summary:
+ *  Reads the monotonic clock. On virtual time the clock is the tick count,
+ *  code runs in zero time between two ticks.
+ *
+ * Return:
+ *  uint64_t : Time in nanoseconds
+ *
+ ******************************************************************************/
+static uint64_t host_time_ns(void) {
+#if HOST_SIM
+  return (uint64_t)xTaskGetTickCount() * (1000000000u / configTICK_RATE_HZ);
+#else
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return ((uint64_t)now.tv_sec * 1000000000u) + (uint64_t)now.tv_nsec;
+#endif
+}
+
+uint64_t host_time_us(void) { return host_time_ns() / 1000u; }
+
+uint32_t Clock_GetTimeMs(void) {
+  return (uint32_t)(xTaskGetTickCount() * portTICK_PERIOD_MS);
+}
+
+uint32_t cyhal_system_critical_section_enter(void) {
+  taskENTER_CRITICAL();
+  return 0u;
+}
+
+void cyhal_system_critical_section_exit(uint32_t old_state) {
+  (void)old_state;
+  taskEXIT_CRITICAL();
+}
+
+cy_rslt_t cyhal_gpio_init(cyhal_gpio_t pin, cyhal_gpio_direction_t direction,
+                          cyhal_gpio_drive_mode_t drive_mode, bool init_val) {
+  (void)direction;
+  (void)drive_mode;
+
+  if (pin >= HOST_GPIO_COUNT) {
+    return CY_RSLT_TYPE_ERROR;
+  }
+  gpio_level[pin] = init_val;
+  return CY_RSLT_SUCCESS;
+}
+
+void cyhal_gpio_free(cyhal_gpio_t pin) {
+  if (pin < HOST_GPIO_COUNT) {
+    gpio_callback[pin] = NULL;
+    gpio_enabled_events[pin] = CYHAL_GPIO_IRQ_NONE;
+  }
+}
+
+void cyhal_gpio_write(cyhal_gpio_t pin, bool value) {
+  if (pin < HOST_GPIO_COUNT) {
+    gpio_level[pin] = value;
+  }
+}
+
+bool cyhal_gpio_read(cyhal_gpio_t pin) {
+  return (pin < HOST_GPIO_COUNT) ? gpio_level[pin] : false;
+}
+
+void cyhal_gpio_register_callback(cyhal_gpio_t pin,
+                                  cyhal_gpio_callback_data_t *callback_data) {
+  if (pin < HOST_GPIO_COUNT) {
+    gpio_callback[pin] = callback_data;
+  }
+}
+
+void cyhal_gpio_enable_event(cyhal_gpio_t pin, cyhal_gpio_event_t event,
+                             uint8_t intr_priority, bool enable) {
+  (void)intr_priority;
+
+  if (pin < HOST_GPIO_COUNT) {
+    gpio_enabled_events[pin] = enable ? event : CYHAL_GPIO_IRQ_NONE;
+  }
+}
+
+/******************************************************************************
+ * Function Name: host_gpio_event
+ ******************************************************************************
+ * Summary:
+ *  Injects an edge on a pin. The callback runs in the calling task with the
+ *  tick masked, the closest the POSIX port gets to an interrupt handler.
+ *
+ * Parameters:
+ *  cyhal_gpio_t pin         : Pin
+ *  cyhal_gpio_event_t event : Edge, ignored unless enabled on the pin
+ *
+ ******************************************************************************/
+void host_gpio_event(cyhal_gpio_t pin, cyhal_gpio_event_t event) {
+  cyhal_gpio_callback_data_t *callback_data;
+
+  if ((pin >= HOST_GPIO_COUNT) ||
+      ((gpio_enabled_events[pin] & event) == CYHAL_GPIO_IRQ_NONE)) {
+    return;
+  }
+
+  taskENTER_CRITICAL();
+  gpio_level[pin] = (event == CYHAL_GPIO_IRQ_RISE);
+  callback_data = gpio_callback[pin];
+  if ((callback_data != NULL) && (callback_data->callback != NULL)) {
+    callback_data->callback(callback_data->callback_arg, event);
+  }
+  taskEXIT_CRITICAL();
+}
+
+cy_rslt_t cyhal_timer_init(cyhal_timer_t *obj, cyhal_gpio_t pin,
+                           const cyhal_clock_t *clk) {
+  (void)pin;
+  (void)clk;
+
+  obj->frequency_hz = 1000000u;
+  obj->start_ns = 0u;
+  obj->running = false;
+  return CY_RSLT_SUCCESS;
+}
+
+cy_rslt_t cyhal_timer_configure(cyhal_timer_t *obj,
+                                const cyhal_timer_cfg_t *cfg) {
+  (void)obj;
+
+  /* Only the free running up counter of sys_stats.c is supported. */
+  return ((cfg->direction == CYHAL_TIMER_DIR_UP) && cfg->is_continuous)
+             ? CY_RSLT_SUCCESS
+             : CY_RSLT_TYPE_ERROR;
+}
+
+cy_rslt_t cyhal_timer_set_frequency(cyhal_timer_t *obj, uint32_t hz) {
+  if ((hz == 0u) || (hz > 1000000000u)) {
+    return CY_RSLT_TYPE_ERROR;
+  }
+  obj->frequency_hz = hz;
+  return CY_RSLT_SUCCESS;
+}
+
+cy_rslt_t cyhal_timer_start(cyhal_timer_t *obj) {
+  obj->start_ns = host_time_ns();
+  obj->running = true;
+  return CY_RSLT_SUCCESS;
+}
+
+uint32_t cyhal_timer_read(const cyhal_timer_t *obj) {
+  if (!obj->running) {
+    return 0u;
+  }
+  /* Wraps at 32 bits like the TCPWM counter. */
+  return (uint32_t)(((host_time_ns() - obj->start_ns) * obj->frequency_hz) /
+                    1000000000u);
+}
@@ -0,0 +1,341 @@
+/**
+ * This file implements the soak test of the TLSF allocator on the host.
+ *
+ * The trace is the text the device publishes on MQTT_DIAG_TOPIC for the
+ * HEAPTRACE command (see source/heap.c), saved by any MQTT client:
+ *
+ *   mosquitto_sub -t security/diag > heap_trace.txt
+ *
+ * Other lines of the file, like the diagnostics JSON, are skipped. The
+ * operations of the trace are replayed in order on a pool of the size of
+ * the board heap, once per pass. A block of the trace is known by its id,
+ * the offset it had on the board; an allocation that failed on the board is
+ * replayed and freed right away. After every pass the pool is checked with
+ * tlsf_check(), the blocks still allocated are freed, and the pool must be
+ * one free block again.
+ *
+ * Blocks are laid out as on the board, but a block header holds 8 byte
+ * pointers on the host, so the smallest block is 8 bytes larger and the
+ * failures and fragmentation are close to, not equal to, the board's. The
+ * times are those of the host CPU, in the unit of probe_now().
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "heap.h"
+#include "heap_soak.h"
+#include "probe.h"
+#include "tlsf.h"
+
+/******************************************************************************
+ * Macros
+ ******************************************************************************/
+#define HEAP_SOAK_LINE_SIZE (256u)
+
+/******************************************************************************
+ * Types
+ ******************************************************************************/
+typedef struct {
+  heap_trace_op_t op;
+  uint32_t old_id;
+  uint32_t id;
+  uint32_t size;
+} heap_soak_event_t;
+
+/* Duration of one kind of operation. */
+typedef struct {
+  uint64_t total;
+  uint32_t count;
+  uint32_t max;
+} heap_soak_timing_t;
+
+/******************************************************************************
+ * Global Variables
+ ******************************************************************************/
+static heap_soak_event_t *events;
+static bool *present;
+static uint32_t event_count;
+static uint32_t pool_size;
+
+/* Host block of each board id, by id / TLSF_ALIGN. */
+static void **blocks;
+static uint32_t block_slots;
+
+static heap_soak_timing_t timings[3];
+static const char *const op_names[3] = {
+    [HEAP_TRACE_ALLOC] = "alloc",
+    [HEAP_TRACE_FREE] = "free",
+    [HEAP_TRACE_REALLOC] = "realloc",
+};
+
+/******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+static bool heap_soak_load(const char *path);
+static bool heap_soak_parse(const char *line);
+static void **heap_soak_slot(uint32_t id);
+static bool heap_soak_pass(tlsf_t *tlsf, uint32_t *fragmentation);
+static void heap_soak_time(heap_trace_op_t op, uint32_t start);
+
+/******************************************************************************
+ * Function Name: heap_soak_run
+ ******************************************************************************
+ * Summary:
+ *  Loads a heap trace and replays it, then prints the times of the
+ *  operations, the peak, the failures and the worst fragmentation.
+ *
+ * Parameters:
+ *  const char *path : Trace file
+ *  uint32_t passes  : Replays of the trace
+ *
+ * Return:
+ *  int : Exit status, 0 if every pass left a consistent, empty pool
+ *
+ ******************************************************************************/
+int heap_soak_run(const char *path, uint32_t passes) {
+  tlsf_t tlsf;
+  tlsf_stats_t stats;
+  void *pool;
+  uint32_t fragmentation = 0u;
+  uint32_t failures = 0u;
+  uint32_t peak = 0u;
+
+  if (!heap_soak_load(path)) {
+    return 1;
+  }
+  pool = malloc(pool_size);
+  if ((pool == NULL) || !tlsf_init(&tlsf, pool, pool_size)) {
+    printf("Soak: no pool of %lu B\n", (unsigned long)pool_size);
+    return 1;
+  }
+  printf("Soak: %s, %lu events, pool %lu B, %lu passes\n", path,
+         (unsigned long)event_count, (unsigned long)pool_size,
+         (unsigned long)passes);
+
+  for (uint32_t pass = 0; pass < passes; pass++) {
+    if (!heap_soak_pass(&tlsf, &fragmentation)) {
+      printf("Soak: pool inconsistent after pass %lu\n", (unsigned long)pass);
+      return 1;
+    }
+    tlsf_get_stats(&tlsf, &stats);
+    if ((stats.used != 0u) || (stats.blocks != 0u) ||
+        (stats.largest_block + TLSF_ALIGN != stats.size)) {
+      printf("Soak: pool not one free block after pass %lu, %lu B used\n",
+             (unsigned long)pass, (unsigned long)stats.used);
+      return 1;
+    }
+    failures = stats.failures;
+    peak = stats.peak;
+  }
+
+  for (uint32_t op = 0; op < 3u; op++) {
+    printf("  %-8s %8lu ops, mean %lu " PROBE_UNIT ", max %lu " PROBE_UNIT
+           "\n",
+           op_names[op], (unsigned long)timings[op].count,
+           (unsigned long)((timings[op].count > 0u)
+                               ? timings[op].total / timings[op].count
+                               : 0u),
+           (unsigned long)timings[op].max);
+  }
+  printf("  peak %lu B of %lu B, %lu failed allocations, fragmentation at "
+         "most %lu permille\n",
+         (unsigned long)peak, (unsigned long)stats.size,
+         (unsigned long)failures, (unsigned long)fragmentation);
+
+  free(pool);
+  free(blocks);
+  free(present);
+  free(events);
+  return 0;
+}
+
+/******************************************************************************
+ * Function Name: heap_soak_load
+ ******************************************************************************
+ * Summary:
+ *  Reads a trace, its lines in any order, and checks that it is complete.
+ *
+ ******************************************************************************/
+static bool heap_soak_load(const char *path) {
+  FILE *file = fopen(path, "r");
+  char line[HEAP_SOAK_LINE_SIZE];
+  unsigned long count, size;
+
+  if (file == NULL) {
+    printf("Soak: opening %s failed\n", path);
+    return false;
+  }
+  while (fgets(line, sizeof(line), file) != NULL) {
+    if (sscanf(line, "HEAP BEGIN %lu %lu", &count, &size) == 2) {
+      event_count = (uint32_t)count;
+      pool_size = (uint32_t)size;
+      events = calloc(event_count + 1u, sizeof(*events));
+      present = calloc(event_count + 1u, sizeof(*present));
+    } else if ((strncmp(line, "H ", 2u) == 0) &&
+               ((events == NULL) || !heap_soak_parse(line))) {
+      printf("Soak: bad event %s", line);
+      fclose(file);
+      return false;
+    }
+  }
+  fclose(file);
+
+  if (events == NULL) {
+    printf("Soak: no HEAP BEGIN in %s\n", path);
+    return false;
+  }
+  for (uint32_t i = 0; i < event_count; i++) {
+    if (!present[i]) {
+      printf("Soak: event %lx of the trace is missing\n", (unsigned long)i);
+      return false;
+    }
+  }
+
+  block_slots = pool_size / TLSF_ALIGN + 1u;
+  blocks = calloc(block_slots, sizeof(*blocks));
+  return blocks != NULL;
+}
+
+/* Decodes an event line, see source/heap.c. */
+static bool heap_soak_parse(const char *line) {
+  unsigned long index, old_id, id, size;
+  heap_soak_event_t event = {0};
+  char op;
+
+  if (sscanf(line, "H %lx %c", &index, &op) != 2) {
+    return false;
+  }
+  if ((op == 'A') && (sscanf(line, "H %*x A %lx %lu", &id, &size) == 2)) {
+    event = (heap_soak_event_t){HEAP_TRACE_ALLOC, 0u, (uint32_t)id,
+                                (uint32_t)size};
+  } else if ((op == 'F') && (sscanf(line, "H %*x F %lx", &old_id) == 1)) {
+    event = (heap_soak_event_t){HEAP_TRACE_FREE, (uint32_t)old_id, 0u, 0u};
+  } else if ((op == 'R') && (sscanf(line, "H %*x R %lx %lx %lu", &old_id, &id,
+                                    &size) == 3)) {
+    event = (heap_soak_event_t){HEAP_TRACE_REALLOC, (uint32_t)old_id,
+                                (uint32_t)id, (uint32_t)size};
+  } else {
+    return false;
+  }
+  if ((index >= event_count) || (event.old_id > pool_size) ||
+      (event.id > pool_size)) {
+    return false;
+  }
+  events[index] = event;
+  present[index] = true;
+  return true;
+}
+
+/* Slot of the host block of a board id, NULL for id 0. */
+static void **heap_soak_slot(uint32_t id) {
+  return (id != 0u) ? &blocks[id / TLSF_ALIGN] : NULL;
+}
+
+/******************************************************************************
+ * Function Name: heap_soak_pass
+ ******************************************************************************
+ * Summary:
+ *  Replays the trace once, then checks the pool and frees the blocks still
+ *  allocated. A free of a block the host could not allocate is skipped.
+ *
+ * Parameters:
+ *  tlsf_t *tlsf             : Pool
+ *  uint32_t *fragmentation  : Raised to the worst fragmentation of the pass,
+ *                             in permille
+ *
+ * Return:
+ *  bool : false if the pool is inconsistent
+ *
+ ******************************************************************************/
+static bool heap_soak_pass(tlsf_t *tlsf, uint32_t *fragmentation) {
+  tlsf_stats_t stats;
+
+  for (uint32_t i = 0; i < event_count; i++) {
+    const heap_soak_event_t *event = &events[i];
+    void **old_slot = heap_soak_slot(event->old_id);
+    void **slot = heap_soak_slot(event->id);
+    void *ptr;
+    uint32_t start;
+
+    switch (event->op) {
+    case HEAP_TRACE_ALLOC:
+      start = probe_now();
+      ptr = tlsf_malloc(tlsf, event->size);
+      heap_soak_time(HEAP_TRACE_ALLOC, start);
+      break;
+    case HEAP_TRACE_FREE:
+      if ((old_slot == NULL) || (*old_slot == NULL)) {
+        continue;
+      }
+      start = probe_now();
+      tlsf_free(tlsf, *old_slot);
+      heap_soak_time(HEAP_TRACE_FREE, start);
+      *old_slot = NULL;
+      continue;
+    default:
+      if ((old_slot == NULL) || (*old_slot == NULL)) {
+        continue;
+      }
+      start = probe_now();
+      ptr = tlsf_realloc(tlsf, *old_slot, event->size);
+      heap_soak_time(HEAP_TRACE_REALLOC, start);
+      if (event->size == 0u) {
+        *old_slot = NULL;
+        continue;
+      }
+      /* A failed reallocation keeps the block, under its old id if it
+       * failed on the board.
+       */
+      if (ptr == NULL) {
+        ptr = *old_slot;
+      }
+      *old_slot = NULL;
+      if (slot == NULL) {
+        slot = old_slot;
+      }
+      break;
+    }
+
+    if (slot != NULL) {
+      if (*slot != NULL) {
+        tlsf_free(tlsf, *slot);
+      }
+      *slot = ptr;
+    } else if (ptr != NULL) {
+      tlsf_free(tlsf, ptr);
+    }
+
+    tlsf_get_stats(tlsf, &stats);
+    if (stats.free > 0u) {
+      uint32_t permille =
+          1000u - (uint32_t)(((uint64_t)stats.largest_free * 1000u) /
+                             stats.free);
+
+      if (permille > *fragmentation) {
+        *fragmentation = permille;
+      }
+    }
+  }
+
+  if (!tlsf_check(tlsf)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < block_slots; i++) {
+    tlsf_free(tlsf, blocks[i]);
+    blocks[i] = NULL;
+  }
+  return tlsf_check(tlsf);
+}
+
+/* Adds the duration of an operation since start. */
+static void heap_soak_time(heap_trace_op_t op, uint32_t start) {
+  uint32_t elapsed = probe_now() - start;
+
+  timings[op].total += elapsed;
+  timings[op].count++;
+  if (elapsed > timings[op].max) {
+    timings[op].max = elapsed;
+  }
+}
@@ -0,0 +1,19 @@
+/*
+ * heap_soak.h
+ *
+ * Soak test of the TLSF allocator: a heap trace captured on the board (see
+ * source/heap.c) is replayed on a pool of the same size over and over, and
+ * the pool is checked after every pass.
+ */
+
+#ifndef HOST_HEAP_SOAK_H_
+#define HOST_HEAP_SOAK_H_
+
+#include <stdint.h>
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+int heap_soak_run(const char *path, uint32_t passes);
+
+#endif /* HOST_HEAP_SOAK_H_ */
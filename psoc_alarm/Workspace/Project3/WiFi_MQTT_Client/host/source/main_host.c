@@ -0,0 +1,197 @@
+/**
+ * This file is the entry point of the host build. It starts the tasks of
+ * main.c on the FreeRTOS POSIX port, with the stand-ins of host/source in
+ * place of the board, and the scenario task that drives them.
+ *
+ *   WiFi_MQTT_Client [-p dump [-b boot]] [-n iterations] [-g gap_ms]
+ *                    [scenario...]
+ *   WiFi_MQTT_Client -B
+ *   WiFi_MQTT_Client [-n passes] -H heap_trace
+ *
+ * With -p the run replays a dump of the event recorder instead of the
+ * scenarios, see replay.c. -B runs the microbenchmarks of bench.c and
+ * exits, without starting the scheduler. -H replays a heap trace of the
+ * board on the TLSF allocator the same way, see heap_soak.c. The simulation build (make SIM=1) takes the
+ * parameters of the network model and the file of the timeline too:
+ *
+ *   WiFi_MQTT_Client [-r rtt_ms] [-o outage_s] [-f flap_ms] [-t timeline]
+ *                    [-p dump [-b boot]] [-n iterations] [-g gap_ms]
+ *                    [scenario...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* FreeRTOS header files */
+#include <FreeRTOS.h>
+#include "task.h"
+
+#include "GeneratedSource/cycfg_bt_settings.h"
+#include "bench.h"
+#include "bt.h"
+#include "coroutine.h"
+#include "heap_soak.h"
+#include "log.h"
+#include "mqtt_task.h"
+#include "recorder.h"
+#include "replay.h"
+#include "scenario.h"
+#include "sim.h"
+#include "wiced_bt_stack.h"
+
+/* Stacks and control blocks of the tasks of main.c and of the kernel. */
+static StackType_t log_task_stack[LOG_TASK_STACK_SIZE];
+static StaticTask_t log_task_tcb;
+static StackType_t coroutine_task_stack[COROUTINE_TASK_STACK_SIZE];
+static StaticTask_t coroutine_task_tcb;
+static StackType_t idle_task_stack[configMINIMAL_STACK_SIZE];
+static StaticTask_t idle_task_tcb;
+static StackType_t timer_task_stack[configTIMER_TASK_STACK_DEPTH];
+static StaticTask_t timer_task_tcb;
+
+/* Output of the microbenchmarks. */
+static void bench_print(const char *line) {
+  printf("%s\n", line);
+}
+
+/* Memory of the idle and timer tasks, which the board support libraries
+ * provide on the board.
+ */
+void vApplicationGetIdleTaskMemory(StaticTask_t **tcb, StackType_t **stack,
+                                   uint32_t *stack_size) {
+  *tcb = &idle_task_tcb;
+  *stack = idle_task_stack;
+  *stack_size = configMINIMAL_STACK_SIZE;
+}
+
+void vApplicationGetTimerTaskMemory(StaticTask_t **tcb, StackType_t **stack,
+                                    uint32_t *stack_size) {
+  *tcb = &timer_task_tcb;
+  *stack = timer_task_stack;
+  *stack_size = configTIMER_TASK_STACK_DEPTH;
+}
+
+/******************************************************************************
+ * Function Name: usage
+ ******************************************************************************/
+static void usage(const char *program) {
+#if HOST_SIM
+  printf("Usage: %s [-r rtt_ms] [-o outage_s] [-f flap_ms] [-t timeline]\n"
+         "       [-p dump [-b boot]] [-n iterations] [-g gap_ms] "
+         "[scenario...]\n       %s -B\n       %s [-n passes] -H heap_trace\n"
+         "Scenarios: all",
+         program, program, program);
+#else
+  printf("Usage: %s [-p dump [-b boot]] [-n iterations] [-g gap_ms] "
+         "[scenario...]\n       %s -B\n       %s [-n passes] -H heap_trace\n"
+         "Scenarios: all",
+         program, program, program);
+#endif
+  scenario_list();
+  exit(2);
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t iterations = 100u;
+  uint32_t gap_ms = 200u;
+  const char *timeline_path = NULL;
+  const char *replay_path = NULL;
+  const char *soak_path = NULL;
+  int replay_boot = REPLAY_LAST_BOOT;
+  int opt;
+
+  while ((opt = getopt(argc, argv,
+                       HOST_SIM ? "n:g:p:b:r:o:f:t:BH:h"
+                                : "n:g:p:b:BH:h")) != -1) {
+    switch (opt) {
+    case 'n':
+      iterations = (uint32_t)strtoul(optarg, NULL, 0);
+      break;
+    case 'g':
+      gap_ms = (uint32_t)strtoul(optarg, NULL, 0);
+      break;
+    case 'p':
+      replay_path = optarg;
+      break;
+    case 'b':
+      replay_boot = (int)strtol(optarg, NULL, 0);
+      break;
+    case 'B':
+      bench_run(bench_print);
+      return 0;
+    case 'H':
+      soak_path = optarg;
+      break;
+#if HOST_SIM
+    case 'r':
+      sim_config.rtt_ms = (uint32_t)strtoul(optarg, NULL, 0);
+      break;
+    case 'o':
+      sim_config.outage_ms = (uint32_t)strtoul(optarg, NULL, 0) * 1000u;
+      break;
+    case 'f':
+      sim_config.flap_ms = (uint32_t)strtoul(optarg, NULL, 0);
+      break;
+    case 't':
+      timeline_path = optarg;
+      break;
+#endif
+    default:
+      usage(argv[0]);
+    }
+  }
+  for (int i = optind; i < argc; i++) {
+    if (!scenario_select(argv[i])) {
+      usage(argv[0]);
+    }
+  }
+  if (soak_path != NULL) {
+    return heap_soak_run(soak_path, iterations);
+  }
+  scenario_configure(iterations, gap_ms);
+  if ((replay_path != NULL) && !replay_load(replay_path, replay_boot)) {
+    return 1;
+  }
+#if HOST_SIM
+  if (!sim_init(timeline_path)) {
+    printf("Opening the timeline %s failed\n", timeline_path);
+    return 1;
+  }
+#else
+  (void)timeline_path;
+#endif
+
+  /* The console of the board is line oriented too. */
+  setvbuf(stdout, NULL, _IOLBF, 0);
+
+  /* Record the run too, replay.c compares its outputs. */
+  recorder_init();
+
+  /* Start the deferred logger before the first callback can log. */
+  log_init();
+  xTaskCreateStatic(log_task, "Log task", LOG_TASK_STACK_SIZE, NULL,
+                    LOG_TASK_PRIORITY, log_task_stack, &log_task_tcb);
+
+  /* Start the connection manager on the coroutine task. */
+  mqtt_task_start();
+  xTaskCreateStatic(coroutine_task, "Coroutine task",
+                    COROUTINE_TASK_STACK_SIZE, NULL, COROUTINE_TASK_PRIORITY,
+                    coroutine_task_stack, &coroutine_task_tcb);
+
+  /* Register call back and configuration with stack */
+  if (WICED_BT_SUCCESS !=
+      wiced_bt_stack_init(app_bt_management_callback, &wiced_bt_cfg_settings)) {
+    printf("Bluetooth Stack Initialization failed!! \n");
+    return 1;
+  }
+
+  xTaskCreate(scenario_task, "Scenario", SCENARIO_TASK_STACK_SIZE, NULL,
+              SCENARIO_TASK_PRIORITY, NULL);
+
+  /* Start the FreeRTOS scheduler. */
+  vTaskStartScheduler();
+
+  /* Should never get here. */
+  return 1;
+}
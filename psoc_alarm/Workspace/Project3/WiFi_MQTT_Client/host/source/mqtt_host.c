@@ -0,0 +1,689 @@
+/**
+ * This file implements the MQTT library stand-in of the host build over
+ * libmosquitto, talking to a real broker.
+ *
+ * libmosquitto is used without its own thread: the "MQTT io" task polls the
+ * client every tick, which sends the queued packets, reads the incoming ones
+ * and runs the libmosquitto callbacks. A mutex serialises the client between
+ * that task and the application tasks. Received messages and the loss of
+ * the connection are reported to the application callback from the io task
+ * once the mutex is released, as the receive task of the target library
+ * does.
+ *
+ * Publish, subscribe and unsubscribe wait for the acknowledgement of their
+ * packet like the target library, so several publisher tasks can wait at
+ * the same time, each on a waiter of its own.
+ *
+ * Blocking system calls of a task are interrupted by the tick signal of the
+ * POSIX port: every socket operation is non-blocking and EINTR is retried.
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <mosquitto.h>
+
+/* FreeRTOS header files */
+#include <FreeRTOS.h>
+#include "queue.h"
+#include "semphr.h"
+#include "task.h"
+
+#include "cy_mqtt_api.h"
+#include "host.h"
+#include "mqtt_client_config.h"
+#include "publisher.h"
+
+/******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Task parameters of the io task, as the receive task of the library. */
+#define MQTT_HOST_TASK_PRIORITY (2)
+#define MQTT_HOST_TASK_STACK_SIZE (configMINIMAL_STACK_SIZE * 2)
+
+/* Operations waiting for an acknowledgement at the same time. */
+#define MQTT_HOST_WAITERS (PUBLISHER_TASKS + 4)
+
+/* Received messages not yet passed to the application. */
+#define MQTT_HOST_RX_QUEUE_LENGTH (8u)
+#define MQTT_HOST_TOPIC_MAX (128u)
+#define MQTT_HOST_PAYLOAD_MAX (512u)
+
+#define MQTT_HOST_CLIENT_ID_MAX (64u)
+
+/******************************************************************************
+ * Types
+ ******************************************************************************/
+typedef struct {
+  bool in_use;
+  int mid;
+  bool acked;
+  SemaphoreHandle_t done;
+} mqtt_host_waiter_t;
+
+typedef struct {
+  char topic[MQTT_HOST_TOPIC_MAX];
+  uint8_t payload[MQTT_HOST_PAYLOAD_MAX];
+  size_t payload_len;
+  cy_mqtt_qos_t qos;
+  bool retain;
+  uint16_t mid;
+} mqtt_host_rx_t;
+
+typedef struct {
+  struct mosquitto *mosq;
+  char hostname[MQTT_HOST_TOPIC_MAX];
+  uint16_t port;
+  cy_mqtt_callback_t callback;
+  void *user_data;
+  bool connected;
+  /* Set by the disconnect callback after an unexpected disconnection. */
+  bool lost;
+  int connack_rc;
+} mqtt_host_t;
+
+/******************************************************************************
+ * Global Variables
+ ******************************************************************************/
+static mqtt_host_t mqtt_host;
+static bool mqtt_host_created;
+
+static SemaphoreHandle_t mqtt_host_lock;
+static SemaphoreHandle_t connack_done;
+static QueueHandle_t rx_queue;
+static mqtt_host_waiter_t waiters[MQTT_HOST_WAITERS];
+
+static host_publish_hook_t publish_hook;
+
+/* Client of the scenarios, a remote user of the alarm. */
+static struct mosquitto *command_client;
+static volatile int command_connected;
+static volatile int command_acked_mid;
+
+/******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+static void mqtt_host_task(void *pvParameters);
+static void on_connect(struct mosquitto *mosq, void *obj, int rc);
+static void on_disconnect(struct mosquitto *mosq, void *obj, int rc);
+static void on_ack(struct mosquitto *mosq, void *obj, int mid);
+static void on_subscribe(struct mosquitto *mosq, void *obj, int mid,
+                         int qos_count, const int *granted_qos);
+static void on_message(struct mosquitto *mosq, void *obj,
+                       const struct mosquitto_message *message);
+static mqtt_host_waiter_t *waiter_add(int mid);
+static cy_rslt_t waiter_wait(mqtt_host_waiter_t *waiter);
+static void copy_string(char *dest, size_t dest_size, const char *string,
+                        uint16_t length);
+
+cy_rslt_t cy_mqtt_init(void) {
+  mosquitto_lib_init();
+
+  mqtt_host_lock = xSemaphoreCreateMutex();
+  connack_done = xSemaphoreCreateBinary();
+  rx_queue = xQueueCreate(MQTT_HOST_RX_QUEUE_LENGTH, sizeof(mqtt_host_rx_t));
+  if ((mqtt_host_lock == NULL) || (connack_done == NULL) ||
+      (rx_queue == NULL)) {
+    return CY_RSLT_MODULE_MQTT_ERROR;
+  }
+  for (uint32_t i = 0; i < MQTT_HOST_WAITERS; i++) {
+    waiters[i].done = xSemaphoreCreateBinary();
+    if (waiters[i].done == NULL) {
+      return CY_RSLT_MODULE_MQTT_ERROR;
+    }
+  }
+
+  if (pdPASS != xTaskCreate(mqtt_host_task, "MQTT io",
+                            MQTT_HOST_TASK_STACK_SIZE, NULL,
+                            MQTT_HOST_TASK_PRIORITY, NULL)) {
+    return CY_RSLT_MODULE_MQTT_ERROR;
+  }
+  return CY_RSLT_SUCCESS;
+}
+
+cy_rslt_t cy_mqtt_deinit(void) {
+  mosquitto_lib_cleanup();
+  return CY_RSLT_SUCCESS;
+}
+
+cy_rslt_t cy_mqtt_create(uint8_t *buffer, uint32_t buff_len,
+                         cy_awsport_ssl_credentials_t *security,
+                         cy_mqtt_broker_info_t *broker_info,
+                         cy_mqtt_callback_t event_callback, void *user_data,
+                         cy_mqtt_t *mqtt_handle) {
+  (void)buffer;
+  (void)buff_len;
+
+  if ((security != NULL) || mqtt_host_created) {
+    /* No TLS, and one instance like the application uses. */
+    return CY_RSLT_MODULE_MQTT_BADARG;
+  }
+
+  xSemaphoreTake(mqtt_host_lock, portMAX_DELAY);
+  memset(&mqtt_host, 0, sizeof(mqtt_host));
+  copy_string(mqtt_host.hostname, sizeof(mqtt_host.hostname),
+              broker_info->hostname, broker_info->hostname_len);
+  mqtt_host.port = broker_info->port;
+  mqtt_host.callback = event_callback;
+  mqtt_host.user_data = user_data;
+  mqtt_host.mosq = mosquitto_new(NULL, true, &mqtt_host);
+  mqtt_host_created = (mqtt_host.mosq != NULL);
+  xSemaphoreGive(mqtt_host_lock);
+
+  if (!mqtt_host_created) {
+    return CY_RSLT_MODULE_MQTT_ERROR;
+  }
+  *mqtt_handle = &mqtt_host;
+  return CY_RSLT_SUCCESS;
+}
+
+cy_rslt_t cy_mqtt_delete(cy_mqtt_t mqtt_handle) {
+  if (mqtt_handle != &mqtt_host) {
+    return CY_RSLT_MODULE_MQTT_BADARG;
+  }
+
+  xSemaphoreTake(mqtt_host_lock, portMAX_DELAY);
+  mosquitto_destroy(mqtt_host.mosq);
+  mqtt_host.mosq = NULL;
+  mqtt_host_created = false;
+  xSemaphoreGive(mqtt_host_lock);
+  return CY_RSLT_SUCCESS;
+}
+
+cy_rslt_t cy_mqtt_connect(cy_mqtt_t mqtt_handle,
+                          cy_mqtt_connect_info_t *connect_info) {
+  mqtt_host_t *host = mqtt_handle;
+  char client_id[MQTT_HOST_CLIENT_ID_MAX];
+  char username[MQTT_HOST_CLIENT_ID_MAX];
+  char password[MQTT_HOST_CLIENT_ID_MAX];
+  char will_topic[MQTT_HOST_TOPIC_MAX];
+  int rc;
+
+  if (host != &mqtt_host) {
+    return CY_RSLT_MODULE_MQTT_BADARG;
+  }
+  copy_string(client_id, sizeof(client_id), connect_info->client_id,
+              connect_info->client_id_len);
+
+  xSemaphoreTake(mqtt_host_lock, portMAX_DELAY);
+  /* A new session, with the client id of this attempt. */
+  mosquitto_reinitialise(host->mosq, client_id, connect_info->clean_session,
+                         host);
+  if (connect_info->username != NULL) {
+    copy_string(username, sizeof(username), connect_info->username,
+                connect_info->username_len);
+    copy_string(password, sizeof(password), connect_info->password,
+                connect_info->password_len);
+    mosquitto_username_pw_set(host->mosq, username, password);
+  }
+  if (connect_info->will_info != NULL) {
+    copy_string(will_topic, sizeof(will_topic), connect_info->will_info->topic,
+                connect_info->will_info->topic_len);
+    mosquitto_will_set(host->mosq, will_topic,
+                       (int)connect_info->will_info->payload_len,
+                       connect_info->will_info->payload,
+                       (int)connect_info->will_info->qos,
+                       connect_info->will_info->retain);
+  }
+  mosquitto_connect_callback_set(host->mosq, on_connect);
+  mosquitto_disconnect_callback_set(host->mosq, on_disconnect);
+  mosquitto_publish_callback_set(host->mosq, on_ack);
+  mosquitto_subscribe_callback_set(host->mosq, on_subscribe);
+  mosquitto_unsubscribe_callback_set(host->mosq, on_ack);
+  mosquitto_message_callback_set(host->mosq, on_message);
+
+  host->connected = false;
+  host->lost = false;
+  host->connack_rc = -1;
+  xSemaphoreTake(connack_done, 0);
+  do {
+    rc = mosquitto_connect_async(host->mosq, host->hostname, host->port,
+                                 connect_info->keep_alive_sec);
+  } while ((rc == MOSQ_ERR_ERRNO) && (errno == EINTR));
+  xSemaphoreGive(mqtt_host_lock);
+
+  if (rc != MOSQ_ERR_SUCCESS) {
+    printf("MQTT host: connection to %s:%u failed: %s\n", host->hostname,
+           host->port, mosquitto_strerror(rc));
+    return CY_RSLT_MODULE_MQTT_ERROR;
+  }
+
+  /* CONNACK, read by the io task. */
+  if (xSemaphoreTake(connack_done, pdMS_TO_TICKS(MQTT_TIMEOUT_MS)) != pdTRUE) {
+    xSemaphoreTake(mqtt_host_lock, portMAX_DELAY);
+    mosquitto_disconnect(host->mosq);
+    xSemaphoreGive(mqtt_host_lock);
+    return CY_RSLT_MODULE_MQTT_TIMEOUT;
+  }
+  return (host->connack_rc == 0) ? CY_RSLT_SUCCESS : CY_RSLT_MODULE_MQTT_ERROR;
+}
+
+cy_rslt_t cy_mqtt_disconnect(cy_mqtt_t mqtt_handle) {
+  mqtt_host_t *host = mqtt_handle;
+
+  if (host != &mqtt_host) {
+    return CY_RSLT_MODULE_MQTT_BADARG;
+  }
+
+  xSemaphoreTake(mqtt_host_lock, portMAX_DELAY);
+  host->connected = false;
+  mosquitto_disconnect(host->mosq);
+  xSemaphoreGive(mqtt_host_lock);
+  return CY_RSLT_SUCCESS;
+}
+
+cy_rslt_t cy_mqtt_publish(cy_mqtt_t mqtt_handle,
+                          cy_mqtt_publish_info_t *pub_msg) {
+  mqtt_host_t *host = mqtt_handle;
+  mqtt_host_waiter_t *waiter = NULL;
+  char topic[MQTT_HOST_TOPIC_MAX];
+  cy_rslt_t result = CY_RSLT_SUCCESS;
+  int mid;
+  int rc;
+
+  if (host != &mqtt_host) {
+    return CY_RSLT_MODULE_MQTT_BADARG;
+  }
+  copy_string(topic, sizeof(topic), pub_msg->topic, pub_msg->topic_len);
+
+  xSemaphoreTake(mqtt_host_lock, portMAX_DELAY);
+  if (!host->connected) {
+    xSemaphoreGive(mqtt_host_lock);
+    return CY_RSLT_MODULE_MQTT_NOT_CONNECTED;
+  }
+  rc = mosquitto_publish(host->mosq, &mid, topic, (int)pub_msg->payload_len,
+                         pub_msg->payload, (int)pub_msg->qos, pub_msg->retain);
+  if ((rc == MOSQ_ERR_SUCCESS) && (pub_msg->qos != CY_MQTT_QOS0)) {
+    /* Before the mutex is released, so the PUBACK cannot be missed. */
+    waiter = waiter_add(mid);
+  }
+  xSemaphoreGive(mqtt_host_lock);
+
+  if (rc != MOSQ_ERR_SUCCESS) {
+    return CY_RSLT_MODULE_MQTT_ERROR;
+  }
+  if (pub_msg->qos != CY_MQTT_QOS0) {
+    result = (waiter != NULL) ? waiter_wait(waiter) : CY_RSLT_MODULE_MQTT_ERROR;
+  }
+
+  if ((result == CY_RSLT_SUCCESS) && (publish_hook != NULL)) {
+    publish_hook(pub_msg);
+  }
+  return result;
+}
+
+cy_rslt_t cy_mqtt_subscribe(cy_mqtt_t mqtt_handle,
+                            cy_mqtt_subscribe_info_t *sub_info,
+                            uint8_t sub_count) {
+  mqtt_host_t *host = mqtt_handle;
+  mqtt_host_waiter_t *waiter = NULL;
+  char topic[MQTT_HOST_TOPIC_MAX];
+  cy_rslt_t result = CY_RSLT_SUCCESS;
+  int mid;
+  int rc;
+
+  if (host != &mqtt_host) {
+    return CY_RSLT_MODULE_MQTT_BADARG;
+  }
+
+  for (uint8_t i = 0; (i < sub_count) && (result == CY_RSLT_SUCCESS); i++) {
+    copy_string(topic, sizeof(topic), sub_info[i].topic, sub_info[i].topic_len);
+
+    xSemaphoreTake(mqtt_host_lock, portMAX_DELAY);
+    rc = host->connected ? mosquitto_subscribe(host->mosq, &mid, topic,
+                                               (int)sub_info[i].qos)
+                         : MOSQ_ERR_NO_CONN;
+    if (rc == MOSQ_ERR_SUCCESS) {
+      waiter = waiter_add(mid);
+    }
+    xSemaphoreGive(mqtt_host_lock);
+
+    result = ((rc == MOSQ_ERR_SUCCESS) && (waiter != NULL))
+                 ? waiter_wait(waiter)
+                 : CY_RSLT_MODULE_MQTT_ERROR;
+    sub_info[i].allocated_qos = sub_info[i].qos;
+  }
+  return result;
+}
+
+cy_rslt_t cy_mqtt_unsubscribe(cy_mqtt_t mqtt_handle,
+                              cy_mqtt_unsubscribe_info_t *unsub_info,
+                              uint8_t unsub_count) {
+  mqtt_host_t *host = mqtt_handle;
+  mqtt_host_waiter_t *waiter = NULL;
+  char topic[MQTT_HOST_TOPIC_MAX];
+  cy_rslt_t result = CY_RSLT_SUCCESS;
+  int mid;
+  int rc;
+
+  if (host != &mqtt_host) {
+    return CY_RSLT_MODULE_MQTT_BADARG;
+  }
+
+  for (uint8_t i = 0; (i < unsub_count) && (result == CY_RSLT_SUCCESS); i++) {
+    copy_string(topic, sizeof(topic), unsub_info[i].topic,
+                unsub_info[i].topic_len);
+
+    xSemaphoreTake(mqtt_host_lock, portMAX_DELAY);
+    rc = host->connected ? mosquitto_unsubscribe(host->mosq, &mid, topic)
+                         : MOSQ_ERR_NO_CONN;
+    if (rc == MOSQ_ERR_SUCCESS) {
+      waiter = waiter_add(mid);
+    }
+    xSemaphoreGive(mqtt_host_lock);
+
+    result = ((rc == MOSQ_ERR_SUCCESS) && (waiter != NULL))
+                 ? waiter_wait(waiter)
+                 : CY_RSLT_MODULE_MQTT_ERROR;
+  }
+  return result;
+}
+
+/******************************************************************************
+ * Function Name: mqtt_host_task
+ ******************************************************************************
+ * Summary:
+ *  Polls the client every tick and passes the received messages and the
+ *  loss of the connection to the application callback.
+ *
+ * Parameters:
+ *  void *pvParameters : Task parameter (unused)
+ *
+ ******************************************************************************/
+static void mqtt_host_task(void *pvParameters) {
+  mqtt_host_rx_t rx;
+  cy_mqtt_event_t event;
+  bool lost;
+
+  (void)pvParameters;
+
+  while (true) {
+    lost = false;
+
+    xSemaphoreTake(mqtt_host_lock, portMAX_DELAY);
+    if (mqtt_host_created) {
+      /* Not connected and EINTR are both retried on the next tick. */
+      (void)mosquitto_loop(mqtt_host.mosq, 0, 1);
+      lost = mqtt_host.lost;
+      mqtt_host.lost = false;
+    }
+    xSemaphoreGive(mqtt_host_lock);
+
+    while (xQueueReceive(rx_queue, &rx, 0) == pdPASS) {
+      memset(&event, 0, sizeof(event));
+      event.type = CY_MQTT_EVENT_TYPE_SUBSCRIPTION_MESSAGE_RECEIVE;
+      event.data.pub_msg.packet_id = rx.mid;
+      event.data.pub_msg.received_message.qos = rx.qos;
+      event.data.pub_msg.received_message.retain = rx.retain;
+      event.data.pub_msg.received_message.topic = rx.topic;
+      event.data.pub_msg.received_message.topic_len =
+          (uint16_t)strlen(rx.topic);
+      event.data.pub_msg.received_message.payload = (const char *)rx.payload;
+      event.data.pub_msg.received_message.payload_len = rx.payload_len;
+      mqtt_host.callback(&mqtt_host, event, mqtt_host.user_data);
+    }
+
+    if (lost) {
+      memset(&event, 0, sizeof(event));
+      event.type = CY_MQTT_EVENT_TYPE_DISCONNECT;
+      event.data.reason = CY_MQTT_DISCONN_TYPE_NETWORK_DOWN;
+      mqtt_host.callback(&mqtt_host, event, mqtt_host.user_data);
+    }
+
+    vTaskDelay(1);
+  }
+}
+
+/* The libmosquitto callbacks run in mosquitto_loop(), with the mutex held. */
+
+static void on_connect(struct mosquitto *mosq, void *obj, int rc) {
+  mqtt_host_t *host = obj;
+
+  (void)mosq;
+
+  host->connack_rc = rc;
+  host->connected = (rc == 0);
+  xSemaphoreGive(connack_done);
+}
+
+static void on_disconnect(struct mosquitto *mosq, void *obj, int rc) {
+  mqtt_host_t *host = obj;
+
+  (void)mosq;
+
+  /* rc is 0 only after cy_mqtt_disconnect(). */
+  if ((rc != 0) && host->connected) {
+    host->lost = true;
+  }
+  host->connected = false;
+
+  /* The acknowledgements will not come. */
+  for (uint32_t i = 0; i < MQTT_HOST_WAITERS; i++) {
+    if (waiters[i].in_use) {
+      waiters[i].in_use = false;
+      waiters[i].acked = false;
+      xSemaphoreGive(waiters[i].done);
+    }
+  }
+}
+
+static void on_ack(struct mosquitto *mosq, void *obj, int mid) {
+  (void)mosq;
+  (void)obj;
+
+  for (uint32_t i = 0; i < MQTT_HOST_WAITERS; i++) {
+    if (waiters[i].in_use && (waiters[i].mid == mid)) {
+      waiters[i].in_use = false;
+      waiters[i].acked = true;
+      xSemaphoreGive(waiters[i].done);
+      break;
+    }
+  }
+}
+
+static void on_subscribe(struct mosquitto *mosq, void *obj, int mid,
+                         int qos_count, const int *granted_qos) {
+  (void)qos_count;
+  (void)granted_qos;
+
+  on_ack(mosq, obj, mid);
+}
+
+static void on_message(struct mosquitto *mosq, void *obj,
+                       const struct mosquitto_message *message) {
+  mqtt_host_rx_t rx;
+
+  (void)mosq;
+  (void)obj;
+
+  if ((size_t)message->payloadlen > sizeof(rx.payload)) {
+    printf("MQTT host: %d bytes message on '%s' dropped\n",
+           message->payloadlen, message->topic);
+    return;
+  }
+  snprintf(rx.topic, sizeof(rx.topic), "%s", message->topic);
+  memcpy(rx.payload, message->payload, (size_t)message->payloadlen);
+  rx.payload_len = (size_t)message->payloadlen;
+  rx.qos = (cy_mqtt_qos_t)message->qos;
+  rx.retain = message->retain;
+  rx.mid = (uint16_t)message->mid;
+
+  if (xQueueSend(rx_queue, &rx, 0) != pdPASS) {
+    printf("MQTT host: receive queue full, message on '%s' dropped\n",
+           message->topic);
+  }
+}
+
+/******************************************************************************
+ * Function Name: waiter_add
+ ******************************************************************************
+ * Summary:
+ *  Registers a wait for the acknowledgement of a packet. Called with the
+ *  mutex held.
+ *
+ * Parameters:
+ *  int mid : Message id of the packet
+ *
+ * Return:
+ *  mqtt_host_waiter_t * : Waiter, NULL if all are in use
+ *
+ ******************************************************************************/
+static mqtt_host_waiter_t *waiter_add(int mid) {
+  for (uint32_t i = 0; i < MQTT_HOST_WAITERS; i++) {
+    if (!waiters[i].in_use) {
+      xSemaphoreTake(waiters[i].done, 0);
+      waiters[i].in_use = true;
+      waiters[i].mid = mid;
+      waiters[i].acked = false;
+      return &waiters[i];
+    }
+  }
+  return NULL;
+}
+
+/******************************************************************************
+ * Function Name: waiter_wait
+ ******************************************************************************
+ * Summary:
+ *  Waits up to MQTT_TIMEOUT_MS for the acknowledgement.
+ *
+ * Parameters:
+ *  mqtt_host_waiter_t *waiter : Waiter returned by waiter_add()
+ *
+ * Return:
+ *  cy_rslt_t : CY_RSLT_SUCCESS once acknowledged, else an error code
+ *
+ ******************************************************************************/
+static cy_rslt_t waiter_wait(mqtt_host_waiter_t *waiter) {
+  if (xSemaphoreTake(waiter->done, pdMS_TO_TICKS(MQTT_TIMEOUT_MS)) != pdTRUE) {
+    xSemaphoreTake(mqtt_host_lock, portMAX_DELAY);
+    waiter->in_use = false;
+    xSemaphoreGive(mqtt_host_lock);
+    return CY_RSLT_MODULE_MQTT_TIMEOUT;
+  }
+  return waiter->acked ? CY_RSLT_SUCCESS : CY_RSLT_MODULE_MQTT_NOT_CONNECTED;
+}
+
+/******************************************************************************
+ * Function Name: copy_string
+ ******************************************************************************
+ * Summary:
+ *  Copies a string with a length, as the library API passes them, into a NUL
+ *  terminated buffer as libmosquitto takes them. Truncates to the buffer.
+ *
+ ******************************************************************************/
+static void copy_string(char *dest, size_t dest_size, const char *string,
+                        uint16_t length) {
+  size_t len = (length < dest_size) ? length : dest_size - 1u;
+
+  if (string == NULL) {
+    len = 0;
+  } else {
+    memcpy(dest, string, len);
+  }
+  dest[len] = '\0';
+}
+
+void host_mqtt_set_publish_hook(host_publish_hook_t hook) {
+  publish_hook = hook;
+}
+
+static void on_command_connect(struct mosquitto *mosq, void *obj, int rc) {
+  (void)mosq;
+  (void)obj;
+
+  command_connected = (rc == 0);
+}
+
+static void on_command_ack(struct mosquitto *mosq, void *obj, int mid) {
+  (void)mosq;
+  (void)obj;
+
+  command_acked_mid = mid;
+}
+
+/******************************************************************************
+ * Function Name: command_loop
+ ******************************************************************************
+ * Summary:
+ *  Polls the command client until a condition holds.
+ *
+ * Parameters:
+ *  volatile int *value : Value to watch
+ *  int expected        : Value to wait for
+ *  TickType_t deadline : Tick count to give up at
+ *
+ * Return:
+ *  bool : true if the value was reached before the deadline
+ *
+ ******************************************************************************/
+static bool command_loop(volatile int *value, int expected,
+                         TickType_t deadline) {
+  int rc;
+
+  while (*value != expected) {
+    rc = mosquitto_loop(command_client, 0, 1);
+    if ((rc != MOSQ_ERR_SUCCESS) &&
+        !((rc == MOSQ_ERR_ERRNO) && (errno == EINTR))) {
+      return false;
+    }
+    if ((int32_t)(xTaskGetTickCount() - deadline) > 0) {
+      return false;
+    }
+    vTaskDelay(1);
+  }
+  return true;
+}
+
+/******************************************************************************
+ * Function Name: host_mqtt_publish_command
+ ******************************************************************************
+ * Summary:
+ *  Publishes a command from a second client, so it reaches the application
+ *  through the broker like a command of a remote user. Returns once the
+ *  broker acknowledged it. Only called from the scenario task.
+ *
+ * Parameters:
+ *  const char *topic   : Topic
+ *  const char *payload : Command
+ *
+ * Return:
+ *  cy_rslt_t : CY_RSLT_SUCCESS once acknowledged, else an error code
+ *
+ ******************************************************************************/
+cy_rslt_t host_mqtt_publish_command(const char *topic, const char *payload) {
+  TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(MQTT_TIMEOUT_MS);
+  int mid;
+  int rc;
+
+  if (command_client == NULL) {
+    command_client = mosquitto_new("host-scenario", true, NULL);
+    if (command_client == NULL) {
+      return CY_RSLT_MODULE_MQTT_ERROR;
+    }
+    mosquitto_connect_callback_set(command_client, on_command_connect);
+    mosquitto_publish_callback_set(command_client, on_command_ack);
+    command_connected = false;
+    do {
+      rc = mosquitto_connect_async(command_client, mqtt_host.hostname,
+                                   mqtt_host.port, MQTT_KEEP_ALIVE_SECONDS);
+    } while ((rc == MOSQ_ERR_ERRNO) && (errno == EINTR));
+    if ((rc != MOSQ_ERR_SUCCESS) ||
+        !command_loop(&command_connected, true, deadline)) {
+      mosquitto_destroy(command_client);
+      command_client = NULL;
+      return CY_RSLT_MODULE_MQTT_ERROR;
+    }
+  }
+
+  command_acked_mid = -1;
+  rc = mosquitto_publish(command_client, &mid, topic, (int)strlen(payload),
+                         payload, CY_MQTT_QOS1, false);
+  if ((rc != MOSQ_ERR_SUCCESS) ||
+      !command_loop(&command_acked_mid, mid, deadline)) {
+    return CY_RSLT_MODULE_MQTT_TIMEOUT;
+  }
+  return CY_RSLT_SUCCESS;
+}
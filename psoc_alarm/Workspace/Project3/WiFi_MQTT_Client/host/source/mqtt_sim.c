@@ -0,0 +1,534 @@
+/**
+ * This file implements the MQTT library stand-in of the simulation build:
+ * a model of the session with the broker, on virtual time. It replaces
+ * mqtt_host.c, no broker is involved.
+ *
+ * Every exchange with the broker takes one round trip (sim_config.rtt_ms),
+ * a connection two. While the broker is unreachable, requests time out
+ * after MQTT_TIMEOUT_MS. The loss of the session is seen the way the board
+ * sees it:
+ *   - losing the AP drops the socket at once;
+ *   - an unreachable broker goes unnoticed until the next keep-alive ping,
+ *     which fails MQTT_TIMEOUT_MS later.
+ *
+ * The "MQTT sim" task stands in for the receive task of the library: it
+ * delivers the commands of the scenarios once they crossed the broker and
+ * reports the loss of the session to the application callback. Commands to
+ * a device that is not connected are lost, as with the clean session the
+ * application uses.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+/* FreeRTOS header files */
+#include <FreeRTOS.h>
+#include "event_groups.h"
+#include "task.h"
+
+#include "cy_mqtt_api.h"
+#include "cy_wcm.h"
+#include "host.h"
+#include "mqtt_client_config.h"
+#include "sim.h"
+
+/******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Task parameters of the sim task, as the receive task of the library. */
+#define MQTT_SIM_TASK_PRIORITY (2)
+#define MQTT_SIM_TASK_STACK_SIZE (configMINIMAL_STACK_SIZE * 2)
+
+/* Topic filters of the session and commands crossing the broker. */
+#define MQTT_SIM_SUBSCRIPTIONS (4u)
+#define MQTT_SIM_INBOX_LENGTH (8u)
+#define MQTT_SIM_TOPIC_MAX (128u)
+#define MQTT_SIM_PAYLOAD_MAX (512u)
+
+/* Event group bit set once the session is lost. */
+#define MQTT_SIM_LOST (1u << 0)
+
+/******************************************************************************
+ * Types
+ ******************************************************************************/
+typedef struct {
+  bool in_use;
+  TickType_t due;
+  char topic[MQTT_SIM_TOPIC_MAX];
+  char payload[MQTT_SIM_PAYLOAD_MAX];
+  size_t payload_len;
+} mqtt_sim_message_t;
+
+typedef struct {
+  cy_mqtt_callback_t callback;
+  void *user_data;
+  bool connected;
+  TickType_t keep_alive;
+  TickType_t ping_due;
+  /* A ping went out while the broker was unreachable. */
+  bool ping_lost;
+  char subscriptions[MQTT_SIM_SUBSCRIPTIONS][MQTT_SIM_TOPIC_MAX];
+} mqtt_sim_t;
+
+/******************************************************************************
+ * Global Variables
+ ******************************************************************************/
+static mqtt_sim_t mqtt_sim;
+static bool mqtt_sim_created;
+
+static TaskHandle_t mqtt_sim_task_handle;
+static EventGroupHandle_t mqtt_sim_events;
+static mqtt_sim_message_t inbox[MQTT_SIM_INBOX_LENGTH];
+
+static host_publish_hook_t publish_hook;
+
+/******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+static void mqtt_sim_task(void *pvParameters);
+static bool path_is_up(void);
+static cy_rslt_t round_trip(void);
+static void session_lost(const char *reason);
+static bool topic_matches(const char *filter, const char *topic);
+static void copy_string(char *dest, size_t dest_size, const char *string,
+                        uint16_t length);
+
+cy_rslt_t cy_mqtt_init(void) {
+  mqtt_sim_events = xEventGroupCreate();
+  if (mqtt_sim_events == NULL) {
+    return CY_RSLT_MODULE_MQTT_ERROR;
+  }
+  if (pdPASS != xTaskCreate(mqtt_sim_task, "MQTT sim",
+                            MQTT_SIM_TASK_STACK_SIZE, NULL,
+                            MQTT_SIM_TASK_PRIORITY, &mqtt_sim_task_handle)) {
+    return CY_RSLT_MODULE_MQTT_ERROR;
+  }
+  return CY_RSLT_SUCCESS;
+}
+
+cy_rslt_t cy_mqtt_deinit(void) { return CY_RSLT_SUCCESS; }
+
+cy_rslt_t cy_mqtt_create(uint8_t *buffer, uint32_t buff_len,
+                         cy_awsport_ssl_credentials_t *security,
+                         cy_mqtt_broker_info_t *broker_info,
+                         cy_mqtt_callback_t event_callback, void *user_data,
+                         cy_mqtt_t *mqtt_handle) {
+  (void)buffer;
+  (void)buff_len;
+  (void)broker_info;
+
+  if ((security != NULL) || mqtt_sim_created) {
+    /* No TLS, and one instance like the application uses. */
+    return CY_RSLT_MODULE_MQTT_BADARG;
+  }
+
+  memset(&mqtt_sim, 0, sizeof(mqtt_sim));
+  mqtt_sim.callback = event_callback;
+  mqtt_sim.user_data = user_data;
+  mqtt_sim_created = true;
+  *mqtt_handle = &mqtt_sim;
+  return CY_RSLT_SUCCESS;
+}
+
+cy_rslt_t cy_mqtt_delete(cy_mqtt_t mqtt_handle) {
+  if (mqtt_handle != &mqtt_sim) {
+    return CY_RSLT_MODULE_MQTT_BADARG;
+  }
+  mqtt_sim.connected = false;
+  mqtt_sim_created = false;
+  return CY_RSLT_SUCCESS;
+}
+
+cy_rslt_t cy_mqtt_connect(cy_mqtt_t mqtt_handle,
+                          cy_mqtt_connect_info_t *connect_info) {
+  cy_rslt_t result;
+
+  if (mqtt_handle != &mqtt_sim) {
+    return CY_RSLT_MODULE_MQTT_BADARG;
+  }
+
+  /* TCP handshake, then CONNECT and CONNACK. */
+  result = round_trip();
+  if (result == CY_RSLT_SUCCESS) {
+    result = round_trip();
+  }
+  if (result != CY_RSLT_SUCCESS) {
+    SIM_TIMELINE("MQTT connection failed");
+    return result;
+  }
+
+  /* A clean session: no subscription survives. */
+  memset(mqtt_sim.subscriptions, 0, sizeof(mqtt_sim.subscriptions));
+  mqtt_sim.keep_alive = pdMS_TO_TICKS(connect_info->keep_alive_sec * 1000u);
+  mqtt_sim.ping_due = xTaskGetTickCount() + mqtt_sim.keep_alive;
+  mqtt_sim.ping_lost = false;
+  xEventGroupClearBits(mqtt_sim_events, MQTT_SIM_LOST);
+  mqtt_sim.connected = true;
+  SIM_TIMELINE("MQTT connected");
+
+  /* The sim task follows the keep-alive from now on. */
+  xTaskNotifyGive(mqtt_sim_task_handle);
+  return CY_RSLT_SUCCESS;
+}
+
+cy_rslt_t cy_mqtt_disconnect(cy_mqtt_t mqtt_handle) {
+  if (mqtt_handle != &mqtt_sim) {
+    return CY_RSLT_MODULE_MQTT_BADARG;
+  }
+  if (mqtt_sim.connected) {
+    mqtt_sim.connected = false;
+    xEventGroupSetBits(mqtt_sim_events, MQTT_SIM_LOST);
+    SIM_TIMELINE("MQTT disconnected");
+  }
+  return CY_RSLT_SUCCESS;
+}
+
+cy_rslt_t cy_mqtt_publish(cy_mqtt_t mqtt_handle,
+                          cy_mqtt_publish_info_t *pub_msg) {
+  TickType_t start = xTaskGetTickCount();
+  cy_rslt_t result = CY_RSLT_SUCCESS;
+
+  if (mqtt_handle != &mqtt_sim) {
+    return CY_RSLT_MODULE_MQTT_BADARG;
+  }
+  if (!mqtt_sim.connected) {
+    return CY_RSLT_MODULE_MQTT_NOT_CONNECTED;
+  }
+
+  if (pub_msg->qos != CY_MQTT_QOS0) {
+    result = round_trip();
+  } else if (!path_is_up()) {
+    /* Sent without an acknowledgement, and lost. */
+    return CY_RSLT_SUCCESS;
+  }
+  if (result != CY_RSLT_SUCCESS) {
+    return result;
+  }
+
+  sim_publish(pub_msg->topic, pub_msg->topic_len, pub_msg->payload,
+              pub_msg->payload_len,
+              (uint32_t)((xTaskGetTickCount() - start) * portTICK_PERIOD_MS));
+  if (publish_hook != NULL) {
+    publish_hook(pub_msg);
+  }
+  return CY_RSLT_SUCCESS;
+}
+
+cy_rslt_t cy_mqtt_subscribe(cy_mqtt_t mqtt_handle,
+                            cy_mqtt_subscribe_info_t *sub_info,
+                            uint8_t sub_count) {
+  cy_rslt_t result = CY_RSLT_SUCCESS;
+
+  if (mqtt_handle != &mqtt_sim) {
+    return CY_RSLT_MODULE_MQTT_BADARG;
+  }
+
+  for (uint8_t i = 0; (i < sub_count) && (result == CY_RSLT_SUCCESS); i++) {
+    result = mqtt_sim.connected ? round_trip()
+                                : CY_RSLT_MODULE_MQTT_NOT_CONNECTED;
+    if (result != CY_RSLT_SUCCESS) {
+      break;
+    }
+
+    result = CY_RSLT_MODULE_MQTT_ERROR;
+    for (uint32_t j = 0; j < MQTT_SIM_SUBSCRIPTIONS; j++) {
+      if (mqtt_sim.subscriptions[j][0] == '\0') {
+        copy_string(mqtt_sim.subscriptions[j], MQTT_SIM_TOPIC_MAX,
+                    sub_info[i].topic, sub_info[i].topic_len);
+        sub_info[i].allocated_qos = sub_info[i].qos;
+        result = CY_RSLT_SUCCESS;
+        break;
+      }
+    }
+  }
+  return result;
+}
+
+cy_rslt_t cy_mqtt_unsubscribe(cy_mqtt_t mqtt_handle,
+                              cy_mqtt_unsubscribe_info_t *unsub_info,
+                              uint8_t unsub_count) {
+  char topic[MQTT_SIM_TOPIC_MAX];
+  cy_rslt_t result = CY_RSLT_SUCCESS;
+
+  if (mqtt_handle != &mqtt_sim) {
+    return CY_RSLT_MODULE_MQTT_BADARG;
+  }
+
+  for (uint8_t i = 0; (i < unsub_count) && (result == CY_RSLT_SUCCESS); i++) {
+    result = mqtt_sim.connected ? round_trip()
+                                : CY_RSLT_MODULE_MQTT_NOT_CONNECTED;
+    if (result != CY_RSLT_SUCCESS) {
+      break;
+    }
+
+    copy_string(topic, sizeof(topic), unsub_info[i].topic,
+                unsub_info[i].topic_len);
+    for (uint32_t j = 0; j < MQTT_SIM_SUBSCRIPTIONS; j++) {
+      if (strcmp(mqtt_sim.subscriptions[j], topic) == 0) {
+        mqtt_sim.subscriptions[j][0] = '\0';
+      }
+    }
+  }
+  return result;
+}
+
+/******************************************************************************
+ * Function Name: mqtt_sim_task
+ ******************************************************************************
+ * Summary:
+ *  Delivers the commands that crossed the broker, follows the keep-alive and
+ *  reports the loss of the session. Sleeps until the next of these is due,
+ *  or until the network changes.
+ *
+ * Parameters:
+ *  void *pvParameters : Task parameter (unused)
+ *
+ ******************************************************************************/
+static void mqtt_sim_task(void *pvParameters) {
+  cy_mqtt_event_t event;
+  TickType_t now;
+  TickType_t wait;
+
+  (void)pvParameters;
+
+  while (true) {
+    now = xTaskGetTickCount();
+    wait = portMAX_DELAY;
+
+    for (uint32_t i = 0; i < MQTT_SIM_INBOX_LENGTH; i++) {
+      mqtt_sim_message_t *message = &inbox[i];
+      bool subscribed = false;
+
+      if (!message->in_use) {
+        continue;
+      }
+      if ((int32_t)(message->due - now) > 0) {
+        if ((message->due - now) < wait) {
+          wait = message->due - now;
+        }
+        continue;
+      }
+
+      for (uint32_t j = 0; j < MQTT_SIM_SUBSCRIPTIONS; j++) {
+        subscribed = subscribed ||
+                     ((mqtt_sim.subscriptions[j][0] != '\0') &&
+                      topic_matches(mqtt_sim.subscriptions[j], message->topic));
+      }
+      if (!mqtt_sim.connected || !path_is_up() || !subscribed) {
+        SIM_TIMELINE("command %.*s lost, device %s", (int)message->payload_len,
+                     message->payload,
+                     mqtt_sim.connected ? "not subscribed" : "offline");
+        message->in_use = false;
+        continue;
+      }
+
+      memset(&event, 0, sizeof(event));
+      event.type = CY_MQTT_EVENT_TYPE_SUBSCRIPTION_MESSAGE_RECEIVE;
+      event.data.pub_msg.received_message.qos = CY_MQTT_QOS1;
+      event.data.pub_msg.received_message.topic = message->topic;
+      event.data.pub_msg.received_message.topic_len =
+          (uint16_t)strlen(message->topic);
+      event.data.pub_msg.received_message.payload = message->payload;
+      event.data.pub_msg.received_message.payload_len = message->payload_len;
+      mqtt_sim.callback(&mqtt_sim, event, mqtt_sim.user_data);
+      message->in_use = false;
+    }
+
+    if (mqtt_sim.connected) {
+      if (!cy_wcm_is_connected_to_ap()) {
+        session_lost("link down");
+      } else if ((int32_t)(now - mqtt_sim.ping_due) >= 0) {
+        if (mqtt_sim.ping_lost) {
+          session_lost("keep-alive timeout");
+        } else {
+          /* PINGREQ: answered after a round trip, or never. */
+          mqtt_sim.ping_lost = !path_is_up();
+          mqtt_sim.ping_due =
+              now + (mqtt_sim.ping_lost ? pdMS_TO_TICKS(MQTT_TIMEOUT_MS)
+                                        : mqtt_sim.keep_alive);
+        }
+      }
+    }
+    if (mqtt_sim.connected && ((mqtt_sim.ping_due - now) < wait)) {
+      wait = mqtt_sim.ping_due - now;
+    }
+
+    ulTaskNotifyTake(pdTRUE, wait);
+  }
+}
+
+/* Called by sim.c when the AP or the broker comes or goes. */
+void mqtt_sim_path_changed(void) {
+  if (mqtt_sim_task_handle != NULL) {
+    xTaskNotifyGive(mqtt_sim_task_handle);
+  }
+}
+
+static bool path_is_up(void) {
+  return cy_wcm_is_connected_to_ap() && sim_broker_is_up();
+}
+
+/******************************************************************************
+ * Function Name: round_trip
+ ******************************************************************************
+ * Summary:
+ *  A request and its answer. Without a path to the broker the request times
+ *  out, unless the loss of the session is noticed first.
+ *
+ * Return:
+ *  cy_rslt_t : CY_RSLT_SUCCESS once answered, else an error code
+ *
+ ******************************************************************************/
+static cy_rslt_t round_trip(void) {
+  TickType_t rtt = pdMS_TO_TICKS(sim_config.rtt_ms);
+  TickType_t timeout = pdMS_TO_TICKS(MQTT_TIMEOUT_MS);
+  TickType_t rest = (timeout > rtt) ? timeout - rtt : 0u;
+
+  if (!mqtt_sim.connected) {
+    /* Connecting: nothing to notice but the timeout. */
+    vTaskDelay(rtt);
+    if (path_is_up()) {
+      return CY_RSLT_SUCCESS;
+    }
+    vTaskDelay(rest);
+    return CY_RSLT_MODULE_MQTT_TIMEOUT;
+  }
+
+  if (xEventGroupWaitBits(mqtt_sim_events, MQTT_SIM_LOST, pdFALSE, pdFALSE,
+                          rtt) &
+      MQTT_SIM_LOST) {
+    return CY_RSLT_MODULE_MQTT_NOT_CONNECTED;
+  }
+  if (path_is_up()) {
+    return CY_RSLT_SUCCESS;
+  }
+  if (xEventGroupWaitBits(mqtt_sim_events, MQTT_SIM_LOST, pdFALSE, pdFALSE,
+                          rest) &
+      MQTT_SIM_LOST) {
+    return CY_RSLT_MODULE_MQTT_NOT_CONNECTED;
+  }
+  return CY_RSLT_MODULE_MQTT_TIMEOUT;
+}
+
+/******************************************************************************
+ * Function Name: session_lost
+ ******************************************************************************
+ * Summary:
+ *  Ends the session and reports it to the application, from the sim task.
+ *
+ * Parameters:
+ *  const char *reason : For the timeline
+ *
+ ******************************************************************************/
+static void session_lost(const char *reason) {
+  cy_mqtt_event_t event;
+
+  mqtt_sim.connected = false;
+  xEventGroupSetBits(mqtt_sim_events, MQTT_SIM_LOST);
+  SIM_TIMELINE("MQTT session lost: %s", reason);
+
+  memset(&event, 0, sizeof(event));
+  event.type = CY_MQTT_EVENT_TYPE_DISCONNECT;
+  event.data.reason = CY_MQTT_DISCONN_TYPE_NETWORK_DOWN;
+  mqtt_sim.callback(&mqtt_sim, event, mqtt_sim.user_data);
+}
+
+/******************************************************************************
+ * Function Name: topic_matches
+ ******************************************************************************
+ * Summary:
+ *  Matches a topic against a filter with the '+' and '#' wildcards.
+ *
+ ******************************************************************************/
+static bool topic_matches(const char *filter, const char *topic) {
+  while ((*filter != '\0') && (*topic != '\0')) {
+    if (*filter == '#') {
+      return true;
+    }
+    if (*filter == '+') {
+      while ((*topic != '\0') && (*topic != '/')) {
+        topic++;
+      }
+      filter++;
+      continue;
+    }
+    if (*filter != *topic) {
+      return false;
+    }
+    filter++;
+    topic++;
+  }
+  return (*topic == '\0') &&
+         ((*filter == '\0') || (strcmp(filter, "/#") == 0) ||
+          (strcmp(filter, "#") == 0));
+}
+
+/******************************************************************************
+ * Function Name: copy_string
+ ******************************************************************************
+ * Summary:
+ *  Copies a string with a length, as the library API passes them, into a NUL
+ *  terminated buffer. Truncates to the buffer.
+ *
+ ******************************************************************************/
+static void copy_string(char *dest, size_t dest_size, const char *string,
+                        uint16_t length) {
+  size_t len = (length < dest_size) ? length : dest_size - 1u;
+
+  if (string == NULL) {
+    len = 0;
+  } else {
+    memcpy(dest, string, len);
+  }
+  dest[len] = '\0';
+}
+
+void host_mqtt_set_publish_hook(host_publish_hook_t hook) {
+  publish_hook = hook;
+}
+
+/******************************************************************************
+ * Function Name: host_mqtt_publish_command
+ ******************************************************************************
+ * Summary:
+ *  Publishes a command from a remote user. It reaches the broker after half a
+ *  round trip and the device after another half, when the user receives the
+ *  PUBACK. Only called from the scenario task.
+ *
+ * Parameters:
+ *  const char *topic   : Topic
+ *  const char *payload : Command
+ *
+ * Return:
+ *  cy_rslt_t : CY_RSLT_SUCCESS once acknowledged, else an error code
+ *
+ ******************************************************************************/
+cy_rslt_t host_mqtt_publish_command(const char *topic, const char *payload) {
+  mqtt_sim_message_t *message = NULL;
+
+  if (!sim_broker_is_up()) {
+    vTaskDelay(pdMS_TO_TICKS(MQTT_TIMEOUT_MS));
+    return CY_RSLT_MODULE_MQTT_TIMEOUT;
+  }
+
+  for (uint32_t i = 0; i < MQTT_SIM_INBOX_LENGTH; i++) {
+    if (!inbox[i].in_use) {
+      message = &inbox[i];
+      break;
+    }
+  }
+  if ((message == NULL) || (strlen(payload) > sizeof(message->payload))) {
+    return CY_RSLT_MODULE_MQTT_ERROR;
+  }
+
+  snprintf(message->topic, sizeof(message->topic), "%s", topic);
+  message->payload_len = strlen(payload);
+  memcpy(message->payload, payload, message->payload_len);
+  message->due = xTaskGetTickCount() + pdMS_TO_TICKS(sim_config.rtt_ms);
+  message->in_use = true;
+  xTaskNotifyGive(mqtt_sim_task_handle);
+
+  vTaskDelay(pdMS_TO_TICKS(sim_config.rtt_ms));
+  return CY_RSLT_SUCCESS;
+}
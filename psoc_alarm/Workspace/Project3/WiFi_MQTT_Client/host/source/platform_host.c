@@ -0,0 +1,80 @@
+/**
+ * This file implements the stand-ins of the application modules that depend
+ * on the board rather than on a library: the DMA console, the reconnect
+ * cache in flash, the TLS heap and the newlib heap instrumentation.
+ *
+ * The console writes to stdout directly, the cache never holds a hint so
+ * every connection takes the full path, and the heap reports are empty.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "console.h"
+#include "heap_stats.h"
+#include "mqtt_client_config.h"
+#include "net_cache.h"
+#include "tls_memory.h"
+
+/******************************************************************************
+ * Global Variables
+ ******************************************************************************/
+static char broker_host[] = MQTT_BROKER_ADDRESS;
+
+cy_rslt_t console_init(void) { return CY_RSLT_SUCCESS; }
+
+void console_flush(void) { fflush(stdout); }
+
+void console_get_stats(console_stats_t *stats, bool reset) {
+  (void)reset;
+  memset(stats, 0, sizeof(*stats));
+}
+
+void net_cache_init(void) {}
+
+bool net_cache_apply_ap_hints(cy_wcm_connect_params_t *connect_param,
+                              cy_wcm_ip_setting_t *ip_settings) {
+  (void)connect_param;
+  (void)ip_settings;
+  return false;
+}
+
+void net_cache_store_ap(void) {}
+
+void net_cache_invalidate_ap(void) {}
+
+void net_cache_set_ap(const cy_wcm_mac_t bssid, uint8_t channel) {
+  (void)bssid;
+  (void)channel;
+}
+
+void net_cache_invalidate_lease(void) {}
+
+const char *net_cache_broker_host(uint16_t *hostname_len) {
+  *hostname_len = (uint16_t)strlen(broker_host);
+  return broker_host;
+}
+
+bool net_cache_broker_is_cached(void) { return false; }
+
+void net_cache_invalidate_broker(void) {}
+
+void tls_memory_init(void) {}
+
+void tls_memory_reset_peak(void) {}
+
+void tls_memory_report(const char *label) { (void)label; }
+
+size_t tls_memory_current(void) { return 0u; }
+
+size_t tls_memory_peak(void) { return 0u; }
+
+void heap_stats_get(heap_stats_snapshot_t *snapshot) {
+  memset(snapshot, 0, sizeof(*snapshot));
+}
+
+void heap_stats_publish(void) {
+  printf("Heap statistics are not available on the host build\n");
+}
+
+void heap_stats_dump(void) { heap_stats_publish(); }
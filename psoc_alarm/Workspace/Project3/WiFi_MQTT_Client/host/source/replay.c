@@ -0,0 +1,377 @@
+/**
+ * This file implements the replay of an event recorder dump on the host.
+ *
+ * The dump is the text the device publishes on MQTT_RECORD_TOPIC for the
+ * RECDUMP command (see source/recorder.c), saved by any MQTT client:
+ *
+ *   mosquitto_sub -t security/record > rec.txt
+ *
+ * One boot of the dump is replayed: its inputs go to the application at the
+ * recorded times, relative to the first one, through the same paths as on
+ * the board. The Bluetooth states go to the state queue, the button to the
+ * GPIO callback and the commands through the broker. A reconnection posts
+ * SEC_INIT, as the connection manager does. The replay starts once the host
+ * is online, so the startup of the board before the first input is not
+ * compared.
+ *
+ * The publishes of the state task in the window, recorded by the host build
+ * as they are on the device, are then compared with the recorded ones by
+ * message class and payload hash, in order. The window ends REPLAY_SETTLE_MS
+ * after the last input. A difference in its last REPLAY_TAIL_MS, where the
+ * blinking of the tripped state falls on either side of the end, is not
+ * counted.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* FreeRTOS header files */
+#include <FreeRTOS.h>
+#include "queue.h"
+#include "task.h"
+
+#include "cybsp.h"
+#include "host.h"
+#include "mqtt_client_config.h"
+#include "recorder.h"
+#include "replay.h"
+#include "sim.h"
+#include "state.h"
+
+/******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Records of a dump, more than RECORDER_BUFFER_SIZE holds. */
+#define REPLAY_MAX_RECORDS (1024u)
+
+/* Outputs compared after the last input, and the end of the window where
+ * a difference is tolerated.
+ */
+#define REPLAY_SETTLE_MS (3000u)
+#define REPLAY_TAIL_MS (600u)
+
+#define REPLAY_LINE_SIZE (256u)
+
+/******************************************************************************
+ * Types
+ ******************************************************************************/
+typedef struct {
+  /* Time relative to the first input of the window. */
+  uint32_t time_ms;
+  uint8_t message_class;
+  uint32_t hash;
+} replay_output_t;
+
+/******************************************************************************
+ * Global Variables
+ ******************************************************************************/
+static recorder_record_t records[REPLAY_MAX_RECORDS];
+static bool present[REPLAY_MAX_RECORDS];
+
+/* Records of the selected boot. */
+static uint32_t first;
+static uint32_t count;
+
+static replay_output_t expected[REPLAY_MAX_RECORDS];
+static replay_output_t actual[REPLAY_MAX_RECORDS];
+
+static const char *const source_names[RECORDER_SOURCE_COUNT] = {
+    [RECORDER_BOOT] = "boot",           [RECORDER_BT] = "bt",
+    [RECORDER_BUTTON] = "button",       [RECORDER_COMMAND] = "command",
+    [RECORDER_RECONNECT] = "reconnect", [RECORDER_MQTT_TASK] = "mqtt_task",
+    [RECORDER_PUBLISH] = "publish",
+};
+
+/******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+static bool parse_line(const char *line);
+static bool is_input(const recorder_record_t *record);
+static void inject(const recorder_record_t *record);
+static uint32_t collect_output(const recorder_record_t *record,
+                               uint32_t start_ms, uint32_t end_ms,
+                               replay_output_t *outputs, uint32_t n);
+static const char *class_topic(uint8_t message_class);
+
+/******************************************************************************
+ * Function Name: replay_load
+ ******************************************************************************
+ * Summary:
+ *  Reads a dump and selects the records of one boot. A file holds one dump,
+ *  its messages in any order.
+ *
+ * Parameters:
+ *  const char *path : Dump file
+ *  int boot         : Boot of the dump, from 0, or REPLAY_LAST_BOOT
+ *
+ * Return:
+ *  bool : false if the file cannot be read, is incomplete or has no such
+ *         boot with inputs
+ *
+ ******************************************************************************/
+bool replay_load(const char *path, int boot) {
+  FILE *file = fopen(path, "r");
+  char line[REPLAY_LINE_SIZE];
+  uint32_t total = 0u;
+  int boots = 0;
+
+  if (file == NULL) {
+    printf("Replay: opening %s failed\n", path);
+    return false;
+  }
+  while (fgets(line, sizeof(line), file) != NULL) {
+    if ((strncmp(line, "R ", 2u) == 0) && !parse_line(line)) {
+      printf("Replay: bad record %s", line);
+      fclose(file);
+      return false;
+    }
+  }
+  fclose(file);
+
+  while ((total < REPLAY_MAX_RECORDS) && present[total]) {
+    total++;
+  }
+  for (uint32_t i = total; i < REPLAY_MAX_RECORDS; i++) {
+    if (present[i]) {
+      printf("Replay: record %lx of the dump is missing\n",
+             (unsigned long)total);
+      return false;
+    }
+  }
+
+  /* Boots start at a RECORDER_BOOT record, the oldest one may not. */
+  for (uint32_t i = 0; i < total; i++) {
+    if ((records[i].source == RECORDER_BOOT) && (i > 0u)) {
+      boots++;
+    }
+  }
+  if (boot == REPLAY_LAST_BOOT) {
+    boot = boots;
+  }
+  if ((boot < 0) || (boot > boots)) {
+    printf("Replay: the dump has boots 0 to %d\n", boots);
+    return false;
+  }
+
+  boots = 0;
+  first = 0u;
+  count = 0u;
+  for (uint32_t i = 0; i < total; i++) {
+    if ((records[i].source == RECORDER_BOOT) && (i > 0u)) {
+      boots++;
+    }
+    if (boots == boot) {
+      if (count == 0u) {
+        first = i;
+      }
+      count++;
+    }
+  }
+
+  for (uint32_t i = first; i < first + count; i++) {
+    if (is_input(&records[i])) {
+      printf("Replay: boot %d of %s, %lu records\n", boot, path,
+             (unsigned long)count);
+      return true;
+    }
+  }
+  printf("Replay: boot %d of %s has no inputs\n", boot, path);
+  return false;
+}
+
+bool replay_loaded(void) {
+  return count > 0u;
+}
+
+/******************************************************************************
+ * Function Name: replay_run
+ ******************************************************************************
+ * Summary:
+ *  Replays the inputs of the loaded boot, waits for the window to end and
+ *  prints the recorded and the replayed outputs side by side. Called by the
+ *  scenario task once the application is online.
+ *
+ * Return:
+ *  uint32_t : Outputs that differ
+ *
+ ******************************************************************************/
+uint32_t replay_run(void) {
+  uint32_t cursor = recorder_cursor();
+  uint32_t t_first = UINT32_MAX;
+  uint32_t t_last = 0u;
+  uint32_t window_ms;
+  uint32_t n_expected = 0u;
+  uint32_t n_actual = 0u;
+  uint32_t mismatches = 0u;
+  TickType_t start = xTaskGetTickCount();
+  TickType_t wake = start;
+  uint32_t start_ms = start * portTICK_PERIOD_MS;
+  recorder_record_t record;
+
+  for (uint32_t i = first; i < first + count; i++) {
+    if (is_input(&records[i])) {
+      if (t_first == UINT32_MAX) {
+        t_first = records[i].time_ms;
+      }
+      t_last = records[i].time_ms;
+    }
+  }
+  window_ms = t_last - t_first + REPLAY_SETTLE_MS;
+
+  for (uint32_t i = first; i < first + count; i++) {
+    const recorder_record_t *input = &records[i];
+    TickType_t at = start + pdMS_TO_TICKS(input->time_ms - t_first);
+
+    if (!is_input(input)) {
+      continue;
+    }
+    /* Inputs already behind their time go in at once, in order. */
+    if ((at - start) > (wake - start)) {
+      vTaskDelayUntil(&wake, at - wake);
+    }
+    SIM_TIMELINE("replay %s", source_names[input->source]);
+    inject(input);
+  }
+  vTaskDelayUntil(&wake, (start + pdMS_TO_TICKS(window_ms)) - wake);
+
+  for (uint32_t i = first; i < first + count; i++) {
+    n_expected = collect_output(&records[i], t_first, t_first + window_ms,
+                                expected, n_expected);
+  }
+  while (recorder_read(&cursor, &record)) {
+    n_actual = collect_output(&record, start_ms, start_ms + window_ms, actual,
+                              n_actual);
+  }
+
+  printf("\nReplay: %lu ms\n%-4s %-28s %8s %8s %9s\n", (unsigned long)window_ms,
+         "#", "topic", "device", "host", "");
+  for (uint32_t i = 0; (i < n_expected) || (i < n_actual); i++) {
+    const replay_output_t *e = (i < n_expected) ? &expected[i] : NULL;
+    const replay_output_t *a = (i < n_actual) ? &actual[i] : NULL;
+    bool same = (e != NULL) && (a != NULL) &&
+                (e->message_class == a->message_class) && (e->hash == a->hash);
+    bool tail = ((e == NULL) || (e->time_ms + REPLAY_TAIL_MS >= window_ms)) &&
+                ((a == NULL) || (a->time_ms + REPLAY_TAIL_MS >= window_ms));
+    char device[12] = "-";
+    char host[12] = "-";
+
+    if (e != NULL) {
+      snprintf(device, sizeof(device), "%lu", (unsigned long)e->time_ms);
+    }
+    if (a != NULL) {
+      snprintf(host, sizeof(host), "%lu", (unsigned long)a->time_ms);
+    }
+    printf("%-4lu %-28s %8s %8s %9s\n", (unsigned long)i,
+           class_topic((e != NULL) ? e->message_class : a->message_class),
+           device, host, same ? "" : (tail ? "tail" : "DIFFERS"));
+    if (!same && !tail) {
+      mismatches++;
+    }
+  }
+  printf("Replay: %lu of %lu outputs differ\n", (unsigned long)mismatches,
+         (unsigned long)((n_expected > n_actual) ? n_expected : n_actual));
+  return mismatches;
+}
+
+/******************************************************************************
+ * Function Name: parse_line
+ ******************************************************************************
+ * Summary:
+ *  Parses a record line of the dump, see source/recorder.c.
+ *
+ ******************************************************************************/
+static bool parse_line(const char *line) {
+  unsigned long index;
+  unsigned long time_ms;
+  unsigned source;
+  int offset = 0;
+  recorder_record_t record = {0};
+
+  if ((sscanf(line, "R %lx %lu %u %n", &index, &time_ms, &source, &offset) !=
+       3) ||
+      (offset == 0) || (index >= REPLAY_MAX_RECORDS) ||
+      (source >= RECORDER_SOURCE_COUNT)) {
+    return false;
+  }
+  record.time_ms = (uint32_t)time_ms;
+  record.source = (uint8_t)source;
+  for (const char *hex = &line[offset]; (hex[0] != '\n') && (hex[0] != '\0');
+       hex += 2) {
+    unsigned byte;
+
+    if ((record.len == RECORDER_PAYLOAD_MAX) ||
+        (sscanf(hex, "%2x", &byte) != 1)) {
+      return false;
+    }
+    record.data[record.len++] = (uint8_t)byte;
+  }
+  records[index] = record;
+  present[index] = true;
+  return true;
+}
+
+static bool is_input(const recorder_record_t *record) {
+  return (record->source == RECORDER_BT) ||
+         (record->source == RECORDER_BUTTON) ||
+         (record->source == RECORDER_COMMAND) ||
+         (record->source == RECORDER_RECONNECT);
+}
+
+/******************************************************************************
+ * Function Name: inject
+ ******************************************************************************
+ * Summary:
+ *  Feeds a recorded input to the application, see the top of the file.
+ *
+ ******************************************************************************/
+static void inject(const recorder_record_t *record) {
+  State state = {0};
+  char command[RECORDER_PAYLOAD_MAX + 1];
+
+  switch (record->source) {
+  case RECORDER_BT:
+    state.state = (enum States)record->data[0];
+    memcpy(&state.meta, &record->data[1], RECORDER_STATE_META_SIZE);
+    xQueueSend(xStateQueue, &state, portMAX_DELAY);
+    break;
+  case RECORDER_BUTTON:
+    host_gpio_event(CYBSP_USER_BTN, CYHAL_GPIO_IRQ_FALL);
+    break;
+  case RECORDER_COMMAND:
+    memcpy(command, record->data, record->len);
+    command[record->len] = '\0';
+    if (host_mqtt_publish_command(MQTT_SUB_TOPIC, command) !=
+        CY_RSLT_SUCCESS) {
+      printf("Replay: publishing the command %s failed\n", command);
+    }
+    break;
+  case RECORDER_RECONNECT:
+    state.state = SEC_INIT;
+    xQueueSend(xStateQueue, &state, portMAX_DELAY);
+    break;
+  default:
+    break;
+  }
+}
+
+/* Appends a publish record inside [start_ms, end_ms] to the outputs. */
+static uint32_t collect_output(const recorder_record_t *record,
+                               uint32_t start_ms, uint32_t end_ms,
+                               replay_output_t *outputs, uint32_t n) {
+  if ((record->source != RECORDER_PUBLISH) || (record->len != 5u) ||
+      (record->time_ms < start_ms) || (record->time_ms > end_ms) ||
+      (n == REPLAY_MAX_RECORDS)) {
+    return n;
+  }
+  outputs[n].time_ms = record->time_ms - start_ms;
+  outputs[n].message_class = record->data[0];
+  memcpy(&outputs[n].hash, &record->data[1], sizeof(outputs[n].hash));
+  return n + 1u;
+}
+
+static const char *class_topic(uint8_t message_class) {
+  return (message_class < MQTT_CLASS_COUNT)
+             ? mqtt_message_classes[message_class].topic
+             : "?";
+}
@@ -0,0 +1,28 @@
+/*
+ * replay.h
+ *
+ * Replay of an event recorder dump (see source/recorder.c) against the host
+ * build: the inputs of one boot go to the state task at their recorded
+ * times, and its publishes are compared with the recorded ones.
+ */
+
+#ifndef HOST_REPLAY_H_
+#define HOST_REPLAY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Boot of replay_load() selecting the last boot of the dump. */
+#define REPLAY_LAST_BOOT (-1)
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+bool replay_load(const char *path, int boot);
+bool replay_loaded(void);
+uint32_t replay_run(void);
+
+#endif /* HOST_REPLAY_H_ */
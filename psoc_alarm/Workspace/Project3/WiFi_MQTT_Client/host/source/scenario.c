@@ -0,0 +1,572 @@
+/**
+ * This file implements the scripted scenarios of the host build.
+ *
+ * A scenario is a list of steps. A step injects one event the way the radio,
+ * the button or a remote user produces it on the board and, if the event
+ * leads to a publish, waits for that publish in the publish hook of the MQTT
+ * stand-in. The latency of a step runs from the injection to the broker
+ * acknowledging the publish, so it covers the callbacks, the state task,
+ * the publisher and the broker round trip. Commands go through the broker
+ * too, so their steps include its round trip twice.
+ *
+ *   pair       : passkey notification -> PAIRING event
+ *   disconnect : GATT connect, GATT disconnect -> ACTIVE state
+ *   trip       : ACTIVATEALARM -> ACTIVE, TRIPALARM -> TRIPPED,
+ *                DEACTIVATEALARM -> UNACTIVE
+ *   button     : TRIPALARM -> TRIPPED, button press -> UNACTIVE
+ *   storm      : TRIPALARM -> TRIPPED, a bouncing button -> UNACTIVE
+ *
+ * The simulation build adds the scenarios of the network model, whose steps
+ * wait through the reconnection of the application:
+ *
+ *   outage     : broker outage, GATT connect, GATT disconnect -> ACTIVE
+ *   flap       : AP lost and back -> "online" status
+ *
+ * Every scenario leaves the alarm out of the tripped state, so they can run
+ * in any order. The tripped state publishes at once, but the state task
+ * then sleeps TRIP_ALARM_DELAY_MS of state.c to blink the LED, which shows
+ * up in the steps right after a trip.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* FreeRTOS header files */
+#include <FreeRTOS.h>
+#include "semphr.h"
+#include "task.h"
+
+#include "cybsp.h"
+#include "deadline.h"
+#include "host.h"
+#include "mqtt_client_config.h"
+#include "probe.h"
+#include "replay.h"
+#include "scenario.h"
+#include "sim.h"
+
+/******************************************************************************
+ * Macros
+ ******************************************************************************/
+#define SCENARIO_MAX_STEPS (4u)
+
+/* Wait for the publish of a step, see scenario_t. */
+#define SCENARIO_STEP_TIMEOUT_MS (5000u)
+
+/* Wait for the first connection, then for the subscription and the
+ * Bluetooth initialization to settle.
+ */
+#define SCENARIO_ONLINE_TIMEOUT_MS (60000u)
+#define SCENARIO_SETTLE_MS (1000u)
+
+#define SCENARIO_PASSKEY (123456u)
+
+/* Presses of a bouncing button, and the time between two. */
+#define SCENARIO_STORM_PRESSES (20u)
+#define SCENARIO_STORM_GAP_MS (10u)
+
+/* Step timeout of the network scenarios: the disturbance of sim_config plus
+ * the reconnection, MAX_WIFI_CONN_RETRIES and MAX_MQTT_CONN_RETRIES cover
+ * much more.
+ */
+#define SCENARIO_RECOVERY (UINT32_MAX)
+#define SCENARIO_RECOVERY_TIMEOUT_MS (20u * 60u * 1000u)
+
+/******************************************************************************
+ * Types
+ ******************************************************************************/
+typedef void (*scenario_inject_t)(const char *arg);
+
+typedef struct {
+  const char *name;
+  scenario_inject_t inject;
+  const char *arg;
+  /* Publish the step waits for, NULL to only inject. */
+  const char *topic;
+  const char *match;
+} scenario_step_t;
+
+typedef struct {
+  const char *name;
+  /* Wait for the publish of a step. */
+  uint32_t timeout_ms;
+  scenario_step_t steps[SCENARIO_MAX_STEPS];
+} scenario_t;
+
+typedef struct {
+  uint32_t *latency_us;
+  uint32_t count;
+  uint32_t misses;
+} scenario_result_t;
+
+/******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+static void inject_passkey(const char *arg);
+static void inject_pairing_complete(const char *arg);
+static void inject_gatt(const char *arg);
+static void inject_command(const char *arg);
+static void inject_button(const char *arg);
+static void inject_storm(const char *arg);
+#if HOST_SIM
+static void inject_outage(const char *arg);
+static void inject_flap(const char *arg);
+#endif
+static uint32_t step_timeout_ms(const scenario_t *scenario);
+static void publish_hook(const cy_mqtt_publish_info_t *info);
+static void expect_arm(const char *topic, const char *match);
+static bool expect_wait(uint64_t start_us, uint32_t timeout_ms,
+                        uint32_t *latency_us);
+static void report(void);
+
+/******************************************************************************
+ * Global Variables
+ ******************************************************************************/
+static const scenario_t scenarios[] = {
+    {"pair",
+     SCENARIO_STEP_TIMEOUT_MS,
+     {{"passkey", inject_passkey, NULL, MQTT_EVENT_TOPIC,
+       "\"state\":\"PAIRING\""},
+      {"bonded", inject_pairing_complete, NULL, NULL, NULL}}},
+    {"disconnect",
+     SCENARIO_STEP_TIMEOUT_MS,
+     {{"connect", inject_gatt, "connect", NULL, NULL},
+      {"disconnect", inject_gatt, "disconnect", MQTT_STATE_TOPIC,
+       "\"state\":\"ACTIVE\""}}},
+    {"trip",
+     SCENARIO_STEP_TIMEOUT_MS,
+     {{"activate", inject_command, "ACTIVATEALARM", MQTT_STATE_TOPIC,
+       "\"state\":\"ACTIVE\""},
+      {"trip", inject_command, "TRIPALARM", MQTT_STATE_TOPIC,
+       "\"state\":\"TRIPPED\""},
+      {"deactivate", inject_command, "DEACTIVATEALARM", MQTT_STATE_TOPIC,
+       "\"state\":\"UNACTIVE\""}}},
+    {"button",
+     SCENARIO_STEP_TIMEOUT_MS,
+     {{"trip", inject_command, "TRIPALARM", MQTT_STATE_TOPIC,
+       "\"state\":\"TRIPPED\""},
+      {"press", inject_button, NULL, MQTT_STATE_TOPIC,
+       "\"state\":\"UNACTIVE\""}}},
+    {"storm",
+     SCENARIO_STEP_TIMEOUT_MS,
+     {{"trip", inject_command, "TRIPALARM", MQTT_STATE_TOPIC,
+       "\"state\":\"TRIPPED\""},
+      {"bounce", inject_storm, NULL, MQTT_STATE_TOPIC,
+       "\"state\":\"UNACTIVE\""}}},
+#if HOST_SIM
+    {"outage",
+     SCENARIO_RECOVERY,
+     {{"outage", inject_outage, NULL, NULL, NULL},
+      {"connect", inject_gatt, "connect", NULL, NULL},
+      {"disconnect", inject_gatt, "disconnect", MQTT_STATE_TOPIC,
+       "\"state\":\"ACTIVE\""}}},
+    {"flap",
+     SCENARIO_RECOVERY,
+     {{"flap", inject_flap, NULL, MQTT_STATUS_TOPIC,
+       MQTT_STATUS_ONLINE_MESSAGE}}},
+#endif
+};
+
+#define SCENARIO_COUNT (sizeof(scenarios) / sizeof(scenarios[0]))
+
+static bool selected[SCENARIO_COUNT];
+static bool selected_any;
+static uint32_t iterations = 100u;
+static uint32_t gap_ms = 200u;
+
+static scenario_result_t results[SCENARIO_COUNT][SCENARIO_MAX_STEPS];
+
+/* Publish awaited by the scenario task, matched by the publish hook. */
+static SemaphoreHandle_t expect_done;
+static const char *expect_topic;
+static const char *expect_match;
+static uint64_t expect_end_us;
+static bool expect_armed;
+
+static const wiced_bt_device_address_t peer_bd_addr = {0x02, 0x11, 0x22,
+                                                       0x33, 0x44, 0x55};
+
+/******************************************************************************
+ * Function Name: scenario_select
+ ******************************************************************************
+ * Summary:
+ *  Adds a scenario to the run, "all" adds every scenario. The selected
+ *  scenarios run in the order of the table, once per iteration.
+ *
+ * Parameters:
+ *  const char *name : Scenario name
+ *
+ * Return:
+ *  bool : false if the name is unknown
+ *
+ ******************************************************************************/
+bool scenario_select(const char *name) {
+  bool found = false;
+
+  for (uint32_t i = 0; i < SCENARIO_COUNT; i++) {
+    if ((strcmp(name, "all") == 0) || (strcmp(name, scenarios[i].name) == 0)) {
+      selected[i] = true;
+      selected_any = true;
+      found = true;
+    }
+  }
+  return found;
+}
+
+void scenario_configure(uint32_t scenario_iterations, uint32_t step_gap_ms) {
+  iterations = scenario_iterations;
+  gap_ms = step_gap_ms;
+}
+
+void scenario_list(void) {
+  for (uint32_t i = 0; i < SCENARIO_COUNT; i++) {
+    printf(" %s", scenarios[i].name);
+  }
+  printf("\n");
+}
+
+/******************************************************************************
+ * Function Name: scenario_task
+ ******************************************************************************
+ * Summary:
+ *  Waits for the application to come online, runs the selected scenarios
+ *  one after the other for the configured iterations, prints the report and
+ *  ends the process, with exit status 1 if a publish never came. With a
+ *  recorder dump loaded it replays the dump instead, with exit status 1 if
+ *  an output differs.
+ *
+ * Parameters:
+ *  void *pvParameters : Task parameter (unused)
+ *
+ ******************************************************************************/
+void scenario_task(void *pvParameters) {
+  uint64_t start_us;
+  uint32_t latency_us;
+  uint32_t misses = 0;
+
+  (void)pvParameters;
+
+#if HOST_SIM
+  /* First of all tasks: the tick runs on virtual time from now on. */
+  sim_start();
+#endif
+  expect_done = xSemaphoreCreateBinary();
+  CY_ASSERT(expect_done != NULL);
+  if (!selected_any) {
+    scenario_select("all");
+  }
+  for (uint32_t s = 0; s < SCENARIO_COUNT; s++) {
+    for (uint32_t i = 0; i < SCENARIO_MAX_STEPS; i++) {
+      results[s][i].latency_us = calloc(iterations, sizeof(uint32_t));
+      CY_ASSERT((iterations == 0u) || (results[s][i].latency_us != NULL));
+    }
+  }
+  host_mqtt_set_publish_hook(publish_hook);
+
+  expect_arm(MQTT_STATUS_TOPIC, MQTT_STATUS_ONLINE_MESSAGE);
+  if (!expect_wait(host_time_us(), SCENARIO_ONLINE_TIMEOUT_MS, &latency_us)) {
+    printf("Scenario: the application did not come online\n");
+    SIM_TIMELINE("the application did not come online");
+#if HOST_SIM
+    sim_report();
+#endif
+    exit(1);
+  }
+  printf("Scenario: online after %lu ms\n",
+         (unsigned long)(latency_us / 1000u));
+  vTaskDelay(pdMS_TO_TICKS(SCENARIO_SETTLE_MS));
+
+  if (replay_loaded()) {
+    misses = replay_run();
+    iterations = 0u;
+  }
+
+  for (uint32_t n = 0; n < iterations; n++) {
+    for (uint32_t s = 0; s < SCENARIO_COUNT; s++) {
+      const scenario_t *scenario = &scenarios[s];
+      scenario_result_t *result = results[s];
+
+      if (!selected[s]) {
+        continue;
+      }
+
+      for (uint32_t i = 0;
+           (i < SCENARIO_MAX_STEPS) && (scenario->steps[i].name != NULL); i++) {
+        const scenario_step_t *step = &scenario->steps[i];
+
+        SIM_TIMELINE("scenario %s/%s", scenario->name, step->name);
+        if (step->topic == NULL) {
+          step->inject(step->arg);
+          vTaskDelay(pdMS_TO_TICKS(gap_ms));
+          continue;
+        }
+
+        expect_arm(step->topic, step->match);
+        start_us = host_time_us();
+        step->inject(step->arg);
+        if (expect_wait(start_us, step_timeout_ms(scenario), &latency_us)) {
+          result[i].latency_us[result[i].count++] = latency_us;
+        } else {
+          result[i].misses++;
+          misses++;
+          printf("Scenario: %s/%s timed out\n", scenario->name, step->name);
+          SIM_TIMELINE("scenario %s/%s timed out", scenario->name,
+                       step->name);
+        }
+        vTaskDelay(pdMS_TO_TICKS(gap_ms));
+      }
+    }
+  }
+
+  if (!replay_loaded()) {
+    report();
+  }
+  probe_print();
+  deadline_print();
+#if HOST_SIM
+  sim_report();
+#endif
+  fflush(stdout);
+  exit((misses == 0u) ? 0 : 1);
+}
+
+/* Resolves the step timeout of a scenario, see SCENARIO_RECOVERY. */
+static uint32_t step_timeout_ms(const scenario_t *scenario) {
+#if HOST_SIM
+  if (scenario->timeout_ms == SCENARIO_RECOVERY) {
+    return sim_config.outage_ms + sim_config.flap_ms +
+           SCENARIO_RECOVERY_TIMEOUT_MS;
+  }
+#endif
+  return scenario->timeout_ms;
+}
+
+/******************************************************************************
+ * Function Name: expect_arm
+ ******************************************************************************
+ * Summary:
+ *  Arms the publish hook for a publish, before the event causing it is
+ *  injected.
+ *
+ * Parameters:
+ *  const char *topic : Topic of the publish
+ *  const char *match : Text the payload must contain
+ *
+ ******************************************************************************/
+static void expect_arm(const char *topic, const char *match) {
+  xSemaphoreTake(expect_done, 0);
+  taskENTER_CRITICAL();
+  expect_topic = topic;
+  expect_match = match;
+  expect_armed = true;
+  taskEXIT_CRITICAL();
+}
+
+/******************************************************************************
+ * Function Name: expect_wait
+ ******************************************************************************
+ * Summary:
+ *  Waits for the publish armed by expect_arm().
+ *
+ * Parameters:
+ *  uint64_t start_us    : Time of the injection
+ *  uint32_t timeout_ms  : Wait
+ *  uint32_t *latency_us : Receives the time from the injection to the publish
+ *
+ * Return:
+ *  bool : true if the publish came in time
+ *
+ ******************************************************************************/
+static bool expect_wait(uint64_t start_us, uint32_t timeout_ms,
+                        uint32_t *latency_us) {
+  bool done =
+      (xSemaphoreTake(expect_done, pdMS_TO_TICKS(timeout_ms)) == pdTRUE);
+
+  taskENTER_CRITICAL();
+  expect_armed = false;
+  taskEXIT_CRITICAL();
+
+  if (done) {
+    *latency_us = (uint32_t)(expect_end_us - start_us);
+  }
+  return done;
+}
+
+/******************************************************************************
+ * Function Name: publish_hook
+ ******************************************************************************
+ * Summary:
+ *  Called by the MQTT stand-in after every acknowledged publish, in the
+ *  publishing task. Completes the awaited publish.
+ *
+ * Parameters:
+ *  const cy_mqtt_publish_info_t *info : Published message
+ *
+ ******************************************************************************/
+static void publish_hook(const cy_mqtt_publish_info_t *info) {
+  uint64_t now_us = host_time_us();
+  char payload[MQTT_PUBLISH_PAYLOAD_MAX + 1];
+  size_t len = (info->payload_len < MQTT_PUBLISH_PAYLOAD_MAX)
+                   ? info->payload_len
+                   : MQTT_PUBLISH_PAYLOAD_MAX;
+  bool matched;
+
+  memcpy(payload, info->payload, len);
+  payload[len] = '\0';
+
+  taskENTER_CRITICAL();
+  matched = expect_armed && (strlen(expect_topic) == info->topic_len) &&
+            (strncmp(expect_topic, info->topic, info->topic_len) == 0) &&
+            (strstr(payload, expect_match) != NULL);
+  if (matched) {
+    expect_armed = false;
+    expect_end_us = now_us;
+  }
+  taskEXIT_CRITICAL();
+
+  if (matched) {
+    xSemaphoreGive(expect_done);
+  }
+}
+
+static void inject_passkey(const char *arg) {
+  wiced_bt_management_evt_data_t data;
+
+  (void)arg;
+
+  memset(&data, 0, sizeof(data));
+  memcpy(data.user_passkey_notification.bd_addr, peer_bd_addr,
+         sizeof(wiced_bt_device_address_t));
+  data.user_passkey_notification.passkey = SCENARIO_PASSKEY;
+  host_bt_management_event(BTM_PASSKEY_NOTIFICATION_EVT, &data);
+}
+
+static void inject_pairing_complete(const char *arg) {
+  wiced_bt_management_evt_data_t data;
+
+  (void)arg;
+
+  memset(&data, 0, sizeof(data));
+  memcpy(data.pairing_complete.bd_addr, peer_bd_addr,
+         sizeof(wiced_bt_device_address_t));
+  data.pairing_complete.pairing_complete_info.ble.reason = WICED_BT_SUCCESS;
+  host_bt_management_event(BTM_PAIRING_COMPLETE_EVT, &data);
+}
+
+static void inject_gatt(const char *arg) {
+  wiced_bt_gatt_event_data_t data;
+  wiced_bt_device_address_t bd_addr;
+
+  memcpy(bd_addr, peer_bd_addr, sizeof(bd_addr));
+  memset(&data, 0, sizeof(data));
+  data.connection_status.bd_addr = bd_addr;
+  data.connection_status.conn_id = 1u;
+  data.connection_status.connected = (strcmp(arg, "connect") == 0);
+  data.connection_status.reason = GATT_CONN_TERMINATE_PEER_USER;
+  host_bt_gatt_event(GATT_CONNECTION_STATUS_EVT, &data);
+}
+
+static void inject_command(const char *arg) {
+  if (host_mqtt_publish_command(MQTT_SUB_TOPIC, arg) != CY_RSLT_SUCCESS) {
+    printf("Scenario: publishing the command %s failed\n", arg);
+  }
+}
+
+static void inject_button(const char *arg) {
+  (void)arg;
+
+  host_gpio_event(CYBSP_USER_BTN, CYHAL_GPIO_IRQ_FALL);
+}
+
+/* Presses faster than the state task handles them, as a bouncing contact
+ * does without a debounce.
+ */
+static void inject_storm(const char *arg) {
+  for (uint32_t i = 0; i < SCENARIO_STORM_PRESSES; i++) {
+    if (i > 0u) {
+      vTaskDelay(pdMS_TO_TICKS(SCENARIO_STORM_GAP_MS));
+    }
+    inject_button(arg);
+  }
+}
+
+#if HOST_SIM
+static void inject_outage(const char *arg) {
+  (void)arg;
+
+  sim_broker_outage(sim_config.outage_ms);
+}
+
+static void inject_flap(const char *arg) {
+  (void)arg;
+
+  sim_ap_set(false);
+  vTaskDelay(pdMS_TO_TICKS(sim_config.flap_ms));
+  sim_ap_set(true);
+}
+#endif
+
+/******************************************************************************
+ * Function Name: compare_latency
+ ******************************************************************************/
+static int compare_latency(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *)a;
+  uint32_t y = *(const uint32_t *)b;
+
+  return (x > y) - (x < y);
+}
+
+/******************************************************************************
+ * Function Name: percentile
+ ******************************************************************************
+ * Summary:
+ *  Nearest-rank percentile of sorted samples.
+ *
+ ******************************************************************************/
+static uint32_t percentile(const uint32_t *sorted, uint32_t count,
+                           uint32_t percent) {
+  uint32_t rank = (count * percent + 99u) / 100u;
+
+  return sorted[(rank > 0u) ? rank - 1u : 0u];
+}
+
+/******************************************************************************
+ * Function Name: report
+ ******************************************************************************
+ * Summary:
+ *  Prints the latency percentiles of every measured step, in microseconds.
+ *
+ ******************************************************************************/
+static void report(void) {
+  printf("\n%-12s %-12s %6s %6s %9s %9s %9s %9s\n", "scenario", "step", "n",
+         "missed", "p50_us", "p90_us", "p99_us", "max_us");
+
+  for (uint32_t s = 0; s < SCENARIO_COUNT; s++) {
+    for (uint32_t i = 0; i < SCENARIO_MAX_STEPS; i++) {
+      const scenario_step_t *step = &scenarios[s].steps[i];
+      scenario_result_t *result = &results[s][i];
+
+      if ((step->topic == NULL) ||
+          ((result->count == 0u) && (result->misses == 0u))) {
+        continue;
+      }
+      if (result->count == 0u) {
+        printf("%-12s %-12s %6u %6lu %9s %9s %9s %9s\n", scenarios[s].name,
+               step->name, 0u, (unsigned long)result->misses, "-", "-", "-",
+               "-");
+        continue;
+      }
+
+      qsort(result->latency_us, result->count, sizeof(uint32_t),
+            compare_latency);
+      printf("%-12s %-12s %6lu %6lu %9lu %9lu %9lu %9lu\n", scenarios[s].name,
+             step->name, (unsigned long)result->count,
+             (unsigned long)result->misses,
+             (unsigned long)percentile(result->latency_us, result->count, 50u),
+             (unsigned long)percentile(result->latency_us, result->count, 90u),
+             (unsigned long)percentile(result->latency_us, result->count, 99u),
+             (unsigned long)result->latency_us[result->count - 1u]);
+    }
+  }
+}
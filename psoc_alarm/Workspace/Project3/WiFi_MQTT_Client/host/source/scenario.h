@@ -0,0 +1,31 @@
+/*
+ * scenario.h
+ *
+ * Scripted scenarios of the host build. Each scenario injects Bluetooth,
+ * button and MQTT command events and measures the time from each event to
+ * the publish it causes. The latency percentiles of every step are printed
+ * once all iterations ran.
+ */
+
+#ifndef HOST_SCENARIO_H_
+#define HOST_SCENARIO_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Task parameters for the scenario task, above every application task. */
+#define SCENARIO_TASK_PRIORITY (configMAX_PRIORITIES - 1)
+#define SCENARIO_TASK_STACK_SIZE (configMINIMAL_STACK_SIZE * 4)
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+bool scenario_select(const char *name);
+void scenario_configure(uint32_t iterations, uint32_t gap_ms);
+void scenario_list(void);
+void scenario_task(void *pvParameters);
+
+#endif /* HOST_SCENARIO_H_ */
@@ -0,0 +1,432 @@
+/**
+ * This file implements the virtual time, the network faults, the timeline
+ * and the report of the simulation build of the host.
+ *
+ * Virtual time: sim_start() stops the interval timer the POSIX port ticks
+ * from, before any application code runs. From then on the tick advances in
+ * the idle task only, that is once every task waits: the idle hook adds one
+ * tick, and tickless idle (portSUPPRESS_TICKS_AND_SLEEP in FreeRTOSConfig.h)
+ * jumps to the tick before the next timeout. Work between two waits takes
+ * no virtual time. Only the tasks themselves wake tasks, so a run depends on
+ * its arguments alone.
+ *
+ * Network faults: the AP and the broker are either up or down. Losing the AP
+ * bumps an epoch that ends the association of wcm_host.c. Every change is
+ * passed on to mqtt_sim.c, which models the MQTT session on top.
+ *
+ * Timeline: injected events, faults, connections and the publishes on the
+ * state, event and status topics, stamped with the virtual time. The report
+ * adds up the publishes per topic and the time spent in each alarm state.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+/* FreeRTOS header files */
+#include <FreeRTOS.h>
+#include "task.h"
+#include "timers.h"
+
+#include "mqtt_client_config.h"
+#include "sim.h"
+
+/******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Topics and alarm states followed by the report. */
+#define SIM_STATS (8u)
+#define SIM_NAME_MAX (32u)
+
+/* Payload shown per publish in the timeline. */
+#define SIM_TIMELINE_PAYLOAD_MAX (60u)
+
+/* Member of the state payloads carrying the alarm state. */
+#define SIM_STATE_KEY "\"state\":\""
+
+/******************************************************************************
+ * Types
+ ******************************************************************************/
+/* Publishes of a topic, or stays in an alarm state. */
+typedef struct {
+  char name[SIM_NAME_MAX];
+  uint32_t count;
+  uint64_t total_ms;
+  uint32_t max_ms;
+} sim_stat_t;
+
+/******************************************************************************
+ * Global Variables
+ ******************************************************************************/
+sim_config_t sim_config = {SIM_RTT_MS, SIM_OUTAGE_MS, SIM_FLAP_MS};
+
+static FILE *timeline;
+static struct timespec wall_start;
+
+static bool ap_present = true;
+static uint32_t ap_epoch;
+static bool broker_up = true;
+static TimerHandle_t outage_timer;
+
+static sim_stat_t topic_stats[SIM_STATS];
+static sim_stat_t state_stats[SIM_STATS];
+static sim_stat_t *current_state;
+static uint32_t state_since_ms;
+
+/******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+static uint32_t now_ms(void);
+static void format_time(char *text, size_t size, uint64_t ms);
+static sim_stat_t *stat_entry(sim_stat_t *stats, const char *name,
+                              size_t name_len);
+static void state_enter(const char *payload, size_t payload_len);
+static void outage_end(TimerHandle_t timer);
+
+/******************************************************************************
+ * Function Name: sim_init
+ ******************************************************************************
+ * Summary:
+ *  Opens the timeline and creates the outage timer, before the scheduler
+ *  starts.
+ *
+ * Parameters:
+ *  const char *timeline_path : File of the timeline, NULL for stdout
+ *
+ * Return:
+ *  bool : false if the file cannot be created
+ *
+ ******************************************************************************/
+bool sim_init(const char *timeline_path) {
+  timeline = (timeline_path != NULL) ? fopen(timeline_path, "w") : stdout;
+  outage_timer = xTimerCreate("Outage", 1, pdFALSE, NULL, outage_end);
+  return (timeline != NULL) && (outage_timer != NULL);
+}
+
+/******************************************************************************
+ * Function Name: sim_start
+ ******************************************************************************
+ * Summary:
+ *  Stops the host tick. Called by the first task to run, the scenario task.
+ *
+ ******************************************************************************/
+void sim_start(void) {
+  struct itimerval stop;
+
+  memset(&stop, 0, sizeof(stop));
+  setitimer(ITIMER_REAL, &stop, NULL);
+  clock_gettime(CLOCK_MONOTONIC, &wall_start);
+
+  sim_timeline("simulation start, broker round trip %lu ms",
+               (unsigned long)sim_config.rtt_ms);
+}
+
+/* Every pass of the idle task is one tick later. */
+void vApplicationIdleHook(void) { (void)xTaskCatchUpTicks(1); }
+
+/******************************************************************************
+ * Function Name: sim_sleep
+ ******************************************************************************
+ * Summary:
+ *  Tickless idle of the kernel, with the scheduler suspended: jumps to the
+ *  tick before the next timeout. The idle hook adds the last tick, which
+ *  unblocks the task. Ends the run when no task has a timeout left.
+ *
+ * Parameters:
+ *  TickType_t expected_idle_ticks : Ticks to the next timeout, 2 or more
+ *
+ ******************************************************************************/
+void sim_sleep(TickType_t expected_idle_ticks) {
+  switch (eTaskConfirmSleepModeStatus()) {
+  case eAbortSleep:
+    return;
+
+  case eNoTasksWaitingTimeout:
+    sim_timeline("every task waits without a timeout, stopping");
+    sim_report();
+    exit(1);
+
+  default:
+    break;
+  }
+
+  vTaskStepTick(expected_idle_ticks - 1u);
+}
+
+void sim_ap_set(bool present) {
+  if (present == ap_present) {
+    return;
+  }
+  ap_present = present;
+  if (!present) {
+    ap_epoch++;
+  }
+  sim_timeline("Wi-Fi AP %s", present ? "back" : "gone");
+  mqtt_sim_path_changed();
+}
+
+bool sim_ap_is_present(void) { return ap_present; }
+
+/* Changes on every loss of the AP, which ends any association. */
+uint32_t sim_ap_epoch(void) { return ap_epoch; }
+
+void sim_broker_set(bool up) {
+  if (up == broker_up) {
+    return;
+  }
+  broker_up = up;
+  sim_timeline("broker %s", up ? "reachable" : "unreachable");
+  mqtt_sim_path_changed();
+}
+
+bool sim_broker_is_up(void) { return broker_up; }
+
+/******************************************************************************
+ * Function Name: sim_broker_outage
+ ******************************************************************************
+ * Summary:
+ *  Takes the broker down now and back up after a while, from the timer task.
+ *
+ * Parameters:
+ *  uint32_t duration_ms : Length of the outage
+ *
+ ******************************************************************************/
+void sim_broker_outage(uint32_t duration_ms) {
+  TickType_t ticks = pdMS_TO_TICKS(duration_ms);
+
+  sim_broker_set(false);
+  xTimerChangePeriod(outage_timer, (ticks > 0u) ? ticks : 1u, portMAX_DELAY);
+}
+
+static void outage_end(TimerHandle_t timer) {
+  (void)timer;
+
+  sim_broker_set(true);
+}
+
+/******************************************************************************
+ * Function Name: sim_timeline
+ ******************************************************************************
+ * Summary:
+ *  Adds a line to the timeline, stamped with the virtual time.
+ *
+ * Parameters:
+ *  const char *format : printf() format of the line, without newline
+ *
+ ******************************************************************************/
+void sim_timeline(const char *format, ...) {
+  char stamp[24];
+  va_list args;
+
+  if (timeline == NULL) {
+    return;
+  }
+  format_time(stamp, sizeof(stamp), now_ms());
+  fprintf(timeline, "[%s] ", stamp);
+  va_start(args, format);
+  vfprintf(timeline, format, args);
+  va_end(args);
+  fputc('\n', timeline);
+}
+
+/******************************************************************************
+ * Function Name: sim_publish
+ ******************************************************************************
+ * Summary:
+ *  Records a publish that reached the broker. The publishes on the state,
+ *  event and status topics go to the timeline, and the state topic tracks
+ *  the alarm state as a subscriber sees it.
+ *
+ * Parameters:
+ *  const char *topic    : Topic
+ *  size_t topic_len     : Length of the topic
+ *  const char *payload  : Payload
+ *  size_t payload_len   : Length of the payload
+ *  uint32_t latency_ms  : Time from the publish call to the acknowledgement
+ *
+ ******************************************************************************/
+void sim_publish(const char *topic, size_t topic_len, const char *payload,
+                 size_t payload_len, uint32_t latency_ms) {
+  sim_stat_t *stat = stat_entry(topic_stats, topic, topic_len);
+  bool is_state = (topic_len == strlen(MQTT_STATE_TOPIC)) &&
+                  (strncmp(topic, MQTT_STATE_TOPIC, topic_len) == 0);
+
+  if (stat != NULL) {
+    stat->count++;
+    stat->total_ms += latency_ms;
+    if (latency_ms > stat->max_ms) {
+      stat->max_ms = latency_ms;
+    }
+  }
+
+  if (is_state ||
+      ((topic_len == strlen(MQTT_EVENT_TOPIC)) &&
+       (strncmp(topic, MQTT_EVENT_TOPIC, topic_len) == 0)) ||
+      ((topic_len == strlen(MQTT_STATUS_TOPIC)) &&
+       (strncmp(topic, MQTT_STATUS_TOPIC, topic_len) == 0))) {
+    sim_timeline("publish %.*s %.*s%s, %lu ms", (int)topic_len, topic,
+                 (int)((payload_len < SIM_TIMELINE_PAYLOAD_MAX)
+                           ? payload_len
+                           : SIM_TIMELINE_PAYLOAD_MAX),
+                 payload,
+                 (payload_len > SIM_TIMELINE_PAYLOAD_MAX) ? "..." : "",
+                 (unsigned long)latency_ms);
+  }
+  if (is_state) {
+    state_enter(payload, payload_len);
+  }
+}
+
+/******************************************************************************
+ * Function Name: sim_report
+ ******************************************************************************
+ * Summary:
+ *  Prints the virtual and wall time of the run, the publishes per topic and
+ *  the time spent in each alarm state.
+ *
+ ******************************************************************************/
+void sim_report(void) {
+  struct timespec wall_now;
+  uint32_t virtual_ms = now_ms();
+  double wall_s;
+  char total[24];
+  char longest[24];
+
+  clock_gettime(CLOCK_MONOTONIC, &wall_now);
+  wall_s = (double)(wall_now.tv_sec - wall_start.tv_sec) +
+           (double)(wall_now.tv_nsec - wall_start.tv_nsec) / 1e9;
+
+  /* The current stay counts up to now. */
+  if (current_state != NULL) {
+    uint32_t stay_ms = virtual_ms - state_since_ms;
+
+    current_state->total_ms += stay_ms;
+    if (stay_ms > current_state->max_ms) {
+      current_state->max_ms = stay_ms;
+    }
+    state_since_ms = virtual_ms;
+  }
+
+  format_time(total, sizeof(total), virtual_ms);
+  printf("\nSimulation: %s of virtual time in %.2f s", total, wall_s);
+  if (wall_s > 0.0) {
+    printf(" (%.0fx)", ((double)virtual_ms / 1000.0) / wall_s);
+  }
+  printf("\n\n%-24s %9s %9s %9s\n", "topic", "publishes", "avg_ms", "max_ms");
+  for (uint32_t i = 0; (i < SIM_STATS) && (topic_stats[i].count > 0u); i++) {
+    printf("%-24s %9lu %9lu %9lu\n", topic_stats[i].name,
+           (unsigned long)topic_stats[i].count,
+           (unsigned long)(topic_stats[i].total_ms / topic_stats[i].count),
+           (unsigned long)topic_stats[i].max_ms);
+  }
+
+  printf("\n%-24s %9s %14s %14s\n", "state", "entries", "total", "longest");
+  for (uint32_t i = 0; (i < SIM_STATS) && (state_stats[i].count > 0u); i++) {
+    format_time(total, sizeof(total), state_stats[i].total_ms);
+    format_time(longest, sizeof(longest), state_stats[i].max_ms);
+    printf("%-24s %9lu %14s %14s\n", state_stats[i].name,
+           (unsigned long)state_stats[i].count, total, longest);
+  }
+
+  if ((timeline != NULL) && (timeline != stdout)) {
+    fflush(timeline);
+  }
+}
+
+static uint32_t now_ms(void) {
+  return (uint32_t)(xTaskGetTickCount() * portTICK_PERIOD_MS);
+}
+
+/******************************************************************************
+ * Function Name: format_time
+ ******************************************************************************
+ * Summary:
+ *  Formats a virtual time as h:mm:ss.mmm.
+ *
+ ******************************************************************************/
+static void format_time(char *text, size_t size, uint64_t ms) {
+  snprintf(text, size, "%3lu:%02lu:%02lu.%03lu",
+           (unsigned long)(ms / 3600000u), (unsigned long)((ms / 60000u) % 60u),
+           (unsigned long)((ms / 1000u) % 60u), (unsigned long)(ms % 1000u));
+}
+
+/******************************************************************************
+ * Function Name: stat_entry
+ ******************************************************************************
+ * Summary:
+ *  Finds the entry of a name, or adds it.
+ *
+ * Return:
+ *  sim_stat_t * : Entry, NULL once the table is full
+ *
+ ******************************************************************************/
+static sim_stat_t *stat_entry(sim_stat_t *stats, const char *name,
+                              size_t name_len) {
+  if (name_len >= SIM_NAME_MAX) {
+    name_len = SIM_NAME_MAX - 1u;
+  }
+  for (uint32_t i = 0; i < SIM_STATS; i++) {
+    if (stats[i].name[0] == '\0') {
+      memcpy(stats[i].name, name, name_len);
+      stats[i].name[name_len] = '\0';
+      return &stats[i];
+    }
+    if ((strlen(stats[i].name) == name_len) &&
+        (strncmp(stats[i].name, name, name_len) == 0)) {
+      return &stats[i];
+    }
+  }
+  return NULL;
+}
+
+/******************************************************************************
+ * Function Name: state_enter
+ ******************************************************************************
+ * Summary:
+ *  Follows the alarm state of a state payload. Publishing the same state
+ *  again is not a transition.
+ *
+ ******************************************************************************/
+static void state_enter(const char *payload, size_t payload_len) {
+  char text[MQTT_PUBLISH_PAYLOAD_MAX + 1];
+  const char *name;
+  const char *end;
+  sim_stat_t *state;
+  uint32_t now = now_ms();
+
+  if (payload_len > MQTT_PUBLISH_PAYLOAD_MAX) {
+    payload_len = MQTT_PUBLISH_PAYLOAD_MAX;
+  }
+  memcpy(text, payload, payload_len);
+  text[payload_len] = '\0';
+
+  name = strstr(text, SIM_STATE_KEY);
+  if (name == NULL) {
+    return;
+  }
+  name += strlen(SIM_STATE_KEY);
+  end = strchr(name, '"');
+  if (end == NULL) {
+    return;
+  }
+
+  state = stat_entry(state_stats, name, (size_t)(end - name));
+  if ((state == NULL) || (state == current_state)) {
+    return;
+  }
+  if (current_state != NULL) {
+    uint32_t stay_ms = now - state_since_ms;
+
+    current_state->total_ms += stay_ms;
+    if (stay_ms > current_state->max_ms) {
+      current_state->max_ms = stay_ms;
+    }
+  }
+  current_state = state;
+  current_state->count++;
+  state_since_ms = now;
+  sim_timeline("state %s", current_state->name);
+}
@@ -0,0 +1,82 @@
+/*
+ * sim.h
+ *
+ * Simulation build of the host (make SIM=1). The kernel tick only advances
+ * when every task waits, straight to the next timeout, so the application
+ * runs on virtual time: an hour of outages costs seconds and a run is the
+ * same every time. The network is modelled in place of the broker: the
+ * Wi-Fi AP and the broker can be taken down, and every MQTT exchange takes
+ * a round trip of virtual time. Events of interest go to a timeline.
+ */
+
+#ifndef HOST_SIM_H_
+#define HOST_SIM_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* FreeRTOS header files */
+#include <FreeRTOS.h>
+
+/*******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Defaults of the network model, see sim_config_t. */
+#define SIM_RTT_MS (40u)
+#define SIM_OUTAGE_MS (120000u)
+#define SIM_FLAP_MS (3000u)
+
+/* Timeline entry, compiled out of the build on real time. HOST_SIM comes
+ * from FreeRTOSConfig.h.
+ */
+#if HOST_SIM
+#define SIM_TIMELINE(...) sim_timeline(__VA_ARGS__)
+#else
+#define SIM_TIMELINE(...)                                                      \
+  do {                                                                         \
+  } while (0)
+#endif
+
+/*******************************************************************************
+ * Data Types
+ ******************************************************************************/
+typedef struct {
+  /* Round trip between the device and the broker. */
+  uint32_t rtt_ms;
+  /* Broker outage of the outage scenario. */
+  uint32_t outage_ms;
+  /* Time the AP stays away in the flap scenario. */
+  uint32_t flap_ms;
+} sim_config_t;
+
+/*******************************************************************************
+ * Global Variables
+ ******************************************************************************/
+extern sim_config_t sim_config;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+/* Virtual time. */
+bool sim_init(const char *timeline_path);
+void sim_start(void);
+void sim_sleep(TickType_t expected_idle_ticks);
+
+/* Network model. */
+void sim_ap_set(bool present);
+bool sim_ap_is_present(void);
+uint32_t sim_ap_epoch(void);
+void sim_broker_set(bool up);
+bool sim_broker_is_up(void);
+void sim_broker_outage(uint32_t duration_ms);
+void mqtt_sim_path_changed(void);
+
+/* Timeline and report. */
+void sim_timeline(const char *format, ...)
+    __attribute__((format(printf, 1, 2)));
+void sim_publish(const char *topic, size_t topic_len, const char *payload,
+                 size_t payload_len, uint32_t latency_ms);
+void sim_report(void);
+
+#endif /* HOST_SIM_H_ */
@@ -0,0 +1,225 @@
+/**
+ * This file implements the network stand-ins of the host build: the Wi-Fi
+ * Connection Manager, the lwIP address formatting and broker probe calls,
+ * and the root CA store of the TLS library.
+ *
+ * The host joins one access point at once with a strong signal, so the link
+ * monitor samples a healthy link and never roams, and scans complete with no
+ * result. The broker is reached through the network of the host.
+ *
+ * In the simulation build the AP of the network model can go away: a join
+ * takes HOST_WIFI_JOIN_MS of virtual time and fails after
+ * HOST_WIFI_JOIN_TIMEOUT_MS without the AP, and the loss of the AP ends the
+ * association until the next join, as a deauthentication does.
+ */
+
+#include <arpa/inet.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "cy_tls.h"
+#include "cy_wcm.h"
+#include "lwip/dns.h"
+#include "lwip/netif.h"
+#include "lwip/tcp.h"
+#include "lwip/tcpip.h"
+#include "sim.h"
+
+#if HOST_SIM
+/* FreeRTOS header files */
+#include <FreeRTOS.h>
+#include "task.h"
+#endif
+
+/******************************************************************************
+ * Macros
+ ******************************************************************************/
+#define HOST_AP_RSSI_DBM (-40)
+#define HOST_AP_CHANNEL (6u)
+
+/* Authentication and DHCP, and the give-up time of the WHD join. */
+#define HOST_WIFI_JOIN_MS (1500u)
+#define HOST_WIFI_JOIN_TIMEOUT_MS (10000u)
+
+/******************************************************************************
+ * Global Variables
+ ******************************************************************************/
+static const cy_wcm_mac_t host_ap_bssid = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+
+static bool wcm_connected;
+static cy_wcm_ssid_t wcm_ssid;
+static cy_wcm_wlan_statistics_t wcm_statistics;
+#if HOST_SIM
+/* AP epoch of the association, see sim_ap_epoch(). */
+static uint32_t wcm_epoch;
+#endif
+
+/******************************************************************************
+ * Function Name: wcm_associated
+ ******************************************************************************
+ * Summary:
+ *  Whether the device is associated. In the simulation build an association
+ *  does not survive the loss of the AP, even once the AP is back.
+ *
+ ******************************************************************************/
+static bool wcm_associated(void) {
+#if HOST_SIM
+  if (wcm_connected && (wcm_epoch != sim_ap_epoch())) {
+    wcm_connected = false;
+  }
+#endif
+  return wcm_connected;
+}
+
+cy_rslt_t cy_wcm_init(cy_wcm_config_t *config) {
+  return (config->interface == CY_WCM_INTERFACE_TYPE_STA) ? CY_RSLT_SUCCESS
+                                                          : CY_RSLT_WCM_ERROR;
+}
+
+cy_rslt_t cy_wcm_deinit(void) {
+  wcm_connected = false;
+  return CY_RSLT_SUCCESS;
+}
+
+cy_rslt_t cy_wcm_connect_ap(cy_wcm_connect_params_t *connect_params,
+                            cy_wcm_ip_address_t *ip_addr) {
+#if HOST_SIM
+  if (!sim_ap_is_present()) {
+    vTaskDelay(pdMS_TO_TICKS(HOST_WIFI_JOIN_TIMEOUT_MS));
+    SIM_TIMELINE("Wi-Fi join failed, no AP");
+    return CY_RSLT_WCM_ERROR;
+  }
+  vTaskDelay(pdMS_TO_TICKS(HOST_WIFI_JOIN_MS));
+  if (!sim_ap_is_present()) {
+    SIM_TIMELINE("Wi-Fi join failed, AP lost");
+    return CY_RSLT_WCM_ERROR;
+  }
+  wcm_epoch = sim_ap_epoch();
+  SIM_TIMELINE("Wi-Fi joined");
+#endif
+  memcpy(wcm_ssid, connect_params->ap_credentials.SSID, sizeof(wcm_ssid));
+  wcm_connected = true;
+
+  /* 127.0.0.1, in network order like lwIP. */
+  memset(ip_addr, 0, sizeof(*ip_addr));
+  ip_addr->version = CY_WCM_IP_VER_V4;
+  ip_addr->ip.v4 = htonl(INADDR_LOOPBACK);
+  return CY_RSLT_SUCCESS;
+}
+
+cy_rslt_t cy_wcm_disconnect_ap(void) {
+  if (!wcm_associated()) {
+    return CY_RSLT_WCM_NOT_CONNECTED;
+  }
+  wcm_connected = false;
+  return CY_RSLT_SUCCESS;
+}
+
+uint8_t cy_wcm_is_connected_to_ap(void) {
+  return wcm_associated() ? 1u : 0u;
+}
+
+cy_rslt_t cy_wcm_get_associated_ap_info(cy_wcm_associated_ap_info_t *ap_info) {
+  if (!wcm_associated()) {
+    return CY_RSLT_WCM_NOT_CONNECTED;
+  }
+  memset(ap_info, 0, sizeof(*ap_info));
+  memcpy(ap_info->SSID, wcm_ssid, sizeof(ap_info->SSID));
+  memcpy(ap_info->BSSID, host_ap_bssid, sizeof(ap_info->BSSID));
+  ap_info->signal_strength = HOST_AP_RSSI_DBM;
+  ap_info->channel = HOST_AP_CHANNEL;
+  ap_info->security = CY_WCM_SECURITY_WPA2_AES_PSK;
+  return CY_RSLT_SUCCESS;
+}
+
+cy_rslt_t cy_wcm_get_wlan_statistics(cy_wcm_interface_t interface,
+                                     cy_wcm_wlan_statistics_t *stat) {
+  (void)interface;
+
+  if (!wcm_associated()) {
+    return CY_RSLT_WCM_NOT_CONNECTED;
+  }
+  /* A link without loss: packets go out, none is retried. */
+  wcm_statistics.tx_packets += 10u;
+  wcm_statistics.rx_packets += 10u;
+  *stat = wcm_statistics;
+  return CY_RSLT_SUCCESS;
+}
+
+cy_rslt_t cy_wcm_start_scan(cy_wcm_scan_result_callback_t callback,
+                            void *user_data,
+                            cy_wcm_scan_filter_t *scan_filter) {
+  (void)scan_filter;
+
+  callback(NULL, user_data, CY_WCM_SCAN_COMPLETE);
+  return CY_RSLT_SUCCESS;
+}
+
+cy_rslt_t cy_wcm_stop_scan(void) { return CY_RSLT_SUCCESS; }
+
+char *ip4addr_ntoa(const ip4_addr_t *addr) {
+  static char text[INET_ADDRSTRLEN];
+
+  return (char *)inet_ntop(AF_INET, &addr->addr, text, sizeof(text));
+}
+
+char *ip6addr_ntoa(const ip6_addr_t *addr) {
+  static char text[INET6_ADDRSTRLEN];
+
+  return (char *)inet_ntop(AF_INET6, addr->addr, text, sizeof(text));
+}
+
+/* The local broker failback is off on the host, see the Makefile. */
+err_t dns_gethostbyname(const char *hostname, ip_addr_t *addr,
+                        dns_found_callback found, void *callback_arg) {
+  (void)hostname;
+  (void)addr;
+  (void)found;
+  (void)callback_arg;
+  return ERR_ARG;
+}
+
+struct tcp_pcb *tcp_new(void) { return NULL; }
+
+void tcp_arg(struct tcp_pcb *pcb, void *arg) {
+  (void)pcb;
+  (void)arg;
+}
+
+void tcp_err(struct tcp_pcb *pcb, tcp_err_fn err) {
+  (void)pcb;
+  (void)err;
+}
+
+err_t tcp_connect(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, uint16_t port,
+                  tcp_connected_fn connected) {
+  (void)pcb;
+  (void)ipaddr;
+  (void)port;
+  (void)connected;
+  return ERR_ARG;
+}
+
+err_t tcp_close(struct tcp_pcb *pcb) {
+  (void)pcb;
+  return ERR_OK;
+}
+
+void tcp_abort(struct tcp_pcb *pcb) { (void)pcb; }
+
+err_t tcpip_callback(tcpip_callback_fn function, void *ctx) {
+  function(ctx);
+  return ERR_OK;
+}
+
+/* The host build connects without TLS. */
+cy_rslt_t cy_tls_load_global_root_ca_certificates(const char *trusted_ca_certs,
+                                                  const uint32_t cert_length) {
+  (void)trusted_ca_certs;
+  (void)cert_length;
+  return CY_RSLT_SUCCESS;
+}
+
+cy_rslt_t cy_tls_release_global_root_ca_certificates(void) {
+  return CY_RSLT_SUCCESS;
+}
@@ -46,6 +46,183 @@
 #include "app_bt_utils.h"
 #include "wiced_bt_dev.h"
 
+/******************************************************************************
+ *                                NAME TABLES
+ ******************************************************************************/
+#if APP_BT_NAMES_ENABLE
+/* Enum values with a name in the logs. Each list expands into a table indexed
+ * by the enum value, so a lookup is an array access. The lists only hold the
+ * enumerator names, the values come from the Bluetooth stack headers.
+ */
+#define BTM_EVENT_NAMES(X)                             \
+    X(BTM_ENABLED_EVT)                                 \
+    X(BTM_DISABLED_EVT)                                \
+    X(BTM_POWER_MANAGEMENT_STATUS_EVT)                 \
+    X(BTM_PIN_REQUEST_EVT)                             \
+    X(BTM_USER_CONFIRMATION_REQUEST_EVT)               \
+    X(BTM_PASSKEY_NOTIFICATION_EVT)                    \
+    X(BTM_PASSKEY_REQUEST_EVT)                         \
+    X(BTM_KEYPRESS_NOTIFICATION_EVT)                   \
+    X(BTM_PAIRING_IO_CAPABILITIES_BR_EDR_REQUEST_EVT)  \
+    X(BTM_PAIRING_IO_CAPABILITIES_BR_EDR_RESPONSE_EVT) \
+    X(BTM_PAIRING_IO_CAPABILITIES_BLE_REQUEST_EVT)     \
+    X(BTM_PAIRING_COMPLETE_EVT)                        \
+    X(BTM_ENCRYPTION_STATUS_EVT)                       \
+    X(BTM_SECURITY_REQUEST_EVT)                        \
+    X(BTM_SECURITY_FAILED_EVT)                         \
+    X(BTM_SECURITY_ABORTED_EVT)                        \
+    X(BTM_READ_LOCAL_OOB_DATA_COMPLETE_EVT)            \
+    X(BTM_REMOTE_OOB_DATA_REQUEST_EVT)                 \
+    X(BTM_PAIRED_DEVICE_LINK_KEYS_UPDATE_EVT)          \
+    X(BTM_PAIRED_DEVICE_LINK_KEYS_REQUEST_EVT)         \
+    X(BTM_LOCAL_IDENTITY_KEYS_UPDATE_EVT)              \
+    X(BTM_LOCAL_IDENTITY_KEYS_REQUEST_EVT)             \
+    X(BTM_BLE_SCAN_STATE_CHANGED_EVT)                  \
+    X(BTM_BLE_ADVERT_STATE_CHANGED_EVT)                \
+    X(BTM_SMP_REMOTE_OOB_DATA_REQUEST_EVT)             \
+    X(BTM_SMP_SC_REMOTE_OOB_DATA_REQUEST_EVT)          \
+    X(BTM_SMP_SC_LOCAL_OOB_DATA_NOTIFICATION_EVT)      \
+    X(BTM_SCO_CONNECTED_EVT)                           \
+    X(BTM_SCO_DISCONNECTED_EVT)                        \
+    X(BTM_SCO_CONNECTION_REQUEST_EVT)                  \
+    X(BTM_SCO_CONNECTION_CHANGE_EVT)                   \
+    X(BTM_BLE_CONNECTION_PARAM_UPDATE)                 \
+    X(BTM_BLE_PHY_UPDATE_EVT)                          \
+    X(BTM_LPM_STATE_LOW_POWER)                         \
+    X(BTM_MULTI_ADVERT_RESP_EVENT)                     \
+    X(BTM_BLE_DATA_LENGTH_UPDATE_EVENT)
+
+#define BT_ADVERT_MODE_NAMES(X)         \
+    X(BTM_BLE_ADVERT_OFF)               \
+    X(BTM_BLE_ADVERT_DIRECTED_HIGH)     \
+    X(BTM_BLE_ADVERT_DIRECTED_LOW)      \
+    X(BTM_BLE_ADVERT_UNDIRECTED_HIGH)   \
+    X(BTM_BLE_ADVERT_UNDIRECTED_LOW)    \
+    X(BTM_BLE_ADVERT_NONCONN_HIGH)      \
+    X(BTM_BLE_ADVERT_NONCONN_LOW)       \
+    X(BTM_BLE_ADVERT_DISCOVERABLE_HIGH) \
+    X(BTM_BLE_ADVERT_DISCOVERABLE_LOW)
+
+#define BT_GATT_DISCONN_REASON_NAMES(X) \
+    X(GATT_CONN_UNKNOWN)                \
+    X(GATT_CONN_L2C_FAILURE)            \
+    X(GATT_CONN_TIMEOUT)                \
+    X(GATT_CONN_TERMINATE_PEER_USER)    \
+    X(GATT_CONN_TERMINATE_LOCAL_HOST)   \
+    X(GATT_CONN_FAIL_ESTABLISH)         \
+    X(GATT_CONN_LMP_TIMEOUT)            \
+    X(GATT_CONN_CANCEL)
+
+#define BT_GATT_STATUS_NAMES(X)                  \
+    X(WICED_BT_GATT_SUCCESS)                     \
+    X(WICED_BT_GATT_INVALID_HANDLE)              \
+    X(WICED_BT_GATT_READ_NOT_PERMIT)             \
+    X(WICED_BT_GATT_WRITE_NOT_PERMIT)            \
+    X(WICED_BT_GATT_INVALID_PDU)                 \
+    X(WICED_BT_GATT_INSUF_AUTHENTICATION)        \
+    X(WICED_BT_GATT_REQ_NOT_SUPPORTED)           \
+    X(WICED_BT_GATT_INVALID_OFFSET)              \
+    X(WICED_BT_GATT_INSUF_AUTHORIZATION)         \
+    X(WICED_BT_GATT_PREPARE_Q_FULL)              \
+    X(WICED_BT_GATT_ATTRIBUTE_NOT_FOUND)         \
+    X(WICED_BT_GATT_NOT_LONG)                    \
+    X(WICED_BT_GATT_INSUF_KEY_SIZE)              \
+    X(WICED_BT_GATT_INVALID_ATTR_LEN)            \
+    X(WICED_BT_GATT_ERR_UNLIKELY)                \
+    X(WICED_BT_GATT_INSUF_ENCRYPTION)            \
+    X(WICED_BT_GATT_UNSUPPORT_GRP_TYPE)          \
+    X(WICED_BT_GATT_INSUF_RESOURCE)              \
+    X(WICED_BT_GATT_DATABASE_OUT_OF_SYNC)        \
+    X(WICED_BT_GATT_VALUE_NOT_ALLOWED)           \
+    X(WICED_BT_GATT_ILLEGAL_PARAMETER)           \
+    X(WICED_BT_GATT_NO_RESOURCES)                \
+    X(WICED_BT_GATT_INTERNAL_ERROR)              \
+    X(WICED_BT_GATT_WRONG_STATE)                 \
+    X(WICED_BT_GATT_DB_FULL)                     \
+    X(WICED_BT_GATT_BUSY)                        \
+    X(WICED_BT_GATT_ERROR)                       \
+    X(WICED_BT_GATT_CMD_STARTED)                 \
+    X(WICED_BT_GATT_PENDING)                     \
+    X(WICED_BT_GATT_AUTH_FAIL)                   \
+    X(WICED_BT_GATT_MORE)                        \
+    X(WICED_BT_GATT_INVALID_CFG)                 \
+    X(WICED_BT_GATT_SERVICE_STARTED)             \
+    X(WICED_BT_GATT_ENCRYPTED_NO_MITM)           \
+    X(WICED_BT_GATT_NOT_ENCRYPTED)               \
+    X(WICED_BT_GATT_CONGESTED)                   \
+    X(WICED_BT_GATT_NOT_ALLOWED)                 \
+    X(WICED_BT_GATT_HANDLED)                     \
+    X(WICED_BT_GATT_NO_PENDING_OPERATION)        \
+    X(WICED_BT_GATT_INDICATION_RESPONSE_PENDING) \
+    X(WICED_BT_GATT_WRITE_REQ_REJECTED)          \
+    X(WICED_BT_GATT_CCC_CFG_ERR)                 \
+    X(WICED_BT_GATT_PRC_IN_PROGRESS)             \
+    X(WICED_BT_GATT_OUT_OF_RANGE)                \
+    X(WICED_BT_GATT_BAD_OPCODE)                  \
+    X(WICED_BT_GATT_INVALID_CONNECTION_ID)
+
+#define BT_SMP_STATUS_NAMES(X)          \
+    X(SMP_SUCCESS)                      \
+    X(SMP_PASSKEY_ENTRY_FAIL)           \
+    X(SMP_OOB_FAIL)                     \
+    X(SMP_PAIR_AUTH_FAIL)               \
+    X(SMP_CONFIRM_VALUE_ERR)            \
+    X(SMP_PAIR_NOT_SUPPORT)             \
+    X(SMP_ENC_KEY_SIZE)                 \
+    X(SMP_INVALID_CMD)                  \
+    X(SMP_PAIR_FAIL_UNKNOWN)            \
+    X(SMP_REPEATED_ATTEMPTS)            \
+    X(SMP_INVALID_PARAMETERS)           \
+    X(SMP_DHKEY_CHK_FAIL)               \
+    X(SMP_NUMERIC_COMPAR_FAIL)          \
+    X(SMP_BR_PAIRING_IN_PROGR)          \
+    X(SMP_XTRANS_DERIVE_NOT_ALLOW)      \
+    X(SMP_PAIR_INTERNAL_ERR)            \
+    X(SMP_UNKNOWN_IO_CAP)               \
+    X(SMP_INIT_FAIL)                    \
+    X(SMP_CONFIRM_FAIL)                 \
+    X(SMP_BUSY)                         \
+    X(SMP_ENC_FAIL)                     \
+    X(SMP_STARTED)                      \
+    X(SMP_RSP_TIMEOUT)                  \
+    X(SMP_FAIL)                         \
+    X(SMP_CONN_TOUT)
+
+/* Entry number of each name, its 1-based index by enum value and the name.
+ * A designated initializer may repeat an index, the last one wins, so two
+ * names with the same value would go unnoticed in the index. The switch of
+ * table##_check() turns them into duplicate case labels, a compile error.
+ */
+#define BT_NAME_ID(name)        BT_NAME_ID_##name,
+#define BT_NAME_INDEX(name)     [name] = BT_NAME_ID_##name + 1,
+#define BT_NAME_STRING(name)    #name,
+#define BT_NAME_CASE(name)      case name:
+
+#define BT_NAME_TABLE(table, list)                                            \
+    enum { list(BT_NAME_ID) table##_count };                                   \
+    _Static_assert(table##_count < UINT8_MAX, #table " has too many names");   \
+    static inline void table##_check(int value)                                \
+    {                                                                          \
+        switch (value) { list(BT_NAME_CASE) default: break; }                  \
+    }                                                                          \
+    static const uint8_t table##_index[] = { list(BT_NAME_INDEX) };            \
+    static const char *const table##_names[table##_count] = {                 \
+        list(BT_NAME_STRING)                                                   \
+    }
+
+#define BT_NAME_LOOKUP(table, value, unknown)                                 \
+    ((((uint32_t)(value)) < sizeof(table##_index)) &&                          \
+     (table##_index[(uint32_t)(value)] != 0u)                                  \
+         ? table##_names[table##_index[(uint32_t)(value)] - 1u]                \
+         : (unknown))
+
+BT_NAME_TABLE(btm_event, BTM_EVENT_NAMES);
+BT_NAME_TABLE(bt_advert_mode, BT_ADVERT_MODE_NAMES);
+BT_NAME_TABLE(bt_gatt_disconn_reason, BT_GATT_DISCONN_REASON_NAMES);
+BT_NAME_TABLE(bt_gatt_status, BT_GATT_STATUS_NAMES);
+BT_NAME_TABLE(bt_smp_status, BT_SMP_STATUS_NAMES);
+#endif /* APP_BT_NAMES_ENABLE */
+
 /****************************************************************************
  *                              FUNCTION DEFINITIONS
  ***************************************************************************/
@@ -63,7 +240,29 @@
 */
 void print_bd_address(wiced_bt_device_address_t bdadr)
 {
-    printf("%02X:%02X:%02X:%02X:%02X:%02X\r\n",bdadr[0],bdadr[1],bdadr[2],bdadr[3],bdadr[4],bdadr[5]);
+    char text[APP_BT_BDA_TEXT_SIZE];
+
+    format_bd_address(text, sizeof(text), bdadr);
+    printf("%s\r\n", text);
+}
+
+/**
+* Function Name:
+* format_bd_address()
+*
+* Function Description:
+* @brief This is the utility function that formats the address of the Bluetooth device
+*
+* @param  char *buffer                             : Output buffer
+*         size_t size                              : Size of the output buffer, APP_BT_BDA_TEXT_SIZE fits
+*         const wiced_bt_device_address_t bdadr    : Bluetooth address
+*
+* @return int : Length of the text, as returned by snprintf()
+*
+*/
+int format_bd_address(char *buffer, size_t size, const wiced_bt_device_address_t bdadr)
+{
+    return snprintf(buffer, size, "%02X:%02X:%02X:%02X:%02X:%02X",bdadr[0],bdadr[1],bdadr[2],bdadr[3],bdadr[4],bdadr[5]);
 }
 
 /**
@@ -95,6 +294,7 @@ void print_array(void * to_print, uint16_t len)
 
 }
 
+#if APP_BT_NAMES_ENABLE
 /**
 * Function Name:
 * get_btm_event_name
@@ -111,47 +311,7 @@ void print_array(void * to_print, uint16_t len)
 */
 const char *get_btm_event_name(wiced_bt_management_evt_t event)
 {
-    switch ( (int)event )
-    {
-    CASE_RETURN_STR(BTM_ENABLED_EVT)
-    CASE_RETURN_STR(BTM_DISABLED_EVT)
-    CASE_RETURN_STR(BTM_POWER_MANAGEMENT_STATUS_EVT)
-    CASE_RETURN_STR(BTM_PIN_REQUEST_EVT)
-    CASE_RETURN_STR(BTM_USER_CONFIRMATION_REQUEST_EVT)
-    CASE_RETURN_STR(BTM_PASSKEY_NOTIFICATION_EVT)
-    CASE_RETURN_STR(BTM_PASSKEY_REQUEST_EVT)
-    CASE_RETURN_STR(BTM_KEYPRESS_NOTIFICATION_EVT)
-    CASE_RETURN_STR(BTM_PAIRING_IO_CAPABILITIES_BR_EDR_REQUEST_EVT)
-    CASE_RETURN_STR(BTM_PAIRING_IO_CAPABILITIES_BR_EDR_RESPONSE_EVT)
-    CASE_RETURN_STR(BTM_PAIRING_IO_CAPABILITIES_BLE_REQUEST_EVT)
-    CASE_RETURN_STR(BTM_PAIRING_COMPLETE_EVT)
-    CASE_RETURN_STR(BTM_ENCRYPTION_STATUS_EVT)
-    CASE_RETURN_STR(BTM_SECURITY_REQUEST_EVT)
-    CASE_RETURN_STR(BTM_SECURITY_FAILED_EVT)
-    CASE_RETURN_STR(BTM_SECURITY_ABORTED_EVT)
-    CASE_RETURN_STR(BTM_READ_LOCAL_OOB_DATA_COMPLETE_EVT)
-    CASE_RETURN_STR(BTM_REMOTE_OOB_DATA_REQUEST_EVT)
-    CASE_RETURN_STR(BTM_PAIRED_DEVICE_LINK_KEYS_UPDATE_EVT)
-    CASE_RETURN_STR(BTM_PAIRED_DEVICE_LINK_KEYS_REQUEST_EVT)
-    CASE_RETURN_STR(BTM_LOCAL_IDENTITY_KEYS_UPDATE_EVT)
-    CASE_RETURN_STR(BTM_LOCAL_IDENTITY_KEYS_REQUEST_EVT)
-    CASE_RETURN_STR(BTM_BLE_SCAN_STATE_CHANGED_EVT)
-    CASE_RETURN_STR(BTM_BLE_ADVERT_STATE_CHANGED_EVT)
-    CASE_RETURN_STR(BTM_SMP_REMOTE_OOB_DATA_REQUEST_EVT)
-    CASE_RETURN_STR(BTM_SMP_SC_REMOTE_OOB_DATA_REQUEST_EVT)
-    CASE_RETURN_STR(BTM_SMP_SC_LOCAL_OOB_DATA_NOTIFICATION_EVT)
-    CASE_RETURN_STR(BTM_SCO_CONNECTED_EVT)
-    CASE_RETURN_STR(BTM_SCO_DISCONNECTED_EVT)
-    CASE_RETURN_STR(BTM_SCO_CONNECTION_REQUEST_EVT)
-    CASE_RETURN_STR(BTM_SCO_CONNECTION_CHANGE_EVT)
-    CASE_RETURN_STR(BTM_BLE_CONNECTION_PARAM_UPDATE)
-    CASE_RETURN_STR(BTM_BLE_PHY_UPDATE_EVT)
-    CASE_RETURN_STR(BTM_LPM_STATE_LOW_POWER)
-    CASE_RETURN_STR(BTM_MULTI_ADVERT_RESP_EVENT)
-    CASE_RETURN_STR(BTM_BLE_DATA_LENGTH_UPDATE_EVENT)
-    }
-
-    return "UNKNOWN_EVENT";
+    return BT_NAME_LOOKUP(btm_event, event, "UNKNOWN_EVENT");
 }
 
 /**
@@ -170,20 +330,7 @@ const char *get_btm_event_name(wiced_bt_management_evt_t event)
 */
 const char *get_bt_advert_mode_name(wiced_bt_ble_advert_mode_t mode)
 {
-    switch ( (int)mode )
-    {
-    CASE_RETURN_STR(BTM_BLE_ADVERT_OFF)
-    CASE_RETURN_STR(BTM_BLE_ADVERT_DIRECTED_HIGH)
-    CASE_RETURN_STR(BTM_BLE_ADVERT_DIRECTED_LOW)
-    CASE_RETURN_STR(BTM_BLE_ADVERT_UNDIRECTED_HIGH)
-    CASE_RETURN_STR(BTM_BLE_ADVERT_UNDIRECTED_LOW)
-    CASE_RETURN_STR(BTM_BLE_ADVERT_NONCONN_HIGH)
-    CASE_RETURN_STR(BTM_BLE_ADVERT_NONCONN_LOW)
-    CASE_RETURN_STR(BTM_BLE_ADVERT_DISCOVERABLE_HIGH)
-    CASE_RETURN_STR(BTM_BLE_ADVERT_DISCOVERABLE_LOW)
-    }
-
-    return "UNKNOWN_MODE";
+    return BT_NAME_LOOKUP(bt_advert_mode, mode, "UNKNOWN_MODE");
 }
 
 /**
@@ -202,19 +349,7 @@ const char *get_bt_advert_mode_name(wiced_bt_ble_advert_mode_t mode)
 */
 const char *get_bt_gatt_disconn_reason_name(wiced_bt_gatt_disconn_reason_t reason)
 {
-    switch ( (int)reason )
-    {
-    CASE_RETURN_STR(GATT_CONN_UNKNOWN)
-    CASE_RETURN_STR(GATT_CONN_L2C_FAILURE)
-    CASE_RETURN_STR(GATT_CONN_TIMEOUT)
-    CASE_RETURN_STR(GATT_CONN_TERMINATE_PEER_USER)
-    CASE_RETURN_STR(GATT_CONN_TERMINATE_LOCAL_HOST)
-    CASE_RETURN_STR(GATT_CONN_FAIL_ESTABLISH)
-    CASE_RETURN_STR(GATT_CONN_LMP_TIMEOUT)
-    CASE_RETURN_STR(GATT_CONN_CANCEL)
-    }
-
-    return "UNKNOWN_REASON";
+    return BT_NAME_LOOKUP(bt_gatt_disconn_reason, reason, "UNKNOWN_REASON");
 }
 
 /**
@@ -233,57 +368,7 @@ const char *get_bt_gatt_disconn_reason_name(wiced_bt_gatt_disconn_reason_t reaso
 **/
 const char *get_bt_gatt_status_name(wiced_bt_gatt_status_t status)
 {
-    switch ( (int)status )
-    {
-    CASE_RETURN_STR(WICED_BT_GATT_SUCCESS)
-    CASE_RETURN_STR(WICED_BT_GATT_INVALID_HANDLE)
-    CASE_RETURN_STR(WICED_BT_GATT_READ_NOT_PERMIT)
-    CASE_RETURN_STR(WICED_BT_GATT_WRITE_NOT_PERMIT)
-    CASE_RETURN_STR(WICED_BT_GATT_INVALID_PDU)
-    CASE_RETURN_STR(WICED_BT_GATT_INSUF_AUTHENTICATION)
-    CASE_RETURN_STR(WICED_BT_GATT_REQ_NOT_SUPPORTED)
-    CASE_RETURN_STR(WICED_BT_GATT_INVALID_OFFSET)
-    CASE_RETURN_STR(WICED_BT_GATT_INSUF_AUTHORIZATION)
-    CASE_RETURN_STR(WICED_BT_GATT_PREPARE_Q_FULL)
-    CASE_RETURN_STR(WICED_BT_GATT_ATTRIBUTE_NOT_FOUND)
-    CASE_RETURN_STR(WICED_BT_GATT_NOT_LONG)
-    CASE_RETURN_STR(WICED_BT_GATT_INSUF_KEY_SIZE)
-    CASE_RETURN_STR(WICED_BT_GATT_INVALID_ATTR_LEN)
-    CASE_RETURN_STR(WICED_BT_GATT_ERR_UNLIKELY)
-    CASE_RETURN_STR(WICED_BT_GATT_INSUF_ENCRYPTION)
-    CASE_RETURN_STR(WICED_BT_GATT_UNSUPPORT_GRP_TYPE)
-    CASE_RETURN_STR(WICED_BT_GATT_INSUF_RESOURCE)
-    CASE_RETURN_STR(WICED_BT_GATT_DATABASE_OUT_OF_SYNC)
-    CASE_RETURN_STR(WICED_BT_GATT_VALUE_NOT_ALLOWED)
-    CASE_RETURN_STR(WICED_BT_GATT_ILLEGAL_PARAMETER)
-    CASE_RETURN_STR(WICED_BT_GATT_NO_RESOURCES)
-    CASE_RETURN_STR(WICED_BT_GATT_INTERNAL_ERROR)
-    CASE_RETURN_STR(WICED_BT_GATT_WRONG_STATE)
-    CASE_RETURN_STR(WICED_BT_GATT_DB_FULL)
-    CASE_RETURN_STR(WICED_BT_GATT_BUSY)
-    CASE_RETURN_STR(WICED_BT_GATT_ERROR)
-    CASE_RETURN_STR(WICED_BT_GATT_CMD_STARTED)
-    CASE_RETURN_STR(WICED_BT_GATT_PENDING)
-    CASE_RETURN_STR(WICED_BT_GATT_AUTH_FAIL)
-    CASE_RETURN_STR(WICED_BT_GATT_MORE)
-    CASE_RETURN_STR(WICED_BT_GATT_INVALID_CFG)
-    CASE_RETURN_STR(WICED_BT_GATT_SERVICE_STARTED)
-    CASE_RETURN_STR(WICED_BT_GATT_ENCRYPTED_NO_MITM)
-    CASE_RETURN_STR(WICED_BT_GATT_NOT_ENCRYPTED)
-    CASE_RETURN_STR(WICED_BT_GATT_CONGESTED)
-    CASE_RETURN_STR(WICED_BT_GATT_NOT_ALLOWED)
-    CASE_RETURN_STR(WICED_BT_GATT_HANDLED)
-    CASE_RETURN_STR(WICED_BT_GATT_NO_PENDING_OPERATION)
-    CASE_RETURN_STR(WICED_BT_GATT_INDICATION_RESPONSE_PENDING)
-    CASE_RETURN_STR(WICED_BT_GATT_WRITE_REQ_REJECTED)
-    CASE_RETURN_STR(WICED_BT_GATT_CCC_CFG_ERR)
-    CASE_RETURN_STR(WICED_BT_GATT_PRC_IN_PROGRESS)
-    CASE_RETURN_STR(WICED_BT_GATT_OUT_OF_RANGE)
-    CASE_RETURN_STR(WICED_BT_GATT_BAD_OPCODE)
-    CASE_RETURN_STR(WICED_BT_GATT_INVALID_CONNECTION_ID)
-    }
-
-    return "UNKNOWN_STATUS";
+    return BT_NAME_LOOKUP(bt_gatt_status, status, "UNKNOWN_STATUS");
 }
 
 /**
@@ -302,38 +387,8 @@ const char *get_bt_gatt_status_name(wiced_bt_gatt_status_t status)
 */
 const char *get_bt_smp_status_name(wiced_bt_smp_status_t status)
 {
-
-    switch ((int)status)
-    {
-
-        CASE_RETURN_STR(SMP_SUCCESS)                 /**< Success */
-        CASE_RETURN_STR(SMP_PASSKEY_ENTRY_FAIL)      /**< Passkey entry failed */
-        CASE_RETURN_STR(SMP_OOB_FAIL)                /**< OOB failed */
-        CASE_RETURN_STR(SMP_PAIR_AUTH_FAIL)          /**< Authentication failed */
-        CASE_RETURN_STR(SMP_CONFIRM_VALUE_ERR)       /**< Value confirmation failed */
-        CASE_RETURN_STR(SMP_PAIR_NOT_SUPPORT)        /**< Not supported */
-        CASE_RETURN_STR(SMP_ENC_KEY_SIZE)            /**< Encryption key size failure */
-        CASE_RETURN_STR(SMP_INVALID_CMD)             /**< Invalid command */
-        CASE_RETURN_STR(SMP_PAIR_FAIL_UNKNOWN)       /**< Unknown failure */
-        CASE_RETURN_STR(SMP_REPEATED_ATTEMPTS)       /**< Repeated attempts */
-        CASE_RETURN_STR(SMP_INVALID_PARAMETERS)      /**< Invalid parameters  */
-        CASE_RETURN_STR(SMP_DHKEY_CHK_FAIL)          /**< DH Key check failed */
-        CASE_RETURN_STR(SMP_NUMERIC_COMPAR_FAIL)     /**< Numeric comparison failed */
-        CASE_RETURN_STR(SMP_BR_PAIRING_IN_PROGR)     /**< BR paIring in progress */
-        CASE_RETURN_STR(SMP_XTRANS_DERIVE_NOT_ALLOW) /**< Cross transport key derivation not allowed */
-        /* bte smp status codes */
-        CASE_RETURN_STR(SMP_PAIR_INTERNAL_ERR) /**< Internal error */
-        CASE_RETURN_STR(SMP_UNKNOWN_IO_CAP)    /**< unknown IO capability, unable to decide associatino model */
-        CASE_RETURN_STR(SMP_INIT_FAIL)         /**< Initialization failed */
-        CASE_RETURN_STR(SMP_CONFIRM_FAIL)      /**< Confirmation failed */
-        CASE_RETURN_STR(SMP_BUSY)              /**< Busy */
-        CASE_RETURN_STR(SMP_ENC_FAIL)          /**< Encryption failed */
-        CASE_RETURN_STR(SMP_STARTED)           /**< Started */
-        CASE_RETURN_STR(SMP_RSP_TIMEOUT)       /**< Response timeout */
-        CASE_RETURN_STR(SMP_FAIL)              /**< Generic failure */
-        CASE_RETURN_STR(SMP_CONN_TOUT)         /**< Connection timeout */
-    }
-
-    return "UNKNOWN_STATUS";
+    return BT_NAME_LOOKUP(bt_smp_status, status, "UNKNOWN_STATUS");
 }
+#endif /* APP_BT_NAMES_ENABLE */
+
 /* [] END OF FILE */
@@ -53,20 +53,38 @@
 /******************************************************************************
  *                                Constants
  ******************************************************************************/
-#define CASE_RETURN_STR(enum_val)          case enum_val: return #enum_val;
+/* Set to 0 to leave the enum names out of the image. The get_*_name()
+ * functions then return an empty string and the logs keep the numeric values.
+ * The Makefile sets it to 0 in Release builds.
+ */
+#ifndef APP_BT_NAMES_ENABLE
+#define APP_BT_NAMES_ENABLE                (1)
+#endif
 
 #define FROM_BIT16_TO_8(val)            ((uint8_t)((val) >> 8 ))
 
+/* Size of a Bluetooth address formatted by format_bd_address() */
+#define APP_BT_BDA_TEXT_SIZE               (18u)
+
 /****************************************************************************
  *                              FUNCTION DECLARATIONS
  ***************************************************************************/
 void print_bd_address(wiced_bt_device_address_t bdadr);
+int format_bd_address(char *buffer, size_t size, const wiced_bt_device_address_t bdadr);
 void print_array(void * to_print, uint16_t len);
+#if APP_BT_NAMES_ENABLE
 const char *get_btm_event_name(wiced_bt_management_evt_t event);
 const char *get_bt_advert_mode_name(wiced_bt_ble_advert_mode_t mode);
 const char *get_bt_gatt_disconn_reason_name(wiced_bt_gatt_disconn_reason_t reason);
 const char *get_bt_gatt_status_name(wiced_bt_gatt_status_t status);
 const char *get_bt_smp_status_name(wiced_bt_smp_status_t status);
+#else
+#define get_btm_event_name(event)                 ((void)(event), "")
+#define get_bt_advert_mode_name(mode)             ((void)(mode), "")
+#define get_bt_gatt_disconn_reason_name(reason)   ((void)(reason), "")
+#define get_bt_gatt_status_name(status)           ((void)(status), "")
+#define get_bt_smp_status_name(status)            ((void)(status), "")
+#endif
 #endif      /*__APP_BT_UTILS_H__ */
 
 
@@ -0,0 +1,373 @@
+/**
+ * This file implements the microbenchmarks of the hot paths: the code that
+ * runs on every Bluetooth event, command or state change.
+ *
+ *   state_format   : payload of the state messages, state.c
+ *   parse_command  : decoding of a command, state.c (first and last entry
+ *                    of the table, and no match)
+ *   format_bd_addr : Bluetooth address text, app_bt_utils.c
+ *   bond_lookup    : bond info lookup of bt.c, hit and miss
+ *   bt_name        : enum names of app_bt_utils.c, when APP_BT_NAMES_ENABLE
+ *
+ * The same cases run on the host build (option -B) and on the board (BENCH
+ * command). The clock is the one of the latency probes, probe_now():
+ * clock_gettime() in nanoseconds on the host and the DWT cycle counter on
+ * the board. As in Google Benchmark, a case is a loop
+ * of a given number of iterations; the count doubles until a run takes
+ * BENCH_MIN_TIME_US, and the time of that run per iteration is reported.
+ * On the board the scheduler is suspended during a run, interrupts are not.
+ *
+ * The results are text lines, printed on the console, and on the board
+ * published on MQTT_DIAG_TOPIC as well:
+ *
+ *   BENCH BEGIN <unit>
+ *   BENCH <case> <iterations> <time per iteration> <unit>
+ *   BENCH END <cases>
+ *
+ * server_code/bench_compare.py compares them with a baseline.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+/* FreeRTOS header files */
+#include <FreeRTOS.h>
+#include "task.h"
+
+#include "app_bt_utils.h"
+#include "bench.h"
+#include "bt.h"
+#include "mqtt_client_config.h"
+#include "probe.h"
+#include "publisher.h"
+#include "state.h"
+
+/******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Shortest run of a case. The scheduler is suspended for up to twice that
+ * on the board.
+ */
+#define BENCH_MIN_TIME_US (20000u)
+#define BENCH_MAX_ITERATIONS (1u << 24)
+
+/* Wait for a free publisher slot. */
+#define BENCH_PUBLISH_RETRY_MS (50u)
+#define BENCH_PUBLISH_RETRIES (40u)
+
+#define BENCH_LINE_SIZE (96u)
+
+/******************************************************************************
+ * Types
+ ******************************************************************************/
+typedef struct {
+  const char *name;
+  void (*run)(uint32_t iterations);
+} bench_case_t;
+
+/* Results being published. */
+typedef struct {
+  char *buffer;
+  size_t size;
+  size_t len;
+  bool failed;
+} bench_sink_t;
+
+/******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+static void bench_state_active(uint32_t iterations);
+static void bench_state_unactive(uint32_t iterations);
+static void bench_state_tripped(uint32_t iterations);
+static void bench_parse(uint32_t iterations, const char *msg);
+static void bench_parse_first(uint32_t iterations);
+static void bench_parse_last(uint32_t iterations);
+static void bench_parse_none(uint32_t iterations);
+static void bench_format_bd_addr(uint32_t iterations);
+static void bench_bond_hit(uint32_t iterations);
+static void bench_bond_miss(uint32_t iterations);
+#if APP_BT_NAMES_ENABLE
+static void bench_name_btm_event(uint32_t iterations);
+static void bench_name_gatt_status(uint32_t iterations);
+#endif
+#if BENCH_ENABLE
+static void bench_publish(const char *line);
+static void bench_flush(void);
+#endif
+
+/******************************************************************************
+ * Global Variables
+ ******************************************************************************/
+static const bench_case_t bench_cases[] = {
+    {"state_format/active", bench_state_active},
+    {"state_format/unactive", bench_state_unactive},
+    {"state_format/tripped", bench_state_tripped},
+    {"parse_command/first", bench_parse_first},
+    {"parse_command/last", bench_parse_last},
+    {"parse_command/none", bench_parse_none},
+    {"format_bd_addr", bench_format_bd_addr},
+    {"bond_lookup/hit", bench_bond_hit},
+    {"bond_lookup/miss", bench_bond_miss},
+#if APP_BT_NAMES_ENABLE
+    {"bt_name/btm_event", bench_name_btm_event},
+    {"bt_name/gatt_status", bench_name_gatt_status},
+#endif
+};
+
+#define BENCH_CASE_COUNT (sizeof(bench_cases) / sizeof(bench_cases[0]))
+
+static const wiced_bt_device_address_t bench_peer = {0x02, 0x11, 0x22,
+                                                     0x33, 0x44, 0x55};
+
+#if BENCH_ENABLE
+static TaskHandle_t bench_task_handle;
+static bench_sink_t bench_sink;
+#endif
+
+/******************************************************************************
+ * Function Name: bench_keep
+ ******************************************************************************
+ * Summary:
+ *  Makes the compiler assume a value is used, and that memory changed, so
+ *  that the loop of a case is neither removed nor hoisted.
+ *
+ ******************************************************************************/
+static inline void bench_keep(uintptr_t value) {
+  __asm__ volatile("" : : "r"(value) : "memory");
+}
+
+/******************************************************************************
+ * Function Name: bench_run
+ ******************************************************************************
+ * Summary:
+ *  Runs every case, see the top of the file.
+ *
+ * Parameters:
+ *  bench_output_t output : Receives the result lines
+ *
+ * Return:
+ *  uint32_t : Cases run
+ *
+ ******************************************************************************/
+uint32_t bench_run(bench_output_t output) {
+  const uint32_t min_ticks = BENCH_MIN_TIME_US * PROBE_TICKS_PER_US;
+  bool suspend = (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING);
+  char line[BENCH_LINE_SIZE];
+
+  output("BENCH BEGIN " PROBE_UNIT);
+  for (uint32_t i = 0; i < BENCH_CASE_COUNT; i++) {
+    uint32_t iterations = 1u;
+    uint32_t elapsed;
+    uint64_t per_op_x100;
+
+    while (true) {
+      uint32_t start;
+
+      if (suspend) {
+        vTaskSuspendAll();
+      }
+      start = probe_now();
+      bench_cases[i].run(iterations);
+      elapsed = probe_now() - start;
+      if (suspend) {
+        xTaskResumeAll();
+      }
+      if ((elapsed >= min_ticks) || (iterations >= BENCH_MAX_ITERATIONS)) {
+        break;
+      }
+      iterations *= 2u;
+    }
+
+    per_op_x100 = ((uint64_t)elapsed * 100u) / iterations;
+    snprintf(line, sizeof(line), "BENCH %s %lu %lu.%02lu " PROBE_UNIT,
+             bench_cases[i].name, (unsigned long)iterations,
+             (unsigned long)(per_op_x100 / 100u),
+             (unsigned long)(per_op_x100 % 100u));
+    output(line);
+  }
+  snprintf(line, sizeof(line), "BENCH END %lu",
+           (unsigned long)BENCH_CASE_COUNT);
+  output(line);
+  return BENCH_CASE_COUNT;
+}
+
+/******************************************************************************
+ * Function Name: bench_request
+ ******************************************************************************
+ * Summary:
+ *  Asks the benchmark task to run the suite.
+ *
+ ******************************************************************************/
+void bench_request(void) {
+#if BENCH_ENABLE
+  if (bench_task_handle != NULL) {
+    xTaskNotifyGive(bench_task_handle);
+  }
+#endif
+}
+
+/******************************************************************************
+ * Function Name: bench_task
+ ******************************************************************************
+ * Summary:
+ *  Runs the suite when requested, and publishes the results on
+ *  MQTT_DIAG_TOPIC.
+ *
+ * Parameters:
+ *  void *pvParameters : Task parameter defined during task creation (unused)
+ *
+ ******************************************************************************/
+void bench_task(void *pvParameters) {
+  (void)pvParameters;
+
+#if BENCH_ENABLE
+  bench_task_handle = xTaskGetCurrentTaskHandle();
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    memset(&bench_sink, 0, sizeof(bench_sink));
+    bench_run(bench_publish);
+    bench_flush();
+    if (bench_sink.failed) {
+      printf("Bench: results incomplete, no publisher slot\n");
+    }
+  }
+#else
+  vTaskDelete(NULL);
+#endif
+}
+
+static void bench_state_active(uint32_t iterations) {
+  State state = {.state = SEC_ACTIVE};
+  char buffer[MQTT_PUBLISH_PAYLOAD_MAX];
+
+  for (uint32_t i = 0; i < iterations; i++) {
+    bench_keep((uintptr_t)state_format(&state, buffer, sizeof(buffer)));
+  }
+}
+
+static void bench_state_unactive(uint32_t iterations) {
+  State state = {.state = SEC_UNACTIVE};
+  char buffer[MQTT_PUBLISH_PAYLOAD_MAX];
+
+  memcpy(state.meta.bdadr, bench_peer, sizeof(state.meta.bdadr));
+  for (uint32_t i = 0; i < iterations; i++) {
+    bench_keep((uintptr_t)state_format(&state, buffer, sizeof(buffer)));
+  }
+}
+
+static void bench_state_tripped(uint32_t iterations) {
+  State state = {.state = SEC_TRIPPED};
+  char buffer[MQTT_PUBLISH_PAYLOAD_MAX];
+
+  for (uint32_t i = 0; i < iterations; i++) {
+    bench_keep((uintptr_t)state_format(&state, buffer, sizeof(buffer)));
+  }
+}
+
+static void bench_parse(uint32_t iterations, const char *msg) {
+  size_t len = strlen(msg);
+
+  for (uint32_t i = 0; i < iterations; i++) {
+    bench_keep((uintptr_t)state_parse_command(msg, len));
+  }
+}
+
+static void bench_parse_first(uint32_t iterations) {
+  bench_parse(iterations, "LOGLEVEL 1 3");
+}
+
+static void bench_parse_last(uint32_t iterations) {
+  bench_parse(iterations, "ACTIVATEALARM");
+}
+
+static void bench_parse_none(uint32_t iterations) {
+  bench_parse(iterations, "HELLO");
+}
+
+static void bench_format_bd_addr(uint32_t iterations) {
+  char text[APP_BT_BDA_TEXT_SIZE];
+
+  for (uint32_t i = 0; i < iterations; i++) {
+    bench_keep((uintptr_t)format_bd_address(text, sizeof(text), bench_peer));
+  }
+}
+
+/* The bond info is empty unless a device bonded, so an all-zero address
+ * hits.
+ */
+static void bench_bond_hit(uint32_t iterations) {
+  static const wiced_bt_device_address_t none = {0};
+
+  for (uint32_t i = 0; i < iterations; i++) {
+    bench_keep((uintptr_t)bt_bond_lookup(none));
+  }
+}
+
+static void bench_bond_miss(uint32_t iterations) {
+  for (uint32_t i = 0; i < iterations; i++) {
+    bench_keep((uintptr_t)bt_bond_lookup(bench_peer));
+  }
+}
+
+#if APP_BT_NAMES_ENABLE
+static void bench_name_btm_event(uint32_t iterations) {
+  for (uint32_t i = 0; i < iterations; i++) {
+    bench_keep((uintptr_t)get_btm_event_name(BTM_PAIRING_COMPLETE_EVT));
+  }
+}
+
+static void bench_name_gatt_status(uint32_t iterations) {
+  for (uint32_t i = 0; i < iterations; i++) {
+    bench_keep((uintptr_t)get_bt_gatt_status_name(WICED_BT_GATT_SUCCESS));
+  }
+}
+#endif
+
+#if BENCH_ENABLE
+/******************************************************************************
+ * Function Name: bench_publish
+ ******************************************************************************
+ * Summary:
+ *  Prints a result line and packs it into a publisher slot. A message holds
+ *  whole lines.
+ *
+ ******************************************************************************/
+static void bench_publish(const char *line) {
+  size_t len = strlen(line) + 1u;
+
+  printf("%s\n", line);
+  if (bench_sink.failed) {
+    return;
+  }
+  if ((bench_sink.buffer != NULL) &&
+      ((bench_sink.len + len) >= bench_sink.size)) {
+    bench_flush();
+  }
+  for (uint32_t retry = 0; bench_sink.buffer == NULL; retry++) {
+    if (retry == BENCH_PUBLISH_RETRIES) {
+      bench_sink.failed = true;
+      return;
+    }
+    bench_sink.buffer = publisher_reserve(&bench_sink.size);
+    bench_sink.len = 0;
+    if (bench_sink.buffer == NULL) {
+      vTaskDelay(pdMS_TO_TICKS(BENCH_PUBLISH_RETRY_MS));
+    }
+  }
+  memcpy(&bench_sink.buffer[bench_sink.len], line, len - 1u);
+  bench_sink.buffer[bench_sink.len + len - 1u] = '\n';
+  bench_sink.len += len;
+}
+
+/* Publishes the lines collected so far. */
+static void bench_flush(void) {
+  if (bench_sink.buffer == NULL) {
+    return;
+  }
+  if (publisher_commit(MQTT_CLASS_DIAG, bench_sink.buffer, bench_sink.len) !=
+      CY_RSLT_SUCCESS) {
+    bench_sink.failed = true;
+  }
+  bench_sink.buffer = NULL;
+}
+#endif /* BENCH_ENABLE */
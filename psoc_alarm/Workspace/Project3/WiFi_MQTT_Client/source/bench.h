@@ -0,0 +1,35 @@
+/*
+ * bench.h
+ *
+ * Microbenchmarks of the code that runs on every event. The same cases run
+ * on the host build, in nanoseconds, and on the board, in cycles of the DWT
+ * cycle counter, see bench.c.
+ */
+
+#ifndef SOURCE_BENCH_H_
+#define SOURCE_BENCH_H_
+
+#include <stdint.h>
+#include "log_config.h"
+
+/*******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Task parameters for the benchmark task, which runs the suite on request. */
+#define BENCH_TASK_PRIORITY (0)
+#define BENCH_TASK_STACK_SIZE (1024 * 2)
+
+/*******************************************************************************
+ * Data Types
+ ******************************************************************************/
+/* Receives each line of the results, without the newline. */
+typedef void (*bench_output_t)(const char *line);
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+uint32_t bench_run(bench_output_t output);
+void bench_request(void);
+void bench_task(void *pvParameters);
+
+#endif /* SOURCE_BENCH_H_ */
@@ -1,5 +1,9 @@
 #include "bt.h"
 #include "app_bt_utils.h"
+#include "deadline.h"
+#include "log.h"
+#include "probe.h"
+#include "recorder.h"
 #include "state.h"
 
 #include "GeneratedSource/cycfg_bt_settings.h"
@@ -91,7 +95,8 @@ void ble_app_init(void) {
 
   /* Allow new devices to bond and disable security */
   bond_mode = TRUE;
-  printf("Starting Undirected Advertisement \r\n\r\n");
+  LOG(LOG_MODULE_BT, LOG_LEVEL_INFO,
+      "Starting Undirected Advertisement \r\n\r\n");
   /* Start Undirected LE Advertisements on device startup. */
   wiced_bt_start_advertisements(BTM_BLE_ADVERT_UNDIRECTED_HIGH, 0, NULL);
 }
@@ -120,35 +125,33 @@ app_bt_management_callback(wiced_bt_management_evt_t event,
   wiced_bt_dev_status_t status = WICED_BT_SUCCESS;
   wiced_bt_device_address_t bda = {0};
   wiced_bt_dev_ble_pairing_info_t *p_ble_info = NULL;
+  uint32_t timing_start = log_timing_start();
+  PROBE_START(PROBE_BT_MANAGEMENT);
 
   switch (event) {
   case BTM_ENABLED_EVT:
     /* Bluetooth Controller and Host Stack Enabled */
     if (WICED_BT_SUCCESS == p_event_data->enabled.status) {
       wiced_bt_dev_read_local_addr(bda);
-      printf("Local Bluetooth Address: ");
-      print_bd_address(bda);
+      LOG(LOG_MODULE_BT, LOG_LEVEL_INFO, "Local Bluetooth Address: " LOG_BDA_FMT "\r\n", LOG_BDA(bda));
       /* Perform application-specific initialization */
       ble_app_init();
     } else {
-      printf("Bluetooth Disabled \n");
+      LOG(LOG_MODULE_BT, LOG_LEVEL_WARNING, "Bluetooth Disabled \n");
     }
     break;
 
   case BTM_DISABLED_EVT:
     /* Bluetooth Controller and Host Stack Disabled */
-    printf("Bluetooth Disabled \r\n");
+    LOG(LOG_MODULE_BT, LOG_LEVEL_INFO, "Bluetooth Disabled \r\n");
     break;
 
   case BTM_PASSKEY_NOTIFICATION_EVT:
     /* Print passkey to the screen so that the user can enter it. */
-    printf("*******************************************************************"
-           "***\n");
-    printf("Passkey Notification\n");
-    printf("PassKey: %" PRIu32 " \n",
-           p_event_data->user_passkey_notification.passkey);
-    printf("*******************************************************************"
-           "***\n");
+    LOG(LOG_MODULE_BT, LOG_LEVEL_INFO, "*******************************************************************"
+        "***\nPasskey Notification\nPassKey: %" PRIu32 " \n"
+        "*******************************************************************"
+        "***\n", p_event_data->user_passkey_notification.passkey);
     /*for simplicity we are confirming the passkey, end users may want to
      * implement their own input method*/
     wiced_bt_dev_confirm_req_reply(
@@ -157,6 +160,7 @@ app_bt_management_callback(wiced_bt_management_evt_t event,
     /* Send to MQTT */
     newState.state = SEC_PAIRING;
     newState.meta.passkey = p_event_data->user_passkey_notification.passkey;
+    recorder_state(RECORDER_BT, newState.state, &newState.meta);
     if (xStateQueue != NULL)
       xQueueSend(xStateQueue, &newState, (TickType_t)10);
     break;
@@ -165,17 +169,17 @@ app_bt_management_callback(wiced_bt_management_evt_t event,
     /* Security Request */
     /* Only grant if we are in bonding mode */
     if (TRUE == bond_mode) {
-      printf("Security Request Granted \n");
+      LOG(LOG_MODULE_BT, LOG_LEVEL_INFO, "Security Request Granted \n");
       wiced_bt_ble_security_grant(p_event_data->security_request.bd_addr,
                                   WICED_SUCCESS);
     } else {
-      printf("Security Request Denied - not in bonding mode \n");
+      LOG(LOG_MODULE_BT, LOG_LEVEL_WARNING, "Security Request Denied - not in bonding mode \n");
     }
     break;
 
   case BTM_PAIRING_IO_CAPABILITIES_BLE_REQUEST_EVT:
     /* Request for Pairing IO Capabilities (BLE) */
-    printf("BLE Pairing IO Capabilities Request\n");
+    LOG(LOG_MODULE_BT, LOG_LEVEL_INFO, "BLE Pairing IO Capabilities Request\n");
     /* IO Capabilities on this Platform */
     p_event_data->pairing_io_capabilities_ble_request.local_io_cap =
         BTM_IO_CAPABILITIES_DISPLAY_AND_YES_NO_INPUT;
@@ -186,60 +190,60 @@ app_bt_management_callback(wiced_bt_management_evt_t event,
     break;
 
   case BTM_BLE_CONNECTION_PARAM_UPDATE:
-    printf("Connection parameter update status:%d, Connection Interval: %d, "
-           "Connection Latency: %d, Connection Timeout: %d\n",
-           p_event_data->ble_connection_param_update.status,
-           p_event_data->ble_connection_param_update.conn_interval,
-           p_event_data->ble_connection_param_update.conn_latency,
-           p_event_data->ble_connection_param_update.supervision_timeout);
+    LOG(LOG_MODULE_BT, LOG_LEVEL_INFO, "Connection parameter update status:%d, Connection Interval: %d, "
+        "Connection Latency: %d, Connection Timeout: %d\n",
+        p_event_data->ble_connection_param_update.status,
+        p_event_data->ble_connection_param_update.conn_interval,
+        p_event_data->ble_connection_param_update.conn_latency,
+        p_event_data->ble_connection_param_update.supervision_timeout);
     break;
 
   case BTM_PAIRING_COMPLETE_EVT:
 
     /* Pairing is Complete */
     p_ble_info = &p_event_data->pairing_complete.pairing_complete_info.ble;
-    printf("Pairing Status %s \n", get_bt_smp_status_name(p_ble_info->reason));
+    LOG(LOG_MODULE_BT, LOG_LEVEL_INFO, "Pairing Status %d %s \n",
+        p_ble_info->reason,
+        LOG_STR(get_bt_smp_status_name(p_ble_info->reason)));
 
     if (WICED_BT_SUCCESS == p_ble_info->reason) /* Bonding successful */
     {
-      printf("Successfully Bonded to: ");
-      print_bd_address(p_event_data->pairing_complete.bd_addr);
+      LOG(LOG_MODULE_BT, LOG_LEVEL_INFO, "Successfully Bonded to: " LOG_BDA_FMT "\r\n",
+          LOG_BDA(p_event_data->pairing_complete.bd_addr));
 
       bond_mode = FALSE; /* remember that the device is now bonded, so disable
                         bonding */
     } else {
-      printf("Bonding failed! \n");
+      LOG(LOG_MODULE_BT, LOG_LEVEL_WARNING, "Bonding failed! \n");
     }
     break;
 
   case BTM_ENCRYPTION_STATUS_EVT:
     /* Encryption Status Change */
-    printf("Encryption Status event for: ");
-    print_bd_address(p_event_data->encryption_status.bd_addr);
-    printf("Encryption Status event result: %d \n",
-           p_event_data->encryption_status.result);
-
-    if (memcmp(&(bondinfo.link_keys.bd_addr),
-               p_event_data->encryption_status.bd_addr,
-               sizeof(wiced_bt_device_address_t)) == 0) {
+    LOG(LOG_MODULE_BT, LOG_LEVEL_INFO, "Encryption Status event for: " LOG_BDA_FMT "\r\n",
+        LOG_BDA(p_event_data->encryption_status.bd_addr));
+    LOG(LOG_MODULE_BT, LOG_LEVEL_INFO, "Encryption Status event result: %d \n",
+        p_event_data->encryption_status.result);
+
+    if (bt_bond_lookup(p_event_data->encryption_status.bd_addr)) {
       app_wicedbutton_mb1_client_char_config[0] = peer_cccd_data;
       /* Bonded */
-      printf("Bond info present.\n");
+      LOG(LOG_MODULE_BT, LOG_LEVEL_INFO, "Bond info present.\n");
     } else {
-      printf("No Bond info present.\n");
+      LOG(LOG_MODULE_BT, LOG_LEVEL_INFO, "No Bond info present.\n");
     }
     break;
 
   case BTM_PAIRED_DEVICE_LINK_KEYS_UPDATE_EVT:
     /* save device keys to Flash */
-    printf("Paired Device Key Update \r\n");
+    LOG(LOG_MODULE_BT, LOG_LEVEL_INFO, "Paired Device Key Update \r\n");
     wiced_bt_device_link_keys_t *link_key =
         &(p_event_data->paired_device_link_keys_update);
     memcpy(&bondinfo.link_keys, (uint8_t *)link_key,
            sizeof(wiced_bt_device_link_keys_t));
 
-    printf("Successfully Bonded to AAAAAAAAAAAAAAAAAAA ");
-    print_bd_address(p_event_data->paired_device_link_keys_update.bd_addr);
+    LOG(LOG_MODULE_BT, LOG_LEVEL_INFO, "Successfully Bonded to " LOG_BDA_FMT "\r\n",
+        LOG_BDA(p_event_data->paired_device_link_keys_update.bd_addr));
 
     /** REAL BT MAC */
     newState.state = SEC_CONNECTED;
@@ -247,15 +251,15 @@ app_bt_management_callback(wiced_bt_management_evt_t event,
            p_event_data->paired_device_link_keys_update.bd_addr,
            sizeof(p_event_data->paired_device_link_keys_update.bd_addr));
     /* Send new state */
+    recorder_state(RECORDER_BT, newState.state, &newState.meta);
     if (xStateQueue != NULL)
       xQueueSend(xStateQueue, (void*)&newState, (TickType_t)10);
     break;
 
   case BTM_PAIRED_DEVICE_LINK_KEYS_REQUEST_EVT:
     /* Paired Device Link Keys Request */
-    printf("Paired Device Link keys Request Event for device ");
-    print_bd_address(
-        (uint8_t *)(p_event_data->paired_device_link_keys_request.bd_addr));
+    LOG(LOG_MODULE_BT, LOG_LEVEL_INFO, "Paired Device Link keys Request Event for device " LOG_BDA_FMT "\r\n",
+        LOG_BDA(p_event_data->paired_device_link_keys_request.bd_addr));
     /* Need to search to see if the BD_ADDR we are looking for is in Flash. If
      * not, we return WICED_BT_ERROR and the stack */
     /* will generate keys and will then call
@@ -263,17 +267,15 @@ app_bt_management_callback(wiced_bt_management_evt_t event,
     status = WICED_BT_ERROR; /* Assume the device won't be found. If it is, we
                                 will set this back to WICED_BT_SUCCESS */
 
-    printf("MEMCMP - ");
-    print_bd_address(bondinfo.link_keys.bd_addr);
-    if (memcmp(&(bondinfo.link_keys.bd_addr),
-               p_event_data->paired_device_link_keys_request.bd_addr,
-               sizeof(wiced_bt_device_address_t)) == 0) {
+    LOG(LOG_MODULE_BT, LOG_LEVEL_DEBUG, "MEMCMP - " LOG_BDA_FMT "\r\n",
+        LOG_BDA(bondinfo.link_keys.bd_addr));
+    if (bt_bond_lookup(p_event_data->paired_device_link_keys_request.bd_addr)) {
       /* Copy the keys to where the stack wants it */
       memcpy(&(p_event_data->paired_device_link_keys_request),
              &(bondinfo.link_keys), sizeof(wiced_bt_device_link_keys_t));
       status = WICED_BT_SUCCESS;
     } else {
-      printf("Device Link Keys not found in the database! \n");
+      LOG(LOG_MODULE_BT, LOG_LEVEL_WARNING, "Device Link Keys not found in the database! \n");
     }
 
     break;
@@ -281,7 +283,7 @@ app_bt_management_callback(wiced_bt_management_evt_t event,
   case BTM_LOCAL_IDENTITY_KEYS_UPDATE_EVT: /* Update of local privacy keys -
                                               save to NVSRAM */
     /* Update of local privacy keys - save to Flash */
-    printf("Local Identity Key Update\n");
+    LOG(LOG_MODULE_BT, LOG_LEVEL_INFO, "Local Identity Key Update\n");
     memcpy(&identity_keys,
            (uint8_t *)&(p_event_data->local_identity_keys_update),
            sizeof(wiced_bt_local_identity_keys_t));
@@ -291,11 +293,10 @@ app_bt_management_callback(wiced_bt_management_evt_t event,
   case BTM_LOCAL_IDENTITY_KEYS_REQUEST_EVT: /* Request for local privacy keys -
                                                read from Flash */
 
-    printf("Local Identity Key Request\r\n");
+    LOG(LOG_MODULE_BT, LOG_LEVEL_INFO, "Local Identity Key Request\r\n");
     /*Read Local Identity Resolution Keys*/
     memcpy(&(p_event_data->local_identity_keys_request), &(identity_keys),
            sizeof(wiced_bt_local_identity_keys_t));
-    print_array(&identity_keys, sizeof(wiced_bt_local_identity_keys_t));
     status = WICED_BT_SUCCESS;
 
     break;
@@ -304,15 +305,18 @@ app_bt_management_callback(wiced_bt_management_evt_t event,
     /* Advertisement State Changed */
     p_adv_mode = &p_event_data->ble_advert_state_changed;
     // led_task_communicator(*p_adv_mode);
-    printf("Advertisement State Change: %d\r\n", *p_adv_mode);
+    LOG(LOG_MODULE_BT, LOG_LEVEL_INFO, "Advertisement State Change: %d\r\n", *p_adv_mode);
     break;
 
   default:
-    printf("Unhandled Bluetooth Management Event: 0x%x %s\n", event,
-           get_btm_event_name(event));
+    LOG(LOG_MODULE_BT, LOG_LEVEL_DEBUG,
+        "Unhandled Bluetooth Management Event: 0x%x %s\n", event,
+        LOG_STR(get_btm_event_name(event)));
     break;
   }
 
+  PROBE_STOP(PROBE_BT_MANAGEMENT);
+  log_timing_end(LOG_TIMING_BT_MANAGEMENT, timing_start);
   return status;
 }
 
@@ -320,9 +324,12 @@ static wiced_bt_gatt_status_t
 ble_app_gatt_event_handler(wiced_bt_gatt_evt_t event,
                            wiced_bt_gatt_event_data_t *p_event_data) {
   wiced_bt_gatt_status_t status = WICED_BT_GATT_ERROR;
+  uint32_t timing_start = log_timing_start();
+
   if (event == GATT_CONNECTION_STATUS_EVT) {
     status = ble_app_connect_handler(&p_event_data->connection_status);
   }
+  log_timing_end(LOG_TIMING_BT_GATT, timing_start);
   return status;
 }
 
@@ -348,18 +355,19 @@ ble_app_connect_handler(wiced_bt_gatt_connection_status_t *p_conn_status) {
   if (NULL != p_conn_status) {
     if (p_conn_status->connected) {
       /* Device has connected */
-      printf("Connected : BD Addr: ");
-      print_bd_address(p_conn_status->bd_addr);
-      printf("Connection ID '%d'\n", p_conn_status->conn_id);
+      LOG(LOG_MODULE_BT, LOG_LEVEL_INFO, "Connected : BD Addr: " LOG_BDA_FMT "\r\n",
+          LOG_BDA(p_conn_status->bd_addr));
+      LOG(LOG_MODULE_BT, LOG_LEVEL_INFO, "Connection ID '%d'\n", p_conn_status->conn_id);
 
       /* Handling the connection by updating connection ID */
       connection_id = p_conn_status->conn_id;
     } else {
       /* Device has disconnected */
-      printf("\nDisconnected : BD Addr: ");
-      print_bd_address(p_conn_status->bd_addr);
-      printf("Connection ID '%d', Reason '%s'\n", p_conn_status->conn_id,
-             get_bt_gatt_disconn_reason_name(p_conn_status->reason));
+      LOG(LOG_MODULE_BT, LOG_LEVEL_INFO, "\nDisconnected : BD Addr: " LOG_BDA_FMT "\r\n",
+          LOG_BDA(p_conn_status->bd_addr));
+      LOG(LOG_MODULE_BT, LOG_LEVEL_INFO, "Connection ID '%d', Reason %d '%s'\n", p_conn_status->conn_id,
+          p_conn_status->reason,
+          LOG_STR(get_bt_gatt_disconn_reason_name(p_conn_status->reason)));
 
       /* Handling the disconnection */
       connection_id = 0;
@@ -371,17 +379,19 @@ ble_app_connect_handler(wiced_bt_gatt_connection_status_t *p_conn_status) {
        * When Disconnected -> Start scanning for the previously bonded device
        * again
        */
-      printf("\r\nStarting directed Advertisement to: ");
-      print_bd_address(bondinfo.link_keys.bd_addr);
-      print_bd_address(bondinfo.link_keys.conn_addr);
-      printf("Enter 'e' for starting undirected Advertisement to add new "
-             "device\r\n");
+      LOG(LOG_MODULE_BT, LOG_LEVEL_INFO, "\r\nStarting directed Advertisement to: " LOG_BDA_FMT "\r\n",
+          LOG_BDA(bondinfo.link_keys.bd_addr));
+      LOG(LOG_MODULE_BT, LOG_LEVEL_INFO, LOG_BDA_FMT "\r\n", LOG_BDA(bondinfo.link_keys.conn_addr));
+      LOG(LOG_MODULE_BT, LOG_LEVEL_INFO, "Enter 'e' for starting undirected Advertisement to add new "
+          "device\r\n");
       wiced_bt_start_advertisements(BTM_BLE_ADVERT_DIRECTED_HIGH,
                                     bondinfo.link_keys.key_data.ble_addr_type,
                                     bondinfo.link_keys.bd_addr);
 
       newState.state = SEC_DISCONNETED;
       /* Send new state */
+      recorder_state(RECORDER_BT, newState.state, &newState.meta);
+      deadline_start(DEADLINE_DISCONNECT_ARMED);
       if (xStateQueue != NULL)
         xQueueSend(xStateQueue, &newState, (TickType_t)10);
     }
@@ -390,3 +400,20 @@ ble_app_connect_handler(wiced_bt_gatt_connection_status_t *p_conn_status) {
 
   return status;
 }
+
+/**
+ * Function Name:
+ * bt_bond_lookup
+ *
+ * Function Description:
+ * @brief  Checks whether a peer is the bonded device. Called on every
+ *         encryption status and link key request.
+ *
+ * @param  const wiced_bt_device_address_t bd_addr: Address of the peer
+ *
+ * @return bool: true if the bond info is for this peer
+ */
+bool bt_bond_lookup(const wiced_bt_device_address_t bd_addr) {
+  return memcmp(bondinfo.link_keys.bd_addr, bd_addr,
+                sizeof(wiced_bt_device_address_t)) == 0;
+}
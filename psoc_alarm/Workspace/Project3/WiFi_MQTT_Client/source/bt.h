@@ -12,6 +12,7 @@
  *                                INCLUDES
  ******************************************************************************/
 #include "stdio.h"
+#include <stdbool.h>
 #include "wiced_bt_dev.h"
 #include <FreeRTOS.h>
 #include <task.h>
@@ -40,4 +41,7 @@ wiced_bt_dev_status_t app_bt_management_callback(
 		wiced_bt_management_evt_t event,
 		wiced_bt_management_evt_data_t *p_event_data);
 
+/* Bond info lookup, see bt.c */
+bool bt_bond_lookup(const wiced_bt_device_address_t bd_addr);
+
 #endif /* SOURCE_BT_H_ */
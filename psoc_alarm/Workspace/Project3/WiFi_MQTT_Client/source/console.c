@@ -0,0 +1,276 @@
+/**
+ * This file implements the non-blocking debug UART console.
+ *
+ * retarget-io writes stdout one byte at a time and waits for the UART, so a
+ * printf() from a high priority task holds the CPU for the duration of the
+ * line on the wire. Here _write() only copies the text into a TX ring, with
+ * the LF to CRLF conversion of retarget-io, and the UART drains the ring by
+ * DMA. Each DMA transfer sends the contiguous part of the ring up to its end;
+ * the TX done interrupt starts the next one. Text that does not fit is
+ * dropped and counted, the caller never waits.
+ *
+ * The fault handler flushes the ring with polled writes, so the last lines
+ * before a crash are not lost.
+ */
+
+#include <stdio.h>
+
+#include "cy_retarget_io.h"
+#include "cyhal.h"
+
+#include "console.h"
+#include "log.h"
+#include "log_config.h"
+#include "trace.h"
+
+#if ((CONSOLE_TX_BUFFER_SIZE & (CONSOLE_TX_BUFFER_SIZE - 1u)) != 0u)
+#error "CONSOLE_TX_BUFFER_SIZE must be a power of two"
+#endif
+
+/******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Priority of the UART TX done interrupt. */
+#define CONSOLE_UART_INTR_PRIORITY (7u)
+
+/******************************************************************************
+ * Global Variables
+ ******************************************************************************/
+#if CONSOLE_DMA_ENABLE
+static uint8_t tx_ring[CONSOLE_TX_BUFFER_SIZE];
+
+/* Free running write and read positions, and the bytes handed to the DMA. */
+static volatile uint32_t tx_head;
+static volatile uint32_t tx_tail;
+static volatile uint32_t tx_in_flight;
+
+static bool console_dma_ready;
+#endif
+
+static console_stats_t console_stats;
+
+/******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+#if CONSOLE_DMA_ENABLE
+static void console_start_tx(void);
+static void console_uart_event(void *callback_arg, cyhal_uart_event_t event);
+#endif
+int _write(int fd, const char *ptr, int len);
+
+/******************************************************************************
+ * Function Name: console_init
+ ******************************************************************************
+ * Summary:
+ *  Switches the retarget-io UART to DMA transfers. Called after
+ *  cy_retarget_io_init(); output before it is written synchronously.
+ *
+ * Return:
+ *  cy_rslt_t : CY_RSLT_SUCCESS on success, else the HAL error. The console
+ *              then stays synchronous.
+ *
+ ******************************************************************************/
+cy_rslt_t console_init(void) {
+#if CONSOLE_DMA_ENABLE
+  cy_rslt_t result;
+
+  result = cyhal_uart_set_async_mode(&cy_retarget_io_uart_obj, CYHAL_ASYNC_DMA,
+                                     CYHAL_DMA_PRIORITY_DEFAULT);
+  if (result != CY_RSLT_SUCCESS) {
+    return result;
+  }
+
+  cyhal_uart_register_callback(&cy_retarget_io_uart_obj, console_uart_event,
+                               NULL);
+  cyhal_uart_enable_event(&cy_retarget_io_uart_obj, CYHAL_UART_IRQ_TX_DONE,
+                          CONSOLE_UART_INTR_PRIORITY, true);
+  console_dma_ready = true;
+#endif
+  return CY_RSLT_SUCCESS;
+}
+
+/******************************************************************************
+ * Function Name: console_flush
+ ******************************************************************************
+ * Summary:
+ *  Stops the DMA and writes what is left in the ring with polled writes. For
+ *  the fault handler, with interrupts disabled. The transfer in flight is
+ *  sent again from its start.
+ *
+ ******************************************************************************/
+void console_flush(void) {
+#if CONSOLE_DMA_ENABLE
+  if (!console_dma_ready) {
+    return;
+  }
+  console_dma_ready = false;
+  cyhal_uart_write_abort(&cy_retarget_io_uart_obj);
+
+  while (tx_tail != tx_head) {
+    cyhal_uart_putc(&cy_retarget_io_uart_obj,
+                    tx_ring[tx_tail & (CONSOLE_TX_BUFFER_SIZE - 1u)]);
+    tx_tail++;
+  }
+  tx_in_flight = 0;
+#endif
+}
+
+/******************************************************************************
+ * Function Name: console_get_stats
+ ******************************************************************************
+ * Summary:
+ *  Reads the console counters.
+ *
+ * Parameters:
+ *  console_stats_t *stats : Filled with the counters
+ *  bool reset             : Restart the counters from 0
+ *
+ ******************************************************************************/
+void console_get_stats(console_stats_t *stats, bool reset) {
+  uint32_t saved_intr = cyhal_system_critical_section_enter();
+
+  *stats = console_stats;
+  if (reset) {
+    console_stats = (console_stats_t){0};
+  }
+  cyhal_system_critical_section_exit(saved_intr);
+}
+
+/******************************************************************************
+ * Function Name: _write
+ ******************************************************************************
+ * Summary:
+ *  newlib output hook, replaces the blocking one of retarget-io. Queues the
+ *  text for the DMA, or writes it synchronously with CONSOLE_DMA_ENABLE set
+ *  to 0 and before console_init().
+ *
+ * Parameters:
+ *  int fd          : File descriptor (unused, stdout and stderr)
+ *  const char *ptr : Text
+ *  int len         : Length of the text
+ *
+ * Return:
+ *  int : len, dropped text included, so that newlib does not retry
+ *
+ ******************************************************************************/
+int _write(int fd, const char *ptr, int len) {
+  uint32_t timing_start = log_timing_start();
+  int i = 0;
+
+  (void)fd;
+
+#if CONSOLE_DMA_ENABLE
+  if (console_dma_ready) {
+    uint32_t saved_intr = cyhal_system_critical_section_enter();
+
+    for (; i < len; i++) {
+      uint32_t needed = 1u;
+#ifdef CY_RETARGET_IO_CONVERT_LF_TO_CRLF
+      if (ptr[i] == '\n') {
+        needed = 2u;
+      }
+#endif
+      if ((CONSOLE_TX_BUFFER_SIZE - (tx_head - tx_tail)) < needed) {
+        break;
+      }
+      if (needed == 2u) {
+        tx_ring[tx_head++ & (CONSOLE_TX_BUFFER_SIZE - 1u)] = '\r';
+      }
+      tx_ring[tx_head++ & (CONSOLE_TX_BUFFER_SIZE - 1u)] = (uint8_t)ptr[i];
+    }
+
+    console_stats.bytes_dropped += (uint32_t)(len - i);
+    if ((tx_head - tx_tail) > console_stats.peak_pending) {
+      console_stats.peak_pending = tx_head - tx_tail;
+    }
+    console_start_tx();
+    cyhal_system_critical_section_exit(saved_intr);
+  }
+#endif
+
+  for (; i < len; i++) {
+#ifdef CY_RETARGET_IO_CONVERT_LF_TO_CRLF
+    if (ptr[i] == '\n') {
+      cyhal_uart_putc(&cy_retarget_io_uart_obj, '\r');
+    }
+#endif
+    cyhal_uart_putc(&cy_retarget_io_uart_obj, (uint32_t)ptr[i]);
+    console_stats.bytes_sent++;
+  }
+
+  log_timing_end(LOG_TIMING_CONSOLE_WRITE, timing_start);
+  return len;
+}
+
+#if CONSOLE_DMA_ENABLE
+/******************************************************************************
+ * Function Name: console_start_tx
+ ******************************************************************************
+ * Summary:
+ *  Starts a DMA transfer of the pending text up to the end of the ring, if
+ *  none is running. Called with interrupts disabled.
+ *
+ ******************************************************************************/
+static void console_start_tx(void) {
+  uint32_t pending = tx_head - tx_tail;
+  uint32_t offset = tx_tail & (CONSOLE_TX_BUFFER_SIZE - 1u);
+  uint32_t chunk = CONSOLE_TX_BUFFER_SIZE - offset;
+
+  if ((tx_in_flight != 0u) || (pending == 0u)) {
+    return;
+  }
+  if (chunk > pending) {
+    chunk = pending;
+  }
+
+  tx_in_flight = chunk;
+  if (cyhal_uart_write_async(&cy_retarget_io_uart_obj, &tx_ring[offset],
+                             chunk) != CY_RSLT_SUCCESS) {
+    tx_in_flight = 0u;
+  }
+}
+
+/******************************************************************************
+ * Function Name: console_uart_event
+ ******************************************************************************
+ * Summary:
+ *  UART interrupt callback. Releases the text sent by the DMA and starts the
+ *  next transfer.
+ *
+ * Parameters:
+ *  void *callback_arg       : Unused
+ *  cyhal_uart_event_t event : UART events
+ *
+ ******************************************************************************/
+static void console_uart_event(void *callback_arg, cyhal_uart_event_t event) {
+  (void)callback_arg;
+
+  TRACE_ISR_ENTER();
+  if ((event & CYHAL_UART_IRQ_TX_DONE) != 0u) {
+    uint32_t saved_intr = cyhal_system_critical_section_enter();
+
+    tx_tail += tx_in_flight;
+    console_stats.bytes_sent += tx_in_flight;
+    tx_in_flight = 0u;
+    console_start_tx();
+    cyhal_system_critical_section_exit(saved_intr);
+  }
+  TRACE_ISR_EXIT();
+}
+#endif
+
+/******************************************************************************
+ * Function Name: Cy_SysLib_ProcessingFault
+ ******************************************************************************
+ * Summary:
+ *  Replaces the weak PDL fault hook, called by the fault handler after it
+ *  saved the fault registers. Sends the pending console output, then halts.
+ *
+ ******************************************************************************/
+void Cy_SysLib_ProcessingFault(void) {
+  console_flush();
+  printf("\nFault, halted.\n");
+
+  for (;;) {
+  }
+}
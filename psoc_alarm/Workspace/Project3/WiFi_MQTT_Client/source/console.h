@@ -0,0 +1,31 @@
+/*
+ * console.h
+ *
+ * Non-blocking debug UART console. stdout goes into a TX ring drained by DMA
+ * on the retarget-io UART; writes that do not fit are dropped and counted.
+ */
+
+#ifndef SOURCE_CONSOLE_H_
+#define SOURCE_CONSOLE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "cy_result.h"
+
+/*******************************************************************************
+ * Data Types
+ ******************************************************************************/
+typedef struct {
+  uint32_t bytes_sent;
+  uint32_t bytes_dropped;
+  uint32_t peak_pending;
+} console_stats_t;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+cy_rslt_t console_init(void);
+void console_flush(void);
+void console_get_stats(console_stats_t *stats, bool reset);
+
+#endif /* SOURCE_CONSOLE_H_ */
@@ -0,0 +1,233 @@
+/**
+ * This file implements the coroutine task, see coroutine.h.
+ *
+ * A pass calls every coroutine once, in the order they were started, and
+ * ends with the wait for the earliest timeout of the coroutines waiting on
+ * one. coroutine_wake() ends the wait early. A coroutine waiting on a
+ * condition is called again on every pass, so the conditions are cheap
+ * checks like a queue receive without wait.
+ *
+ * Sharing one task costs latency: an event waits for the coroutines called
+ * before its own in the pass. Two latency probes measure it,
+ * "coroutine_wake" from coroutine_wake() to the start of the next pass and
+ * "coroutine_pass" the length of a pass.
+ *
+ * The blocking calls run on the worker task instead, which the coroutine
+ * task starts: CORO_BLOCKING() hands over the call and waits for the worker
+ * to report its end with coroutine_wake(). The worker keeps the large stack
+ * the TLS handshake needs, and the coroutine task only what the coroutines
+ * need between their waits.
+ */
+
+#include <stdio.h>
+
+#include "coroutine.h"
+#include "probe.h"
+
+/******************************************************************************
+ * Types
+ ******************************************************************************/
+typedef struct {
+  coroutine_t *co;
+  coroutine_function_t function;
+} coroutine_slot_t;
+
+/******************************************************************************
+ * Global Variables
+ ******************************************************************************/
+static coroutine_slot_t slots[COROUTINE_MAX];
+static uint32_t slot_count;
+
+static TaskHandle_t coroutine_task_handle;
+
+/* Call handed to the worker task. owner is the coroutine waiting for it,
+ * NULL while the worker is idle; only the coroutine task changes it.
+ */
+static struct {
+  coroutine_t *owner;
+  coroutine_blocking_t function;
+  void *arg;
+  volatile bool done;
+  TaskHandle_t task;
+} worker;
+
+static StackType_t worker_task_stack[COROUTINE_WORKER_STACK_SIZE];
+static StaticTask_t worker_task_tcb;
+
+#if PROBE_ENABLE
+/* Time of the first coroutine_wake() since the last pass. */
+static volatile uint32_t wake_start;
+static volatile bool wake_pending;
+#endif
+
+/******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+static void coroutine_worker_task(void *pvParameters);
+
+/******************************************************************************
+ * Function Name: coroutine_start
+ ******************************************************************************
+ * Summary:
+ *  Starts a coroutine on the coroutine task. Called before the scheduler
+ *  starts or from a coroutine.
+ *
+ * Parameters:
+ *  coroutine_t *co               : State of the coroutine
+ *  coroutine_function_t function : Body of the coroutine
+ *
+ * Return:
+ *  bool : false if COROUTINE_MAX coroutines are running
+ *
+ ******************************************************************************/
+bool coroutine_start(coroutine_t *co, coroutine_function_t function) {
+  uint32_t i;
+
+  /* Reuse the slot of a finished coroutine, keeping the order. */
+  for (i = 0; i < slot_count; i++) {
+    if (slots[i].function == NULL) {
+      break;
+    }
+  }
+  if (i == COROUTINE_MAX) {
+    printf("Coroutines: more than %u\n", COROUTINE_MAX);
+    return false;
+  }
+  if (i == slot_count) {
+    slot_count++;
+  }
+
+  co->line = 0u;
+  co->timed = false;
+  slots[i].co = co;
+  slots[i].function = function;
+
+  /* A slot before the running coroutine is only called on the next pass. */
+  if (coroutine_task_handle != NULL) {
+    xTaskNotifyGive(coroutine_task_handle);
+  }
+  return true;
+}
+
+/******************************************************************************
+ * Function Name: coroutine_wake
+ ******************************************************************************
+ * Summary:
+ *  Makes the coroutine task run a pass. Called from tasks, not interrupts,
+ *  after a change a coroutine may wait for.
+ *
+ ******************************************************************************/
+void coroutine_wake(void) {
+#if PROBE_ENABLE
+  if (!wake_pending) {
+    wake_start = probe_now();
+    wake_pending = true;
+  }
+#endif
+  if (coroutine_task_handle != NULL) {
+    xTaskNotifyGive(coroutine_task_handle);
+  }
+}
+
+/******************************************************************************
+ * Function Name: coroutine_blocking
+ ******************************************************************************
+ * Summary:
+ *  Wait condition of CORO_BLOCKING(): hands the call to the worker task when
+ *  it is idle, then tells whether the call has ended. Called from the
+ *  coroutines only.
+ *
+ * Parameters:
+ *  coroutine_t *co               : State of the calling coroutine
+ *  coroutine_blocking_t function : Blocking call
+ *  void *arg                     : Argument of the call
+ *
+ * Return:
+ *  bool : true once the call has ended on the worker task
+ *
+ ******************************************************************************/
+bool coroutine_blocking(coroutine_t *co, coroutine_blocking_t function,
+                        void *arg) {
+  if (worker.owner == NULL) {
+    worker.owner = co;
+    worker.function = function;
+    worker.arg = arg;
+    worker.done = false;
+    xTaskNotifyGive(worker.task);
+    return false;
+  }
+  if ((worker.owner != co) || !worker.done) {
+    return false;
+  }
+
+  /* Another coroutine may be waiting for its turn. */
+  worker.owner = NULL;
+  xTaskNotifyGive(coroutine_task_handle);
+  return true;
+}
+
+/* Runs the calls handed over by coroutine_blocking(). */
+static void coroutine_worker_task(void *pvParameters) {
+  (void)pvParameters;
+
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    worker.function(worker.arg);
+    worker.done = true;
+    coroutine_wake();
+  }
+}
+
+/******************************************************************************
+ * Function Name: coroutine_task
+ ******************************************************************************
+ * Summary:
+ *  Runs the coroutines, see the top of the file.
+ *
+ * Parameters:
+ *  void *pvParameters : Task parameter defined during task creation (unused)
+ *
+ ******************************************************************************/
+void coroutine_task(void *pvParameters) {
+  (void)pvParameters;
+
+  coroutine_task_handle = xTaskGetCurrentTaskHandle();
+  worker.task = xTaskCreateStatic(
+      coroutine_worker_task, "Worker task", COROUTINE_WORKER_STACK_SIZE, NULL,
+      COROUTINE_WORKER_PRIORITY, worker_task_stack, &worker_task_tcb);
+
+  while (true) {
+    TickType_t wait_ticks = portMAX_DELAY;
+
+    PROBE_START(PROBE_COROUTINE_PASS);
+    for (uint32_t i = 0; i < slot_count; i++) {
+      coroutine_slot_t *slot = &slots[i];
+
+      if (slot->function == NULL) {
+        continue;
+      }
+      if (slot->function(slot->co) == COROUTINE_DONE) {
+        slot->function = NULL;
+        continue;
+      }
+      if (slot->co->timed) {
+        TickType_t left = coroutine_expired(slot->co)
+                              ? 0u
+                              : slot->co->wake - xTaskGetTickCount();
+
+        if (left < wait_ticks) {
+          wait_ticks = left;
+        }
+      }
+    }
+    PROBE_STOP(PROBE_COROUTINE_PASS);
+
+    ulTaskNotifyTake(pdTRUE, wait_ticks);
+#if PROBE_ENABLE
+    if (wake_pending) {
+      probe_record(PROBE_COROUTINE_WAKE, probe_now() - wake_start);
+      wake_pending = false;
+    }
+#endif
+  }
+}
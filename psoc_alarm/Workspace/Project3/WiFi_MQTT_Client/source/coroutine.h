@@ -0,0 +1,153 @@
+/*
+ * coroutine.h
+ *
+ * Stackless coroutines, in the style of protothreads. A coroutine is a
+ * function that returns wherever it waits and resumes at the same line on
+ * its next call: CORO_BEGIN() switches on the line stored in its
+ * coroutine_t. Local variables are not kept across a wait, the state of a
+ * coroutine lives in static variables of its module.
+ *
+ * The coroutines started with coroutine_start() all run on the coroutine
+ * task, one after the other. The task sleeps until the earliest timeout of
+ * a coroutine or until coroutine_wake(), which whatever a coroutine waits
+ * for must call once it is ready: a queue send, a semaphore give.
+ *
+ * A wait macro is used at most once per line, and not inside a switch
+ * statement of the coroutine. A coroutine hands its blocking calls, the
+ * Wi-Fi join and the TLS handshake, to the worker task with CORO_BLOCKING(),
+ * so that the other coroutines keep running meanwhile.
+ */
+
+#ifndef SOURCE_COROUTINE_H_
+#define SOURCE_COROUTINE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* FreeRTOS header files */
+#include <FreeRTOS.h>
+#include "task.h"
+
+/*******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Task parameters for the coroutine task. The connection manager of
+ * mqtt_task.c, the link monitor and the task statistics run on it.
+ */
+#define COROUTINE_TASK_PRIORITY (2)
+#define COROUTINE_TASK_STACK_SIZE (1024 * 1)
+
+/* Task parameters for the worker task, started by the coroutine task. It
+ * runs the blocking calls of the coroutines, the TLS handshake among them,
+ * below the coroutine task.
+ */
+#define COROUTINE_WORKER_PRIORITY (1)
+#define COROUTINE_WORKER_STACK_SIZE (1024 * 3)
+
+/* Coroutines running at the same time. */
+#define COROUTINE_MAX (8u)
+
+#if defined(__GNUC__) && (__GNUC__ >= 7)
+#define COROUTINE_FALLTHROUGH __attribute__((fallthrough))
+#else
+#define COROUTINE_FALLTHROUGH
+#endif
+
+/* Start and end of the body of a coroutine. */
+#define CORO_BEGIN(co)                                                         \
+  switch ((co)->line) {                                                        \
+  case 0:
+
+#define CORO_END(co)                                                           \
+  }                                                                            \
+  (co)->line = 0u;                                                             \
+  (co)->timed = false;                                                         \
+  return COROUTINE_DONE
+
+/* Ends the coroutine early. */
+#define CORO_EXIT(co)                                                          \
+  do {                                                                         \
+    (co)->line = 0u;                                                           \
+    (co)->timed = false;                                                       \
+    return COROUTINE_DONE;                                                     \
+  } while (0)
+
+/* Waits until cond is true. */
+#define CORO_WAIT_UNTIL(co, cond)                                              \
+  do {                                                                         \
+    (co)->line = __LINE__;                                                     \
+    COROUTINE_FALLTHROUGH;                                                     \
+  case __LINE__:                                                               \
+    if (!(cond)) {                                                             \
+      return COROUTINE_WAITING;                                                \
+    }                                                                          \
+  } while (0)
+
+/* Waits until cond is true, for ms milliseconds at most. */
+#define CORO_WAIT_UNTIL_FOR(co, cond, ms)                                      \
+  do {                                                                         \
+    (co)->wake = xTaskGetTickCount() + pdMS_TO_TICKS(ms);                      \
+    (co)->timed = true;                                                        \
+    CORO_WAIT_UNTIL(co, (cond) || coroutine_expired(co));                      \
+    (co)->timed = false;                                                       \
+  } while (0)
+
+#define CORO_DELAY(co, ms) CORO_WAIT_UNTIL_FOR(co, false, ms)
+
+/* Runs another coroutine to its end, call being the call of its function
+ * with the coroutine_t child. Its timeouts are those of the caller.
+ */
+#define CORO_SPAWN(co, child, call)                                            \
+  do {                                                                         \
+    (child)->line = 0u;                                                        \
+    (child)->timed = false;                                                    \
+    CORO_WAIT_UNTIL(co, coroutine_join((co), (child), (call)));                \
+  } while (0)
+
+/* Runs function(arg) on the worker task and waits for its end. The worker
+ * runs one call at a time, a coroutine finding it busy waits its turn.
+ */
+#define CORO_BLOCKING(co, function, arg)                                       \
+  CORO_WAIT_UNTIL(co, coroutine_blocking((co), (function), (arg)))
+
+/*******************************************************************************
+ * Types
+ ******************************************************************************/
+typedef enum { COROUTINE_WAITING, COROUTINE_DONE } coroutine_status_t;
+
+typedef struct {
+  /* Line to resume at, 0 at the start. */
+  uint32_t line;
+  /* Tick of the timeout, when timed. */
+  TickType_t wake;
+  bool timed;
+} coroutine_t;
+
+typedef coroutine_status_t (*coroutine_function_t)(coroutine_t *co);
+
+/* A blocking call for the worker task. */
+typedef void (*coroutine_blocking_t)(void *arg);
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+bool coroutine_start(coroutine_t *co, coroutine_function_t function);
+void coroutine_wake(void);
+bool coroutine_blocking(coroutine_t *co, coroutine_blocking_t function,
+                        void *arg);
+void coroutine_task(void *pvParameters);
+
+/* True once the timeout of a timed wait has passed. */
+static inline bool coroutine_expired(const coroutine_t *co) {
+  return (TickType_t)(xTaskGetTickCount() - co->wake) < (portMAX_DELAY / 2u);
+}
+
+/* Passes the timeout of a waiting child on to its caller. */
+static inline bool coroutine_join(coroutine_t *co, const coroutine_t *child,
+                                  coroutine_status_t status) {
+  co->timed = child->timed;
+  co->wake = child->wake;
+  return status == COROUTINE_DONE;
+}
+
+#endif /* SOURCE_COROUTINE_H_ */
@@ -0,0 +1,307 @@
+/**
+ * This file implements the response-time monitor, see deadline.h.
+ *
+ * A deadline keeps the tick it was started at. On every tick the tick hook
+ * looks at the pending deadlines, and the first tick past the budget of one
+ * copies the name of the running task. deadline_stop() counts the response,
+ * and a miss goes with that name into a ring of the last DEADLINE_MISS_LOG
+ * misses. A deadline that expires while the board sleeps in tickless idle
+ * has no task, shown as "-".
+ *
+ * DEADLINES prints the deadlines on the console and publishes them on
+ * MQTT_DIAG_TOPIC, one message per deadline and one with the misses, oldest
+ * first:
+ *
+ *   {"deadline":"button_led","budget_ms":..,"n":..,"misses":..,"max_ms":..}
+ *   {"missed":[["button_led",elapsed_ms,"task"],...]}
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+/* FreeRTOS header files */
+#include <FreeRTOS.h>
+#include "task.h"
+
+#include "deadline.h"
+#include "log.h"
+#include "mqtt_client_config.h"
+#include "publisher.h"
+
+/******************************************************************************
+ * Types
+ ******************************************************************************/
+typedef struct {
+  TickType_t start;
+  bool pending;
+  /* Set by the tick hook once the budget has passed. */
+  bool expired;
+  char task[configMAX_TASK_NAME_LEN];
+  uint32_t count;
+  uint32_t misses;
+  uint32_t max_ms;
+} deadline_state_t;
+
+typedef struct {
+  deadline_id_t id;
+  uint32_t elapsed_ms;
+  char task[configMAX_TASK_NAME_LEN];
+} deadline_miss_t;
+
+/******************************************************************************
+ * Global Variables
+ ******************************************************************************/
+#if DEADLINE_ENABLE
+static const struct {
+  const char *name;
+  uint32_t budget_ms;
+} deadline_info[DEADLINE_COUNT] = {
+    [DEADLINE_BUTTON_LED] = {"button_led", DEADLINE_BUTTON_LED_MS},
+    [DEADLINE_DISCONNECT_ARMED] = {"disconnect_armed",
+                                   DEADLINE_DISCONNECT_ARMED_MS},
+    [DEADLINE_TRIP_PUBLISH] = {"trip_publish", DEADLINE_TRIP_PUBLISH_MS},
+};
+
+static deadline_state_t deadlines[DEADLINE_COUNT];
+
+/* Ring of the last misses; miss_total counts all of them. */
+static deadline_miss_t miss_log[DEADLINE_MISS_LOG];
+static uint32_t miss_total;
+
+/******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+void vApplicationTickHook(void);
+#endif
+
+/******************************************************************************
+ * Function Name: deadline_start
+ ******************************************************************************
+ * Summary:
+ *  Starts a deadline, unless it is pending already.
+ *
+ * Parameters:
+ *  deadline_id_t id : Deadline
+ *
+ ******************************************************************************/
+void deadline_start(deadline_id_t id) {
+#if DEADLINE_ENABLE
+  deadline_state_t *deadline = &deadlines[id];
+
+  taskENTER_CRITICAL();
+  if (!deadline->pending) {
+    deadline->start = xTaskGetTickCount();
+    deadline->expired = false;
+    deadline->pending = true;
+  }
+  taskEXIT_CRITICAL();
+#else
+  (void)id;
+#endif
+}
+
+/* deadline_start() for interrupt handlers. */
+void deadline_start_from_isr(deadline_id_t id) {
+#if DEADLINE_ENABLE
+  deadline_state_t *deadline = &deadlines[id];
+  UBaseType_t saved = taskENTER_CRITICAL_FROM_ISR();
+
+  if (!deadline->pending) {
+    deadline->start = xTaskGetTickCountFromISR();
+    deadline->expired = false;
+    deadline->pending = true;
+  }
+  taskEXIT_CRITICAL_FROM_ISR(saved);
+#else
+  (void)id;
+#endif
+}
+
+/******************************************************************************
+ * Function Name: deadline_stop
+ ******************************************************************************
+ * Summary:
+ *  Counts the response to a pending deadline and logs it when late. Does
+ *  nothing when the deadline is not pending.
+ *
+ * Parameters:
+ *  deadline_id_t id : Deadline
+ *
+ ******************************************************************************/
+void deadline_stop(deadline_id_t id) {
+#if DEADLINE_ENABLE
+  deadline_state_t *deadline = &deadlines[id];
+  deadline_miss_t *miss = NULL;
+  uint32_t elapsed_ms;
+
+  taskENTER_CRITICAL();
+  if (!deadline->pending) {
+    taskEXIT_CRITICAL();
+    return;
+  }
+  deadline->pending = false;
+  elapsed_ms = (uint32_t)(xTaskGetTickCount() - deadline->start) *
+               portTICK_PERIOD_MS;
+  deadline->count++;
+  if (elapsed_ms > deadline->max_ms) {
+    deadline->max_ms = elapsed_ms;
+  }
+  if (elapsed_ms > deadline_info[id].budget_ms) {
+    deadline->misses++;
+    miss = &miss_log[miss_total % DEADLINE_MISS_LOG];
+    miss_total++;
+    miss->id = id;
+    miss->elapsed_ms = elapsed_ms;
+    if (deadline->expired) {
+      memcpy(miss->task, deadline->task, sizeof(miss->task));
+    } else {
+      strcpy(miss->task, "-");
+    }
+  }
+  taskEXIT_CRITICAL();
+
+  /* The task name is in RAM, which the deferred logger cannot print;
+   * DEADLINES shows it.
+   */
+  if (miss != NULL) {
+    LOG(LOG_MODULE_APP, LOG_LEVEL_WARNING,
+        "Deadline %s missed: %lu ms of %lu ms\n",
+        LOG_STR(deadline_info[id].name), (unsigned long)elapsed_ms,
+        (unsigned long)deadline_info[id].budget_ms);
+  }
+#else
+  (void)id;
+#endif
+}
+
+#if DEADLINE_ENABLE
+/******************************************************************************
+ * Function Name: vApplicationTickHook
+ ******************************************************************************
+ * Summary:
+ *  Notes the running task when a pending deadline expires. Called by the
+ *  kernel from the tick interrupt, configUSE_TICK_HOOK.
+ *
+ ******************************************************************************/
+void vApplicationTickHook(void) {
+  TickType_t now = xTaskGetTickCountFromISR();
+
+  for (uint32_t id = 0; id < DEADLINE_COUNT; id++) {
+    deadline_state_t *deadline = &deadlines[id];
+    TickType_t budget = pdMS_TO_TICKS(deadline_info[id].budget_ms);
+
+    if (deadline->pending && !deadline->expired &&
+        ((TickType_t)(now - deadline->start) > budget)) {
+      strncpy(deadline->task, pcTaskGetName(NULL),
+              sizeof(deadline->task) - 1u);
+      deadline->expired = true;
+    }
+  }
+}
+#endif
+
+/******************************************************************************
+ * Function Name: deadline_print
+ ******************************************************************************
+ * Summary:
+ *  Prints the deadlines and the misses in the ring on the console.
+ *
+ ******************************************************************************/
+void deadline_print(void) {
+#if DEADLINE_ENABLE
+  uint32_t first = (miss_total > DEADLINE_MISS_LOG)
+                       ? (miss_total - DEADLINE_MISS_LOG)
+                       : 0u;
+
+  for (uint32_t id = 0; id < DEADLINE_COUNT; id++) {
+    printf("Deadline %s (%lu ms): n=%lu misses=%lu max=%lu ms\n",
+           deadline_info[id].name, (unsigned long)deadline_info[id].budget_ms,
+           (unsigned long)deadlines[id].count,
+           (unsigned long)deadlines[id].misses,
+           (unsigned long)deadlines[id].max_ms);
+  }
+  for (uint32_t i = first; i < miss_total; i++) {
+    const deadline_miss_t *miss = &miss_log[i % DEADLINE_MISS_LOG];
+
+    printf("  missed %s: %lu ms, %s running\n", deadline_info[miss->id].name,
+           (unsigned long)miss->elapsed_ms, miss->task);
+  }
+#endif
+}
+
+/******************************************************************************
+ * Function Name: deadline_publish
+ ******************************************************************************
+ * Summary:
+ *  Prints the deadlines and publishes them on MQTT_DIAG_TOPIC, see the top
+ *  of the file. Misses that do not fit the message are left out.
+ *
+ ******************************************************************************/
+void deadline_publish(void) {
+  deadline_print();
+
+#if DEADLINE_ENABLE
+  char *buffer;
+  size_t buffer_size;
+  int len;
+  uint32_t first = (miss_total > DEADLINE_MISS_LOG)
+                       ? (miss_total - DEADLINE_MISS_LOG)
+                       : 0u;
+
+  for (uint32_t id = 0; id < DEADLINE_COUNT; id++) {
+    buffer = publisher_reserve(&buffer_size);
+    if (buffer == NULL) {
+      return;
+    }
+    len = snprintf(buffer, buffer_size,
+                   "{\"deadline\":\"%s\",\"budget_ms\":%lu,\"n\":%lu,"
+                   "\"misses\":%lu,\"max_ms\":%lu}",
+                   deadline_info[id].name,
+                   (unsigned long)deadline_info[id].budget_ms,
+                   (unsigned long)deadlines[id].count,
+                   (unsigned long)deadlines[id].misses,
+                   (unsigned long)deadlines[id].max_ms);
+    if ((len <= 0) || ((size_t)len >= buffer_size)) {
+      publisher_cancel(buffer);
+      return;
+    }
+    if (publisher_commit(MQTT_CLASS_DIAG, buffer, (size_t)len) !=
+        CY_RSLT_SUCCESS) {
+      return;
+    }
+  }
+
+  if (miss_total == 0u) {
+    return;
+  }
+  buffer = publisher_reserve(&buffer_size);
+  if (buffer == NULL) {
+    return;
+  }
+  /* Room is kept for the closing "]}". */
+  len = snprintf(buffer, buffer_size - 2u, "{\"missed\":[");
+  for (uint32_t i = first; (i < miss_total) && (len > 0) &&
+                           ((size_t)len < buffer_size - 2u);
+       i++) {
+    const deadline_miss_t *miss = &miss_log[i % DEADLINE_MISS_LOG];
+    int entry;
+
+    entry = snprintf(&buffer[len], buffer_size - 2u - (size_t)len,
+                     "%s[\"%s\",%lu,\"%s\"]", (i == first) ? "" : ",",
+                     deadline_info[miss->id].name,
+                     (unsigned long)miss->elapsed_ms, miss->task);
+    if ((entry < 0) || ((size_t)entry >= buffer_size - 2u - (size_t)len)) {
+      break;
+    }
+    len += entry;
+  }
+  if ((len <= 0) || ((size_t)len >= buffer_size - 2u)) {
+    publisher_cancel(buffer);
+    return;
+  }
+  memcpy(&buffer[len], "]}", 2u);
+  len += 2;
+  (void)publisher_commit(MQTT_CLASS_DIAG, buffer, (size_t)len);
+#endif
+}
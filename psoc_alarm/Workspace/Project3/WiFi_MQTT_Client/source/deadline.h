@@ -0,0 +1,43 @@
+/*
+ * deadline.h
+ *
+ * Response-time monitor. An event starts its deadline where it enters the
+ * application and its response stops it; a response later than the budget
+ * of the deadline, set in log_config.h, is a miss. The FreeRTOS tick hook
+ * notes the task running when a pending deadline expires, which is the task
+ * the response was waiting for.
+ *
+ * The functions compile to nothing with DEADLINE_ENABLE set to 0.
+ */
+
+#ifndef SOURCE_DEADLINE_H_
+#define SOURCE_DEADLINE_H_
+
+#include "log_config.h"
+
+/*******************************************************************************
+ * Data Types
+ ******************************************************************************/
+/* A deadline is started again only once it is stopped, so it measures the
+ * response to the first of several events.
+ */
+typedef enum {
+  /* Button interrupt to the LED turned off, state.c */
+  DEADLINE_BUTTON_LED,
+  /* Bluetooth disconnection to the alarm armed with the LED on, bt.c */
+  DEADLINE_DISCONNECT_ARMED,
+  /* TRIPALARM command to the tripped state published, publisher.c */
+  DEADLINE_TRIP_PUBLISH,
+  DEADLINE_COUNT
+} deadline_id_t;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+void deadline_start(deadline_id_t id);
+void deadline_start_from_isr(deadline_id_t id);
+void deadline_stop(deadline_id_t id);
+void deadline_print(void);
+void deadline_publish(void);
+
+#endif /* SOURCE_DEADLINE_H_ */
@@ -0,0 +1,568 @@
+/**
+ * This file implements the heap of the application on the TLSF allocator.
+ *
+ * The Makefile leaves heap_3.c out of the build. pvPortMalloc() and
+ * vPortFree() and the malloc() family of the C library, with the reentrant
+ * _malloc_r() calls newlib makes internally, are defined here on one TLSF
+ * pool, so the newlib-nano allocator is not linked either. The pool is the
+ * whole heap region of the linker script, claimed from sbrk() at the first
+ * allocation. The pool is locked by suspending the scheduler, as heap_3 did;
+ * allocating from an ISR is not supported.
+ *
+ * Arenas are further pools on static buffers, for a subsystem that should
+ * not share the heap, like mbedTLS (tls_memory.c). Their owner locks them.
+ * The heap and the arenas are listed by heap_pool_stats().
+ *
+ * With HEAP_TRACE_ENABLE the first HEAP_TRACE_EVENTS operations of the heap
+ * from boot on are recorded, 12 bytes each. A block is identified by the
+ * offset of its payload in the pool, 0 for a failed allocation. Publishing
+ * HEAPTRACE makes the heap trace task publish them on MQTT_DIAG_TOPIC as
+ * text lines, read by host/source/heap_soak.c:
+ *
+ *   HEAP BEGIN <events> <pool_size>
+ *   H <index> A <id> <size>             allocation
+ *   H <index> F <id>                    free
+ *   H <index> R <old_id> <id> <size>    reallocation
+ *   HEAP END <events> <dropped>
+ *
+ * Index and ids are hexadecimal. The messages of the dump may arrive out of
+ * order, the index orders the events again.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+/* FreeRTOS header files */
+#include <FreeRTOS.h>
+#include "task.h"
+
+#include "heap.h"
+#include "mqtt_client_config.h"
+#include "publisher.h"
+
+#if HEAP_TRACE_ENABLE && !HEAP_TLSF_ENABLE
+#error "HEAP_TRACE_ENABLE needs HEAP_TLSF_ENABLE"
+#endif
+
+#if HEAP_TLSF_ENABLE
+#include <errno.h>
+#include <malloc.h>
+#include <reent.h>
+#include <unistd.h>
+
+/******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Wait for a free publisher slot during a dump. */
+#define HEAP_TRACE_PUBLISH_RETRY_MS (50u)
+#define HEAP_TRACE_PUBLISH_RETRIES (40u)
+
+/* Longest dump line. */
+#define HEAP_TRACE_LINE_SIZE (64u)
+
+/******************************************************************************
+ * Types
+ ******************************************************************************/
+/* Operation in the low two bits of the id, which is a multiple of
+ * TLSF_ALIGN.
+ */
+typedef struct {
+  uint32_t op_id;
+  uint32_t old_id;
+  uint32_t size;
+} heap_trace_event_t;
+
+/* Dump in progress. */
+typedef struct {
+  char *buffer;
+  size_t size;
+  size_t len;
+  bool failed;
+} heap_trace_sink_t;
+
+/******************************************************************************
+ * Global Variables
+ ******************************************************************************/
+/* End of the heap region in the linker script. */
+extern char __HeapLimit[];
+
+static heap_arena_t heap_main = {.name = "main"};
+static bool heap_ready;
+
+static heap_arena_t *arenas[HEAP_MAX_ARENAS];
+static uint32_t arena_count;
+
+#if HEAP_TRACE_ENABLE
+static heap_trace_event_t trace_events[HEAP_TRACE_EVENTS];
+static uint32_t trace_count;
+static uint32_t trace_dropped;
+
+static TaskHandle_t heap_trace_task_handle;
+#endif
+
+/******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+static void heap_lock(void);
+static void heap_unlock(void);
+static bool heap_start(void);
+static void *heap_alloc(size_t size);
+static void heap_release(void *ptr);
+static void *heap_resize(void *ptr, size_t size);
+#if HEAP_TRACE_ENABLE
+static void heap_trace(heap_trace_op_t op, const void *old_ptr,
+                       const void *ptr, size_t size);
+static uint32_t heap_trace_id(const void *ptr);
+static void heap_trace_dump(void);
+static void heap_trace_emit(heap_trace_sink_t *sink, const char *line,
+                            int len);
+static void heap_trace_flush(heap_trace_sink_t *sink);
+#endif
+void vApplicationMallocFailedHook(void);
+
+/******************************************************************************
+ * Function Name: heap_lock
+ ******************************************************************************
+ * Summary:
+ *  Locks the heap by suspending the scheduler. Before the scheduler starts
+ *  there is only main(), which needs no lock.
+ *
+ ******************************************************************************/
+static void heap_lock(void) {
+  if (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED) {
+    vTaskSuspendAll();
+  }
+}
+
+static void heap_unlock(void) {
+  if (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED) {
+    (void)xTaskResumeAll();
+  }
+}
+
+/******************************************************************************
+ * Function Name: heap_start
+ ******************************************************************************
+ * Summary:
+ *  Claims the rest of the heap region from sbrk() for the pool, at the first
+ *  allocation. Called with the heap locked.
+ *
+ * Return:
+ *  bool : false if the heap region is too small
+ *
+ ******************************************************************************/
+static bool heap_start(void) {
+  char *base;
+  ptrdiff_t size;
+
+  if (heap_ready) {
+    return true;
+  }
+  base = sbrk(0);
+  size = __HeapLimit - base;
+  if ((size <= 0) || (sbrk(size) == (void *)-1) ||
+      !tlsf_init(&heap_main.tlsf, base, (size_t)size)) {
+    return false;
+  }
+  heap_ready = true;
+  return true;
+}
+
+/* Allocation from the heap, with the trace and the failure count. */
+static void *heap_alloc(size_t size) {
+  void *ptr = NULL;
+
+  heap_lock();
+  if (heap_start()) {
+    ptr = tlsf_malloc(&heap_main.tlsf, size);
+  }
+#if HEAP_TRACE_ENABLE
+  heap_trace(HEAP_TRACE_ALLOC, NULL, ptr, size);
+#endif
+  heap_unlock();
+  return ptr;
+}
+
+static void heap_release(void *ptr) {
+  if (ptr == NULL) {
+    return;
+  }
+  heap_lock();
+  tlsf_free(&heap_main.tlsf, ptr);
+#if HEAP_TRACE_ENABLE
+  heap_trace(HEAP_TRACE_FREE, ptr, NULL, 0u);
+#endif
+  heap_unlock();
+}
+
+static void *heap_resize(void *ptr, size_t size) {
+  void *new_ptr = NULL;
+
+  if (ptr == NULL) {
+    return heap_alloc(size);
+  }
+  heap_lock();
+  new_ptr = tlsf_realloc(&heap_main.tlsf, ptr, size);
+#if HEAP_TRACE_ENABLE
+  heap_trace(HEAP_TRACE_REALLOC, ptr, new_ptr, size);
+#endif
+  heap_unlock();
+  return new_ptr;
+}
+
+/******************************************************************************
+ * FreeRTOS heap, in place of heap_3.c.
+ ******************************************************************************/
+void *pvPortMalloc(size_t xWantedSize) {
+  void *ptr = heap_alloc(xWantedSize);
+
+#if (configUSE_MALLOC_FAILED_HOOK == 1)
+  if (ptr == NULL) {
+    vApplicationMallocFailedHook();
+  }
+#endif
+  return ptr;
+}
+
+void vPortFree(void *pv) { heap_release(pv); }
+
+/******************************************************************************
+ * C library heap, in place of the newlib-nano allocator. A failure sets
+ * errno to ENOMEM.
+ ******************************************************************************/
+void *_malloc_r(struct _reent *reent, size_t size) {
+  void *ptr = heap_alloc(size);
+
+  if (ptr == NULL) {
+    reent->_errno = ENOMEM;
+  }
+  return ptr;
+}
+
+void _free_r(struct _reent *reent, void *ptr) {
+  (void)reent;
+  heap_release(ptr);
+}
+
+void *_calloc_r(struct _reent *reent, size_t count, size_t size) {
+  void *ptr;
+
+  if ((size != 0u) && (count > (SIZE_MAX / size))) {
+    reent->_errno = ENOMEM;
+    return NULL;
+  }
+  ptr = _malloc_r(reent, count * size);
+  if (ptr != NULL) {
+    memset(ptr, 0, count * size);
+  }
+  return ptr;
+}
+
+void *_realloc_r(struct _reent *reent, void *ptr, size_t size) {
+  void *new_ptr = heap_resize(ptr, size);
+
+  if ((new_ptr == NULL) && (size != 0u)) {
+    reent->_errno = ENOMEM;
+  }
+  return new_ptr;
+}
+
+size_t _malloc_usable_size_r(struct _reent *reent, void *ptr) {
+  (void)reent;
+  return (ptr != NULL) ? tlsf_block_size(ptr) : 0u;
+}
+
+void *malloc(size_t size) { return _malloc_r(_REENT, size); }
+
+void free(void *ptr) { _free_r(_REENT, ptr); }
+
+void *calloc(size_t count, size_t size) {
+  return _calloc_r(_REENT, count, size);
+}
+
+void *realloc(void *ptr, size_t size) { return _realloc_r(_REENT, ptr, size); }
+
+size_t malloc_usable_size(void *ptr) {
+  return _malloc_usable_size_r(_REENT, ptr);
+}
+
+/******************************************************************************
+ * Function Name: heap_arena_init
+ ******************************************************************************
+ * Summary:
+ *  Makes a static buffer an arena and lists it with the pools.
+ *
+ * Parameters:
+ *  heap_arena_t *arena : Arena, static
+ *  const char *name    : Name in the statistics, static
+ *  void *mem           : Buffer
+ *  size_t size         : Size of the buffer in bytes
+ *
+ * Return:
+ *  bool : false if the buffer is too small or there are HEAP_MAX_ARENAS
+ *         arenas already
+ *
+ ******************************************************************************/
+bool heap_arena_init(heap_arena_t *arena, const char *name, void *mem,
+                     size_t size) {
+  bool listed = false;
+
+  if (!tlsf_init(&arena->tlsf, mem, size)) {
+    return false;
+  }
+  arena->name = name;
+
+  heap_lock();
+  for (uint32_t i = 0; i < arena_count; i++) {
+    listed = listed || (arenas[i] == arena);
+  }
+  if (!listed && (arena_count < HEAP_MAX_ARENAS)) {
+    arenas[arena_count++] = arena;
+    listed = true;
+  }
+  heap_unlock();
+  return listed;
+}
+
+/* Allocation and free in an arena, locked by its owner. */
+void *heap_arena_alloc(heap_arena_t *arena, size_t size) {
+  return tlsf_malloc(&arena->tlsf, size);
+}
+
+void *heap_arena_calloc(heap_arena_t *arena, size_t count, size_t size) {
+  void *ptr;
+
+  if ((size != 0u) && (count > (SIZE_MAX / size))) {
+    return NULL;
+  }
+  ptr = tlsf_malloc(&arena->tlsf, count * size);
+  if (ptr != NULL) {
+    memset(ptr, 0, count * size);
+  }
+  return ptr;
+}
+
+void heap_arena_free(heap_arena_t *arena, void *ptr) {
+  tlsf_free(&arena->tlsf, ptr);
+}
+
+void heap_arena_reset_peak(heap_arena_t *arena) {
+  tlsf_reset_peak(&arena->tlsf);
+}
+
+/* Whether the blocks and free lists of an arena are consistent. */
+bool heap_arena_check(heap_arena_t *arena) { return tlsf_check(&arena->tlsf); }
+
+/* Number of pools, the heap and the arenas. */
+uint32_t heap_pool_count(void) { return 1u + arena_count; }
+
+/******************************************************************************
+ * Function Name: heap_pool_stats
+ ******************************************************************************
+ * Summary:
+ *  Copies the statistics of a pool. Pool 0 is the heap, the arenas follow.
+ *  The heap is started if no allocation has yet.
+ *
+ * Parameters:
+ *  uint32_t index            : Pool, below heap_pool_count()
+ *  heap_pool_stats_t *stats  : Receives the name and the statistics
+ *
+ * Return:
+ *  bool : false if there is no such pool
+ *
+ ******************************************************************************/
+bool heap_pool_stats(uint32_t index, heap_pool_stats_t *stats) {
+  heap_arena_t *arena;
+
+  heap_lock();
+  if (index == 0u) {
+    arena = heap_start() ? &heap_main : NULL;
+  } else {
+    arena = (index <= arena_count) ? arenas[index - 1u] : NULL;
+  }
+  if (arena != NULL) {
+    stats->name = arena->name;
+    tlsf_get_stats(&arena->tlsf, &stats->stats);
+  }
+  heap_unlock();
+  return arena != NULL;
+}
+
+#if HEAP_TRACE_ENABLE
+/******************************************************************************
+ * Function Name: heap_trace
+ ******************************************************************************
+ * Summary:
+ *  Records an operation of the heap, while there is room. Called with the
+ *  heap locked.
+ *
+ * Parameters:
+ *  heap_trace_op_t op  : Operation
+ *  const void *old_ptr : Block freed or reallocated, NULL for an allocation
+ *  const void *ptr     : Block allocated, NULL if the allocation failed
+ *  size_t size         : Requested size
+ *
+ ******************************************************************************/
+static void heap_trace(heap_trace_op_t op, const void *old_ptr,
+                       const void *ptr, size_t size) {
+  heap_trace_event_t *event;
+
+  if (trace_count == HEAP_TRACE_EVENTS) {
+    trace_dropped++;
+    return;
+  }
+  event = &trace_events[trace_count++];
+  event->op_id = heap_trace_id((op == HEAP_TRACE_FREE) ? old_ptr : ptr) |
+                 (uint32_t)op;
+  event->old_id = heap_trace_id(old_ptr);
+  event->size = (uint32_t)size;
+}
+
+/* Offset of a block in the heap, 0 for NULL. */
+static uint32_t heap_trace_id(const void *ptr) {
+  return (ptr != NULL)
+             ? (uint32_t)((const char *)ptr - (const char *)heap_main.tlsf.first)
+             : 0u;
+}
+
+/******************************************************************************
+ * Function Name: heap_trace_dump
+ ******************************************************************************
+ * Summary:
+ *  Publishes the trace on MQTT_DIAG_TOPIC, see the top of the file. The
+ *  trace is full by the time it is worth a dump, so the allocations of the
+ *  dump itself are not in it.
+ *
+ ******************************************************************************/
+static void heap_trace_dump(void) {
+  heap_trace_sink_t sink = {0};
+  uint32_t count = trace_count;
+  char line[HEAP_TRACE_LINE_SIZE];
+
+  heap_trace_emit(&sink, line,
+                  snprintf(line, sizeof(line), "HEAP BEGIN %lu %lu\n",
+                           (unsigned long)count,
+                           (unsigned long)heap_main.tlsf.stats.size));
+
+  for (uint32_t index = 0; (index < count) && !sink.failed; index++) {
+    heap_trace_event_t event = trace_events[index];
+    unsigned long id = (unsigned long)(event.op_id & ~3u);
+    int len;
+
+    switch ((heap_trace_op_t)(event.op_id & 3u)) {
+    case HEAP_TRACE_ALLOC:
+      len = snprintf(line, sizeof(line), "H %lx A %lx %lu\n",
+                     (unsigned long)index, id, (unsigned long)event.size);
+      break;
+    case HEAP_TRACE_FREE:
+      len = snprintf(line, sizeof(line), "H %lx F %lx\n",
+                     (unsigned long)index, id);
+      break;
+    default:
+      len = snprintf(line, sizeof(line), "H %lx R %lx %lx %lu\n",
+                     (unsigned long)index, (unsigned long)event.old_id, id,
+                     (unsigned long)event.size);
+      break;
+    }
+    heap_trace_emit(&sink, line, len);
+  }
+
+  heap_trace_emit(&sink, line,
+                  snprintf(line, sizeof(line), "HEAP END %lu %lu\n",
+                           (unsigned long)count,
+                           (unsigned long)trace_dropped));
+  heap_trace_flush(&sink);
+
+  if (sink.failed) {
+    printf("Heap trace: dump incomplete, no publisher slot\n");
+  }
+}
+
+/******************************************************************************
+ * Function Name: heap_trace_emit
+ ******************************************************************************
+ * Summary:
+ *  Packs a dump line into a publisher slot. A message holds whole lines.
+ *
+ * Parameters:
+ *  heap_trace_sink_t *sink : Dump
+ *  const char *line        : Line, with its newline
+ *  int len                 : Length of the line, as returned by snprintf()
+ *
+ ******************************************************************************/
+static void heap_trace_emit(heap_trace_sink_t *sink, const char *line,
+                            int len) {
+  if ((len <= 0) || (len >= (int)HEAP_TRACE_LINE_SIZE) || sink->failed) {
+    return;
+  }
+
+  if ((sink->buffer != NULL) && ((sink->len + (size_t)len) >= sink->size)) {
+    heap_trace_flush(sink);
+  }
+  for (uint32_t retry = 0; sink->buffer == NULL; retry++) {
+    if (retry == HEAP_TRACE_PUBLISH_RETRIES) {
+      sink->failed = true;
+      return;
+    }
+    sink->buffer = publisher_reserve(&sink->size);
+    sink->len = 0;
+    if (sink->buffer == NULL) {
+      vTaskDelay(pdMS_TO_TICKS(HEAP_TRACE_PUBLISH_RETRY_MS));
+    }
+  }
+  memcpy(&sink->buffer[sink->len], line, (size_t)len);
+  sink->len += (size_t)len;
+}
+
+/* Publishes the lines collected so far. */
+static void heap_trace_flush(heap_trace_sink_t *sink) {
+  if (sink->buffer == NULL) {
+    return;
+  }
+  if (publisher_commit(MQTT_CLASS_DIAG, sink->buffer, sink->len) !=
+      CY_RSLT_SUCCESS) {
+    sink->failed = true;
+  }
+  sink->buffer = NULL;
+}
+#endif /* HEAP_TRACE_ENABLE */
+#endif /* HEAP_TLSF_ENABLE */
+
+/******************************************************************************
+ * Function Name: heap_trace_request_dump
+ ******************************************************************************
+ * Summary:
+ *  Asks the heap trace task to publish the trace on MQTT_DIAG_TOPIC.
+ *
+ ******************************************************************************/
+void heap_trace_request_dump(void) {
+#if HEAP_TRACE_ENABLE
+  if (heap_trace_task_handle != NULL) {
+    xTaskNotifyGive(heap_trace_task_handle);
+  }
+#endif
+}
+
+/******************************************************************************
+ * Function Name: heap_trace_task
+ ******************************************************************************
+ * Summary:
+ *  Publishes the trace when requested.
+ *
+ * Parameters:
+ *  void *pvParameters : Task parameter defined during task creation (unused)
+ *
+ ******************************************************************************/
+void heap_trace_task(void *pvParameters) {
+  (void)pvParameters;
+
+#if HEAP_TRACE_ENABLE
+  heap_trace_task_handle = xTaskGetCurrentTaskHandle();
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    heap_trace_dump();
+  }
+#else
+  vTaskDelete(NULL);
+#endif
+}
@@ -0,0 +1,68 @@
+/*
+ * heap.h
+ *
+ * Single heap of the application on the TLSF allocator of tlsf.c, behind
+ * pvPortMalloc() and the malloc() family of the C library, in place of
+ * heap_3 and the newlib-nano allocator. Allocation and free take constant
+ * time. Subsystems can have arenas of their own on static buffers, like the
+ * mbedTLS arena of tls_memory.c, and every pool keeps its statistics.
+ *
+ * With HEAP_TRACE_ENABLE the allocations of the heap from boot on are
+ * recorded and published on request, for the soak test of the host build.
+ */
+
+#ifndef SOURCE_HEAP_H_
+#define SOURCE_HEAP_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "log_config.h"
+#include "tlsf.h"
+
+/*******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Arenas besides the heap. */
+#define HEAP_MAX_ARENAS (2u)
+
+/* Task parameters for the heap trace task, which publishes the trace. */
+#define HEAP_TRACE_TASK_PRIORITY (0)
+#define HEAP_TRACE_TASK_STACK_SIZE (1024 * 1)
+
+/*******************************************************************************
+ * Data Types
+ ******************************************************************************/
+typedef struct {
+  tlsf_t tlsf;
+  const char *name;
+} heap_arena_t;
+
+typedef struct {
+  const char *name;
+  tlsf_stats_t stats;
+} heap_pool_stats_t;
+
+/* Operations of the trace, shared with the dump format and the soak test. */
+typedef enum {
+  HEAP_TRACE_ALLOC,
+  HEAP_TRACE_FREE,
+  HEAP_TRACE_REALLOC
+} heap_trace_op_t;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+bool heap_arena_init(heap_arena_t *arena, const char *name, void *mem,
+                     size_t size);
+void *heap_arena_alloc(heap_arena_t *arena, size_t size);
+void *heap_arena_calloc(heap_arena_t *arena, size_t count, size_t size);
+void heap_arena_free(heap_arena_t *arena, void *ptr);
+void heap_arena_reset_peak(heap_arena_t *arena);
+bool heap_arena_check(heap_arena_t *arena);
+uint32_t heap_pool_count(void);
+bool heap_pool_stats(uint32_t index, heap_pool_stats_t *stats);
+void heap_trace_request_dump(void);
+void heap_trace_task(void *pvParameters);
+
+#endif /* SOURCE_HEAP_H_ */
@@ -0,0 +1,563 @@
+/**
+ * This file implements the heap instrumentation.
+ *
+ * With heap_3 pvPortMalloc() is malloc() with the scheduler suspended, so the
+ * FreeRTOS heap and the C library share the newlib heap. The whole heap is
+ * measured with mallinfo() and a walk of the newlib-nano free list, which
+ * gives the largest free block and the fragmentation. With HEAP_TLSF_ENABLE
+ * both share the TLSF heap of heap.c instead, and the figures are those of
+ * its pools.
+ *
+ * With HEAP_STATS_ENABLE the Makefile wraps malloc(), calloc(), realloc(),
+ * free(), pvPortMalloc() and vPortFree() at link time (-Wl,--wrap). The
+ * wrappers count the bytes in use and the peak of each allocator, and the
+ * allocations of each call site, identified by its return address. Resolve
+ * the sites with arm-none-eabi-addr2line -e <application elf> <address>.
+ * Allocations the C library makes internally (_malloc_r()) are only seen by
+ * the whole heap figures.
+ */
+
+#include <malloc.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/* FreeRTOS header files */
+#include <FreeRTOS.h>
+#include "task.h"
+
+#include "cyhal.h"
+
+#include "heap.h"
+#include "heap_stats.h"
+#include "mqtt_client_config.h"
+#include "publisher.h"
+
+/******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Caller of the function this is used in, without the Thumb bit. */
+#define HEAP_STATS_CALLER()                                                    \
+  ((uintptr_t)__builtin_return_address(0) & ~(uintptr_t)1u)
+
+/******************************************************************************
+ * Types
+ ******************************************************************************/
+/* Free chunk of newlib-nano malloc. */
+typedef struct heap_chunk {
+  long size;
+  struct heap_chunk *next;
+} heap_chunk_t;
+
+typedef struct {
+  /* Return address, 0 for the sites that did not fit in the table. */
+  uintptr_t site;
+  uint32_t allocs;
+  uint32_t bytes;
+  uint8_t heap;
+} heap_stats_site_t;
+
+/******************************************************************************
+ * Global Variables
+ ******************************************************************************/
+#if !HEAP_TLSF_ENABLE
+/* Newlib-nano free list and end of the heap region in the linker script. */
+extern heap_chunk_t *__malloc_free_list;
+extern char __HeapLimit[];
+#endif
+
+static const char *const heap_names[HEAP_STATS_HEAP_COUNT + 1] = {
+    [HEAP_STATS_RTOS] = "rtos",
+    [HEAP_STATS_LIBC] = "libc",
+    [HEAP_STATS_HEAP_COUNT] = "other",
+};
+
+#if HEAP_STATS_ENABLE
+static heap_stats_usage_t usage[HEAP_STATS_HEAP_COUNT];
+static heap_stats_site_t sites[HEAP_STATS_MAX_SITES];
+static uint32_t site_count;
+
+/* Set inside pvPortMalloc() and vPortFree(), with the scheduler suspended,
+ * so that their own malloc() and free() calls are not counted twice.
+ */
+static uint32_t port_nesting;
+
+/* Set by the failed hook inside pvPortMalloc(). The report prints and walks
+ * the heaps, so it is made only after the scheduler is resumed.
+ */
+static bool port_failed;
+#endif
+
+/******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+static void heap_stats_failed(heap_stats_heap_t heap, size_t size,
+                              uintptr_t site);
+#if HEAP_TLSF_ENABLE
+static void heap_stats_publish_pools(void);
+#endif
+#if HEAP_STATS_ENABLE
+static void heap_stats_record(heap_stats_heap_t heap, uintptr_t site,
+                              const void *ptr, size_t size);
+static void heap_stats_release(heap_stats_heap_t heap, uint32_t size);
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+void *__real_pvPortMalloc(size_t size);
+void __real_vPortFree(void *ptr);
+#endif
+void vApplicationMallocFailedHook(void);
+
+/******************************************************************************
+ * Function Name: heap_stats_get
+ ******************************************************************************
+ * Summary:
+ *  Takes a snapshot of the heap.
+ *
+ * Parameters:
+ *  heap_stats_snapshot_t *snapshot : Filled with the snapshot
+ *
+ ******************************************************************************/
+void heap_stats_get(heap_stats_snapshot_t *snapshot) {
+#if HEAP_TLSF_ENABLE
+  heap_pool_stats_t pool = {0};
+
+  (void)heap_pool_stats(0u, &pool);
+  snapshot->used = pool.stats.used;
+  snapshot->free = pool.stats.free;
+  snapshot->largest_free = pool.stats.largest_free;
+  snapshot->arena = pool.stats.size;
+#else
+  struct mallinfo info;
+  uint32_t largest = 0;
+  uint32_t tail;
+
+  __malloc_lock(_REENT);
+  info = mallinfo();
+  for (heap_chunk_t *chunk = __malloc_free_list; chunk != NULL;
+       chunk = chunk->next) {
+    if ((uint32_t)chunk->size > largest) {
+      largest = (uint32_t)chunk->size;
+    }
+  }
+  /* Never requested from sbrk() yet. */
+  tail = (uint32_t)(__HeapLimit - (char *)sbrk(0));
+  __malloc_unlock(_REENT);
+
+  snapshot->used = (uint32_t)info.uordblks;
+  snapshot->free = (uint32_t)info.fordblks + tail;
+  snapshot->largest_free = (tail > largest) ? tail : largest;
+  snapshot->arena = (uint32_t)info.arena;
+#endif
+  snapshot->fragmentation_permille =
+      (snapshot->free > 0u)
+          ? 1000u - (uint32_t)(((uint64_t)snapshot->largest_free * 1000u) /
+                               snapshot->free)
+          : 0u;
+
+#if HEAP_STATS_ENABLE
+  uint32_t saved_intr = cyhal_system_critical_section_enter();
+  memcpy(snapshot->heaps, usage, sizeof(usage));
+  cyhal_system_critical_section_exit(saved_intr);
+#else
+  memset(snapshot->heaps, 0, sizeof(snapshot->heaps));
+#endif
+}
+
+/******************************************************************************
+ * Function Name: heap_stats_publish
+ ******************************************************************************
+ * Summary:
+ *  Publishes a snapshot on MQTT_DIAG_TOPIC:
+ *
+ *   {"heap":{"used":..,"free":..,"largest":..,"arena":..,"frag_pml":..},
+ *    "rtos":[used,peak,allocs,failures],"libc":[used,peak,allocs,failures]}
+ *
+ *  followed by the call sites, split over as many messages as needed:
+ *
+ *   {"heap_sites":[["rtos","0x10004a2c",allocs,bytes],...]}
+ *
+ *  and, with HEAP_TLSF_ENABLE, the pools:
+ *
+ *   {"heap_pools":[["main",used,peak,free,largest,allocs,failures],...]}
+ *
+ ******************************************************************************/
+void heap_stats_publish(void) {
+  heap_stats_snapshot_t snapshot;
+  char *buffer;
+  size_t buffer_size;
+  int len;
+
+  heap_stats_get(&snapshot);
+
+  buffer = publisher_reserve(&buffer_size);
+  if (buffer == NULL) {
+    return;
+  }
+  len = snprintf(
+      buffer, buffer_size,
+      "{\"heap\":{\"used\":%lu,\"free\":%lu,\"largest\":%lu,\"arena\":%lu,"
+      "\"frag_pml\":%lu},\"rtos\":[%lu,%lu,%lu,%lu],"
+      "\"libc\":[%lu,%lu,%lu,%lu]}",
+      (unsigned long)snapshot.used, (unsigned long)snapshot.free,
+      (unsigned long)snapshot.largest_free, (unsigned long)snapshot.arena,
+      (unsigned long)snapshot.fragmentation_permille,
+      (unsigned long)snapshot.heaps[HEAP_STATS_RTOS].used,
+      (unsigned long)snapshot.heaps[HEAP_STATS_RTOS].peak,
+      (unsigned long)snapshot.heaps[HEAP_STATS_RTOS].allocs,
+      (unsigned long)snapshot.heaps[HEAP_STATS_RTOS].failures,
+      (unsigned long)snapshot.heaps[HEAP_STATS_LIBC].used,
+      (unsigned long)snapshot.heaps[HEAP_STATS_LIBC].peak,
+      (unsigned long)snapshot.heaps[HEAP_STATS_LIBC].allocs,
+      (unsigned long)snapshot.heaps[HEAP_STATS_LIBC].failures);
+  if ((len < 0) ||
+      (publisher_commit(MQTT_CLASS_DIAG, buffer, (size_t)len) !=
+       CY_RSLT_SUCCESS)) {
+    return;
+  }
+#if HEAP_TLSF_ENABLE
+  heap_stats_publish_pools();
+#endif
+
+#if HEAP_STATS_ENABLE
+  size_t pos = 0;
+  uint32_t count = site_count;
+
+  buffer = NULL;
+  for (uint32_t i = 0; i < count;) {
+    heap_stats_site_t site = sites[i];
+
+    if (buffer == NULL) {
+      buffer = publisher_reserve(&buffer_size);
+      if (buffer == NULL) {
+        return;
+      }
+      pos = (size_t)snprintf(buffer, buffer_size, "{\"heap_sites\":[");
+    }
+
+    /* Room is kept for the closing "]}". */
+    len = snprintf(&buffer[pos], buffer_size - pos,
+                   "%s[\"%s\",\"0x%08lx\",%lu,%lu]",
+                   (buffer[pos - 1] == '[') ? "" : ",",
+                   heap_names[site.heap], (unsigned long)site.site,
+                   (unsigned long)site.allocs, (unsigned long)site.bytes);
+    if ((len < 0) || ((pos + (size_t)len + 2u) >= buffer_size)) {
+      if (buffer[pos - 1] == '[') {
+        publisher_cancel(buffer);
+        return;
+      }
+      memcpy(&buffer[pos], "]}", 2);
+      publisher_commit(MQTT_CLASS_DIAG, buffer, pos + 2u);
+      buffer = NULL;
+      continue;
+    }
+    pos += (size_t)len;
+    i++;
+  }
+
+  if (buffer != NULL) {
+    memcpy(&buffer[pos], "]}", 2);
+    publisher_commit(MQTT_CLASS_DIAG, buffer, pos + 2u);
+  }
+#endif
+}
+
+/******************************************************************************
+ * Function Name: heap_stats_dump
+ ******************************************************************************
+ * Summary:
+ *  Prints a snapshot and the call sites on the console.
+ *
+ ******************************************************************************/
+void heap_stats_dump(void) {
+  heap_stats_snapshot_t snapshot;
+
+  heap_stats_get(&snapshot);
+  printf("Heap: %lu B used, %lu B free, largest free block %lu B, "
+         "fragmentation %lu permille, arena %lu B\n",
+         (unsigned long)snapshot.used, (unsigned long)snapshot.free,
+         (unsigned long)snapshot.largest_free,
+         (unsigned long)snapshot.fragmentation_permille,
+         (unsigned long)snapshot.arena);
+
+#if HEAP_TLSF_ENABLE
+  for (uint32_t i = 0; i < heap_pool_count(); i++) {
+    heap_pool_stats_t pool;
+
+    if (heap_pool_stats(i, &pool)) {
+      printf("  pool %s: %lu B used of %lu B, peak %lu B, largest "
+             "allocation %lu B, %lu allocations, %lu failed\n",
+             pool.name, (unsigned long)pool.stats.used,
+             (unsigned long)pool.stats.size, (unsigned long)pool.stats.peak,
+             (unsigned long)pool.stats.largest_free,
+             (unsigned long)pool.stats.allocs,
+             (unsigned long)pool.stats.failures);
+    }
+  }
+#endif
+#if HEAP_STATS_ENABLE
+  for (uint32_t i = 0; i < HEAP_STATS_HEAP_COUNT; i++) {
+    printf("  %s: %lu B used, peak %lu B, %lu allocations, %lu failed\n",
+           heap_names[i], (unsigned long)snapshot.heaps[i].used,
+           (unsigned long)snapshot.heaps[i].peak,
+           (unsigned long)snapshot.heaps[i].allocs,
+           (unsigned long)snapshot.heaps[i].failures);
+  }
+  for (uint32_t i = 0; i < site_count; i++) {
+    printf("  %s site 0x%08lx: %lu allocations, %lu B\n",
+           heap_names[sites[i].heap], (unsigned long)sites[i].site,
+           (unsigned long)sites[i].allocs, (unsigned long)sites[i].bytes);
+  }
+#endif
+}
+
+/******************************************************************************
+ * Function Name: vApplicationMallocFailedHook
+ ******************************************************************************
+ * Summary:
+ *  Called by pvPortMalloc() when the heap is exhausted. Prints the snapshot;
+ *  the caller gets NULL and handles it. Inside __wrap_pvPortMalloc() the
+ *  scheduler is suspended, so the failure is only recorded there.
+ *
+ ******************************************************************************/
+void vApplicationMallocFailedHook(void) {
+#if HEAP_STATS_ENABLE
+  if (port_nesting > 0u) {
+    port_failed = true;
+    return;
+  }
+  heap_stats_failed(HEAP_STATS_RTOS, 0, 0);
+#else
+  heap_stats_failed(HEAP_STATS_RTOS, 0, 0);
+#endif
+}
+
+/******************************************************************************
+ * Function Name: heap_stats_failed
+ ******************************************************************************
+ * Summary:
+ *  Reports a failed allocation.
+ *
+ * Parameters:
+ *  heap_stats_heap_t heap : Allocator
+ *  size_t size            : Requested size, 0 if unknown
+ *  uintptr_t site         : Call site, 0 if unknown
+ *
+ ******************************************************************************/
+static void heap_stats_failed(heap_stats_heap_t heap, size_t size,
+                              uintptr_t site) {
+  printf("\n%s allocation of %lu B from 0x%08lx failed\n", heap_names[heap],
+         (unsigned long)size, (unsigned long)site);
+  heap_stats_dump();
+}
+
+#if HEAP_TLSF_ENABLE
+/******************************************************************************
+ * Function Name: heap_stats_publish_pools
+ ******************************************************************************
+ * Summary:
+ *  Publishes the statistics of the TLSF pools, see heap_stats_publish().
+ *
+ ******************************************************************************/
+static void heap_stats_publish_pools(void) {
+  size_t buffer_size;
+  char *buffer = publisher_reserve(&buffer_size);
+  size_t pos;
+  int len;
+
+  if (buffer == NULL) {
+    return;
+  }
+  pos = (size_t)snprintf(buffer, buffer_size, "{\"heap_pools\":[");
+  for (uint32_t i = 0; i < heap_pool_count(); i++) {
+    heap_pool_stats_t pool;
+
+    if (!heap_pool_stats(i, &pool)) {
+      continue;
+    }
+    /* Room is kept for the closing "]}". */
+    len = snprintf(&buffer[pos], buffer_size - pos,
+                   "%s[\"%s\",%lu,%lu,%lu,%lu,%lu,%lu]",
+                   (buffer[pos - 1] == '[') ? "" : ",", pool.name,
+                   (unsigned long)pool.stats.used,
+                   (unsigned long)pool.stats.peak,
+                   (unsigned long)pool.stats.free,
+                   (unsigned long)pool.stats.largest_free,
+                   (unsigned long)pool.stats.allocs,
+                   (unsigned long)pool.stats.failures);
+    if ((len < 0) || ((pos + (size_t)len + 2u) >= buffer_size)) {
+      break;
+    }
+    pos += (size_t)len;
+  }
+  memcpy(&buffer[pos], "]}", 2);
+  publisher_commit(MQTT_CLASS_DIAG, buffer, pos + 2u);
+}
+#endif
+
+#if HEAP_STATS_ENABLE
+/******************************************************************************
+ * Function Name: heap_stats_record
+ ******************************************************************************
+ * Summary:
+ *  Counts an allocation.
+ *
+ * Parameters:
+ *  heap_stats_heap_t heap : Allocator
+ *  uintptr_t site         : Call site
+ *  const void *ptr        : Allocated block, NULL if the allocation failed
+ *  size_t size            : Requested size
+ *
+ ******************************************************************************/
+static void heap_stats_record(heap_stats_heap_t heap, uintptr_t site,
+                              const void *ptr, size_t size) {
+  uint32_t block = (ptr != NULL) ? (uint32_t)malloc_usable_size((void *)ptr)
+                                 : 0u;
+  heap_stats_usage_t *stats = &usage[heap];
+  heap_stats_site_t *entry = NULL;
+  uint32_t saved_intr = cyhal_system_critical_section_enter();
+
+  if (ptr == NULL) {
+    stats->failures++;
+  } else {
+    stats->allocs++;
+    stats->used += block;
+    if (stats->used > stats->peak) {
+      stats->peak = stats->used;
+    }
+  }
+
+  for (uint32_t i = 0; i < site_count; i++) {
+    if ((sites[i].site == site) && (sites[i].heap == heap)) {
+      entry = &sites[i];
+      break;
+    }
+  }
+  if (entry == NULL) {
+    if (site_count < (HEAP_STATS_MAX_SITES - 1u)) {
+      entry = &sites[site_count++];
+      entry->site = site;
+      entry->heap = (uint8_t)heap;
+    } else {
+      /* The last entry collects the sites that did not fit. */
+      entry = &sites[HEAP_STATS_MAX_SITES - 1u];
+      entry->site = 0;
+      entry->heap = HEAP_STATS_HEAP_COUNT;
+      site_count = HEAP_STATS_MAX_SITES;
+    }
+  }
+  if (ptr != NULL) {
+    entry->allocs++;
+    entry->bytes += (uint32_t)size;
+  }
+  cyhal_system_critical_section_exit(saved_intr);
+}
+
+/******************************************************************************
+ * Function Name: heap_stats_release
+ ******************************************************************************
+ * Summary:
+ *  Counts a free. Blocks allocated before the counting or inside the C
+ *  library are not in the count, which therefore stops at 0.
+ *
+ * Parameters:
+ *  heap_stats_heap_t heap : Allocator
+ *  uint32_t size          : Usable size of the block
+ *
+ ******************************************************************************/
+static void heap_stats_release(heap_stats_heap_t heap, uint32_t size) {
+  uint32_t saved_intr = cyhal_system_critical_section_enter();
+
+  usage[heap].used = (usage[heap].used > size) ? (usage[heap].used - size) : 0u;
+  cyhal_system_critical_section_exit(saved_intr);
+}
+
+/******************************************************************************
+ * Allocator wrappers, see the linker flags in the Makefile. Calls made from
+ * pvPortMalloc() and vPortFree() are counted there.
+ ******************************************************************************/
+void *__wrap_malloc(size_t size) {
+  void *ptr = __real_malloc(size);
+
+  if (port_nesting == 0u) {
+    heap_stats_record(HEAP_STATS_LIBC, HEAP_STATS_CALLER(), ptr, size);
+    if ((ptr == NULL) && (size > 0u)) {
+      heap_stats_failed(HEAP_STATS_LIBC, size, HEAP_STATS_CALLER());
+    }
+  }
+  return ptr;
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+  void *ptr = __real_calloc(count, size);
+
+  if (port_nesting == 0u) {
+    heap_stats_record(HEAP_STATS_LIBC, HEAP_STATS_CALLER(), ptr, count * size);
+    if ((ptr == NULL) && ((count * size) > 0u)) {
+      heap_stats_failed(HEAP_STATS_LIBC, count * size, HEAP_STATS_CALLER());
+    }
+  }
+  return ptr;
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+  uint32_t old_block = (ptr != NULL) ? (uint32_t)malloc_usable_size(ptr) : 0u;
+  void *new_ptr = __real_realloc(ptr, size);
+
+  if (port_nesting == 0u) {
+    /* On failure the old block is kept. */
+    if ((new_ptr != NULL) || (size == 0u)) {
+      heap_stats_release(HEAP_STATS_LIBC, old_block);
+    }
+    if (size > 0u) {
+      heap_stats_record(HEAP_STATS_LIBC, HEAP_STATS_CALLER(), new_ptr, size);
+      if (new_ptr == NULL) {
+        heap_stats_failed(HEAP_STATS_LIBC, size, HEAP_STATS_CALLER());
+      }
+    }
+  }
+  return new_ptr;
+}
+
+void __wrap_free(void *ptr) {
+  if ((ptr != NULL) && (port_nesting == 0u)) {
+    heap_stats_release(HEAP_STATS_LIBC, (uint32_t)malloc_usable_size(ptr));
+  }
+  __real_free(ptr);
+}
+
+void *__wrap_pvPortMalloc(size_t size) {
+  uintptr_t site = HEAP_STATS_CALLER();
+  bool failed;
+  void *ptr;
+
+  vTaskSuspendAll();
+  port_nesting++;
+  ptr = __real_pvPortMalloc(size);
+  port_nesting--;
+  failed = port_failed;
+  port_failed = false;
+  (void)xTaskResumeAll();
+
+  heap_stats_record(HEAP_STATS_RTOS, site, ptr, size);
+  if (failed) {
+    heap_stats_failed(HEAP_STATS_RTOS, size, site);
+  }
+  return ptr;
+}
+
+void __wrap_vPortFree(void *ptr) {
+  if (ptr == NULL) {
+    return;
+  }
+
+  vTaskSuspendAll();
+  port_nesting++;
+  heap_stats_release(HEAP_STATS_RTOS, (uint32_t)malloc_usable_size(ptr));
+  __real_vPortFree(ptr);
+  port_nesting--;
+  (void)xTaskResumeAll();
+}
+#endif /* HEAP_STATS_ENABLE */
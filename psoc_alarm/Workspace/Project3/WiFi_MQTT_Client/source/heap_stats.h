@@ -0,0 +1,53 @@
+/*
+ * heap_stats.h
+ *
+ * Heap instrumentation. Usage, peak, largest free block and fragmentation of
+ * the heap, and allocation counts per call site of the FreeRTOS heap and of
+ * malloc(). Snapshots are published on the diagnostics topic on demand and
+ * printed when an allocation fails.
+ */
+
+#ifndef SOURCE_HEAP_STATS_H_
+#define SOURCE_HEAP_STATS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "log_config.h"
+
+/*******************************************************************************
+ * Data Types
+ ******************************************************************************/
+/* Allocators. With heap_3 both take their memory from the newlib heap. */
+typedef enum {
+  HEAP_STATS_RTOS,
+  HEAP_STATS_LIBC,
+  HEAP_STATS_HEAP_COUNT
+} heap_stats_heap_t;
+
+typedef struct {
+  /* Bytes currently allocated and at most, through the wrapped calls. */
+  uint32_t used;
+  uint32_t peak;
+  uint32_t allocs;
+  uint32_t failures;
+} heap_stats_usage_t;
+
+typedef struct {
+  /* Whole newlib heap, untracked allocations of the C library included. */
+  uint32_t used;
+  uint32_t free;
+  uint32_t largest_free;
+  uint32_t arena;
+  /* 0 when the free memory is one block, up to 1000 when it is scattered. */
+  uint32_t fragmentation_permille;
+  heap_stats_usage_t heaps[HEAP_STATS_HEAP_COUNT];
+} heap_stats_snapshot_t;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+void heap_stats_get(heap_stats_snapshot_t *snapshot);
+void heap_stats_publish(void);
+void heap_stats_dump(void);
+
+#endif /* SOURCE_HEAP_STATS_H_ */
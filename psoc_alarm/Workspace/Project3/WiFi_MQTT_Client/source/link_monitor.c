@@ -0,0 +1,355 @@
+/**
+ * This file implements the Wi-Fi link monitor.
+ *
+ * Every LINK_MONITOR_INTERVAL_MS the RSSI and the WLAN TX counters of the
+ * association are sampled. While the link is weak, the monitor scans for
+ * other BSSIDs of the configured SSID, at most every LINK_SCAN_INTERVAL_MS.
+ * If one is better by LINK_ROAM_HYSTERESIS_DB, it is stored as AP hint in
+ * the net cache and the connection manager is asked to reassociate to it.
+ * The monitor is a coroutine on the coroutine task, next to the connection
+ * manager.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "cy_wcm.h"
+
+/* FreeRTOS header files */
+#include <FreeRTOS.h>
+#include "queue.h"
+#include "semphr.h"
+#include "task.h"
+
+#include "coroutine.h"
+#include "link_monitor.h"
+#include "mqtt_task.h"
+#include "net_cache.h"
+#include "publish_policy.h"
+#include "publisher.h"
+#include "wifi_config.h"
+
+#if LINK_MONITOR_ENABLE && !NET_CACHE_ENABLE
+#error "LINK_MONITOR_ENABLE needs NET_CACHE_ENABLE to pass the roam target"
+#endif
+
+/******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Maximum time to wait for a scan to complete. */
+#define LINK_SCAN_TIMEOUT_MS (10000u)
+
+/* Fewer TX frames than this per sample give no meaningful retry share. */
+#define LINK_MIN_TX_PACKETS (10u)
+
+/* Number of publishes averaged after a roam before it is reported. */
+#define LINK_PUBLISH_SAMPLES (5u)
+
+/* Size of a telemetry record. */
+#define LINK_TELEMETRY_SIZE (40)
+
+/******************************************************************************
+ * Types
+ ******************************************************************************/
+typedef struct {
+  cy_wcm_mac_t bssid;
+  uint8_t channel;
+  int16_t rssi;
+  bool found;
+} link_candidate_t;
+
+/******************************************************************************
+ * Global Variables
+ ******************************************************************************/
+static SemaphoreHandle_t scan_done;
+static StaticSemaphore_t scan_done_buffer;
+static link_candidate_t candidate;
+static cy_wcm_mac_t current_bssid;
+
+/* Averaged values, in dBm and ms. */
+static int16_t rssi_avg;
+static uint32_t publish_avg_ms;
+
+/* Publish latency before the last roam and sample count since. */
+static uint32_t publish_before_roam_ms;
+static uint32_t publish_after_roam_count;
+static uint32_t publish_after_roam_sum_ms;
+static bool roam_pending;
+
+/* Variables of the coroutine, kept across its waits. */
+static struct {
+  coroutine_t co;
+  uint32_t last_tx_packets;
+  uint32_t last_tx_retries;
+  uint32_t last_scan_ms;
+  uint32_t last_roam_ms;
+  uint32_t now_ms;
+  bool have_stats;
+  bool weak;
+  bool scanned;
+} monitor;
+
+/******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+static coroutine_status_t link_monitor_run(coroutine_t *co);
+static void scan_callback(cy_wcm_scan_result_t *result_ptr, void *user_data,
+                          cy_wcm_scan_status_t status);
+static bool link_scan_start(void);
+static bool link_scan_done(void);
+
+/******************************************************************************
+ * Function Name: link_monitor_start
+ ******************************************************************************
+ * Summary:
+ *  Starts the link monitor on the coroutine task.
+ *
+ ******************************************************************************/
+void link_monitor_start(void) {
+  scan_done = xSemaphoreCreateBinaryStatic(&scan_done_buffer);
+  rssi_avg = 0;
+  coroutine_start(&monitor.co, link_monitor_run);
+}
+
+/******************************************************************************
+ * Function Name: link_monitor_run
+ ******************************************************************************
+ * Summary:
+ *  Coroutine that samples the link quality and triggers scans and roams.
+ *
+ * Parameters:
+ *  coroutine_t *co : State of the coroutine, monitor.co
+ *
+ * Return:
+ *  coroutine_status_t : Never COROUTINE_DONE
+ *
+ ******************************************************************************/
+static coroutine_status_t link_monitor_run(coroutine_t *co) {
+  cy_wcm_associated_ap_info_t ap_info;
+  cy_wcm_wlan_statistics_t stats;
+
+  CORO_BEGIN(co);
+
+  while (true) {
+    CORO_DELAY(co, LINK_MONITOR_INTERVAL_MS);
+
+    /* Reconnection and roaming belong to the connection manager. */
+    if (roam_pending || (cy_wcm_is_connected_to_ap() == 0) ||
+        (cy_wcm_get_associated_ap_info(&ap_info) != CY_RSLT_SUCCESS)) {
+      monitor.have_stats = false;
+      rssi_avg = 0;
+      continue;
+    }
+
+    /* Restart the average on a new association. */
+    if ((rssi_avg == 0) ||
+        (memcmp(current_bssid, ap_info.BSSID, sizeof(cy_wcm_mac_t)) != 0)) {
+      memcpy(current_bssid, ap_info.BSSID, sizeof(cy_wcm_mac_t));
+      rssi_avg = ap_info.signal_strength;
+    } else {
+      rssi_avg = (int16_t)((3 * rssi_avg + ap_info.signal_strength) / 4);
+    }
+
+    /* Share of retried frames since the previous sample. */
+    uint32_t retry_percent = 0;
+    if (cy_wcm_get_wlan_statistics(CY_WCM_INTERFACE_TYPE_STA, &stats) ==
+        CY_RSLT_SUCCESS) {
+      uint32_t tx_packets = stats.tx_packets - monitor.last_tx_packets;
+      uint32_t tx_retries = stats.tx_retries - monitor.last_tx_retries;
+
+      if (monitor.have_stats && (tx_packets >= LINK_MIN_TX_PACKETS)) {
+        retry_percent = (tx_retries * 100u) / tx_packets;
+      }
+      monitor.last_tx_packets = stats.tx_packets;
+      monitor.last_tx_retries = stats.tx_retries;
+      monitor.have_stats = true;
+    }
+
+    /* Link quality telemetry, batched by the publish policy on poor links.
+     * The Wi-Fi link can be up with the broker down, and the record would
+     * only be dropped then.
+     */
+    if (publisher_connected()) {
+      char record[LINK_TELEMETRY_SIZE];
+      int record_len = snprintf(record, sizeof(record),
+                                "{\"rssi\":%d,\"retry\":%lu}",
+                                ap_info.signal_strength,
+                                (unsigned long)retry_percent);
+      publish_policy_telemetry(record, (size_t)record_len);
+    }
+
+    bool was_weak = monitor.weak;
+    monitor.weak = (rssi_avg < LINK_WEAK_RSSI_DBM) ||
+                   (retry_percent > LINK_WEAK_RETRY_PERCENT);
+    if (monitor.weak != was_weak) {
+      printf("Link: %s (RSSI %d dBm, TX retries %lu%%)\n",
+             monitor.weak ? "weak" : "recovered", rssi_avg,
+             (unsigned long)retry_percent);
+    }
+
+    monitor.now_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    if (!monitor.weak ||
+        ((monitor.now_ms - monitor.last_scan_ms) < LINK_SCAN_INTERVAL_MS) ||
+        ((monitor.last_roam_ms != 0) &&
+         ((monitor.now_ms - monitor.last_roam_ms) < LINK_ROAM_HOLDOFF_MS))) {
+      continue;
+    }
+
+    monitor.last_scan_ms = monitor.now_ms;
+    if (!link_scan_start()) {
+      continue;
+    }
+    CORO_WAIT_UNTIL_FOR(co, link_scan_done(), LINK_SCAN_TIMEOUT_MS);
+    if (!monitor.scanned) {
+      cy_wcm_stop_scan();
+      printf("Link: scan timed out\n");
+      continue;
+    }
+
+    if (!candidate.found ||
+        (candidate.rssi < rssi_avg + LINK_ROAM_HYSTERESIS_DB)) {
+      printf("Link: no better AP found (best %d dBm)\n",
+             candidate.found ? candidate.rssi : 0);
+      continue;
+    }
+
+    printf("Link: roaming from %02X:%02X:%02X:%02X:%02X:%02X (%d dBm) to "
+           "%02X:%02X:%02X:%02X:%02X:%02X ch %u (%d dBm)\n",
+           current_bssid[0], current_bssid[1], current_bssid[2],
+           current_bssid[3], current_bssid[4], current_bssid[5], rssi_avg,
+           candidate.bssid[0], candidate.bssid[1], candidate.bssid[2],
+           candidate.bssid[3], candidate.bssid[4], candidate.bssid[5],
+           candidate.channel, candidate.rssi);
+
+    /* Hand the target to the connection manager, which owns the connection.
+     * It runs on the same task, so the command is not waited for.
+     */
+    net_cache_set_ap(candidate.bssid, candidate.channel);
+    publish_before_roam_ms = publish_avg_ms;
+    monitor.last_roam_ms = monitor.now_ms;
+    roam_pending = (mqtt_task_send(HANDLE_ROAM, 0) == pdTRUE);
+  }
+
+  CORO_END(co);
+}
+
+/******************************************************************************
+ * Function Name: link_monitor_roam_done
+ ******************************************************************************
+ * Summary:
+ *  Called by the connection manager once the connection is back after a
+ *  roam.
+ *
+ * Parameters:
+ *  uint32_t outage_ms : Time without MQTT connection
+ *
+ ******************************************************************************/
+void link_monitor_roam_done(uint32_t outage_ms) {
+  cy_wcm_associated_ap_info_t ap_info;
+  bool success =
+      (cy_wcm_get_associated_ap_info(&ap_info) == CY_RSLT_SUCCESS) &&
+      (memcmp(ap_info.BSSID, candidate.bssid, sizeof(cy_wcm_mac_t)) == 0);
+
+  printf("Link: roam %s, MQTT outage %lu ms\n",
+         success ? "completed" : "failed, rejoined by scan",
+         (unsigned long)outage_ms);
+
+  publish_after_roam_count = 0;
+  publish_after_roam_sum_ms = 0;
+  roam_pending = false;
+}
+
+/******************************************************************************
+ * Function Name: link_monitor_publish_latency
+ ******************************************************************************
+ * Summary:
+ *  Records the latency of a publish. The average before a roam is compared
+ *  with the average of the first LINK_PUBLISH_SAMPLES publishes after it.
+ *
+ * Parameters:
+ *  uint32_t latency_ms : Time cy_mqtt_publish() took
+ *
+ ******************************************************************************/
+void link_monitor_publish_latency(uint32_t latency_ms) {
+  publish_avg_ms = (publish_avg_ms == 0)
+                       ? latency_ms
+                       : (3u * publish_avg_ms + latency_ms) / 4u;
+
+  if ((publish_before_roam_ms == 0) ||
+      (publish_after_roam_count >= LINK_PUBLISH_SAMPLES)) {
+    return;
+  }
+
+  publish_after_roam_sum_ms += latency_ms;
+  if (++publish_after_roam_count == LINK_PUBLISH_SAMPLES) {
+    printf("Link: publish latency %lu ms before roam, %lu ms after\n",
+           (unsigned long)publish_before_roam_ms,
+           (unsigned long)(publish_after_roam_sum_ms / LINK_PUBLISH_SAMPLES));
+    publish_before_roam_ms = 0;
+  }
+}
+
+/******************************************************************************
+ * Function Name: link_scan_start
+ ******************************************************************************
+ * Summary:
+ *  Starts a scan for the configured SSID, which keeps the strongest other
+ *  BSSID. link_scan_done() tells when it completed.
+ *
+ * Return:
+ *  bool : true if the scan started
+ *
+ ******************************************************************************/
+static bool link_scan_start(void) {
+  cy_wcm_scan_filter_t scan_filter;
+  cy_rslt_t result;
+
+  memset(&candidate, 0, sizeof(candidate));
+  memset(&scan_filter, 0, sizeof(scan_filter));
+  scan_filter.mode = CY_WCM_SCAN_FILTER_TYPE_SSID;
+  memcpy(scan_filter.param.SSID, WIFI_SSID, sizeof(WIFI_SSID));
+
+  xSemaphoreTake(scan_done, 0);
+  result = cy_wcm_start_scan(scan_callback, NULL, &scan_filter);
+  if (result != CY_RSLT_SUCCESS) {
+    printf("Link: scan failed with error code 0x%0X\n", (int)result);
+    return false;
+  }
+  return true;
+}
+
+/* True once the scan completed. */
+static bool link_scan_done(void) {
+  monitor.scanned = (xSemaphoreTake(scan_done, 0) == pdTRUE);
+  return monitor.scanned;
+}
+
+/******************************************************************************
+ * Function Name: scan_callback
+ ******************************************************************************
+ * Summary:
+ *  WCM scan callback, runs in the WCM worker thread.
+ *
+ ******************************************************************************/
+static void scan_callback(cy_wcm_scan_result_t *result_ptr, void *user_data,
+                          cy_wcm_scan_status_t status) {
+  (void)user_data;
+
+  if (status == CY_WCM_SCAN_COMPLETE) {
+    xSemaphoreGive(scan_done);
+    coroutine_wake();
+    return;
+  }
+
+  if ((result_ptr == NULL) ||
+      (memcmp(result_ptr->BSSID, current_bssid, sizeof(cy_wcm_mac_t)) == 0)) {
+    return;
+  }
+
+  if (!candidate.found || (result_ptr->signal_strength > candidate.rssi)) {
+    memcpy(candidate.bssid, result_ptr->BSSID, sizeof(cy_wcm_mac_t));
+    candidate.channel = result_ptr->channel;
+    candidate.rssi = result_ptr->signal_strength;
+    candidate.found = true;
+  }
+}
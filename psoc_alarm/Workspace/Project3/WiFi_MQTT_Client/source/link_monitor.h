@@ -0,0 +1,21 @@
+/*
+ * link_monitor.h
+ *
+ * Background Wi-Fi link monitor. Tracks RSSI and TX retries of the current
+ * association and roams to a better BSSID of the same SSID before the link
+ * fails.
+ */
+
+#ifndef SOURCE_LINK_MONITOR_H_
+#define SOURCE_LINK_MONITOR_H_
+
+#include <stdint.h>
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+void link_monitor_start(void);
+void link_monitor_roam_done(uint32_t outage_ms);
+void link_monitor_publish_latency(uint32_t latency_ms);
+
+#endif /* SOURCE_LINK_MONITOR_H_ */
@@ -0,0 +1,369 @@
+/**
+ * This file implements the deferred logger.
+ *
+ * printf() over retarget-io blocks until the line is on the UART, which
+ * costs the Bluetooth stack thread and the MQTT callback milliseconds per
+ * line. LOG() instead stores a fixed size record: the format string address,
+ * the module, the level, a timestamp and the raw arguments. The records live
+ * in a multi-producer ring. A writer claims a record with a compare and swap
+ * on the head index and publishes it by writing its sequence number last, so
+ * it never waits on the reader or on another writer. The logger task, at
+ * the lowest priority, expands the records when the CPU is otherwise idle.
+ *
+ * log_timing_start() / log_timing_end() measure callbacks with the DWT cycle
+ * counter. With LOG_DEFERRED_ENABLE set to 0 records are printed at once,
+ * which gives the timings of the synchronous printf() for comparison.
+ */
+
+#include <stdio.h>
+
+/* FreeRTOS header files */
+#include <FreeRTOS.h>
+#include "task.h"
+
+#include "cy_utils.h"
+#include "cyhal.h"
+
+#include "console.h"
+#include "log.h"
+#include "trace.h"
+
+#if ((LOG_RING_RECORDS & (LOG_RING_RECORDS - 1u)) != 0u)
+#error "LOG_RING_RECORDS must be a power of two"
+#endif
+
+/******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Compare and swap is available from ARMv7-M, the CM0+ masks interrupts. */
+#if defined(__CORTEX_M) && (__CORTEX_M >= 3)
+#define LOG_LOCK_FREE (1)
+#else
+#define LOG_LOCK_FREE (0)
+#endif
+
+/* Delay of the logger task when the ring is empty. */
+#define LOG_TASK_POLL_MS (20u)
+
+/******************************************************************************
+ * Types
+ ******************************************************************************/
+typedef struct {
+  /* Ring position + 1 once the record is complete. */
+  volatile uint32_t seq;
+  const char *fmt;
+  uint32_t timestamp_ms;
+  uint8_t module;
+  uint8_t level;
+  uint8_t argc;
+  log_arg_t argv[LOG_MAX_ARGS];
+} log_record_t;
+
+typedef struct {
+  uint32_t count;
+  uint32_t max_cycles;
+  uint64_t total_cycles;
+} log_timing_stats_t;
+
+/******************************************************************************
+ * Global Variables
+ ******************************************************************************/
+volatile uint8_t log_levels[LOG_MODULE_COUNT];
+
+#if LOG_DEFERRED_ENABLE
+static log_record_t log_ring[LOG_RING_RECORDS];
+
+/* Next position to claim and next position to print. */
+static volatile uint32_t log_head;
+static volatile uint32_t log_tail;
+
+/* Records lost because the ring was full. */
+static volatile uint32_t log_dropped;
+#endif
+
+static log_timing_stats_t log_timing[LOG_TIMING_COUNT];
+
+static const char *const log_timing_names[LOG_TIMING_COUNT] = {
+    [LOG_TIMING_BT_MANAGEMENT] = "BT management",
+    [LOG_TIMING_BT_GATT] = "BT GATT",
+    [LOG_TIMING_MQTT_EVENT] = "MQTT event",
+    [LOG_TIMING_CONSOLE_WRITE] = "console write",
+};
+
+/******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+static void log_print(const char *fmt, const log_arg_t *argv);
+#if (LOG_TIMING_REPORT_MS > 0)
+static void log_timing_report(void);
+#endif
+
+/******************************************************************************
+ * Function Name: log_init
+ ******************************************************************************
+ * Summary:
+ *  Sets every module to LOG_DEFAULT_LEVEL and starts the cycle counter. Called
+ *  from main() before the first LOG().
+ *
+ ******************************************************************************/
+void log_init(void) {
+  for (uint32_t module = 0; module < LOG_MODULE_COUNT; module++) {
+    log_levels[module] = LOG_DEFAULT_LEVEL;
+  }
+
+#if defined(__CORTEX_M) && (__CORTEX_M >= 3)
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+/******************************************************************************
+ * Function Name: log_set_level
+ ******************************************************************************
+ * Summary:
+ *  Changes the level of a module at runtime.
+ *
+ * Parameters:
+ *  log_module_t module : Module
+ *  log_level_t level   : Most verbose level to keep
+ *
+ * Return:
+ *  bool : false if the module or level is out of range
+ *
+ ******************************************************************************/
+bool log_set_level(log_module_t module, log_level_t level) {
+  if ((module >= LOG_MODULE_COUNT) || (level > LOG_LEVEL_DEBUG)) {
+    return false;
+  }
+  log_levels[module] = (uint8_t)level;
+  return true;
+}
+
+/******************************************************************************
+ * Function Name: log_write
+ ******************************************************************************
+ * Summary:
+ *  Stores a record in the ring, or drops it when the ring is full. Safe from
+ *  tasks and ISRs. Use LOG() rather than calling this directly.
+ *
+ * Parameters:
+ *  log_module_t module   : Module
+ *  log_level_t level     : Level
+ *  const char *fmt       : printf() format string in flash
+ *  uint32_t argc         : Number of arguments
+ *  const log_arg_t *argv : Arguments
+ *
+ ******************************************************************************/
+void log_write(log_module_t module, log_level_t level, const char *fmt,
+               uint32_t argc, const log_arg_t *argv) {
+#if LOG_DEFERRED_ENABLE
+  log_record_t *record;
+  uint32_t head;
+
+  if (argc > LOG_MAX_ARGS) {
+    argc = LOG_MAX_ARGS;
+  }
+
+#if LOG_LOCK_FREE
+  head = __atomic_load_n(&log_head, __ATOMIC_RELAXED);
+  do {
+    if ((head - log_tail) >= LOG_RING_RECORDS) {
+      __atomic_fetch_add(&log_dropped, 1u, __ATOMIC_RELAXED);
+      return;
+    }
+  } while (!__atomic_compare_exchange_n(&log_head, &head, head + 1u, true,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+#else
+  uint32_t saved_intr = cyhal_system_critical_section_enter();
+  head = log_head;
+  if ((head - log_tail) >= LOG_RING_RECORDS) {
+    log_dropped++;
+    cyhal_system_critical_section_exit(saved_intr);
+    return;
+  }
+  log_head = head + 1u;
+  cyhal_system_critical_section_exit(saved_intr);
+#endif
+
+  record = &log_ring[head & (LOG_RING_RECORDS - 1u)];
+  record->fmt = fmt;
+  record->timestamp_ms = xTaskGetTickCountFromISR() * portTICK_PERIOD_MS;
+  record->module = (uint8_t)module;
+  record->level = (uint8_t)level;
+  record->argc = (uint8_t)argc;
+  for (uint32_t i = 0; i < argc; i++) {
+    record->argv[i] = argv[i];
+  }
+  __atomic_store_n(&record->seq, head + 1u, __ATOMIC_RELEASE);
+#else
+  log_arg_t args[LOG_MAX_ARGS] = {0};
+
+  (void)module;
+  (void)level;
+  for (uint32_t i = 0; (i < argc) && (i < LOG_MAX_ARGS); i++) {
+    args[i] = argv[i];
+  }
+  log_print(fmt, args);
+#endif
+}
+
+/******************************************************************************
+ * Function Name: log_task
+ ******************************************************************************
+ * Summary:
+ *  Prints the records of the ring in order, and the callback timings every
+ *  LOG_TIMING_REPORT_MS.
+ *
+ * Parameters:
+ *  void *pvParameters : Task parameter defined during task creation (unused)
+ *
+ ******************************************************************************/
+void log_task(void *pvParameters) {
+  TickType_t last_report = xTaskGetTickCount();
+
+  (void)pvParameters;
+
+  while (true) {
+#if LOG_DEFERRED_ENABLE
+    while (log_tail != log_head) {
+      log_record_t *record = &log_ring[log_tail & (LOG_RING_RECORDS - 1u)];
+      log_arg_t args[LOG_MAX_ARGS] = {0};
+
+      /* Claimed but still being written. */
+      if (__atomic_load_n(&record->seq, __ATOMIC_ACQUIRE) != log_tail + 1u) {
+        break;
+      }
+      for (uint32_t i = 0; i < record->argc; i++) {
+        args[i] = record->argv[i];
+      }
+      const char *fmt = record->fmt;
+      __atomic_store_n(&log_tail, log_tail + 1u, __ATOMIC_RELEASE);
+      log_print(fmt, args);
+    }
+
+    if (log_dropped != 0u) {
+      uint32_t saved_intr = cyhal_system_critical_section_enter();
+      uint32_t dropped = log_dropped;
+      log_dropped = 0u;
+      cyhal_system_critical_section_exit(saved_intr);
+      printf("[log: %lu records dropped]\n", (unsigned long)dropped);
+    }
+#endif
+
+#if (LOG_TIMING_REPORT_MS > 0)
+    if ((xTaskGetTickCount() - last_report) >=
+        pdMS_TO_TICKS(LOG_TIMING_REPORT_MS)) {
+      last_report = xTaskGetTickCount();
+      log_timing_report();
+    }
+#else
+    (void)last_report;
+#endif
+
+    vTaskDelay(pdMS_TO_TICKS(LOG_TASK_POLL_MS));
+  }
+}
+
+/******************************************************************************
+ * Function Name: log_timing_start
+ ******************************************************************************
+ * Summary:
+ *  Start of a measured callback.
+ *
+ * Return:
+ *  uint32_t : Cycle count to pass to log_timing_end()
+ *
+ ******************************************************************************/
+uint32_t log_timing_start(void) {
+#if defined(__CORTEX_M) && (__CORTEX_M >= 3)
+  return DWT->CYCCNT;
+#else
+  return 0;
+#endif
+}
+
+/******************************************************************************
+ * Function Name: log_timing_end
+ ******************************************************************************
+ * Summary:
+ *  End of a measured callback. Each callback runs in a single thread, so the
+ *  statistics are not locked. Console writes come from several tasks, so
+ *  their statistics are approximate. A callback slower than
+ *  TRACE_TRIGGER_LATENCY_US triggers the kernel event trace.
+ *
+ * Parameters:
+ *  log_timing_t callback : Measured callback
+ *  uint32_t start        : Value returned by log_timing_start()
+ *
+ ******************************************************************************/
+void log_timing_end(log_timing_t callback, uint32_t start) {
+  uint32_t cycles = log_timing_start() - start;
+  log_timing_stats_t *stats = &log_timing[callback];
+
+  stats->count++;
+  stats->total_cycles += cycles;
+  if (cycles > stats->max_cycles) {
+    stats->max_cycles = cycles;
+  }
+
+#if TRACE_ENABLE && (TRACE_TRIGGER_LATENCY_US > 0)
+  if ((callback != LOG_TIMING_CONSOLE_WRITE) &&
+      (cycles > (SystemCoreClock / 1000000u) * TRACE_TRIGGER_LATENCY_US)) {
+    trace_trigger();
+  }
+#endif
+}
+
+/******************************************************************************
+ * Function Name: log_print
+ ******************************************************************************
+ * Summary:
+ *  Expands a record. Every argument is a full word, so passing all of them
+ *  is safe whatever the format string consumes.
+ *
+ * Parameters:
+ *  const char *fmt       : printf() format string
+ *  const log_arg_t *argv : LOG_MAX_ARGS arguments
+ *
+ ******************************************************************************/
+static void log_print(const char *fmt, const log_arg_t *argv) {
+  printf(fmt, argv[0], argv[1], argv[2], argv[3], argv[4], argv[5]);
+}
+
+#if (LOG_TIMING_REPORT_MS > 0)
+/******************************************************************************
+ * Function Name: log_timing_report
+ ******************************************************************************
+ * Summary:
+ *  Prints the average and worst execution time of each callback since the
+ *  last report.
+ *
+ ******************************************************************************/
+static void log_timing_report(void) {
+  uint32_t cycles_per_us = SystemCoreClock / 1000000u;
+
+  printf("Callback timing (%s):", LOG_DEFERRED_ENABLE ? "deferred log"
+                                                      : "synchronous log");
+  for (uint32_t i = 0; i < LOG_TIMING_COUNT; i++) {
+    log_timing_stats_t stats = log_timing[i];
+
+    log_timing[i] = (log_timing_stats_t){0};
+    printf(" %s n=%lu avg=%lu us max=%lu us;", log_timing_names[i],
+           (unsigned long)stats.count,
+           (unsigned long)((stats.count > 0)
+                               ? (stats.total_cycles / stats.count) /
+                                     cycles_per_us
+                               : 0),
+           (unsigned long)(stats.max_cycles / cycles_per_us));
+  }
+  printf("\n");
+
+  console_stats_t console;
+  console_get_stats(&console, true);
+  printf("Console: %lu B/s sent, %lu B dropped, peak %lu of %u B pending\n",
+         (unsigned long)((console.bytes_sent * 1000u) / LOG_TIMING_REPORT_MS),
+         (unsigned long)console.bytes_dropped,
+         (unsigned long)console.peak_pending, (unsigned)CONSOLE_TX_BUFFER_SIZE);
+}
+#endif
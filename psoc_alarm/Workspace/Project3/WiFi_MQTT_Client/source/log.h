@@ -0,0 +1,95 @@
+/*
+ * log.h
+ *
+ * Deferred logger. LOG() stores the format string address and up to
+ * LOG_MAX_ARGS integer arguments in a lock-free ring, from tasks and ISRs.
+ * The logger task expands the records later over retarget-io.
+ *
+ * Arguments are stored as pointer-sized words, 32 bits on the target: use
+ * integer conversions and %s for strings in flash only (wrap them in
+ * LOG_STR()). The format string must be a literal.
+ */
+
+#ifndef SOURCE_LOG_H_
+#define SOURCE_LOG_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "log_config.h"
+
+/*******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Task parameters for the logger task, below every other task. */
+#define LOG_TASK_PRIORITY (0)
+#define LOG_TASK_STACK_SIZE (1024 * 1)
+
+/* Arguments stored per record. */
+#define LOG_MAX_ARGS (6)
+
+/* Argument of a %s conversion. */
+#define LOG_STR(s) ((log_arg_t)(s))
+
+/* Writes a record if the level is enabled for the module. */
+#define LOG(module, level, fmt, ...)                                           \
+  do {                                                                         \
+    if ((level) <= log_levels[(module)]) {                                     \
+      const log_arg_t log_argv_[] = {0, ##__VA_ARGS__};                        \
+      log_write((module), (level), (fmt),                                      \
+                (sizeof(log_argv_) / sizeof(log_argv_[0])) - 1u,               \
+                &log_argv_[1]);                                                \
+    }                                                                          \
+  } while (0)
+
+/* Bluetooth device address as six arguments of "%02X:%02X:...". */
+#define LOG_BDA_FMT "%02X:%02X:%02X:%02X:%02X:%02X"
+#define LOG_BDA(bda) (bda)[0], (bda)[1], (bda)[2], (bda)[3], (bda)[4], (bda)[5]
+
+/*******************************************************************************
+ * Data Types
+ ******************************************************************************/
+/* Argument word, wide enough for a string address on the host build. */
+typedef uintptr_t log_arg_t;
+
+typedef enum {
+  LOG_MODULE_APP,
+  LOG_MODULE_BT,
+  LOG_MODULE_MQTT,
+  LOG_MODULE_STATE,
+  LOG_MODULE_COUNT
+} log_module_t;
+
+typedef enum {
+  LOG_LEVEL_OFF,
+  LOG_LEVEL_ERROR,
+  LOG_LEVEL_WARNING,
+  LOG_LEVEL_INFO,
+  LOG_LEVEL_DEBUG
+} log_level_t;
+
+/* Callbacks whose execution time is measured, and console writes. */
+typedef enum {
+  LOG_TIMING_BT_MANAGEMENT,
+  LOG_TIMING_BT_GATT,
+  LOG_TIMING_MQTT_EVENT,
+  LOG_TIMING_CONSOLE_WRITE,
+  LOG_TIMING_COUNT
+} log_timing_t;
+
+/*******************************************************************************
+ * Global Variables
+ ******************************************************************************/
+extern volatile uint8_t log_levels[LOG_MODULE_COUNT];
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+void log_init(void);
+void log_task(void *pvParameters);
+void log_write(log_module_t module, log_level_t level, const char *fmt,
+               uint32_t argc, const log_arg_t *argv);
+bool log_set_level(log_module_t module, log_level_t level);
+uint32_t log_timing_start(void);
+void log_timing_end(log_timing_t callback, uint32_t start);
+
+#endif /* SOURCE_LOG_H_ */
@@ -46,8 +46,17 @@
 #include "cy_retarget_io.h"
 
 #include "mqtt_task.h"
+#include "bench.h"
 #include "bt.h"
+#include "console.h"
+#include "coroutine.h"
+#include "heap.h"
+#include "log.h"
+#include "memory_plan.h"
+#include "recorder.h"
+#include "stack_profile.h"
 #include "state.h"
+#include "trace.h"
 
 #include "FreeRTOSConfig.h"
 #include <FreeRTOS.h>
@@ -58,12 +67,39 @@
 /* Queue size for LED and UART tasks*/
 #define QUEUE_SIZE (3)
 
+/* Stacks and control blocks of the tasks started here. */
+static StackType_t log_task_stack[LOG_TASK_STACK_SIZE];
+static StaticTask_t log_task_tcb;
+#if TRACE_ENABLE
+static StackType_t trace_task_stack[TRACE_TASK_STACK_SIZE];
+static StaticTask_t trace_task_tcb;
+#endif
+#if RECORDER_ENABLE
+static StackType_t recorder_task_stack[RECORDER_TASK_STACK_SIZE];
+static StaticTask_t recorder_task_tcb;
+#endif
+#if BENCH_ENABLE
+static StackType_t bench_task_stack[BENCH_TASK_STACK_SIZE];
+static StaticTask_t bench_task_tcb;
+#endif
+#if STACK_PROFILE_ENABLE
+static StackType_t stack_profile_task_stack[STACK_PROFILE_TASK_STACK_SIZE];
+static StaticTask_t stack_profile_task_tcb;
+#endif
+#if HEAP_TRACE_ENABLE
+static StackType_t heap_trace_task_stack[HEAP_TRACE_TASK_STACK_SIZE];
+static StaticTask_t heap_trace_task_tcb;
+#endif
+static StackType_t coroutine_task_stack[COROUTINE_TASK_STACK_SIZE];
+static StaticTask_t coroutine_task_tcb;
+
 /******************************************************************************
  * Function Name: main
  ******************************************************************************
  * Summary:
  *  System entrance point. This function initializes retarget IO, sets up
- *  the MQTT client task, and then starts the RTOS scheduler.
+ *  the connection manager on the coroutine task, and then starts the RTOS
+ *  scheduler.
  *
  * Parameters:
  *  void
@@ -76,6 +112,9 @@ int main() {
   cy_rslt_t result;
   wiced_result_t wiced_result;
 
+  /* Fill the main stack before it is used further, for the stack profile. */
+  stack_profile_init();
+
   /* Initialize the board support package. */
   result = cybsp_init();
   CY_ASSERT(CY_RSLT_SUCCESS == result);
@@ -90,9 +129,52 @@ int main() {
   cy_retarget_io_init(CYBSP_DEBUG_UART_TX, CYBSP_DEBUG_UART_RX,
                       CY_RETARGET_IO_BAUDRATE);
 
-  /* Create the MQTT Client task. */
-  xTaskCreate(mqtt_client_task, "MQTT Client task", MQTT_CLIENT_TASK_STACK_SIZE,
-              NULL, MQTT_CLIENT_TASK_PRIORITY, NULL);
+  /* Drain the console by DMA from now on. */
+  console_init();
+
+  /* Start the deferred logger before the first callback can log. */
+  log_init();
+  xTaskCreateStatic(log_task, "Log task", LOG_TASK_STACK_SIZE, NULL,
+                    LOG_TASK_PRIORITY, log_task_stack, &log_task_tcb);
+#if TRACE_ENABLE
+  xTaskCreateStatic(trace_task, "Trace task", TRACE_TASK_STACK_SIZE, NULL,
+                    TRACE_TASK_PRIORITY, trace_task_stack, &trace_task_tcb);
+#endif
+
+  /* Record the inputs from the first Bluetooth or MQTT event on. */
+  recorder_init();
+#if RECORDER_ENABLE
+  xTaskCreateStatic(recorder_task, "Recorder task", RECORDER_TASK_STACK_SIZE,
+                    NULL, RECORDER_TASK_PRIORITY, recorder_task_stack,
+                    &recorder_task_tcb);
+#endif
+#if BENCH_ENABLE
+  xTaskCreateStatic(bench_task, "Bench task", BENCH_TASK_STACK_SIZE, NULL,
+                    BENCH_TASK_PRIORITY, bench_task_stack, &bench_task_tcb);
+#endif
+#if STACK_PROFILE_ENABLE
+  xTaskCreateStatic(stack_profile_task, "Stack profile",
+                    STACK_PROFILE_TASK_STACK_SIZE, NULL,
+                    STACK_PROFILE_TASK_PRIORITY, stack_profile_task_stack,
+                    &stack_profile_task_tcb);
+#endif
+#if HEAP_TRACE_ENABLE
+  xTaskCreateStatic(heap_trace_task, "Heap trace task",
+                    HEAP_TRACE_TASK_STACK_SIZE, NULL, HEAP_TRACE_TASK_PRIORITY,
+                    heap_trace_task_stack, &heap_trace_task_tcb);
+#endif
+
+  /* Start the connection manager on the coroutine task. */
+  mqtt_task_start();
+  xTaskCreateStatic(coroutine_task, "Coroutine task",
+                    COROUTINE_TASK_STACK_SIZE, NULL, COROUTINE_TASK_PRIORITY,
+                    coroutine_task_stack, &coroutine_task_tcb);
+  printf("Memory plan: tasks %lu, kernel objects %lu, buffers %lu of %lu "
+         "bytes\n",
+         (unsigned long)MEMORY_PLAN_TASKS,
+         (unsigned long)MEMORY_PLAN_KERNEL_OBJECTS,
+         (unsigned long)MEMORY_PLAN_BUFFERS,
+         (unsigned long)MEMORY_PLAN_RAM_BUDGET);
 
   /* Create the state task and cleanup if the operation fails. */
   /*xTaskCreate(state_task, "State task", MQTT_CLIENT_TASK_STACK_SIZE, NULL,
@@ -0,0 +1,139 @@
+/*
+ * memory_plan.h
+ *
+ * Compile-time RAM plan of the application. Its tasks, queues, timers and
+ * buffers are all allocated statically, with xTaskCreateStatic() and the
+ * other *Static() calls, so that the heap is left to the Bluetooth stack,
+ * lwIP, the WCM and the MQTT library. The plan adds up the stack sizes and
+ * queue lengths of the module headers and the buffer sizes of the
+ * configuration headers, and fails the build when the total exceeds
+ * MEMORY_PLAN_RAM_BUDGET.
+ *
+ * The plan leaves out the small globals of each module. server_code/
+ * map_report.py lists everything the linker placed, from the .map file of
+ * the build.
+ */
+
+#ifndef SOURCE_MEMORY_PLAN_H_
+#define SOURCE_MEMORY_PLAN_H_
+
+#include "FreeRTOS.h"
+#include "event_groups.h"
+#include "queue.h"
+#include "semphr.h"
+#include "task.h"
+#include "timers.h"
+
+#include "bench.h"
+#include "coroutine.h"
+#include "heap.h"
+#include "log.h"
+#include "log_config.h"
+#include "mqtt_client_config.h"
+#include "mqtt_task.h"
+#include "publisher.h"
+#include "recorder.h"
+#include "stack_profile.h"
+#include "state.h"
+#include "trace.h"
+#include "wifi_config.h"
+
+#if !configSUPPORT_STATIC_ALLOCATION
+#error "The memory plan needs configSUPPORT_STATIC_ALLOCATION"
+#endif
+
+/*******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* RAM of a statically allocated task, stack size in words as for
+ * xTaskCreateStatic().
+ */
+#define MEMORY_PLAN_TASK(stack_size)                                           \
+  ((stack_size) * sizeof(StackType_t) + sizeof(StaticTask_t))
+
+/* RAM of a statically allocated queue. */
+#define MEMORY_PLAN_QUEUE(length, item_size)                                   \
+  ((length) * (item_size) + sizeof(StaticQueue_t))
+
+/* Tasks that can be compiled out. */
+#if TRACE_ENABLE
+#define MEMORY_PLAN_TRACE_TASK MEMORY_PLAN_TASK(TRACE_TASK_STACK_SIZE)
+#else
+#define MEMORY_PLAN_TRACE_TASK (0u)
+#endif
+
+#if RECORDER_ENABLE
+#define MEMORY_PLAN_RECORDER_TASK MEMORY_PLAN_TASK(RECORDER_TASK_STACK_SIZE)
+#define MEMORY_PLAN_RECORDER_BUFFER (RECORDER_BUFFER_SIZE)
+#else
+#define MEMORY_PLAN_RECORDER_TASK (0u)
+#define MEMORY_PLAN_RECORDER_BUFFER (0u)
+#endif
+
+#if BENCH_ENABLE
+#define MEMORY_PLAN_BENCH_TASK MEMORY_PLAN_TASK(BENCH_TASK_STACK_SIZE)
+#else
+#define MEMORY_PLAN_BENCH_TASK (0u)
+#endif
+
+#if HEAP_TRACE_ENABLE
+#define MEMORY_PLAN_HEAP_TRACE_TASK MEMORY_PLAN_TASK(HEAP_TRACE_TASK_STACK_SIZE)
+#define MEMORY_PLAN_HEAP_TRACE_BUFFER (HEAP_TRACE_EVENTS * 12u)
+#else
+#define MEMORY_PLAN_HEAP_TRACE_TASK (0u)
+#define MEMORY_PLAN_HEAP_TRACE_BUFFER (0u)
+#endif
+
+#if STACK_PROFILE_ENABLE
+#define MEMORY_PLAN_STACK_PROFILE_TASK                                         \
+  MEMORY_PLAN_TASK(STACK_PROFILE_TASK_STACK_SIZE)
+#else
+#define MEMORY_PLAN_STACK_PROFILE_TASK (0u)
+#endif
+
+/* Task stacks and control blocks. The connection manager, the link monitor
+ * and the task statistics share the coroutine task, and their blocking calls
+ * the worker task.
+ */
+#define MEMORY_PLAN_TASKS                                                      \
+  (MEMORY_PLAN_TASK(LOG_TASK_STACK_SIZE) +                                     \
+   MEMORY_PLAN_TASK(COROUTINE_TASK_STACK_SIZE) +                               \
+   MEMORY_PLAN_TASK(COROUTINE_WORKER_STACK_SIZE) +                             \
+   MEMORY_PLAN_TASK(STATE_TASK_STACK_SIZE) +                                   \
+   PUBLISHER_TASKS * MEMORY_PLAN_TASK(PUBLISHER_TASK_STACK_SIZE) +             \
+   MEMORY_PLAN_TRACE_TASK + MEMORY_PLAN_RECORDER_TASK +                        \
+   MEMORY_PLAN_BENCH_TASK + MEMORY_PLAN_HEAP_TRACE_TASK +                      \
+   MEMORY_PLAN_STACK_PROFILE_TASK)
+
+/* Queues with their storage, the policy mutex and the scan semaphore, the
+ * batch and lease timers and the publisher event group.
+ */
+#define MEMORY_PLAN_KERNEL_OBJECTS                                             \
+  (MEMORY_PLAN_QUEUE(MQTT_TASK_QUEUE_LENGTH, sizeof(mqtt_task_cmd_t)) +        \
+   MEMORY_PLAN_QUEUE(STATE_QUEUE_LENGTH, sizeof(State)) +                      \
+   3u * MEMORY_PLAN_QUEUE(PUBLISHER_SLOTS, sizeof(uint8_t)) +                  \
+   MEMORY_PLAN_QUEUE(PUBLISHER_ALARM_SLOTS, sizeof(uint8_t)) +                 \
+   2u * sizeof(StaticSemaphore_t) + 2u * sizeof(StaticTimer_t) +               \
+   sizeof(StaticEventGroup_t))
+
+/* Buffers sized in the configuration headers. A trace record and a heap
+ * trace event take 12 bytes.
+ */
+#define MEMORY_PLAN_BUFFERS                                                    \
+  (MQTT_NETWORK_BUFFER_SIZE + MQTT_TLS_HEAP_SIZE +                             \
+   PUBLISHER_SLOTS * MQTT_PUBLISH_PAYLOAD_MAX + CONSOLE_TX_BUFFER_SIZE +       \
+   (TRACE_ENABLE ? TRACE_BUFFER_EVENTS * 12u : 0u) +                           \
+   MEMORY_PLAN_RECORDER_BUFFER + MEMORY_PLAN_HEAP_TRACE_BUFFER)
+
+#define MEMORY_PLAN_TOTAL                                                      \
+  (MEMORY_PLAN_TASKS + MEMORY_PLAN_KERNEL_OBJECTS + MEMORY_PLAN_BUFFERS)
+
+/* The host build has 8 byte stack words and gives every task a pthread, so
+ * the budget is only checked on the board.
+ */
+#if defined(__CORTEX_M)
+_Static_assert(MEMORY_PLAN_TOTAL <= MEMORY_PLAN_RAM_BUDGET,
+               "The memory plan exceeds MEMORY_PLAN_RAM_BUDGET");
+#endif
+
+#endif /* SOURCE_MEMORY_PLAN_H_ */
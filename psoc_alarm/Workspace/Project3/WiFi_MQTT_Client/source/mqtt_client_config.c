@@ -43,11 +43,33 @@
 #include <stdio.h>
 #include "mqtt_client_config.h"
 #include "cy_mqtt_api.h"
+#include "cy_utils.h"
 
 /******************************************************************************
 * Global Variables
 *******************************************************************************/
-/* MQTT Broker/Server details */
+/* MQTT Brokers/Servers in order of preference. The first one is the primary
+ * broker, the client fails back to it when it is reachable again.
+ */
+const cy_mqtt_broker_info_t mqtt_brokers[] =
+{
+    {
+        .hostname = MQTT_BROKER_ADDRESS,
+        .hostname_len = sizeof(MQTT_BROKER_ADDRESS) - 1,
+        .port = MQTT_PORT
+    },
+#if MQTT_LOCAL_BROKER_ENABLE
+    {
+        .hostname = MQTT_LOCAL_BROKER_ADDRESS,
+        .hostname_len = sizeof(MQTT_LOCAL_BROKER_ADDRESS) - 1,
+        .port = MQTT_LOCAL_BROKER_PORT
+    },
+#endif
+};
+
+const uint32_t mqtt_broker_count = sizeof(mqtt_brokers) / sizeof(mqtt_brokers[0]);
+
+/* Details of the MQTT Broker/Server in use, one of mqtt_brokers[]. */
 cy_mqtt_broker_info_t broker_info =
 {
     .hostname = MQTT_BROKER_ADDRESS,
@@ -56,35 +78,327 @@ cy_mqtt_broker_info_t broker_info =
 };
 
 #if (MQTT_SECURE_CONNECTION)
+/* The DER-encoded credentials are kept together in their own flash section so
+ * their footprint shows up as a single entry in the linker map.
+ */
+#define MQTT_CREDENTIALS_SECTION          CY_SECTION(".rodata.mqtt_credentials")
+
+#if (CLIENT_CERTIFICATE)
+/* DER-encoded client certificate (server_code/Mosquitto/client.crt) */
+MQTT_CREDENTIALS_SECTION const uint8_t client_certificate_der[] =
+{
+    0x30, 0x82, 0x03, 0xa1, 0x30, 0x82, 0x02, 0x89, 0x02, 0x14, 0x77, 0x37,
+    0xb0, 0xcf, 0x5f, 0x24, 0x50, 0x07, 0x34, 0x9c, 0x67, 0x95, 0xcf, 0xe4,
+    0xf3, 0x76, 0x30, 0xad, 0xa9, 0x05, 0x30, 0x0d, 0x06, 0x09, 0x2a, 0x86,
+    0x48, 0x86, 0xf7, 0x0d, 0x01, 0x01, 0x0b, 0x05, 0x00, 0x30, 0x81, 0x8c,
+    0x31, 0x0b, 0x30, 0x09, 0x06, 0x03, 0x55, 0x04, 0x06, 0x13, 0x02, 0x42,
+    0x45, 0x31, 0x10, 0x30, 0x0e, 0x06, 0x03, 0x55, 0x04, 0x08, 0x0c, 0x07,
+    0x4c, 0x69, 0x6d, 0x62, 0x75, 0x72, 0x67, 0x31, 0x10, 0x30, 0x0e, 0x06,
+    0x03, 0x55, 0x04, 0x07, 0x0c, 0x07, 0x48, 0x61, 0x73, 0x73, 0x65, 0x6c,
+    0x74, 0x31, 0x11, 0x30, 0x0f, 0x06, 0x03, 0x55, 0x04, 0x0a, 0x0c, 0x08,
+    0x6d, 0x61, 0x73, 0x73, 0x69, 0x6d, 0x6f, 0x67, 0x31, 0x0c, 0x30, 0x0a,
+    0x06, 0x03, 0x55, 0x04, 0x0b, 0x0c, 0x03, 0x69, 0x6f, 0x74, 0x31, 0x15,
+    0x30, 0x13, 0x06, 0x03, 0x55, 0x04, 0x03, 0x0c, 0x0c, 0x6d, 0x61, 0x73,
+    0x73, 0x69, 0x6d, 0x6f, 0x67, 0x2e, 0x6e, 0x65, 0x74, 0x31, 0x21, 0x30,
+    0x1f, 0x06, 0x09, 0x2a, 0x86, 0x48, 0x86, 0xf7, 0x0d, 0x01, 0x09, 0x01,
+    0x16, 0x12, 0x61, 0x64, 0x6d, 0x69, 0x6e, 0x40, 0x6d, 0x61, 0x73, 0x73,
+    0x69, 0x6d, 0x6f, 0x67, 0x2e, 0x6e, 0x65, 0x74, 0x30, 0x1e, 0x17, 0x0d,
+    0x32, 0x32, 0x31, 0x32, 0x33, 0x31, 0x31, 0x30, 0x34, 0x34, 0x30, 0x36,
+    0x5a, 0x17, 0x0d, 0x32, 0x33, 0x31, 0x32, 0x32, 0x36, 0x31, 0x30, 0x34,
+    0x34, 0x30, 0x36, 0x5a, 0x30, 0x81, 0x8c, 0x31, 0x0b, 0x30, 0x09, 0x06,
+    0x03, 0x55, 0x04, 0x06, 0x13, 0x02, 0x42, 0x45, 0x31, 0x10, 0x30, 0x0e,
+    0x06, 0x03, 0x55, 0x04, 0x08, 0x0c, 0x07, 0x4c, 0x69, 0x6d, 0x62, 0x75,
+    0x72, 0x67, 0x31, 0x10, 0x30, 0x0e, 0x06, 0x03, 0x55, 0x04, 0x07, 0x0c,
+    0x07, 0x48, 0x61, 0x73, 0x73, 0x65, 0x6c, 0x74, 0x31, 0x11, 0x30, 0x0f,
+    0x06, 0x03, 0x55, 0x04, 0x0a, 0x0c, 0x08, 0x6d, 0x61, 0x73, 0x73, 0x69,
+    0x6d, 0x6f, 0x67, 0x31, 0x0c, 0x30, 0x0a, 0x06, 0x03, 0x55, 0x04, 0x0b,
+    0x0c, 0x03, 0x69, 0x6f, 0x74, 0x31, 0x15, 0x30, 0x13, 0x06, 0x03, 0x55,
+    0x04, 0x03, 0x0c, 0x0c, 0x6d, 0x61, 0x73, 0x73, 0x69, 0x6d, 0x6f, 0x67,
+    0x2e, 0x6e, 0x65, 0x74, 0x31, 0x21, 0x30, 0x1f, 0x06, 0x09, 0x2a, 0x86,
+    0x48, 0x86, 0xf7, 0x0d, 0x01, 0x09, 0x01, 0x16, 0x12, 0x61, 0x64, 0x6d,
+    0x69, 0x6e, 0x40, 0x6d, 0x61, 0x73, 0x73, 0x69, 0x6d, 0x6f, 0x67, 0x2e,
+    0x6e, 0x65, 0x74, 0x30, 0x82, 0x01, 0x22, 0x30, 0x0d, 0x06, 0x09, 0x2a,
+    0x86, 0x48, 0x86, 0xf7, 0x0d, 0x01, 0x01, 0x01, 0x05, 0x00, 0x03, 0x82,
+    0x01, 0x0f, 0x00, 0x30, 0x82, 0x01, 0x0a, 0x02, 0x82, 0x01, 0x01, 0x00,
+    0xaf, 0x87, 0xfa, 0x93, 0x66, 0x24, 0xa3, 0xb3, 0x14, 0x65, 0xd9, 0xc6,
+    0x75, 0xe7, 0x6c, 0x1b, 0x11, 0x03, 0x49, 0x1b, 0x1a, 0x2c, 0x5d, 0xd4,
+    0x63, 0x57, 0xd4, 0xc1, 0x0b, 0x88, 0xf8, 0x3d, 0x6e, 0x29, 0x9e, 0x4e,
+    0xb8, 0xd4, 0x36, 0x56, 0x05, 0x3b, 0x72, 0x12, 0x3a, 0x10, 0xfa, 0xbe,
+    0xfa, 0xa5, 0x01, 0x02, 0x5f, 0xd6, 0xd3, 0x56, 0x31, 0x23, 0xad, 0x74,
+    0x64, 0x7c, 0xfa, 0xa8, 0x09, 0x4d, 0xd8, 0xed, 0x99, 0x5c, 0x89, 0x22,
+    0x33, 0x04, 0x7e, 0xb7, 0xab, 0x83, 0x9c, 0x2b, 0xa3, 0x85, 0xb7, 0x8f,
+    0x18, 0xa2, 0x84, 0x8d, 0xae, 0xb1, 0x31, 0x0f, 0xa2, 0x95, 0x71, 0x46,
+    0xc2, 0xb0, 0x1d, 0x12, 0x44, 0x8d, 0xd7, 0x93, 0xb1, 0x71, 0x79, 0x98,
+    0x10, 0x99, 0x08, 0x4b, 0x79, 0x36, 0xc4, 0xdd, 0x31, 0x08, 0xcf, 0x3d,
+    0xc2, 0x51, 0x16, 0xc5, 0xe6, 0x58, 0xb5, 0x81, 0xe6, 0xec, 0xb2, 0x34,
+    0xaa, 0x83, 0xd5, 0xb5, 0xe3, 0x71, 0x40, 0x76, 0x8d, 0x2c, 0xa0, 0x6f,
+    0xa4, 0x86, 0x31, 0x29, 0x3f, 0x30, 0xcd, 0x54, 0xd8, 0x7a, 0x40, 0x2a,
+    0xef, 0xcf, 0x3f, 0xb5, 0x84, 0xfe, 0x44, 0xe4, 0x2e, 0x8b, 0x4a, 0x8b,
+    0xe3, 0x14, 0x58, 0x74, 0x29, 0x72, 0x20, 0x33, 0xea, 0x45, 0x06, 0xcf,
+    0xf4, 0x22, 0x89, 0x77, 0x79, 0x09, 0xb0, 0xa4, 0xc5, 0x95, 0x10, 0x30,
+    0xe9, 0xb8, 0xfc, 0xeb, 0xf2, 0x40, 0x41, 0xc6, 0x60, 0xbd, 0x46, 0x04,
+    0x19, 0xdc, 0x86, 0x27, 0xc6, 0x59, 0x21, 0xbd, 0xc9, 0x45, 0x35, 0xb3,
+    0xb1, 0x39, 0x25, 0x75, 0xf1, 0xa7, 0xe5, 0xe8, 0x15, 0xcb, 0xbf, 0xd7,
+    0x68, 0x24, 0x94, 0x31, 0xf9, 0x69, 0xf0, 0x38, 0x33, 0x91, 0x9f, 0x6e,
+    0x9f, 0x4d, 0xf3, 0xee, 0x14, 0x4b, 0x62, 0xe9, 0x1e, 0x31, 0x41, 0x2c,
+    0x1c, 0x4e, 0x67, 0xdb, 0x02, 0x03, 0x01, 0x00, 0x01, 0x30, 0x0d, 0x06,
+    0x09, 0x2a, 0x86, 0x48, 0x86, 0xf7, 0x0d, 0x01, 0x01, 0x0b, 0x05, 0x00,
+    0x03, 0x82, 0x01, 0x01, 0x00, 0x97, 0x85, 0x5a, 0xbe, 0x18, 0xa7, 0xc8,
+    0xd5, 0x8d, 0x36, 0x84, 0xe7, 0x2e, 0x8d, 0x29, 0x08, 0xcd, 0xba, 0x38,
+    0x0d, 0xaa, 0x2a, 0xa7, 0xc7, 0x89, 0xc3, 0x5a, 0x1a, 0xcd, 0xe2, 0x0f,
+    0x42, 0x77, 0x02, 0xe8, 0xc8, 0xe7, 0xe1, 0xef, 0xce, 0x45, 0xeb, 0x10,
+    0xd8, 0x28, 0xaa, 0x09, 0xa5, 0xa6, 0x9e, 0x26, 0xf1, 0x2f, 0x5b, 0xa2,
+    0x10, 0x80, 0x5c, 0x4e, 0x22, 0x99, 0xcb, 0x87, 0x48, 0x45, 0xf3, 0x2f,
+    0x39, 0x00, 0x2c, 0x18, 0x27, 0x3b, 0x53, 0xc7, 0xca, 0x6d, 0x67, 0x60,
+    0xf2, 0x18, 0x18, 0x46, 0xe7, 0xc7, 0xf2, 0x5b, 0x50, 0xa5, 0xb3, 0x28,
+    0x67, 0x74, 0xa9, 0xd8, 0xb8, 0x9c, 0xa8, 0xb7, 0x0e, 0x68, 0xb3, 0xc7,
+    0x69, 0x3d, 0x92, 0xb8, 0x2b, 0x0e, 0x1b, 0x8c, 0x1b, 0x29, 0xca, 0x26,
+    0x2e, 0xe6, 0x53, 0x62, 0x05, 0xb8, 0xd0, 0x50, 0x52, 0x76, 0xf3, 0x4d,
+    0x45, 0x5d, 0xd5, 0xfa, 0x67, 0x93, 0xa2, 0xcf, 0x5c, 0x09, 0xe0, 0x44,
+    0x8c, 0x43, 0xbc, 0xaf, 0x0c, 0x1a, 0x33, 0xc3, 0xe6, 0x63, 0x43, 0x31,
+    0xd8, 0xf1, 0x4d, 0x46, 0x9f, 0x09, 0x54, 0xed, 0x49, 0x46, 0xb4, 0xed,
+    0xca, 0xc1, 0x7d, 0x9a, 0xc2, 0x8e, 0x94, 0x4d, 0xdc, 0x42, 0x8d, 0xff,
+    0x50, 0x74, 0xd9, 0x67, 0xb2, 0x88, 0xb1, 0x08, 0x00, 0x81, 0x12, 0x1f,
+    0xcd, 0xac, 0xeb, 0x8e, 0x22, 0xd7, 0x22, 0x12, 0xc7, 0x2a, 0x65, 0xf4,
+    0xf7, 0xfa, 0xa0, 0x5f, 0xa3, 0x70, 0xe4, 0xdf, 0x15, 0xe8, 0x23, 0xec,
+    0xf1, 0xdb, 0x15, 0xe3, 0x39, 0x51, 0x41, 0xce, 0xbb, 0x9b, 0x30, 0xf2,
+    0x1d, 0xa2, 0x00, 0x28, 0xf8, 0x47, 0x62, 0x73, 0x22, 0xc4, 0xe5, 0x25,
+    0xbe, 0x55, 0xa5, 0xad, 0x7e, 0xa9, 0x87, 0x66, 0x69, 0xc8, 0x8b, 0x7a,
+    0x1a, 0xb4, 0xda, 0xa0, 0x45, 0x83, 0xa2, 0x76, 0xcd
+};
+const uint32_t client_certificate_der_len = sizeof(client_certificate_der);
+#endif
+
+#if (CLIENT_PRIVATE_KEY)
+/* DER-encoded PKCS#1 client private key (server_code/Mosquitto/client.key) */
+MQTT_CREDENTIALS_SECTION const uint8_t client_private_key_der[] =
+{
+    0x30, 0x82, 0x04, 0xa2, 0x02, 0x01, 0x00, 0x02, 0x82, 0x01, 0x01, 0x00,
+    0xaf, 0x87, 0xfa, 0x93, 0x66, 0x24, 0xa3, 0xb3, 0x14, 0x65, 0xd9, 0xc6,
+    0x75, 0xe7, 0x6c, 0x1b, 0x11, 0x03, 0x49, 0x1b, 0x1a, 0x2c, 0x5d, 0xd4,
+    0x63, 0x57, 0xd4, 0xc1, 0x0b, 0x88, 0xf8, 0x3d, 0x6e, 0x29, 0x9e, 0x4e,
+    0xb8, 0xd4, 0x36, 0x56, 0x05, 0x3b, 0x72, 0x12, 0x3a, 0x10, 0xfa, 0xbe,
+    0xfa, 0xa5, 0x01, 0x02, 0x5f, 0xd6, 0xd3, 0x56, 0x31, 0x23, 0xad, 0x74,
+    0x64, 0x7c, 0xfa, 0xa8, 0x09, 0x4d, 0xd8, 0xed, 0x99, 0x5c, 0x89, 0x22,
+    0x33, 0x04, 0x7e, 0xb7, 0xab, 0x83, 0x9c, 0x2b, 0xa3, 0x85, 0xb7, 0x8f,
+    0x18, 0xa2, 0x84, 0x8d, 0xae, 0xb1, 0x31, 0x0f, 0xa2, 0x95, 0x71, 0x46,
+    0xc2, 0xb0, 0x1d, 0x12, 0x44, 0x8d, 0xd7, 0x93, 0xb1, 0x71, 0x79, 0x98,
+    0x10, 0x99, 0x08, 0x4b, 0x79, 0x36, 0xc4, 0xdd, 0x31, 0x08, 0xcf, 0x3d,
+    0xc2, 0x51, 0x16, 0xc5, 0xe6, 0x58, 0xb5, 0x81, 0xe6, 0xec, 0xb2, 0x34,
+    0xaa, 0x83, 0xd5, 0xb5, 0xe3, 0x71, 0x40, 0x76, 0x8d, 0x2c, 0xa0, 0x6f,
+    0xa4, 0x86, 0x31, 0x29, 0x3f, 0x30, 0xcd, 0x54, 0xd8, 0x7a, 0x40, 0x2a,
+    0xef, 0xcf, 0x3f, 0xb5, 0x84, 0xfe, 0x44, 0xe4, 0x2e, 0x8b, 0x4a, 0x8b,
+    0xe3, 0x14, 0x58, 0x74, 0x29, 0x72, 0x20, 0x33, 0xea, 0x45, 0x06, 0xcf,
+    0xf4, 0x22, 0x89, 0x77, 0x79, 0x09, 0xb0, 0xa4, 0xc5, 0x95, 0x10, 0x30,
+    0xe9, 0xb8, 0xfc, 0xeb, 0xf2, 0x40, 0x41, 0xc6, 0x60, 0xbd, 0x46, 0x04,
+    0x19, 0xdc, 0x86, 0x27, 0xc6, 0x59, 0x21, 0xbd, 0xc9, 0x45, 0x35, 0xb3,
+    0xb1, 0x39, 0x25, 0x75, 0xf1, 0xa7, 0xe5, 0xe8, 0x15, 0xcb, 0xbf, 0xd7,
+    0x68, 0x24, 0x94, 0x31, 0xf9, 0x69, 0xf0, 0x38, 0x33, 0x91, 0x9f, 0x6e,
+    0x9f, 0x4d, 0xf3, 0xee, 0x14, 0x4b, 0x62, 0xe9, 0x1e, 0x31, 0x41, 0x2c,
+    0x1c, 0x4e, 0x67, 0xdb, 0x02, 0x03, 0x01, 0x00, 0x01, 0x02, 0x82, 0x01,
+    0x00, 0x62, 0x76, 0xd9, 0xd6, 0x33, 0x77, 0x1c, 0x29, 0x09, 0xa9, 0x34,
+    0xa7, 0x82, 0x5e, 0x26, 0x23, 0x6c, 0xc0, 0xb6, 0x12, 0xb0, 0xf4, 0xf0,
+    0x51, 0x82, 0xc4, 0xb3, 0x40, 0xf3, 0x12, 0x8b, 0x86, 0x12, 0x34, 0xe0,
+    0x6b, 0xf2, 0x7c, 0x80, 0x5a, 0x72, 0xa6, 0xed, 0x0f, 0x52, 0x69, 0x51,
+    0xef, 0x2d, 0xb4, 0xbf, 0xc3, 0x30, 0x35, 0xd6, 0xe9, 0x43, 0xb9, 0x6a,
+    0xc4, 0x9e, 0xd6, 0x08, 0xd9, 0x98, 0x16, 0x86, 0x38, 0x8a, 0x4e, 0x01,
+    0x53, 0x20, 0xe1, 0x45, 0xa0, 0x0c, 0x63, 0x50, 0x88, 0x9e, 0x3b, 0x15,
+    0x43, 0xfd, 0x22, 0xb5, 0x4e, 0xb1, 0x0f, 0x0e, 0xa1, 0x61, 0xa7, 0x89,
+    0x1a, 0x93, 0x7d, 0xad, 0x61, 0x20, 0xf9, 0x9c, 0x53, 0x6a, 0x37, 0x68,
+    0x69, 0x27, 0xee, 0x60, 0x5b, 0xce, 0x0c, 0x2e, 0x14, 0x92, 0x3c, 0x09,
+    0xdc, 0xf0, 0x13, 0x02, 0xbe, 0x52, 0xbf, 0xb2, 0x58, 0xd4, 0x56, 0x16,
+    0xdb, 0x56, 0x2e, 0x83, 0x4a, 0x0f, 0xcb, 0x96, 0xcf, 0xb1, 0x83, 0x99,
+    0x28, 0xc4, 0x35, 0xff, 0xeb, 0xeb, 0x18, 0x0a, 0xf1, 0xe5, 0x97, 0x9c,
+    0xb1, 0xa1, 0x41, 0x28, 0x22, 0x9f, 0x51, 0x5e, 0xb9, 0xd4, 0x25, 0xb2,
+    0x74, 0xa8, 0x95, 0xe8, 0x15, 0xe6, 0xba, 0x76, 0x12, 0xfb, 0x5c, 0x03,
+    0x18, 0x18, 0xa3, 0x92, 0x4b, 0xe1, 0xc2, 0x3d, 0xf1, 0x22, 0xaa, 0xc8,
+    0xd7, 0xb0, 0x9f, 0xbc, 0xb4, 0x6c, 0x2f, 0xe7, 0x5a, 0x2f, 0xbd, 0xd8,
+    0x95, 0x00, 0x31, 0x42, 0x4e, 0x35, 0x03, 0x7a, 0x99, 0xdc, 0x4e, 0x07,
+    0x74, 0x98, 0x94, 0x6a, 0xa6, 0x0b, 0x1e, 0x33, 0x32, 0x5b, 0x8b, 0x72,
+    0x61, 0x74, 0x6f, 0x90, 0x89, 0xf1, 0xfe, 0xca, 0x90, 0x43, 0xf0, 0xb1,
+    0xfc, 0x07, 0x7a, 0x0f, 0x6a, 0x24, 0x76, 0x58, 0x12, 0x33, 0x8d, 0xf1,
+    0x74, 0x45, 0x4f, 0x23, 0x41, 0x02, 0x81, 0x81, 0x00, 0xe9, 0xbc, 0xf4,
+    0x5f, 0x9e, 0x2d, 0x3e, 0x86, 0x5c, 0x9b, 0x69, 0x41, 0x3f, 0x16, 0xe3,
+    0xce, 0x63, 0x82, 0x73, 0xef, 0x92, 0x05, 0xde, 0x4e, 0x4c, 0x94, 0x78,
+    0x8c, 0xf2, 0xbb, 0xf5, 0x55, 0x44, 0xe8, 0x65, 0xae, 0x4e, 0x40, 0xe2,
+    0xda, 0xd9, 0x22, 0xe5, 0x80, 0x1f, 0xa3, 0xbe, 0xe2, 0xc1, 0xf5, 0x0d,
+    0x6a, 0xb1, 0x86, 0x19, 0xc2, 0xf3, 0xc6, 0x50, 0x8c, 0xc2, 0x2f, 0xda,
+    0x1a, 0x8d, 0xde, 0xda, 0xf4, 0x06, 0xa8, 0x36, 0xba, 0x2e, 0x43, 0x7a,
+    0xc9, 0x03, 0x5e, 0x15, 0xaf, 0xa3, 0xe6, 0x63, 0xda, 0xa2, 0x47, 0x49,
+    0x9f, 0x3e, 0xd8, 0x95, 0xdd, 0x91, 0x2e, 0x92, 0xa1, 0x36, 0xb9, 0x01,
+    0x99, 0x28, 0xe2, 0x5b, 0xfe, 0x9a, 0x10, 0x3b, 0x9e, 0x41, 0x2c, 0xda,
+    0x26, 0x3a, 0x1a, 0x70, 0x3f, 0x82, 0xd5, 0x2a, 0xbf, 0xba, 0x65, 0x9e,
+    0xd2, 0xfe, 0x5f, 0xed, 0xbb, 0x02, 0x81, 0x81, 0x00, 0xc0, 0x3f, 0xcf,
+    0xdf, 0x2a, 0x7a, 0x38, 0x3a, 0x1f, 0xe5, 0x5f, 0x3e, 0xe2, 0x72, 0x9c,
+    0x93, 0x02, 0xcf, 0xa3, 0x1c, 0xd7, 0x23, 0x1b, 0x3e, 0x8e, 0xac, 0x27,
+    0x94, 0x6b, 0xca, 0x36, 0x6d, 0x51, 0x55, 0x8a, 0x02, 0xa7, 0x41, 0x77,
+    0x76, 0x22, 0x55, 0x1b, 0x36, 0xd7, 0x36, 0xb1, 0xf1, 0xcf, 0x55, 0x21,
+    0x8a, 0x1c, 0xef, 0x0b, 0x89, 0xe7, 0x46, 0x1e, 0xff, 0x04, 0x56, 0x03,
+    0x69, 0x15, 0x0b, 0x43, 0xd8, 0x49, 0x27, 0x4e, 0x92, 0x82, 0x4a, 0x9b,
+    0x56, 0x36, 0x5d, 0x38, 0x48, 0xc9, 0x8f, 0x9f, 0x45, 0xf7, 0x21, 0xe2,
+    0x2c, 0x63, 0x1b, 0x29, 0x2d, 0xf2, 0xaf, 0x71, 0x90, 0x74, 0xec, 0x31,
+    0x8f, 0x4d, 0xc5, 0x40, 0x98, 0x5a, 0x8f, 0xb4, 0x25, 0xf9, 0x0b, 0x48,
+    0x6d, 0xc2, 0x24, 0x8b, 0x27, 0x00, 0xd1, 0xae, 0x79, 0xa0, 0x4b, 0x24,
+    0xa7, 0xb0, 0x20, 0xbc, 0x61, 0x02, 0x81, 0x80, 0x0e, 0x49, 0x94, 0x8e,
+    0x7b, 0xb6, 0xbc, 0x49, 0xae, 0x43, 0x79, 0xad, 0x99, 0x53, 0xa6, 0xdd,
+    0x28, 0xcc, 0x02, 0x96, 0x34, 0x50, 0xd3, 0x83, 0xe9, 0xbe, 0x71, 0x97,
+    0xfc, 0x06, 0x6d, 0x3a, 0xa7, 0x19, 0xa5, 0x8d, 0x80, 0x0f, 0x0b, 0x4e,
+    0xe1, 0x52, 0xf6, 0xc0, 0x5c, 0x2e, 0xc0, 0x2e, 0x50, 0x38, 0xd0, 0x77,
+    0x23, 0x1e, 0xd5, 0x58, 0x4b, 0x5a, 0x65, 0xf6, 0x14, 0xb0, 0xa4, 0x1e,
+    0x57, 0x69, 0xb5, 0xec, 0x90, 0xb3, 0x9b, 0x94, 0xc9, 0xdb, 0x2a, 0x18,
+    0x3b, 0x72, 0x76, 0xd4, 0xe3, 0xa9, 0xe3, 0x94, 0xab, 0xb2, 0xbb, 0xd7,
+    0x56, 0x1a, 0x1b, 0x1f, 0x0e, 0x0e, 0xd0, 0xbb, 0xb6, 0x02, 0x9d, 0x0c,
+    0x65, 0xa9, 0x60, 0x82, 0x31, 0x9c, 0xa8, 0x68, 0x46, 0x07, 0x9d, 0xd6,
+    0x14, 0x5b, 0x25, 0x5d, 0x5c, 0x7b, 0xf7, 0x3e, 0xfc, 0xff, 0xd5, 0x33,
+    0x84, 0x85, 0x0c, 0x9d, 0x02, 0x81, 0x80, 0x4c, 0xb5, 0xa9, 0x96, 0x1c,
+    0x76, 0xe4, 0x14, 0x9d, 0x41, 0x82, 0xbd, 0xae, 0xd1, 0x98, 0x94, 0x38,
+    0x5c, 0xed, 0x72, 0xc6, 0x8d, 0x25, 0x83, 0xd2, 0x9d, 0xf2, 0xb5, 0x10,
+    0x45, 0x81, 0x6e, 0x21, 0x34, 0x06, 0x7b, 0x84, 0x8d, 0x64, 0xc3, 0x68,
+    0x73, 0x99, 0x06, 0x4a, 0xdd, 0x72, 0x27, 0x50, 0x59, 0x61, 0xa6, 0xa0,
+    0x60, 0xe9, 0xb3, 0xbe, 0xea, 0x85, 0xd7, 0xaf, 0xbd, 0x3a, 0x63, 0x25,
+    0x98, 0x77, 0x1b, 0xc8, 0x24, 0xbc, 0xff, 0x4c, 0xa9, 0xc4, 0x4d, 0xa4,
+    0x27, 0x92, 0x1b, 0xc9, 0x01, 0x5b, 0xc6, 0x29, 0x14, 0x06, 0x11, 0x3c,
+    0x02, 0x4c, 0x6e, 0x1f, 0x15, 0xce, 0x34, 0x9b, 0xd2, 0xda, 0xfb, 0x99,
+    0x46, 0x89, 0xbd, 0xc0, 0xf4, 0xf2, 0x26, 0xec, 0xb6, 0x89, 0xd1, 0xf1,
+    0xd3, 0x6f, 0x0a, 0xc3, 0x12, 0xe7, 0x91, 0x74, 0x5a, 0x47, 0x67, 0xf9,
+    0xa9, 0x36, 0x41, 0x02, 0x81, 0x80, 0x6f, 0xe5, 0x6d, 0x37, 0xb7, 0x9a,
+    0x55, 0x3d, 0x3a, 0x7d, 0xcf, 0xda, 0x0a, 0x3f, 0xab, 0x66, 0x89, 0x77,
+    0xb0, 0x20, 0x42, 0xc5, 0x1f, 0xb4, 0x7a, 0xf5, 0x5e, 0xa6, 0xda, 0xbc,
+    0xb6, 0xbc, 0xea, 0xd9, 0xb5, 0xd9, 0x14, 0xdc, 0x7f, 0x23, 0xf4, 0xd5,
+    0x93, 0x28, 0x96, 0xbc, 0x65, 0xba, 0x42, 0x2a, 0x18, 0x89, 0x45, 0xda,
+    0x7c, 0x81, 0x89, 0x24, 0xc1, 0xc8, 0x58, 0x3b, 0x7b, 0x8b, 0x1e, 0x71,
+    0xc8, 0x91, 0xc0, 0x47, 0x16, 0x27, 0xcc, 0xcd, 0xca, 0x90, 0x4a, 0x8a,
+    0x43, 0x34, 0x93, 0xda, 0x19, 0x3f, 0x00, 0xdc, 0x5e, 0x01, 0xa3, 0xb3,
+    0x3b, 0xc8, 0xc3, 0x07, 0x61, 0xa0, 0xc9, 0xf7, 0x67, 0x76, 0x97, 0xcb,
+    0x6d, 0x23, 0x3f, 0x1e, 0xf8, 0x71, 0x00, 0x83, 0x8e, 0xb3, 0x28, 0x6a,
+    0x70, 0xb8, 0x1c, 0xb9, 0x13, 0x0f, 0x14, 0x63, 0xe8, 0x37, 0xbf, 0xa5,
+    0x7b, 0x3a
+};
+const uint32_t client_private_key_der_len = sizeof(client_private_key_der);
+#endif
+
+#if (ROOT_CA_CERTIFICATE)
+/* DER-encoded Root CA certificate (server_code/Mosquitto/ca.crt) */
+MQTT_CREDENTIALS_SECTION const uint8_t root_ca_certificate_der[] =
+{
+    0x30, 0x82, 0x03, 0xfb, 0x30, 0x82, 0x02, 0xe3, 0xa0, 0x03, 0x02, 0x01,
+    0x02, 0x02, 0x14, 0x43, 0xdd, 0x97, 0xe8, 0xb3, 0xd3, 0xd7, 0xef, 0xfc,
+    0x59, 0xb6, 0xf5, 0x88, 0x5d, 0xc4, 0xae, 0xe7, 0xe8, 0xc6, 0xeb, 0x30,
+    0x0d, 0x06, 0x09, 0x2a, 0x86, 0x48, 0x86, 0xf7, 0x0d, 0x01, 0x01, 0x0b,
+    0x05, 0x00, 0x30, 0x81, 0x8c, 0x31, 0x0b, 0x30, 0x09, 0x06, 0x03, 0x55,
+    0x04, 0x06, 0x13, 0x02, 0x42, 0x45, 0x31, 0x10, 0x30, 0x0e, 0x06, 0x03,
+    0x55, 0x04, 0x08, 0x0c, 0x07, 0x4c, 0x69, 0x6d, 0x62, 0x75, 0x72, 0x67,
+    0x31, 0x10, 0x30, 0x0e, 0x06, 0x03, 0x55, 0x04, 0x07, 0x0c, 0x07, 0x48,
+    0x61, 0x73, 0x73, 0x65, 0x6c, 0x74, 0x31, 0x11, 0x30, 0x0f, 0x06, 0x03,
+    0x55, 0x04, 0x0a, 0x0c, 0x08, 0x6d, 0x61, 0x73, 0x73, 0x69, 0x6d, 0x6f,
+    0x67, 0x31, 0x0c, 0x30, 0x0a, 0x06, 0x03, 0x55, 0x04, 0x0b, 0x0c, 0x03,
+    0x69, 0x6f, 0x74, 0x31, 0x15, 0x30, 0x13, 0x06, 0x03, 0x55, 0x04, 0x03,
+    0x0c, 0x0c, 0x6d, 0x61, 0x73, 0x73, 0x69, 0x6d, 0x6f, 0x67, 0x2e, 0x6e,
+    0x65, 0x74, 0x31, 0x21, 0x30, 0x1f, 0x06, 0x09, 0x2a, 0x86, 0x48, 0x86,
+    0xf7, 0x0d, 0x01, 0x09, 0x01, 0x16, 0x12, 0x61, 0x64, 0x6d, 0x69, 0x6e,
+    0x40, 0x6d, 0x61, 0x73, 0x73, 0x69, 0x6d, 0x6f, 0x67, 0x2e, 0x6e, 0x65,
+    0x74, 0x30, 0x1e, 0x17, 0x0d, 0x32, 0x32, 0x31, 0x32, 0x33, 0x31, 0x31,
+    0x30, 0x32, 0x36, 0x32, 0x32, 0x5a, 0x17, 0x0d, 0x32, 0x37, 0x31, 0x32,
+    0x33, 0x31, 0x31, 0x30, 0x32, 0x36, 0x32, 0x32, 0x5a, 0x30, 0x81, 0x8c,
+    0x31, 0x0b, 0x30, 0x09, 0x06, 0x03, 0x55, 0x04, 0x06, 0x13, 0x02, 0x42,
+    0x45, 0x31, 0x10, 0x30, 0x0e, 0x06, 0x03, 0x55, 0x04, 0x08, 0x0c, 0x07,
+    0x4c, 0x69, 0x6d, 0x62, 0x75, 0x72, 0x67, 0x31, 0x10, 0x30, 0x0e, 0x06,
+    0x03, 0x55, 0x04, 0x07, 0x0c, 0x07, 0x48, 0x61, 0x73, 0x73, 0x65, 0x6c,
+    0x74, 0x31, 0x11, 0x30, 0x0f, 0x06, 0x03, 0x55, 0x04, 0x0a, 0x0c, 0x08,
+    0x6d, 0x61, 0x73, 0x73, 0x69, 0x6d, 0x6f, 0x67, 0x31, 0x0c, 0x30, 0x0a,
+    0x06, 0x03, 0x55, 0x04, 0x0b, 0x0c, 0x03, 0x69, 0x6f, 0x74, 0x31, 0x15,
+    0x30, 0x13, 0x06, 0x03, 0x55, 0x04, 0x03, 0x0c, 0x0c, 0x6d, 0x61, 0x73,
+    0x73, 0x69, 0x6d, 0x6f, 0x67, 0x2e, 0x6e, 0x65, 0x74, 0x31, 0x21, 0x30,
+    0x1f, 0x06, 0x09, 0x2a, 0x86, 0x48, 0x86, 0xf7, 0x0d, 0x01, 0x09, 0x01,
+    0x16, 0x12, 0x61, 0x64, 0x6d, 0x69, 0x6e, 0x40, 0x6d, 0x61, 0x73, 0x73,
+    0x69, 0x6d, 0x6f, 0x67, 0x2e, 0x6e, 0x65, 0x74, 0x30, 0x82, 0x01, 0x22,
+    0x30, 0x0d, 0x06, 0x09, 0x2a, 0x86, 0x48, 0x86, 0xf7, 0x0d, 0x01, 0x01,
+    0x01, 0x05, 0x00, 0x03, 0x82, 0x01, 0x0f, 0x00, 0x30, 0x82, 0x01, 0x0a,
+    0x02, 0x82, 0x01, 0x01, 0x00, 0xab, 0xaa, 0x90, 0xfc, 0x08, 0xc4, 0xe5,
+    0x86, 0xcb, 0x5e, 0x39, 0x0b, 0x6a, 0x3b, 0x65, 0x31, 0xd4, 0x66, 0x95,
+    0x84, 0x58, 0xe8, 0x10, 0xfb, 0xb5, 0xdc, 0xf6, 0x1b, 0x3d, 0xac, 0xef,
+    0x09, 0xeb, 0x2a, 0xf1, 0x3d, 0x2d, 0xa2, 0xce, 0xb9, 0x6d, 0xaa, 0xbc,
+    0x7d, 0x53, 0xdf, 0xec, 0xbf, 0x40, 0x45, 0x01, 0x9a, 0x0a, 0xdd, 0x13,
+    0x86, 0x09, 0xb9, 0x61, 0x93, 0xa1, 0x30, 0xd1, 0x19, 0x0b, 0xc8, 0x86,
+    0x8a, 0x7d, 0xe8, 0x31, 0x71, 0x40, 0x53, 0xed, 0xb2, 0x80, 0x28, 0x84,
+    0x5e, 0xe8, 0x3b, 0xed, 0xaa, 0x89, 0xbb, 0x4a, 0x64, 0xaf, 0xd5, 0xb4,
+    0xbf, 0x49, 0x3a, 0xbf, 0x8f, 0xd8, 0xa2, 0xdb, 0xd4, 0x7e, 0x15, 0x23,
+    0xa3, 0x19, 0xf2, 0xf0, 0x53, 0x1c, 0x63, 0xa0, 0x8b, 0x50, 0x94, 0x51,
+    0x3a, 0xe4, 0x2b, 0x36, 0x1d, 0x0d, 0x33, 0xa9, 0x02, 0xd4, 0x3d, 0x73,
+    0xb5, 0xef, 0x2e, 0x52, 0xf4, 0xb3, 0xde, 0x36, 0x14, 0xa1, 0x3b, 0x11,
+    0xfb, 0xc7, 0xa1, 0x3d, 0xd5, 0x62, 0x50, 0x90, 0x2c, 0xa5, 0xde, 0x03,
+    0xdb, 0x79, 0x6d, 0x02, 0xf4, 0x54, 0xc2, 0x90, 0xcc, 0x43, 0x52, 0xa7,
+    0x0c, 0xe4, 0x81, 0x83, 0x90, 0x7e, 0x25, 0x2b, 0x5f, 0x3f, 0x31, 0x03,
+    0x5c, 0x38, 0x1a, 0x04, 0xab, 0xf3, 0x47, 0x52, 0xe3, 0xe0, 0xfa, 0xe8,
+    0x0b, 0x69, 0x38, 0x4d, 0xd9, 0xb7, 0x02, 0x21, 0x48, 0x32, 0xf6, 0x49,
+    0xf5, 0x11, 0x49, 0xfb, 0x22, 0x1a, 0x14, 0x25, 0x24, 0xac, 0xc7, 0xc4,
+    0x2c, 0x57, 0xeb, 0x4d, 0xa6, 0xaf, 0x23, 0x27, 0x00, 0x82, 0x38, 0xbf,
+    0xcc, 0x22, 0xd3, 0xd7, 0x79, 0xc7, 0x5c, 0x16, 0xb2, 0x97, 0xd6, 0xb6,
+    0x49, 0x3a, 0xc5, 0x45, 0x0a, 0x21, 0xb0, 0x05, 0x82, 0xa2, 0x13, 0xf6,
+    0x84, 0x83, 0xf5, 0xd2, 0x84, 0x85, 0x03, 0x68, 0x6b, 0x02, 0x03, 0x01,
+    0x00, 0x01, 0xa3, 0x53, 0x30, 0x51, 0x30, 0x1d, 0x06, 0x03, 0x55, 0x1d,
+    0x0e, 0x04, 0x16, 0x04, 0x14, 0x75, 0x4c, 0x4e, 0x53, 0xe0, 0x7e, 0xe5,
+    0x55, 0x60, 0xc3, 0xe7, 0x9c, 0x5b, 0x14, 0x78, 0x51, 0x8f, 0xe1, 0x06,
+    0x17, 0x30, 0x1f, 0x06, 0x03, 0x55, 0x1d, 0x23, 0x04, 0x18, 0x30, 0x16,
+    0x80, 0x14, 0x75, 0x4c, 0x4e, 0x53, 0xe0, 0x7e, 0xe5, 0x55, 0x60, 0xc3,
+    0xe7, 0x9c, 0x5b, 0x14, 0x78, 0x51, 0x8f, 0xe1, 0x06, 0x17, 0x30, 0x0f,
+    0x06, 0x03, 0x55, 0x1d, 0x13, 0x01, 0x01, 0xff, 0x04, 0x05, 0x30, 0x03,
+    0x01, 0x01, 0xff, 0x30, 0x0d, 0x06, 0x09, 0x2a, 0x86, 0x48, 0x86, 0xf7,
+    0x0d, 0x01, 0x01, 0x0b, 0x05, 0x00, 0x03, 0x82, 0x01, 0x01, 0x00, 0x88,
+    0xc7, 0xce, 0xa4, 0x98, 0x39, 0x54, 0xc3, 0xab, 0x10, 0xf3, 0x79, 0x18,
+    0xad, 0xbe, 0x8e, 0x22, 0xf8, 0x31, 0xd8, 0xde, 0xc7, 0xd9, 0xab, 0xb6,
+    0x33, 0x70, 0x63, 0xf5, 0xde, 0xdd, 0xb4, 0x8d, 0xd5, 0xd0, 0x90, 0x68,
+    0x55, 0x7a, 0x4f, 0x2c, 0x27, 0xe4, 0x90, 0xb7, 0xf2, 0x9d, 0x99, 0x9f,
+    0x9e, 0x05, 0x16, 0xf5, 0xc1, 0xe7, 0x7b, 0xfb, 0x65, 0x3b, 0x8f, 0xa6,
+    0xe2, 0xef, 0x9a, 0x8c, 0xb3, 0x28, 0xfa, 0x92, 0x69, 0x37, 0xc7, 0xe4,
+    0x0a, 0x9a, 0x2d, 0x1b, 0x5b, 0x9a, 0xf4, 0x87, 0xd5, 0xf1, 0xaa, 0x53,
+    0x19, 0x2f, 0x16, 0x0d, 0x65, 0x72, 0x30, 0x44, 0x5c, 0xec, 0xe8, 0xd8,
+    0x97, 0x42, 0xd2, 0x0c, 0xf5, 0xc5, 0x4c, 0xf9, 0x44, 0xab, 0x48, 0x59,
+    0x5f, 0xbb, 0x6b, 0xfc, 0x19, 0xec, 0x99, 0x62, 0x2e, 0xd2, 0xf6, 0x35,
+    0xe5, 0x90, 0x4b, 0x0d, 0x1a, 0x9c, 0x44, 0x39, 0x9b, 0xdd, 0x36, 0x31,
+    0x05, 0x29, 0x38, 0x9a, 0x5e, 0x70, 0x10, 0x5f, 0xd1, 0xbe, 0xd3, 0x18,
+    0x9e, 0x20, 0x55, 0x50, 0xab, 0xbb, 0x2e, 0xc7, 0x7a, 0xb1, 0xd4, 0x64,
+    0x2f, 0x54, 0x7f, 0xfd, 0x86, 0x4d, 0x8a, 0x04, 0x02, 0xaa, 0x66, 0x8d,
+    0x9b, 0x51, 0xb1, 0x5e, 0x98, 0x98, 0x9b, 0x98, 0xea, 0xe8, 0x59, 0x4a,
+    0x4f, 0xf4, 0xfc, 0x86, 0x1a, 0x6a, 0xbf, 0x1f, 0x97, 0x2c, 0x6f, 0x73,
+    0xda, 0x81, 0x8c, 0x9c, 0x6c, 0x07, 0x40, 0xd6, 0x4d, 0xad, 0x3b, 0x54,
+    0xda, 0x2d, 0x3b, 0xcf, 0xd2, 0x0c, 0xd9, 0xd1, 0xe1, 0xf6, 0x95, 0x8e,
+    0x23, 0xfb, 0x5c, 0xbb, 0x23, 0x1b, 0xd7, 0x6b, 0x35, 0x2f, 0x2f, 0x59,
+    0xea, 0x18, 0xad, 0x0c, 0x45, 0xd7, 0xc0, 0xbc, 0x36, 0xdc, 0xda, 0xe7,
+    0xd4, 0x20, 0xaa, 0x29, 0xde, 0x45, 0xe9, 0x28, 0x71, 0x6e, 0x46, 0xb8,
+    0xa7, 0x4e, 0x2f
+};
+const uint32_t root_ca_certificate_der_len = sizeof(root_ca_certificate_der);
+#endif
+
 /* MQTT client credentials to be used in case of a secure connection. */
 static cy_awsport_ssl_credentials_t credentials =
 {
     /* Configure the client certificate. */
-#ifdef CLIENT_CERTIFICATE
-    .client_cert = (const char *)CLIENT_CERTIFICATE,
-    .client_cert_size = sizeof(CLIENT_CERTIFICATE),
+#if (CLIENT_CERTIFICATE)
+    .client_cert = (const char *)client_certificate_der,
+    .client_cert_size = sizeof(client_certificate_der),
 #else
     .client_cert = NULL,
     .client_cert_size = 0,
 #endif
 
     /* Configure the client private key. */
-#ifdef CLIENT_PRIVATE_KEY
-    .private_key = (const char *)CLIENT_PRIVATE_KEY,
-    .private_key_size = sizeof(CLIENT_PRIVATE_KEY),
+#if (CLIENT_PRIVATE_KEY)
+    .private_key = (const char *)client_private_key_der,
+    .private_key_size = sizeof(client_private_key_der),
 #else
     .private_key = NULL,
     .private_key_size = 0,
 #endif
 
-    /* Configure the Root CA certificate of the MQTT Broker/Server. */
-#ifdef ROOT_CA_CERTIFICATE
-    .root_ca = (const char *)ROOT_CA_CERTIFICATE,
-    .root_ca_size = sizeof(ROOT_CA_CERTIFICATE),
-#else
+    /* The Root CA certificate of the MQTT Broker/Server is not passed per
+     * connection. mqtt_init() parses it once into the global TLS trust chain,
+     * which the TLS layer falls back to when a socket has no Root CA of its
+     * own.
+     */
     .root_ca = NULL,
     .root_ca_size = 0,
-#endif
 
     /* Application Layer Protocol Negotiation (ALPN) is used to implement 
      * MQTT with TLS Client Authentication from client devices.
@@ -124,16 +438,36 @@ cy_awsport_ssl_credentials_t *security_info = NULL;
  */
 static cy_mqtt_publish_info_t will_msg_info =
 {
-    .qos = CY_MQTT_QOS2,
+    .qos = CY_MQTT_QOS1,
     .topic = MQTT_WILL_TOPIC_NAME,
     .topic_len = (uint16_t)(sizeof(MQTT_WILL_TOPIC_NAME) - 1),
     .payload = MQTT_WILL_MESSAGE,
     .payload_len = (size_t)(sizeof(MQTT_WILL_MESSAGE) - 1),
-    .retain = false,
+    /* Retained, so it replaces the retained "online" status. */
+    .retain = true,
     .dup = false
 };
 #endif /* ENABLE_LWT_MESSAGE */
 
+/* Topic, QoS and retain policy of each message class. The payload is set per
+ * message by the publisher.
+ */
+#define MQTT_MESSAGE_CLASS(topic_name, qos_level, retained) \
+    { .qos = (qos_level), .topic = (topic_name), \
+      .topic_len = (uint16_t)(sizeof(topic_name) - 1), .retain = (retained), \
+      .dup = false }
+
+const cy_mqtt_publish_info_t mqtt_message_classes[MQTT_CLASS_COUNT] =
+{
+    [MQTT_CLASS_STATE]     = MQTT_MESSAGE_CLASS(MQTT_STATE_TOPIC, CY_MQTT_QOS1, true),
+    [MQTT_CLASS_EVENT]     = MQTT_MESSAGE_CLASS(MQTT_EVENT_TOPIC, CY_MQTT_QOS1, false),
+    [MQTT_CLASS_TELEMETRY] = MQTT_MESSAGE_CLASS(MQTT_TELEMETRY_TOPIC, CY_MQTT_QOS0, false),
+    [MQTT_CLASS_DIAG]      = MQTT_MESSAGE_CLASS(MQTT_DIAG_TOPIC, CY_MQTT_QOS0, false),
+    [MQTT_CLASS_STATUS]    = MQTT_MESSAGE_CLASS(MQTT_STATUS_TOPIC, CY_MQTT_QOS1, true),
+    [MQTT_CLASS_TRACE]     = MQTT_MESSAGE_CLASS(MQTT_TRACE_TOPIC, CY_MQTT_QOS1, false),
+    [MQTT_CLASS_RECORD]    = MQTT_MESSAGE_CLASS(MQTT_RECORD_TOPIC, CY_MQTT_QOS1, false)
+};
+
 /* MQTT connection information structure */
 cy_mqtt_connect_info_t connection_info =
 {
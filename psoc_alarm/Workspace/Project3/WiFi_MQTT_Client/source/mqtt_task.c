@@ -7,8 +7,18 @@
 #include "task.h"
 
 /* Task header files */
+#include "coroutine.h"
+#include "link_monitor.h"
+#include "log.h"
 #include "mqtt_task.h"
+#include "net_cache.h"
+#include "probe.h"
+#include "publish_policy.h"
+#include "publisher.h"
+#include "recorder.h"
 #include "state.h"
+#include "sys_stats.h"
+#include "tls_memory.h"
 
 /* Configuration file for Wi-Fi and MQTT client */
 #include "mqtt_client_config.h"
@@ -20,29 +30,37 @@
 
 #include "clock.h"
 #include "cy_mqtt_api.h"
+#include "cy_tls.h"
 
 /* LwIP header files */
+#include "lwip/dns.h"
 #include "lwip/netif.h"
+#include "lwip/tcp.h"
+#include "lwip/tcpip.h"
 
 /******************************************************************************
  * Macros
  ******************************************************************************/
-/* Queue length of a message queue that is used to communicate the status of
- * various operations.
- */
-#define MQTT_TASK_QUEUE_LENGTH (3u)
-
 /* Time in milliseconds to wait before creating the publisher task. */
 #define TASK_CREATION_DELAY_MS (2000u)
 
+/* Maximum number of retries for MQTT subscribe operation */
+#define MAX_SUBSCRIBE_RETRIES (3u)
+
+/* Time interval in milliseconds between MQTT subscribe retries. */
+#define MQTT_SUBSCRIBE_RETRY_INTERVAL_MS (1000)
+
+/* The number of MQTT topics to be subscribed to. */
+#define SUBSCRIPTION_COUNT (1)
+
 /* Flag Masks for tracking which cleanup functions must be called. */
 #define WCM_INITIALIZED (1lu << 0)
 #define WIFI_CONNECTED (1lu << 1)
 #define LIBS_INITIALIZED (1lu << 2)
-#define BUFFER_INITIALIZED (1lu << 3)
 #define MQTT_INSTANCE_CREATED (1lu << 4)
 #define MQTT_CONNECTION_SUCCESS (1lu << 5)
 #define MQTT_MSG_RECEIVED (1lu << 6)
+#define ROOT_CA_LOADED (1lu << 7)
 
 /* Macro to check if the result of an operation was successful and set the
  * corresponding bit in the status_flag based on 'init_mask' parameter. When
@@ -70,21 +88,130 @@ cy_mqtt_t mqtt_connection;
  * and callbacks.
  */
 QueueHandle_t mqtt_task_q;
+static StaticQueue_t mqtt_task_q_buffer;
+static uint8_t mqtt_task_q_storage[MQTT_TASK_QUEUE_LENGTH *
+                                   sizeof(mqtt_task_cmd_t)];
 
 /* Flag to denote initialization status of various operations. */
 uint32_t status_flag;
 
-/* Pointer to the network buffer needed by the MQTT library for MQTT send and
- * receive operations.
+/* Network buffer needed by the MQTT library for MQTT send and receive
+ * operations.
  */
-uint8_t *mqtt_network_buffer = NULL;
+static uint8_t mqtt_network_buffer[MQTT_NETWORK_BUFFER_SIZE];
+
+/* Configure the subscription information structure. */
+static cy_mqtt_subscribe_info_t subscribe_info = {
+    .qos = (cy_mqtt_qos_t)MQTT_MESSAGES_QOS,
+    .topic = MQTT_SUB_TOPIC,
+    .topic_len = (sizeof(MQTT_SUB_TOPIC) - 1)};
+
+/* State task, started once the MQTT connection is up. */
+static StackType_t state_task_stack[STATE_TASK_STACK_SIZE];
+static StaticTask_t state_task_tcb;
+
+/* Index of the broker in use in mqtt_brokers[], 0 is the primary broker. */
+static uint32_t broker_index;
+
+/* The connection manager and its steps are coroutines on the coroutine task
+ * (coroutine.h). Their variables are kept here across the waits; the steps
+ * run one at a time, so each has a single set. The Wi-Fi and MQTT calls that
+ * block run on the worker task, with CORO_BLOCKING().
+ */
+static struct {
+  coroutine_t co;
+  coroutine_t step;
+  mqtt_task_cmd_t command;
+  bool received;
+  /* Successful probes of the primary broker in a row. */
+  uint32_t failback_probes;
+  uint32_t start_ms;
+} client;
+
+static struct {
+  coroutine_t co;
+  cy_rslt_t result;
+  cy_wcm_connect_params_t connect_param;
+  cy_wcm_ip_setting_t ip_settings;
+  cy_wcm_ip_address_t ip_address;
+  bool fast_path;
+  uint32_t connect_start_ms;
+  uint32_t retry_count;
+} wifi;
+
+static struct {
+  coroutine_t co;
+  cy_rslt_t result;
+  uint32_t retry_count;
+  /* Failed connects to the current broker, and the start of the outage. */
+  uint32_t broker_failures;
+  uint32_t first_failure_ms;
+  uint32_t start_index;
+  uint32_t connect_start_ms;
+  bool broker_cached;
+  /* MQTT client identifier string. */
+  char client_identifier[(MQTT_CLIENT_IDENTIFIER_MAX_LEN + 1)];
+} connect;
+
+static struct {
+  coroutine_t co;
+  cy_rslt_t result;
+  uint32_t retry_count;
+} subscribe;
+
+/* Failback probe. The lookup and the connect run in the lwIP thread and end
+ * in its callbacks; the coroutine only waits for done. generation tells the
+ * callbacks of a probe that was given up on, and pcb is only used in the
+ * lwIP thread.
+ */
+static struct {
+  coroutine_t co;
+  const cy_mqtt_broker_info_t *broker;
+  struct tcp_pcb *pcb;
+  uintptr_t generation;
+  volatile bool done;
+  volatile bool reachable;
+} probe;
+
+/* Result of the last blocking call on the worker task. */
+static cy_rslt_t work_result;
+
+/* Host of the primary broker the MQTT instance was created with, the cached
+ * address or the configured hostname. See mqtt_connect_work().
+ */
+static char broker_host[NET_CACHE_HOST_LEN] = MQTT_BROKER_ADDRESS;
 
 /******************************************************************************
  * Function Prototypes
  *******************************************************************************/
-static cy_rslt_t wifi_connect(void);
+static coroutine_status_t mqtt_client_run(coroutine_t *co);
+static bool mqtt_task_receive(void);
+static coroutine_status_t wifi_connect(coroutine_t *co);
 static cy_rslt_t mqtt_init(void);
-static cy_rslt_t mqtt_connect(void);
+static cy_rslt_t mqtt_create_instance(void);
+static coroutine_status_t mqtt_connect(coroutine_t *co);
+static coroutine_status_t mqtt_subscribe(coroutine_t *co);
+static void mqtt_publish_status(bool online);
+static cy_rslt_t mqtt_select_broker(uint32_t index);
+static coroutine_status_t mqtt_probe_broker(coroutine_t *co);
+static void probe_start(void *arg);
+static void probe_dns_found(const char *name, const ip_addr_t *address,
+                            void *arg);
+static err_t probe_connected(void *arg, struct tcp_pcb *pcb, err_t err);
+static void probe_error(void *arg, err_t err);
+static void probe_cancel(void *arg);
+static void probe_finish(bool reachable);
+static void mqtt_reinit_state(void);
+static void wcm_init_work(void *arg);
+static void mqtt_init_work(void *arg);
+static void wifi_join_work(void *arg);
+static void wifi_leave_work(void *arg);
+static void mqtt_connect_work(void *arg);
+static void mqtt_select_work(void *arg);
+static void mqtt_subscribe_work(void *arg);
+static void mqtt_disconnect_work(void *arg);
+static void mqtt_offline_work(void *arg);
+static void cleanup_work(void *arg);
 
 void mqtt_event_callback(cy_mqtt_t mqtt_handle, cy_mqtt_event_t event,
                          void *user_data);
@@ -96,40 +223,60 @@ mqtt_get_unique_client_identifier(char *mqtt_client_identifier);
 #endif /* GENERATE_UNIQUE_CLIENT_ID */
 
 /******************************************************************************
- * Function Name: mqtt_client_task
+ * Function Name: mqtt_task_start
  ******************************************************************************
  * Summary:
- *  Task for handling initialization & connection of Wi-Fi and the MQTT client.
- *  The task also creates and manages the subscriber and publisher tasks upon
- *  successful MQTT connection. The task also handles the WiFi and MQTT
+ *  Creates the command queue and starts the connection manager on the
+ *  coroutine task. Called from main() before the scheduler starts.
+ *
+ ******************************************************************************/
+void mqtt_task_start(void) {
+  /* Create a message queue to communicate with other tasks and callbacks. */
+  mqtt_task_q =
+      xQueueCreateStatic(MQTT_TASK_QUEUE_LENGTH, sizeof(mqtt_task_cmd_t),
+                         mqtt_task_q_storage, &mqtt_task_q_buffer);
+  vQueueAddToRegistry(mqtt_task_q, "MQTT task");
+
+  coroutine_start(&client.co, mqtt_client_run);
+}
+
+/******************************************************************************
+ * Function Name: mqtt_client_run
+ ******************************************************************************
+ * Summary:
+ *  Connection manager, a coroutine: initialization & connection of Wi-Fi and
+ *  the MQTT client. It also starts the state task and the housekeeping
+ *  coroutines upon successful MQTT connection, and handles the WiFi and MQTT
  *  connections by initiating reconnection on the event of disconnections.
  *
  * Parameters:
- *  void *pvParameters : Task parameter defined during task creation (unused)
+ *  coroutine_t *co : State of the coroutine
  *
  * Return:
- *  void
+ *  coroutine_status_t : COROUTINE_DONE once the client has given up
  *
  ******************************************************************************/
-void mqtt_client_task(void *pvParameters) {
-  /* Structures that store the data to be sent/received to/from various
-   * message queues.
-   */
-  mqtt_task_cmd_t mqtt_status;
+static coroutine_status_t mqtt_client_run(coroutine_t *co) {
+  CORO_BEGIN(co);
 
-  /* Configure the Wi-Fi interface as a Wi-Fi STA (i.e. Client). */
-  cy_wcm_config_t config = {.interface = CY_WCM_INTERFACE_TYPE_STA};
+  /* Serve all mbedTLS allocations from their own static arena. */
+  tls_memory_init();
 
-  /* To avoid compiler warnings */
-  (void)pvParameters;
+  /* Load the AP and broker hints of the previous connection. */
+  net_cache_init();
 
-  /* Create a message queue to communicate with other tasks and callbacks. */
-  mqtt_task_q = xQueueCreate(MQTT_TASK_QUEUE_LENGTH, sizeof(mqtt_task_cmd_t));
+  /* Start the publisher tasks, they wait for the MQTT connection. */
+  if ((CY_RSLT_SUCCESS != publisher_init()) ||
+      (CY_RSLT_SUCCESS != publish_policy_init())) {
+    printf("\nPublisher initialization failed!\n");
+    goto exit_cleanup;
+  }
 
   /* Initialize the Wi-Fi Connection Manager and jump to the cleanup block
    * upon failure.
    */
-  if (CY_RSLT_SUCCESS != cy_wcm_init(&config)) {
+  CORO_BLOCKING(co, wcm_init_work, NULL);
+  if (CY_RSLT_SUCCESS != work_result) {
     printf("\nWi-Fi Connection Manager initialization failed!\n");
     goto exit_cleanup;
   }
@@ -141,54 +288,119 @@ void mqtt_client_task(void *pvParameters) {
   printf("\nWi-Fi Connection Manager initialized.\n");
 
   /* Initiate connection to the Wi-Fi AP and cleanup if the operation fails. */
-  if (CY_RSLT_SUCCESS != wifi_connect()) {
+  CORO_SPAWN(co, &wifi.co, wifi_connect(&wifi.co));
+  if (CY_RSLT_SUCCESS != wifi.result) {
     goto exit_cleanup;
   }
 
   /* Set-up the MQTT client and connect to the MQTT broker. Jump to the
    * cleanup block if any of the operations fail.
    */
-  if ((CY_RSLT_SUCCESS != mqtt_init()) || (CY_RSLT_SUCCESS != mqtt_connect())) {
+  CORO_BLOCKING(co, mqtt_init_work, NULL);
+  if (CY_RSLT_SUCCESS != work_result) {
     goto exit_cleanup;
   }
-
-  /* Create MQTT subscriber/publisher task => STATE */
-  if (pdPASS != xTaskCreate(state_task, "State task", STATE_TASK_STACK_SIZE,
-                            NULL, STATE_TASK_PRIORITY, &state_task_handle)) {
-    printf("Failed to create Publisher task!\n");
+  CORO_SPAWN(co, &connect.co, mqtt_connect(&connect.co));
+  if (CY_RSLT_SUCCESS != connect.result) {
     goto exit_cleanup;
   }
+  printf("Boot to MQTT connected: %lu ms\n\n", (unsigned long)Clock_GetTimeMs());
+
+#if MQTT_PUBLISH_BENCH_COUNT
+  publisher_benchmark(MQTT_PUBLISH_BENCH_COUNT);
+#endif
+
+  /* Create MQTT subscriber/publisher task => STATE */
+  state_task_handle = xTaskCreateStatic(
+      state_task, "State task", STATE_TASK_STACK_SIZE, NULL,
+      STATE_TASK_PRIORITY, state_task_stack, &state_task_tcb);
+
+#if LINK_MONITOR_ENABLE
+  /* Watch the link quality and roam before the AP is lost. */
+  link_monitor_start();
+#endif /* LINK_MONITOR_ENABLE */
+
+#if (MQTT_DIAG_INTERVAL_MS > 0)
+  /* Publish the CPU share and free stack of every task. */
+  sys_stats_start();
+#endif
+
+  CORO_SPAWN(co, &subscribe.co, mqtt_subscribe(&subscribe.co));
 
   while (true) {
-    /* Wait for results of MQTT operations from other tasks and callbacks. */
-    if (pdTRUE == xQueueReceive(mqtt_task_q, &mqtt_status, portMAX_DELAY)) {
+    /* Wait for results of MQTT operations from other tasks and callbacks. On
+     * a secondary broker, wake up regularly to probe the primary one.
+     */
+    if (broker_index != 0) {
+      CORO_WAIT_UNTIL_FOR(co, mqtt_task_receive(),
+                          MQTT_BROKER_FAILBACK_CHECK_MS);
+    } else {
+      CORO_WAIT_UNTIL(co, mqtt_task_receive());
+    }
+
+    if (client.received) {
       /* In this code example, the disconnection from the MQTT Broker or
-       * the Wi-Fi network is handled by the case 'HANDLE_DISCONNECTION'.
+       * the Wi-Fi network is handled by the 'HANDLE_DISCONNECTION' branch.
        *
        * The publish and subscribe failures (`HANDLE_MQTT_PUBLISH_FAILURE`
        * and `HANDLE_MQTT_SUBSCRIBE_FAILURE`) does not initiate
        * reconnection in this example, but they can be handled as per the
-       * application requirement in the following swich cases.
+       * application requirement in the following branches. A switch
+       * statement cannot hold the waits of a coroutine.
        */
-      switch (mqtt_status) {
-      case HANDLE_MQTT_PUBLISH_FAILURE: {
+      if (client.command == HANDLE_MQTT_PUBLISH_FAILURE) {
         /* Handle Publish Failure here. */
         printf("Publish Failure!\n");
-        break;
-      }
-
-      case HANDLE_MQTT_SUBSCRIBE_FAILURE: {
+      } else if (client.command == HANDLE_MQTT_SUBSCRIBE_FAILURE) {
         /* Handle Subscribe Failure here. */
-        printf("Publish Failure!\n");
-        break;
-      }
+        printf("Subscribe Failure!\n");
+      } else if (client.command == HANDLE_ROAM) {
+        client.start_ms = Clock_GetTimeMs();
+
+        /* Leave the weak AP on purpose. wifi_connect() joins the BSSID the
+         * link monitor stored in the net cache, or scans if that fails.
+         */
+        publisher_pause();
+        CORO_BLOCKING(co, mqtt_disconnect_work, NULL);
+        status_flag &= ~(MQTT_CONNECTION_SUCCESS);
+        CORO_BLOCKING(co, wifi_leave_work, NULL);
+        status_flag &= ~(WIFI_CONNECTED);
+
+        CORO_SPAWN(co, &wifi.co, wifi_connect(&wifi.co));
+        if (CY_RSLT_SUCCESS != wifi.result) {
+          goto exit_cleanup;
+        }
+        CORO_SPAWN(co, &connect.co, mqtt_connect(&connect.co));
+        if (CY_RSLT_SUCCESS != connect.result) {
+          goto exit_cleanup;
+        }
+        link_monitor_roam_done(Clock_GetTimeMs() - client.start_ms);
+
+        CORO_SPAWN(co, &subscribe.co, mqtt_subscribe(&subscribe.co));
+        mqtt_reinit_state();
+      } else if ((client.command == HANDLE_LEASE_EXPIRY) ||
+                 (client.command == HANDLE_DISCONNECTION)) {
+        if (client.command == HANDLE_LEASE_EXPIRY) {
+          /* The reused DHCP lease is running low. Drop the association so
+           * the reconnection below goes through DHCP again.
+           */
+          printf("\nCached DHCP lease expiring, renewing through DHCP...\n");
+          net_cache_invalidate_lease();
+          publisher_pause();
+          status_flag &= ~(MQTT_CONNECTION_SUCCESS);
+          CORO_BLOCKING(co, wifi_leave_work, NULL);
+        }
+
+        client.start_ms = Clock_GetTimeMs();
 
-      case HANDLE_DISCONNECTION: {
         /* Although the connection with the MQTT Broker is lost,
          * call the MQTT disconnect API for cleanup of threads and
          * other resources before reconnection.
          */
-        cy_mqtt_disconnect(mqtt_connection);
+        CORO_BLOCKING(co, mqtt_disconnect_work, NULL);
+
+        /* Everything of the old TLS session must be released by now. */
+        tls_memory_report("after teardown");
 
         /* Check if Wi-Fi connection is active. If not, update the
          * status flag and initiate Wi-Fi reconnection.
@@ -196,113 +408,224 @@ void mqtt_client_task(void *pvParameters) {
         if (cy_wcm_is_connected_to_ap() == 0) {
           status_flag &= ~(WIFI_CONNECTED);
           printf("Initiating Wi-Fi Reconnection...\n");
-          if (CY_RSLT_SUCCESS != wifi_connect()) {
+          CORO_SPAWN(co, &wifi.co, wifi_connect(&wifi.co));
+          if (CY_RSLT_SUCCESS != wifi.result) {
             goto exit_cleanup;
           }
         }
 
         printf("Initiating MQTT Reconnection...\n");
-        if (CY_RSLT_SUCCESS != mqtt_connect()) {
+        CORO_SPAWN(co, &connect.co, mqtt_connect(&connect.co));
+        if (CY_RSLT_SUCCESS != connect.result) {
           goto exit_cleanup;
         }
 
-        /* Initiate MQTT subscribe post the reconnection. */
-        State newState;
-        newState.state = SEC_INIT;
-        if (xStateQueue != NULL)
-          xQueueSend(xStateQueue, &newState, portMAX_DELAY);
+        printf("Link flap to MQTT reconnected: %lu ms\n\n",
+               (unsigned long)(Clock_GetTimeMs() - client.start_ms));
+        publish_policy_record_reconnect();
 
-        break;
+        CORO_SPAWN(co, &subscribe.co, mqtt_subscribe(&subscribe.co));
+        mqtt_reinit_state();
+      }
+    } else if (broker_index != 0) {
+      /* Fail back once the primary broker answers again. */
+      probe.broker = &mqtt_brokers[0];
+      CORO_SPAWN(co, &probe.co, mqtt_probe_broker(&probe.co));
+      if (!probe.reachable) {
+        client.failback_probes = 0;
+        continue;
+      }
+      if (++client.failback_probes < MQTT_BROKER_FAILBACK_PROBES) {
+        continue;
       }
+      client.failback_probes = 0;
 
-      default:
-        break;
+      printf("\nPrimary MQTT broker reachable again, failing back...\n");
+      client.start_ms = Clock_GetTimeMs();
+
+      /* A clean disconnect does not trigger the LWT, so report offline. */
+      publisher_pause();
+      CORO_BLOCKING(co, mqtt_offline_work, NULL);
+      status_flag &= ~(MQTT_CONNECTION_SUCCESS);
+
+      CORO_BLOCKING(co, mqtt_select_work, (void *)(uintptr_t)0u);
+      if (CY_RSLT_SUCCESS != work_result) {
+        goto exit_cleanup;
       }
+      CORO_SPAWN(co, &connect.co, mqtt_connect(&connect.co));
+      if (CY_RSLT_SUCCESS != connect.result) {
+        goto exit_cleanup;
+      }
+      printf("MQTT broker failback took %lu ms\n\n",
+             (unsigned long)(Clock_GetTimeMs() - client.start_ms));
+      CORO_SPAWN(co, &subscribe.co, mqtt_subscribe(&subscribe.co));
+      mqtt_reinit_state();
     }
   }
 
-/* Cleanup section: Delete subscriber and publisher tasks and perform
- * cleanup for various operations based on the status_flag.
+/* Cleanup section: Delete the state task and perform cleanup for various
+ * operations based on the status_flag.
  */
 exit_cleanup:
   printf("\nTerminating MQTT tasks...\n");
   if (state_task_handle != NULL) {
     vTaskDelete(state_task_handle);
   }
-  cleanup();
-  printf("\nCleanup Done\nTerminating the MQTT task...\n\n");
-  vTaskDelete(NULL);
+  CORO_BLOCKING(co, cleanup_work, NULL);
+  printf("\nCleanup Done\nTerminating the MQTT client...\n\n");
+
+  CORO_END(co);
+}
+
+/* Takes the next command of mqtt_task_q, if any. */
+static bool mqtt_task_receive(void) {
+  client.received =
+      (xQueueReceive(mqtt_task_q, &client.command, 0) == pdTRUE);
+  return client.received;
+}
+
+/******************************************************************************
+ * Function Name: mqtt_task_send
+ ******************************************************************************
+ * Summary:
+ *  Sends a command to the connection manager and wakes it. Called from tasks
+ *  and callbacks, not interrupts.
+ *
+ * Parameters:
+ *  mqtt_task_cmd_t cmd     : Command
+ *  TickType_t ticks_to_wait : Time to wait for room in mqtt_task_q, 0 from
+ *                             the coroutine task itself
+ *
+ * Return:
+ *  BaseType_t : pdTRUE if the command was queued
+ *
+ ******************************************************************************/
+BaseType_t mqtt_task_send(mqtt_task_cmd_t cmd, TickType_t ticks_to_wait) {
+  BaseType_t queued;
+
+  recorder_value(RECORDER_MQTT_TASK, cmd);
+  queued = xQueueSend(mqtt_task_q, &cmd, ticks_to_wait);
+  coroutine_wake();
+  return queued;
+}
+
+/******************************************************************************
+ * Function Name: mqtt_task_request_reconnect
+ ******************************************************************************
+ * Summary:
+ *  Makes the connection manager tear the MQTT connection down and connect
+ *  again, TLS handshake included, as after an unexpected disconnection. Used
+ *  by the stack profile.
+ *
+ ******************************************************************************/
+void mqtt_task_request_reconnect(void) {
+  status_flag &= ~(MQTT_CONNECTION_SUCCESS);
+  publisher_pause();
+  mqtt_task_send(HANDLE_DISCONNECTION, portMAX_DELAY);
 }
 
 /******************************************************************************
  * Function Name: wifi_connect
  ******************************************************************************
  * Summary:
- *  Function that initiates connection to the Wi-Fi Access Point using the
+ *  Coroutine that initiates connection to the Wi-Fi Access Point using the
  *  specified SSID and PASSWORD. The connection is retried a maximum of
  *  'MAX_WIFI_CONN_RETRIES' times with interval of 'WIFI_CONN_RETRY_INTERVAL_MS'
- *  milliseconds.
+ *  milliseconds. The first attempt uses the hints of the fast reconnect cache,
+ *  if any. When it fails, the hints are dropped and the connection falls back
+ *  to a full scan and DHCP.
  *
  * Parameters:
- *  void
+ *  coroutine_t *co : State of the coroutine, wifi.co
  *
  * Return:
- *  cy_rslt_t : CY_RSLT_SUCCESS upon a successful Wi-Fi connection, else an
- *              error code indicating the failure.
+ *  coroutine_status_t : COROUTINE_DONE with wifi.result CY_RSLT_SUCCESS upon
+ *                       a successful Wi-Fi connection, else an error code
+ *                       indicating the failure.
  *
  ******************************************************************************/
-static cy_rslt_t wifi_connect(void) {
-  cy_rslt_t result = CY_RSLT_SUCCESS;
-  cy_wcm_connect_params_t connect_param;
-  cy_wcm_ip_address_t ip_address;
+static coroutine_status_t wifi_connect(coroutine_t *co) {
+  CORO_BEGIN(co);
+
+  wifi.result = CY_RSLT_SUCCESS;
 
   /* Check if Wi-Fi connection is already established. */
-  if (cy_wcm_is_connected_to_ap() == 0) {
-    /* Configure the connection parameters for the Wi-Fi interface. */
-    memset(&connect_param, 0, sizeof(cy_wcm_connect_params_t));
-    memcpy(connect_param.ap_credentials.SSID, WIFI_SSID, sizeof(WIFI_SSID));
-    memcpy(connect_param.ap_credentials.password, WIFI_PASSWORD,
-           sizeof(WIFI_PASSWORD));
-    connect_param.ap_credentials.security = WIFI_SECURITY;
-
-    printf("\nConnecting to Wi-Fi AP '%s'\n\n",
-           connect_param.ap_credentials.SSID);
-
-    /* Connect to the Wi-Fi AP. */
-    for (uint32_t retry_count = 0; retry_count < MAX_WIFI_CONN_RETRIES;
-         retry_count++) {
-      result = cy_wcm_connect_ap(&connect_param, &ip_address);
-
-      if (result == CY_RSLT_SUCCESS) {
-        printf("\nSuccessfully connected to Wi-Fi network '%s'.\n",
-               connect_param.ap_credentials.SSID);
-
-        /* Set the appropriate bit in the status_flag to denote
-         * successful Wi-Fi connection, print the assigned IP address.
-         */
-        status_flag |= WIFI_CONNECTED;
-        if (ip_address.version == CY_WCM_IP_VER_V4) {
-          printf("IPv4 Address Assigned: %s\n\n",
-                 ip4addr_ntoa((const ip4_addr_t *)&ip_address.ip.v4));
-        } else if (ip_address.version == CY_WCM_IP_VER_V6) {
-          printf("IPv6 Address Assigned: %s\n\n",
-                 ip6addr_ntoa((const ip6_addr_t *)&ip_address.ip.v6));
-        }
-        return result;
+  if (cy_wcm_is_connected_to_ap() != 0) {
+    CORO_EXIT(co);
+  }
+
+  /* Configure the connection parameters for the Wi-Fi interface. */
+  memset(&wifi.connect_param, 0, sizeof(cy_wcm_connect_params_t));
+  memcpy(wifi.connect_param.ap_credentials.SSID, WIFI_SSID, sizeof(WIFI_SSID));
+  memcpy(wifi.connect_param.ap_credentials.password, WIFI_PASSWORD,
+         sizeof(WIFI_PASSWORD));
+  wifi.connect_param.ap_credentials.security = WIFI_SECURITY;
+
+  /* Join the cached AP directly, reusing its lease when still valid. */
+  wifi.fast_path =
+      net_cache_apply_ap_hints(&wifi.connect_param, &wifi.ip_settings);
+
+  printf("\nConnecting to Wi-Fi AP '%s'%s\n\n",
+         wifi.connect_param.ap_credentials.SSID,
+         wifi.fast_path ? " (cached AP)" : "");
+  wifi.connect_start_ms = Clock_GetTimeMs();
+
+  /* Connect to the Wi-Fi AP. */
+  for (wifi.retry_count = 0; wifi.retry_count < MAX_WIFI_CONN_RETRIES;
+       wifi.retry_count++) {
+    CORO_BLOCKING(co, wifi_join_work, NULL);
+    wifi.result = work_result;
+
+    if (wifi.result == CY_RSLT_SUCCESS) {
+      printf("\nSuccessfully connected to Wi-Fi network '%s' in %lu ms "
+             "(%s path%s).\n",
+             wifi.connect_param.ap_credentials.SSID,
+             (unsigned long)(Clock_GetTimeMs() - wifi.connect_start_ms),
+             wifi.fast_path ? "fast" : "slow",
+             (wifi.connect_param.static_ip_settings != NULL)
+                 ? ", cached lease"
+                 : "");
+      net_cache_store_ap();
+
+      /* Set the appropriate bit in the status_flag to denote
+       * successful Wi-Fi connection, print the assigned IP address.
+       */
+      status_flag |= WIFI_CONNECTED;
+      if (wifi.ip_address.version == CY_WCM_IP_VER_V4) {
+        printf("IPv4 Address Assigned: %s\n\n",
+               ip4addr_ntoa((const ip4_addr_t *)&wifi.ip_address.ip.v4));
+      } else if (wifi.ip_address.version == CY_WCM_IP_VER_V6) {
+        printf("IPv6 Address Assigned: %s\n\n",
+               ip6addr_ntoa((const ip6_addr_t *)&wifi.ip_address.ip.v6));
       }
+      CORO_EXIT(co);
+    }
 
-      printf("Connection to Wi-Fi network failed with error code 0x%0X. "
-             "Retrying in %d ms. Retries left: %d\n",
-             (int)result, WIFI_CONN_RETRY_INTERVAL_MS,
-             (int)(MAX_WIFI_CONN_RETRIES - retry_count - 1));
-      vTaskDelay(pdMS_TO_TICKS(WIFI_CONN_RETRY_INTERVAL_MS));
+    if (wifi.fast_path) {
+      /* The cached AP is gone or moved: retry right away with a scan. */
+      printf("Fast reconnect failed with error code 0x%0X, falling back to "
+             "a full scan.\n",
+             (int)wifi.result);
+      net_cache_invalidate_ap();
+      memset(wifi.connect_param.BSSID, 0, sizeof(wifi.connect_param.BSSID));
+      wifi.connect_param.band = CY_WCM_WIFI_BAND_ANY;
+      wifi.connect_param.static_ip_settings = NULL;
+      wifi.fast_path = false;
+      continue;
     }
 
-    printf("\nExceeded maximum Wi-Fi connection attempts!\n");
-    printf("Wi-Fi connection failed after retrying for %d mins\n\n",
-           (int)(WIFI_CONN_RETRY_INTERVAL_MS * MAX_WIFI_CONN_RETRIES) / 60000u);
+    printf("Connection to Wi-Fi network failed with error code 0x%0X. "
+           "Retrying in %d ms. Retries left: %d\n",
+           (int)wifi.result, WIFI_CONN_RETRY_INTERVAL_MS,
+           (int)(MAX_WIFI_CONN_RETRIES - wifi.retry_count - 1));
+    CORO_DELAY(co, WIFI_CONN_RETRY_INTERVAL_MS);
   }
-  return result;
+
+  printf("\nExceeded maximum Wi-Fi connection attempts!\n");
+  printf("Wi-Fi connection failed after retrying for %d mins\n\n",
+         (int)(WIFI_CONN_RETRY_INTERVAL_MS * MAX_WIFI_CONN_RETRIES) / 60000u);
+
+  CORO_END(co);
 }
 
 /******************************************************************************
@@ -310,8 +633,7 @@ static cy_rslt_t wifi_connect(void) {
  ******************************************************************************
  * Summary:
  *  Function that initializes the MQTT library and creates an instance for the
- *  MQTT client. The network buffer needed by the MQTT library for MQTT send
- *  send and receive operations is also allocated by this function.
+ *  MQTT client on the static network buffer.
  *
  * Parameters:
  *  void
@@ -330,24 +652,66 @@ static cy_rslt_t mqtt_init(void) {
   CHECK_RESULT(result, LIBS_INITIALIZED,
                "MQTT library initialization failed!\n\n");
 
-  /* Allocate buffer for MQTT send and receive operations. */
-  mqtt_network_buffer =
-      (uint8_t *)pvPortMalloc(sizeof(uint8_t) * MQTT_NETWORK_BUFFER_SIZE);
-  if (mqtt_network_buffer == NULL) {
-    result = ~CY_RSLT_SUCCESS;
+#if (MQTT_SECURE_CONNECTION) && (ROOT_CA_CERTIFICATE)
+  /* Parse the DER-encoded Root CA once into the global TLS trust chain. It is
+   * kept for the lifetime of the MQTT library and reused on every reconnect.
+   */
+  uint32_t parse_start_ms = Clock_GetTimeMs();
+  result = cy_tls_load_global_root_ca_certificates(
+      (const char *)root_ca_certificate_der, root_ca_certificate_der_len);
+  CHECK_RESULT(result, ROOT_CA_LOADED, "Root CA certificate parsing failed!\n\n");
+  printf("Root CA parsed once in %lu ms (DER credentials: cert %lu, key %lu, "
+         "CA %lu bytes).\n",
+         (unsigned long)(Clock_GetTimeMs() - parse_start_ms),
+#if (CLIENT_CERTIFICATE)
+         (unsigned long)client_certificate_der_len,
+#else
+         0ul,
+#endif
+#if (CLIENT_PRIVATE_KEY)
+         (unsigned long)client_private_key_der_len,
+#else
+         0ul,
+#endif
+         (unsigned long)root_ca_certificate_der_len);
+#endif
+
+  /* Create the MQTT client instance. The broker is resolved later, in
+   * mqtt_connect_work(), once Wi-Fi is up.
+   */
+  result = mqtt_create_instance();
+  if (result == CY_RSLT_SUCCESS) {
+    printf("MQTT library initialization successful.\n\n");
+  }
+  return result;
+}
+
+/******************************************************************************
+ * Function Name: mqtt_create_instance
+ ******************************************************************************
+ * Summary:
+ *  Creates the MQTT instance for broker_info, deleting the previous one. The
+ *  instance copies the broker details, the hostname length included, so this
+ *  is the only way to change them. Only while disconnected.
+ *
+ * Return:
+ *  cy_rslt_t : CY_RSLT_SUCCESS on success, else an error code
+ *
+ ******************************************************************************/
+static cy_rslt_t mqtt_create_instance(void) {
+  cy_rslt_t result;
+
+  if (status_flag & MQTT_INSTANCE_CREATED) {
+    cy_mqtt_delete(mqtt_connection);
+    status_flag &= ~(MQTT_INSTANCE_CREATED);
   }
-  CHECK_RESULT(result, BUFFER_INITIALIZED,
-               "Network Buffer allocation failed!\n\n");
 
-  /* Create the MQTT client instance. */
   result = cy_mqtt_create(mqtt_network_buffer, MQTT_NETWORK_BUFFER_SIZE,
                           security_info, &broker_info,
                           (cy_mqtt_callback_t)mqtt_event_callback, NULL,
                           &mqtt_connection);
   CHECK_RESULT(result, MQTT_INSTANCE_CREATED,
                "MQTT instance creation failed!\n\n");
-  printf("MQTT library initialization successful.\n\n");
-
   return result;
 }
 
@@ -355,25 +719,28 @@ static cy_rslt_t mqtt_init(void) {
  * Function Name: mqtt_connect
  ******************************************************************************
  * Summary:
- *  Function that initiates MQTT connect operation. The connection is retried
+ *  Coroutine that initiates MQTT connect operation. The connection is retried
  *  a maximum of 'MAX_MQTT_CONN_RETRIES' times with interval of
  *  'MQTT_CONN_RETRY_INTERVAL_MS' milliseconds.
  *
  * Parameters:
- *  void
+ *  coroutine_t *co : State of the coroutine, connect.co
  *
  * Return:
- *  cy_rslt_t : CY_RSLT_SUCCESS upon a successful MQTT connection, else an
- *              error code indicating the failure.
+ *  coroutine_status_t : COROUTINE_DONE with connect.result CY_RSLT_SUCCESS
+ *                       upon a successful MQTT connection, else an error
+ *                       code indicating the failure.
  *
  ******************************************************************************/
-static cy_rslt_t mqtt_connect(void) {
-  /* Variable to indicate status of various operations. */
-  cy_rslt_t result = CY_RSLT_SUCCESS;
+static coroutine_status_t mqtt_connect(coroutine_t *co) {
+  CORO_BEGIN(co);
 
-  /* MQTT client identifier string. */
-  char mqtt_client_identifier[(MQTT_CLIENT_IDENTIFIER_MAX_LEN + 1)] =
-      MQTT_CLIENT_IDENTIFIER;
+  connect.result = CY_RSLT_SUCCESS;
+  connect.broker_failures = 0;
+  connect.first_failure_ms = 0;
+  connect.start_index = broker_index;
+  memcpy(connect.client_identifier, MQTT_CLIENT_IDENTIFIER,
+         sizeof(MQTT_CLIENT_IDENTIFIER));
 
   /* Configure the user credentials as a part of MQTT Connect packet */
   if (strlen(MQTT_USERNAME) > 0) {
@@ -387,58 +754,142 @@ static cy_rslt_t mqtt_connect(void) {
    * as a prefix if the `GENERATE_UNIQUE_CLIENT_ID` macro is enabled.
    */
 #if GENERATE_UNIQUE_CLIENT_ID
-  result = mqtt_get_unique_client_identifier(mqtt_client_identifier);
-  CHECK_RESULT(
-      result, 0,
-      "Failed to generate unique client identifier for the MQTT client!\n");
+  connect.result = mqtt_get_unique_client_identifier(connect.client_identifier);
+  if (connect.result != CY_RSLT_SUCCESS) {
+    printf(
+        "Failed to generate unique client identifier for the MQTT client!\n");
+    CORO_EXIT(co);
+  }
 #endif /* GENERATE_UNIQUE_CLIENT_ID */
 
   /* Set the client identifier buffer and length. */
-  connection_info.client_id = mqtt_client_identifier;
-  connection_info.client_id_len = strlen(mqtt_client_identifier);
+  connection_info.client_id = connect.client_identifier;
+  connection_info.client_id_len = strlen(connect.client_identifier);
 
   printf("\nMQTT client '%.*s' connecting to MQTT broker '%.*s'...\n\n",
          connection_info.client_id_len, connection_info.client_id,
          broker_info.hostname_len, broker_info.hostname);
 
-  for (uint32_t retry_count = 0; retry_count < MAX_MQTT_CONN_RETRIES;
-       retry_count++) {
+  for (connect.retry_count = 0; connect.retry_count < MAX_MQTT_CONN_RETRIES;
+       connect.retry_count++) {
     if (cy_wcm_is_connected_to_ap() == 0) {
       printf("Unexpectedly disconnected from Wi-Fi network! Initiating Wi-Fi "
              "reconnection...\n");
       status_flag &= ~(WIFI_CONNECTED);
 
       /* Initiate Wi-Fi reconnection. */
-      result = wifi_connect();
-      if (CY_RSLT_SUCCESS != result) {
-        return result;
+      CORO_SPAWN(co, &wifi.co, wifi_connect(&wifi.co));
+      connect.result = wifi.result;
+      if (CY_RSLT_SUCCESS != connect.result) {
+        CORO_EXIT(co);
       }
     }
 
-    /* Establish the MQTT connection. */
-    result = cy_mqtt_connect(mqtt_connection, &connection_info);
-
-    if (result == CY_RSLT_SUCCESS) {
-      printf("\nMQTT connection successful.\n\n");
+    /* Establish the MQTT connection, lookup and handshake included. */
+    connect.connect_start_ms = Clock_GetTimeMs();
+    CORO_BLOCKING(co, mqtt_connect_work, NULL);
+    connect.result = work_result;
+
+    if (connect.result == CY_RSLT_SUCCESS) {
+      printf("\nMQTT connection successful in %lu ms.\n\n",
+             (unsigned long)(Clock_GetTimeMs() - connect.connect_start_ms));
+      /* Peak = handshake, current = steady state of the open session. */
+      tls_memory_report("connected");
+      if (broker_index != connect.start_index) {
+        printf("MQTT broker failover to '%.*s' took %lu ms.\n\n",
+               broker_info.hostname_len, broker_info.hostname,
+               (unsigned long)(Clock_GetTimeMs() - connect.first_failure_ms));
+      }
 
       /* Set the appropriate bit in the status_flag to denote successful
        * MQTT connection, and return the result to the calling function.
        */
       status_flag |= MQTT_CONNECTION_SUCCESS;
-      return result;
+      publisher_resume();
+      CORO_EXIT(co);
+    }
+
+    if (connect.broker_cached) {
+      /* The broker may have moved: resolve it again and retry right away. */
+      printf("MQTT connection to cached broker address %s failed, resolving "
+             "'%s' again.\n",
+             broker_info.hostname, MQTT_BROKER_ADDRESS);
+      net_cache_invalidate_broker();
+      continue;
+    }
+
+    if (connect.first_failure_ms == 0) {
+      connect.first_failure_ms = connect.connect_start_ms;
+    }
+
+    /* Move on to the next broker of the list after repeated failures. */
+    if ((mqtt_broker_count > 1) &&
+        (++connect.broker_failures >= MQTT_BROKER_FAILOVER_ATTEMPTS)) {
+      connect.broker_failures = 0;
+      CORO_BLOCKING(co, mqtt_select_work,
+                    (void *)(uintptr_t)((broker_index + 1) % mqtt_broker_count));
+      connect.result = work_result;
+      if (CY_RSLT_SUCCESS != connect.result) {
+        CORO_EXIT(co);
+      }
+      continue;
     }
 
     printf("MQTT connection failed with error code 0x%0X. Retrying in %d ms. "
            "Retries left: %d\n",
-           (int)result, MQTT_CONN_RETRY_INTERVAL_MS,
-           (int)(MAX_MQTT_CONN_RETRIES - retry_count - 1));
-    vTaskDelay(pdMS_TO_TICKS(MQTT_CONN_RETRY_INTERVAL_MS));
+           (int)connect.result, MQTT_CONN_RETRY_INTERVAL_MS,
+           (int)(MAX_MQTT_CONN_RETRIES - connect.retry_count - 1));
+    CORO_DELAY(co, MQTT_CONN_RETRY_INTERVAL_MS);
   }
 
   printf("\nExceeded maximum MQTT connection attempts\n");
   printf("MQTT connection failed after retrying for %d mins\n\n",
          (int)(MQTT_CONN_RETRY_INTERVAL_MS * MAX_MQTT_CONN_RETRIES) / 60000u);
-  return result;
+
+  CORO_END(co);
+}
+
+/******************************************************************************
+ * Function Name: mqtt_subscribe
+ ******************************************************************************
+ * Summary:
+ *  Coroutine that subscribes to MQTT_SUB_TOPIC after every connection. The
+ *  subscription is retried a maximum of 'MAX_SUBSCRIBE_RETRIES' times with
+ *  interval of 'MQTT_SUBSCRIBE_RETRY_INTERVAL_MS' milliseconds; a failure is
+ *  reported to the connection manager with HANDLE_MQTT_SUBSCRIBE_FAILURE.
+ *
+ * Parameters:
+ *  coroutine_t *co : State of the coroutine, subscribe.co
+ *
+ * Return:
+ *  coroutine_status_t : COROUTINE_DONE once subscribed or given up
+ *
+ ******************************************************************************/
+static coroutine_status_t mqtt_subscribe(coroutine_t *co) {
+  CORO_BEGIN(co);
+
+  /* Subscribe with the configured parameters. */
+  for (subscribe.retry_count = 0;
+       subscribe.retry_count < MAX_SUBSCRIBE_RETRIES;
+       subscribe.retry_count++) {
+    CORO_BLOCKING(co, mqtt_subscribe_work, NULL);
+    subscribe.result = work_result;
+    if (subscribe.result == CY_RSLT_SUCCESS) {
+      printf("MQTT client subscribed to the topic '%.*s' successfully.\n\n",
+             subscribe_info.topic_len, subscribe_info.topic);
+      CORO_EXIT(co);
+    }
+
+    CORO_DELAY(co, MQTT_SUBSCRIBE_RETRY_INTERVAL_MS);
+  }
+
+  printf("MQTT Subscribe failed with error 0x%0X after %d retries...\n\n",
+         (int)subscribe.result, MAX_SUBSCRIBE_RETRIES);
+
+  /* Notify the connection manager, which reads the queue itself. */
+  mqtt_task_send(HANDLE_MQTT_SUBSCRIBE_FAILURE, 0);
+
+  CORO_END(co);
 }
 
 /******************************************************************************
@@ -447,7 +898,7 @@ static cy_rslt_t mqtt_connect(void) {
  * Summary:
  *  Callback invoked by the MQTT library for events like MQTT disconnection,
  *  incoming MQTT subscription messages from the MQTT broker.
- *    1. In case of MQTT disconnection, the MQTT client task is communicated
+ *    1. In case of MQTT disconnection, the connection manager is communicated
  *       about the disconnection using a message queue.
  *    2. When an MQTT subscription message is received, the subscriber callback
  *       function implemented in subscriber_task.c is invoked to handle the
@@ -466,6 +917,8 @@ void mqtt_event_callback(cy_mqtt_t mqtt_handle, cy_mqtt_event_t event,
                          void *user_data) {
   cy_mqtt_publish_info_t *received_msg;
   mqtt_task_cmd_t mqtt_task_cmd;
+  uint32_t timing_start = log_timing_start();
+  PROBE_START(PROBE_MQTT_EVENT);
 
   (void)mqtt_handle;
   (void)user_data;
@@ -475,17 +928,21 @@ void mqtt_event_callback(cy_mqtt_t mqtt_handle, cy_mqtt_event_t event,
     /* Clear the status flag bit to indicate MQTT disconnection. */
     status_flag &= ~(MQTT_CONNECTION_SUCCESS);
 
+    /* Hold the messages in flight until the reconnection. */
+    publisher_pause();
+
     /* MQTT connection with the MQTT broker is broken as the client
      * is unable to communicate with the broker. Set the appropriate
      * command to be sent to the MQTT task.
      */
-    printf("\nUnexpectedly disconnected from MQTT broker!\n");
+    LOG(LOG_MODULE_MQTT, LOG_LEVEL_WARNING,
+        "\nUnexpectedly disconnected from MQTT broker!\n");
     mqtt_task_cmd = HANDLE_DISCONNECTION;
 
-    /* Send the message to the MQTT client task to handle the
+    /* Send the message to the connection manager to handle the
      * disconnection.
      */
-    xQueueSend(mqtt_task_q, &mqtt_task_cmd, portMAX_DELAY);
+    mqtt_task_send(mqtt_task_cmd, portMAX_DELAY);
     break;
   }
 
@@ -501,10 +958,295 @@ void mqtt_event_callback(cy_mqtt_t mqtt_handle, cy_mqtt_event_t event,
   }
   default: {
     /* Unknown MQTT event */
-    printf("\nUnknown Event received from MQTT callback!\n");
+    LOG(LOG_MODULE_MQTT, LOG_LEVEL_WARNING,
+        "\nUnknown Event received from MQTT callback!\n");
     break;
   }
   }
+
+  PROBE_STOP(PROBE_MQTT_EVENT);
+  log_timing_end(LOG_TIMING_MQTT_EVENT, timing_start);
+}
+
+/******************************************************************************
+ * Function Name: mqtt_select_broker
+ ******************************************************************************
+ * Summary:
+ *  Switches to another broker of mqtt_brokers[] while disconnected. The MQTT
+ *  instance copies the broker details when it is created, so it is created
+ *  again.
+ *
+ * Parameters:
+ *  uint32_t index : Index of the broker in mqtt_brokers[]
+ *
+ * Return:
+ *  cy_rslt_t : CY_RSLT_SUCCESS on success, else an error code
+ *
+ ******************************************************************************/
+static cy_rslt_t mqtt_select_broker(uint32_t index) {
+  if (index == broker_index) {
+    return CY_RSLT_SUCCESS;
+  }
+
+  broker_index = index;
+  broker_info = mqtt_brokers[index];
+  printf("\nSwitching to MQTT broker '%s' port %d\n", mqtt_brokers[index].hostname,
+         mqtt_brokers[index].port);
+
+  return mqtt_create_instance();
+}
+
+/******************************************************************************
+ * Function Name: mqtt_probe_broker
+ ******************************************************************************
+ * Summary:
+ *  Health check of a broker, a coroutine: resolves it and opens a plain TCP
+ *  connection to its port, without TLS or MQTT. Neither step blocks the
+ *  coroutine task, and the probe is given up on after
+ *  MQTT_BROKER_PROBE_TIMEOUT_MS. Sets probe.reachable.
+ *
+ * Parameters:
+ *  coroutine_t *co : State of the coroutine, probe.co
+ *
+ * Return:
+ *  coroutine_status_t : COROUTINE_DONE once the probe has ended
+ *
+ ******************************************************************************/
+static coroutine_status_t mqtt_probe_broker(coroutine_t *co) {
+  CORO_BEGIN(co);
+
+  probe.done = false;
+  probe.reachable = false;
+  if (tcpip_callback(probe_start, NULL) != ERR_OK) {
+    CORO_EXIT(co);
+  }
+
+  CORO_WAIT_UNTIL_FOR(co, probe.done, MQTT_BROKER_PROBE_TIMEOUT_MS);
+  if (!probe.done) {
+    (void)tcpip_callback(probe_cancel, NULL);
+  }
+
+  CORO_END(co);
+}
+
+/* Starts the lookup of probe.broker, in the lwIP thread. */
+static void probe_start(void *arg) {
+  ip_addr_t address;
+  err_t err;
+
+  (void)arg;
+  probe.generation++;
+  err = dns_gethostbyname(probe.broker->hostname, &address, probe_dns_found,
+                          (void *)probe.generation);
+  if (err == ERR_OK) {
+    probe_dns_found(probe.broker->hostname, &address,
+                    (void *)probe.generation);
+  } else if (err != ERR_INPROGRESS) {
+    probe_finish(false);
+  }
+}
+
+/* Connects to the resolved address, address is NULL if the lookup failed. */
+static void probe_dns_found(const char *name, const ip_addr_t *address,
+                            void *arg) {
+  (void)name;
+  if ((uintptr_t)arg != probe.generation) {
+    return;
+  }
+  if ((address == NULL) || ((probe.pcb = tcp_new()) == NULL)) {
+    probe_finish(false);
+    return;
+  }
+
+  tcp_arg(probe.pcb, arg);
+  tcp_err(probe.pcb, probe_error);
+  if (tcp_connect(probe.pcb, address, probe.broker->port, probe_connected) !=
+      ERR_OK) {
+    /* Closing a pcb that never connected frees it at once. */
+    tcp_close(probe.pcb);
+    probe.pcb = NULL;
+    probe_finish(false);
+  }
+}
+
+/* The broker accepted the connection, which is closed again. */
+static err_t probe_connected(void *arg, struct tcp_pcb *pcb, err_t err) {
+  (void)arg;
+  (void)err;
+  probe.pcb = NULL;
+  tcp_err(pcb, NULL);
+  probe_finish(true);
+  if (tcp_close(pcb) != ERR_OK) {
+    tcp_abort(pcb);
+    return ERR_ABRT;
+  }
+  return ERR_OK;
+}
+
+/* The connect failed, lwIP has freed the pcb. */
+static void probe_error(void *arg, err_t err) {
+  (void)err;
+  if ((uintptr_t)arg == probe.generation) {
+    probe.pcb = NULL;
+    probe_finish(false);
+  }
+}
+
+/* Gives up on a probe past its timeout, in the lwIP thread. */
+static void probe_cancel(void *arg) {
+  (void)arg;
+  probe.generation++;
+  if (probe.pcb != NULL) {
+    tcp_err(probe.pcb, NULL);
+    tcp_abort(probe.pcb);
+    probe.pcb = NULL;
+  }
+}
+
+/* Hands the result of the probe to the coroutine. */
+static void probe_finish(bool reachable) {
+  probe.reachable = reachable;
+  probe.done = true;
+  coroutine_wake();
+}
+
+/******************************************************************************
+ * Function Name: mqtt_reinit_state
+ ******************************************************************************
+ * Summary:
+ *  Asks the state task to subscribe again and to refresh the retained state
+ *  after a reconnection, which may be to another broker.
+ *
+ ******************************************************************************/
+static void mqtt_reinit_state(void) {
+  State newState;
+
+  newState.state = SEC_INIT;
+  recorder_input(RECORDER_RECONNECT, NULL, 0);
+
+  /* The coroutine task must not wait on the state task; the state queue is
+   * only full during a burst, which the state task drains in a few ticks.
+   */
+  if ((xStateQueue != NULL) &&
+      (xQueueSend(xStateQueue, &newState, (TickType_t)10) != pdTRUE)) {
+    printf("State queue full, retained state not refreshed\n");
+  }
+}
+
+/******************************************************************************
+ * Blocking calls, run on the worker task with CORO_BLOCKING(). They leave
+ * their result in work_result.
+ ******************************************************************************/
+static void wcm_init_work(void *arg) {
+  /* Configure the Wi-Fi interface as a Wi-Fi STA (i.e. Client). */
+  cy_wcm_config_t config = {.interface = CY_WCM_INTERFACE_TYPE_STA};
+
+  (void)arg;
+  work_result = cy_wcm_init(&config);
+}
+
+static void mqtt_init_work(void *arg) {
+  (void)arg;
+  work_result = mqtt_init();
+}
+
+static void wifi_join_work(void *arg) {
+  (void)arg;
+  work_result = cy_wcm_connect_ap(&wifi.connect_param, &wifi.ip_address);
+}
+
+static void wifi_leave_work(void *arg) {
+  (void)arg;
+  work_result = cy_wcm_disconnect_ap();
+}
+
+/* Uses the cached address of the primary broker, resolving it only when
+ * stale, and reports the device online once connected. The instance is
+ * created again when the host string changed.
+ */
+static void mqtt_connect_work(void *arg) {
+  const char *host;
+  uint16_t host_len;
+
+  (void)arg;
+  work_result = CY_RSLT_SUCCESS;
+  connect.broker_cached = false;
+  if (broker_index == 0) {
+    host = net_cache_broker_host(&host_len);
+    connect.broker_cached = net_cache_broker_is_cached();
+    if ((host_len != broker_info.hostname_len) ||
+        (memcmp(host, broker_info.hostname, host_len) != 0)) {
+      memcpy(broker_host, host, host_len + 1u);
+      broker_info.hostname = broker_host;
+      broker_info.hostname_len = host_len;
+      work_result = mqtt_create_instance();
+    }
+  }
+
+  if (work_result == CY_RSLT_SUCCESS) {
+    tls_memory_reset_peak();
+    work_result = cy_mqtt_connect(mqtt_connection, &connection_info);
+  }
+  if (work_result == CY_RSLT_SUCCESS) {
+    mqtt_publish_status(true);
+  }
+}
+
+/* arg is the index of the broker in mqtt_brokers[]. */
+static void mqtt_select_work(void *arg) {
+  work_result = mqtt_select_broker((uint32_t)(uintptr_t)arg);
+}
+
+static void mqtt_subscribe_work(void *arg) {
+  (void)arg;
+  work_result =
+      cy_mqtt_subscribe(mqtt_connection, &subscribe_info, SUBSCRIPTION_COUNT);
+}
+
+static void mqtt_disconnect_work(void *arg) {
+  (void)arg;
+  work_result = cy_mqtt_disconnect(mqtt_connection);
+}
+
+/* Reports offline and disconnects, before a failback. */
+static void mqtt_offline_work(void *arg) {
+  (void)arg;
+  mqtt_publish_status(false);
+  work_result = cy_mqtt_disconnect(mqtt_connection);
+}
+
+static void cleanup_work(void *arg) {
+  (void)arg;
+  cleanup();
+  work_result = CY_RSLT_SUCCESS;
+}
+
+/******************************************************************************
+ * Function Name: mqtt_publish_status
+ ******************************************************************************
+ * Summary:
+ *  Publishes the retained device status. "online" replaces the offline LWT
+ *  the broker published for an unexpected disconnection; "offline" is sent
+ *  before a deliberate shutdown, where the broker does not publish the LWT.
+ *
+ * Parameters:
+ *  bool online : Status to publish
+ *
+ * Return:
+ *  void
+ *
+ ******************************************************************************/
+static void mqtt_publish_status(bool online) {
+  cy_mqtt_publish_info_t status_info = mqtt_message_classes[MQTT_CLASS_STATUS];
+
+  status_info.payload =
+      online ? MQTT_STATUS_ONLINE_MESSAGE : MQTT_STATUS_OFFLINE_MESSAGE;
+  status_info.payload_len = strlen(status_info.payload);
+
+  /* Directly, so the offline status goes out before the disconnect. */
+  if (cy_mqtt_publish(mqtt_connection, &status_info) != CY_RSLT_SUCCESS) {
+    printf("Publishing the %s status failed\n", online ? "online" : "offline");
+  }
 }
 
 #if GENERATE_UNIQUE_CLIENT_ID
@@ -557,15 +1299,16 @@ static void cleanup(void) {
   /* Disconnect the MQTT connection if it was established. */
   if (status_flag & MQTT_CONNECTION_SUCCESS) {
     printf("Disconnecting from the MQTT Broker...\n");
+    mqtt_publish_status(false);
     cy_mqtt_disconnect(mqtt_connection);
   }
   /* Delete the MQTT instance if it was created. */
   if (status_flag & MQTT_INSTANCE_CREATED) {
     cy_mqtt_delete(mqtt_connection);
   }
-  /* Deallocate the network buffer. */
-  if (status_flag & BUFFER_INITIALIZED) {
-    vPortFree((void *)mqtt_network_buffer);
+  /* Release the global Root CA trust chain. */
+  if (status_flag & ROOT_CA_LOADED) {
+    cy_tls_release_global_root_ca_certificates();
   }
   /* Deinit the MQTT library. */
   if (status_flag & LIBS_INITIALIZED) {
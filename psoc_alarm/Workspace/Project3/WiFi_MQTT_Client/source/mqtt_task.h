@@ -50,19 +50,22 @@
 /*******************************************************************************
 * Macros
 ********************************************************************************/
-/* Task parameters for MQTT Client Task. */
-#define MQTT_CLIENT_TASK_PRIORITY       (2)
-#define MQTT_CLIENT_TASK_STACK_SIZE     (1024 * 3)
+/* Queue length of a message queue that is used to communicate the status of
+ * various operations.
+ */
+#define MQTT_TASK_QUEUE_LENGTH          (3u)
 
 /*******************************************************************************
 * Global Variables
 ********************************************************************************/
-/* Commands for the MQTT Client Task. */
+/* Commands for the connection manager. */
 typedef enum
 {
     HANDLE_MQTT_SUBSCRIBE_FAILURE,
     HANDLE_MQTT_PUBLISH_FAILURE,
-    HANDLE_DISCONNECTION
+    HANDLE_DISCONNECTION,
+    HANDLE_LEASE_EXPIRY,
+    HANDLE_ROAM
 } mqtt_task_cmd_t;
 
 /*******************************************************************************
@@ -74,7 +77,9 @@ extern QueueHandle_t mqtt_task_q;
 /*******************************************************************************
 * Function Prototypes
 ********************************************************************************/
-void mqtt_client_task(void *pvParameters);
+void mqtt_task_start(void);
+BaseType_t mqtt_task_send(mqtt_task_cmd_t cmd, TickType_t ticks_to_wait);
+void mqtt_task_request_reconnect(void);
 
 #endif /* MQTT_TASK_H_ */
 
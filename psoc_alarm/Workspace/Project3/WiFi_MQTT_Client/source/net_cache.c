@@ -0,0 +1,443 @@
+/**
+ * This file implements the fast reconnect cache.
+ *
+ * The last associated AP (BSSID and channel) and the resolved broker address
+ * are persisted in a row of the emulated EEPROM flash region so they also
+ * speed up the first connection after a reset. The DHCP lease is only kept in
+ * RAM: without a real-time clock the remaining lease time cannot be known
+ * after a reset, so it is reused for reconnects within the same boot only and
+ * is renewed through DHCP before it runs out.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cyhal.h"
+#include "cy_secure_sockets.h"
+#include "cy_utils.h"
+#include "cy_wcm.h"
+
+/* FreeRTOS header files */
+#include <FreeRTOS.h>
+#include "task.h"
+#include "timers.h"
+
+/* LwIP header files */
+#include "lwip/dhcp.h"
+#include "lwip/dns.h"
+#include "lwip/ip4_addr.h"
+#include "lwip/netif.h"
+
+#include "mqtt_client_config.h"
+#include "mqtt_task.h"
+#include "net_cache.h"
+#include "wifi_config.h"
+
+/******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Marks a valid record, bump the last digit when the layout changes. */
+#define NET_CACHE_MAGIC (0x4E434331u) /* "NCC1" */
+
+/* Highest 2.4 GHz channel number. */
+#define NET_CACHE_MAX_2G4_CHANNEL (14u)
+
+/******************************************************************************
+ * Types
+ ******************************************************************************/
+/* Persisted part of the cache. */
+typedef struct {
+  uint32_t magic;
+  cy_wcm_mac_t bssid;
+  uint8_t channel;
+  uint8_t ap_valid;
+  uint32_t broker_ip; /* IPv4, network byte order, 0 if unknown */
+  uint32_t checksum;
+} net_cache_record_t;
+
+/* RAM-only DHCP lease of the current boot. */
+typedef struct {
+  bool valid;
+  bool in_use; /* current association runs on the cached lease */
+  cy_wcm_ip_address_t ip;
+  cy_wcm_ip_address_t netmask;
+  cy_wcm_ip_address_t gateway;
+  ip_addr_t dns_server;
+  uint32_t lease_ms;
+  uint32_t obtained_ms;
+} net_cache_lease_t;
+
+/******************************************************************************
+ * Global Variables
+ ******************************************************************************/
+/* Flash row backing the persisted record. It is rewritten behind the
+ * compiler's back by cyhal_flash_write(), so it is volatile: the compiler
+ * would otherwise fold the reads of a const object initialized to zero.
+ */
+CY_SECTION(".cy_em_eeprom")
+CY_ALIGN(CY_FLASH_SIZEOF_ROW)
+static const volatile uint8_t net_cache_row[CY_FLASH_SIZEOF_ROW] = {0};
+
+/* Row image used for flash writes. */
+static uint32_t net_cache_row_buf[CY_FLASH_SIZEOF_ROW / sizeof(uint32_t)];
+
+static cyhal_flash_t flash_obj;
+static bool flash_ready;
+
+static net_cache_record_t cache;
+static net_cache_lease_t lease;
+
+/* Time the broker address was resolved, and whether it still has to be
+ * confirmed by a successful connect after being loaded from flash.
+ */
+static uint32_t broker_resolved_ms;
+static bool broker_from_flash;
+
+/* Last broker host was served from the cache, without a DNS lookup. */
+static bool broker_hit;
+
+/* Buffer handed to the MQTT library as broker hostname. The library keeps
+ * the pointer, so it is rewritten in place when the address changes.
+ */
+static char broker_host[NET_CACHE_HOST_LEN] = MQTT_BROKER_ADDRESS;
+
+/* Fires when the reused lease reaches NET_CACHE_LEASE_MARGIN_PERCENT. */
+static TimerHandle_t lease_timer;
+static StaticTimer_t lease_timer_buffer;
+
+/******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+static uint32_t net_cache_checksum(const net_cache_record_t *record);
+static void net_cache_persist(void);
+static void lease_timer_callback(TimerHandle_t timer);
+static uint32_t lease_remaining_ms(void);
+
+/******************************************************************************
+ * Function Name: net_cache_init
+ ******************************************************************************
+ * Summary:
+ *  Loads the persisted record from flash and creates the lease timer.
+ *
+ ******************************************************************************/
+void net_cache_init(void) {
+  memset(&lease, 0, sizeof(lease));
+  memset(&cache, 0, sizeof(cache));
+
+  flash_ready = (cyhal_flash_init(&flash_obj) == CY_RSLT_SUCCESS);
+  lease_timer = xTimerCreateStatic("Lease", 1, pdFALSE, NULL,
+                                   lease_timer_callback, &lease_timer_buffer);
+
+#if NET_CACHE_ENABLE
+  for (size_t i = 0; i < sizeof(cache); i++) {
+    ((uint8_t *)&cache)[i] = net_cache_row[i];
+  }
+  if ((cache.magic != NET_CACHE_MAGIC) ||
+      (cache.checksum != net_cache_checksum(&cache))) {
+    memset(&cache, 0, sizeof(cache));
+    printf("Net cache: empty\n");
+    return;
+  }
+
+  broker_from_flash = (cache.broker_ip != 0);
+  printf("Net cache: AP %02X:%02X:%02X:%02X:%02X:%02X ch %u, broker %s\n",
+         cache.bssid[0], cache.bssid[1], cache.bssid[2], cache.bssid[3],
+         cache.bssid[4], cache.bssid[5], cache.channel,
+         broker_from_flash
+             ? ip4addr_ntoa((const ip4_addr_t *)&cache.broker_ip)
+             : "-");
+#endif /* NET_CACHE_ENABLE */
+}
+
+/******************************************************************************
+ * Function Name: net_cache_apply_ap_hints
+ ******************************************************************************
+ * Summary:
+ *  Adds the cached BSSID/band and, if still valid, the cached DHCP lease as
+ *  static IP settings to the connection parameters.
+ *
+ * Parameters:
+ *  cy_wcm_connect_params_t *connect_param : Parameters to complete
+ *  cy_wcm_ip_setting_t *ip_settings       : Storage for the static IP
+ *                                           settings, must outlive the
+ *                                           connect call
+ *
+ * Return:
+ *  bool : true if any hint was applied (fast path)
+ *
+ ******************************************************************************/
+bool net_cache_apply_ap_hints(cy_wcm_connect_params_t *connect_param,
+                              cy_wcm_ip_setting_t *ip_settings) {
+  lease.in_use = false;
+
+  if (!NET_CACHE_ENABLE || !cache.ap_valid) {
+    return false;
+  }
+
+  memcpy(connect_param->BSSID, cache.bssid, sizeof(cy_wcm_mac_t));
+  connect_param->band = (cache.channel <= NET_CACHE_MAX_2G4_CHANNEL)
+                            ? CY_WCM_WIFI_BAND_2_4GHZ
+                            : CY_WCM_WIFI_BAND_5GHZ;
+
+  /* The lease is only worth reusing if the DNS lookup is skipped as well,
+   * otherwise the connection still waits for the network round trips.
+   */
+  if (lease.valid && (cache.broker_ip != 0) &&
+      (lease_remaining_ms() >
+       (lease.lease_ms / 100u) * NET_CACHE_LEASE_MARGIN_PERCENT)) {
+    ip_settings->ip_address = lease.ip;
+    ip_settings->netmask = lease.netmask;
+    ip_settings->gateway = lease.gateway;
+    connect_param->static_ip_settings = ip_settings;
+    lease.in_use = true;
+  }
+
+  return true;
+}
+
+/******************************************************************************
+ * Function Name: net_cache_store_ap
+ ******************************************************************************
+ * Summary:
+ *  Records the AP and the DHCP lease of a successful association. Persists
+ *  the record only if the AP changed, to spare the flash.
+ *
+ ******************************************************************************/
+void net_cache_store_ap(void) {
+  cy_wcm_associated_ap_info_t ap_info;
+
+  if (!NET_CACHE_ENABLE) {
+    return;
+  }
+
+  if (cy_wcm_get_associated_ap_info(&ap_info) == CY_RSLT_SUCCESS) {
+    if (!cache.ap_valid || (cache.channel != ap_info.channel) ||
+        (memcmp(cache.bssid, ap_info.BSSID, sizeof(cy_wcm_mac_t)) != 0)) {
+      memcpy(cache.bssid, ap_info.BSSID, sizeof(cy_wcm_mac_t));
+      cache.channel = ap_info.channel;
+      cache.ap_valid = 1;
+      net_cache_persist();
+    }
+  }
+
+  if (lease.in_use) {
+    /* A static association comes without DNS server, restore the leased one
+     * for lookups after the broker address changed.
+     */
+    dns_setserver(0, &lease.dns_server);
+
+    /* Renew through DHCP once the reused lease reaches the margin. */
+    uint32_t renew_ms = lease_remaining_ms() -
+                        (lease.lease_ms / 100u) * NET_CACHE_LEASE_MARGIN_PERCENT;
+    xTimerChangePeriod(lease_timer, pdMS_TO_TICKS(renew_ms), 0);
+    return;
+  }
+
+  /* Fresh lease from DHCP. */
+  struct netif *netif = netif_default;
+  struct dhcp *dhcp = (netif != NULL) ? netif_dhcp_data(netif) : NULL;
+  if ((dhcp == NULL) || !dhcp_supplied_address(netif) ||
+      (dhcp->offered_t0_lease == 0) ||
+      (dhcp->offered_t0_lease == 0xffffffffUL)) {
+    lease.valid = false;
+    return;
+  }
+
+  cy_wcm_get_ip_addr(CY_WCM_INTERFACE_TYPE_STA, &lease.ip);
+  cy_wcm_get_ip_netmask(CY_WCM_INTERFACE_TYPE_STA, &lease.netmask);
+  cy_wcm_get_gateway_ip_address(CY_WCM_INTERFACE_TYPE_STA, &lease.gateway);
+  lease.dns_server = *dns_getserver(0);
+  lease.lease_ms = dhcp->offered_t0_lease * 1000u;
+  lease.obtained_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+  lease.valid = true;
+}
+
+/******************************************************************************
+ * Function Name: net_cache_invalidate_ap
+ ******************************************************************************
+ * Summary:
+ *  Drops the AP hint after a failed fast join. The lease goes with it, the
+ *  next association runs the full scan and DHCP.
+ *
+ ******************************************************************************/
+void net_cache_invalidate_ap(void) {
+  net_cache_invalidate_lease();
+  if (cache.ap_valid) {
+    cache.ap_valid = 0;
+    net_cache_persist();
+  }
+}
+
+/******************************************************************************
+ * Function Name: net_cache_set_ap
+ ******************************************************************************
+ * Summary:
+ *  Replaces the AP hint, so the next association joins the given BSSID. Used
+ *  by the link monitor to roam. The lease is kept: an AP of the same SSID is
+ *  expected to serve the same subnet.
+ *
+ * Parameters:
+ *  const cy_wcm_mac_t bssid : BSSID to join
+ *  uint8_t channel          : Channel of that BSSID
+ *
+ ******************************************************************************/
+void net_cache_set_ap(const cy_wcm_mac_t bssid, uint8_t channel) {
+  memcpy(cache.bssid, bssid, sizeof(cy_wcm_mac_t));
+  cache.channel = channel;
+  cache.ap_valid = 1;
+  net_cache_persist();
+}
+
+/******************************************************************************
+ * Function Name: net_cache_invalidate_lease
+ ******************************************************************************/
+void net_cache_invalidate_lease(void) {
+  xTimerStop(lease_timer, 0);
+  lease.valid = false;
+  lease.in_use = false;
+}
+
+/******************************************************************************
+ * Function Name: net_cache_broker_host
+ ******************************************************************************
+ * Summary:
+ *  Returns the host to connect to: the cached broker IPv4 address while it is
+ *  within NET_CACHE_DNS_TTL_MS, otherwise a freshly resolved one. Falls back
+ *  to MQTT_BROKER_ADDRESS if the lookup fails so the socket layer resolves it.
+ *
+ * Parameters:
+ *  uint16_t *hostname_len : Receives the length of the returned string
+ *
+ * Return:
+ *  const char * : Broker host string. Always the same buffer.
+ *
+ ******************************************************************************/
+const char *net_cache_broker_host(uint16_t *hostname_len) {
+  uint32_t now_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+  cy_socket_ip_address_t address;
+
+  broker_hit = false;
+  if (NET_CACHE_ENABLE && (cache.broker_ip != 0) &&
+      (broker_from_flash ||
+       ((now_ms - broker_resolved_ms) < NET_CACHE_DNS_TTL_MS))) {
+    if (broker_from_flash) {
+      /* Start the TTL at the first use after reset. */
+      broker_from_flash = false;
+      broker_resolved_ms = now_ms;
+    }
+    broker_hit = true;
+  } else if (NET_CACHE_ENABLE &&
+             (cy_socket_gethostbyname(MQTT_BROKER_ADDRESS,
+                                      CY_SOCKET_IP_VER_V4,
+                                      &address) == CY_RSLT_SUCCESS)) {
+    broker_resolved_ms = now_ms;
+    if (cache.broker_ip != address.ip.v4) {
+      cache.broker_ip = address.ip.v4;
+      net_cache_persist();
+    }
+  } else {
+    cache.broker_ip = 0;
+  }
+
+  if (cache.broker_ip != 0) {
+    ip4addr_ntoa_r((const ip4_addr_t *)&cache.broker_ip, broker_host,
+                   sizeof(broker_host));
+  } else {
+    memcpy(broker_host, MQTT_BROKER_ADDRESS, sizeof(MQTT_BROKER_ADDRESS));
+  }
+
+  *hostname_len = (uint16_t)strlen(broker_host);
+  return broker_host;
+}
+
+/******************************************************************************
+ * Function Name: net_cache_broker_is_cached
+ ******************************************************************************
+ * Summary:
+ *  Tells whether the last net_cache_broker_host() call skipped the DNS lookup.
+ *
+ ******************************************************************************/
+bool net_cache_broker_is_cached(void) { return broker_hit; }
+
+/******************************************************************************
+ * Function Name: net_cache_invalidate_broker
+ ******************************************************************************
+ * Summary:
+ *  Forces a DNS lookup on the next connect, e.g. after a connect to the
+ *  cached address failed.
+ *
+ ******************************************************************************/
+void net_cache_invalidate_broker(void) {
+  broker_from_flash = false;
+  broker_hit = false;
+  broker_resolved_ms = 0;
+  if (cache.broker_ip != 0) {
+    cache.broker_ip = 0;
+    net_cache_persist();
+  }
+}
+
+/******************************************************************************
+ * Function Name: lease_remaining_ms
+ ******************************************************************************/
+static uint32_t lease_remaining_ms(void) {
+  uint32_t elapsed_ms =
+      (xTaskGetTickCount() * portTICK_PERIOD_MS) - lease.obtained_ms;
+
+  return (elapsed_ms < lease.lease_ms) ? (lease.lease_ms - elapsed_ms) : 0u;
+}
+
+/******************************************************************************
+ * Function Name: lease_timer_callback
+ ******************************************************************************
+ * Summary:
+ *  Asks the connection manager to reassociate through DHCP before the reused
+ *  lease expires.
+ *
+ ******************************************************************************/
+static void lease_timer_callback(TimerHandle_t timer) {
+  (void)timer;
+  mqtt_task_send(HANDLE_LEASE_EXPIRY, 0);
+}
+
+/******************************************************************************
+ * Function Name: net_cache_checksum
+ ******************************************************************************
+ * Summary:
+ *  FNV-1a over the record, excluding the checksum field itself.
+ *
+ ******************************************************************************/
+static uint32_t net_cache_checksum(const net_cache_record_t *record) {
+  const uint8_t *bytes = (const uint8_t *)record;
+  uint32_t hash = 2166136261u;
+
+  for (size_t i = 0; i < offsetof(net_cache_record_t, checksum); i++) {
+    hash = (hash ^ bytes[i]) * 16777619u;
+  }
+  return hash;
+}
+
+/******************************************************************************
+ * Function Name: net_cache_persist
+ ******************************************************************************
+ * Summary:
+ *  Writes the record to its flash row.
+ *
+ ******************************************************************************/
+static void net_cache_persist(void) {
+  if (!flash_ready) {
+    return;
+  }
+
+  cache.magic = NET_CACHE_MAGIC;
+  cache.checksum = net_cache_checksum(&cache);
+
+  memset(net_cache_row_buf, 0, sizeof(net_cache_row_buf));
+  memcpy(net_cache_row_buf, &cache, sizeof(cache));
+
+  if (cyhal_flash_write(&flash_obj, (uint32_t)(uintptr_t)net_cache_row,
+                        net_cache_row_buf) != CY_RSLT_SUCCESS) {
+    printf("Net cache: flash write failed\n");
+  }
+}
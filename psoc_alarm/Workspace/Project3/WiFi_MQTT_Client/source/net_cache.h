@@ -0,0 +1,46 @@
+/*
+ * net_cache.h
+ *
+ * Fast reconnect cache: last AP (BSSID/channel), DHCP lease and resolved
+ * broker address. Used as a fast path by wifi_connect() and mqtt_connect(),
+ * with a fallback to the full scan/DHCP/DNS path whenever a hint fails.
+ */
+
+#ifndef SOURCE_NET_CACHE_H_
+#define SOURCE_NET_CACHE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "cy_wcm.h"
+#include "mqtt_client_config.h"
+
+/*******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Longest broker host string: the configured hostname or a dotted IPv4
+ * address (IP4ADDR_STRLEN_MAX).
+ */
+#define NET_CACHE_HOST_LEN                                                     \
+  ((sizeof(MQTT_BROKER_ADDRESS) > sizeof("255.255.255.255"))                   \
+       ? sizeof(MQTT_BROKER_ADDRESS)                                           \
+       : sizeof("255.255.255.255"))
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+void net_cache_init(void);
+
+/* Wi-Fi association and DHCP lease */
+bool net_cache_apply_ap_hints(cy_wcm_connect_params_t *connect_param,
+                              cy_wcm_ip_setting_t *ip_settings);
+void net_cache_store_ap(void);
+void net_cache_invalidate_ap(void);
+void net_cache_set_ap(const cy_wcm_mac_t bssid, uint8_t channel);
+void net_cache_invalidate_lease(void);
+
+/* Broker address */
+const char *net_cache_broker_host(uint16_t *hostname_len);
+bool net_cache_broker_is_cached(void);
+void net_cache_invalidate_broker(void);
+
+#endif /* SOURCE_NET_CACHE_H_ */
@@ -0,0 +1,184 @@
+/**
+ * This file implements the statistics of the latency probes, see probe.h.
+ *
+ * A probe keeps its count, minimum, maximum and total, and a log2 histogram
+ * of PROBE_BUCKETS counters. Recording takes a count leading zeros and a few
+ * additions, cheap enough for the button interrupt.
+ *
+ * PROBEDUMP prints the probes on the console and publishes them on
+ * MQTT_DIAG_TOPIC, one message per probe with the non-empty buckets:
+ *
+ *   {"probe":"gpio_isr","unit":"cycles","n":..,"min":..,"mean":..,"max":..,
+ *    "hist":[[bucket,count],...]}
+ *
+ * PROBERESET clears them.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "mqtt_client_config.h"
+#include "probe.h"
+#include "publisher.h"
+
+/******************************************************************************
+ * Types
+ ******************************************************************************/
+typedef struct {
+  uint32_t count;
+  uint32_t min;
+  uint32_t max;
+  uint64_t total;
+  uint32_t buckets[PROBE_BUCKETS];
+} probe_stats_t;
+
+/******************************************************************************
+ * Global Variables
+ ******************************************************************************/
+#if PROBE_ENABLE
+static probe_stats_t probes[PROBE_COUNT];
+
+static const char *const probe_names[PROBE_COUNT] = {
+    [PROBE_GPIO_ISR] = "gpio_isr",
+    [PROBE_BT_MANAGEMENT] = "bt_management",
+    [PROBE_MQTT_EVENT] = "mqtt_event",
+    [PROBE_STATE_TASK] = "state_task",
+    [PROBE_COROUTINE_WAKE] = "coroutine_wake",
+    [PROBE_COROUTINE_PASS] = "coroutine_pass",
+};
+#endif
+
+/******************************************************************************
+ * Function Name: probe_record
+ ******************************************************************************
+ * Summary:
+ *  Adds a duration to a probe. Called by PROBE_STOP().
+ *
+ * Parameters:
+ *  probe_id_t id     : Probe
+ *  uint32_t duration : Duration in PROBE_UNIT
+ *
+ ******************************************************************************/
+void probe_record(probe_id_t id, uint32_t duration) {
+#if PROBE_ENABLE
+  probe_stats_t *stats = &probes[id];
+  uint32_t bucket =
+      (duration == 0u) ? 0u : (32u - (uint32_t)__builtin_clz(duration));
+
+  if ((stats->count == 0u) || (duration < stats->min)) {
+    stats->min = duration;
+  }
+  if (duration > stats->max) {
+    stats->max = duration;
+  }
+  stats->count++;
+  stats->total += duration;
+  stats->buckets[(bucket < PROBE_BUCKETS) ? bucket : (PROBE_BUCKETS - 1u)]++;
+#else
+  (void)id;
+  (void)duration;
+#endif
+}
+
+/******************************************************************************
+ * Function Name: probe_print
+ ******************************************************************************
+ * Summary:
+ *  Prints the probes that recorded anything on the console, with the
+ *  non-empty buckets.
+ *
+ ******************************************************************************/
+void probe_print(void) {
+#if PROBE_ENABLE
+  for (uint32_t id = 0; id < PROBE_COUNT; id++) {
+    probe_stats_t stats = probes[id];
+
+    if (stats.count == 0u) {
+      continue;
+    }
+    printf("Probe %s (" PROBE_UNIT "): n=%lu min=%lu mean=%lu max=%lu\n",
+           probe_names[id], (unsigned long)stats.count,
+           (unsigned long)stats.min,
+           (unsigned long)(stats.total / stats.count),
+           (unsigned long)stats.max);
+    for (uint32_t b = 0; b < PROBE_BUCKETS; b++) {
+      if (stats.buckets[b] != 0u) {
+        printf("  %s %10lu: %lu\n", (b == PROBE_BUCKETS - 1u) ? ">=" : "< ",
+               (unsigned long)((b == PROBE_BUCKETS - 1u) ? (1ul << (b - 1u))
+                                                        : (1ul << b)),
+               (unsigned long)stats.buckets[b]);
+      }
+    }
+  }
+#endif
+}
+
+/******************************************************************************
+ * Function Name: probe_publish
+ ******************************************************************************
+ * Summary:
+ *  Prints the probes and publishes them on MQTT_DIAG_TOPIC, see the top of
+ *  the file. Buckets that do not fit the message are left out.
+ *
+ ******************************************************************************/
+void probe_publish(void) {
+  probe_print();
+
+#if PROBE_ENABLE
+  for (uint32_t id = 0; id < PROBE_COUNT; id++) {
+    probe_stats_t stats = probes[id];
+    char *buffer;
+    size_t buffer_size;
+    int len;
+
+    if (stats.count == 0u) {
+      continue;
+    }
+    buffer = publisher_reserve(&buffer_size);
+    if (buffer == NULL) {
+      return;
+    }
+    /* Room is kept for the closing "]}". */
+    len = snprintf(buffer, buffer_size - 2u,
+                   "{\"probe\":\"%s\",\"unit\":\"" PROBE_UNIT "\",\"n\":%lu,"
+                   "\"min\":%lu,\"mean\":%lu,\"max\":%lu,\"hist\":[",
+                   probe_names[id], (unsigned long)stats.count,
+                   (unsigned long)stats.min,
+                   (unsigned long)(stats.total / stats.count),
+                   (unsigned long)stats.max);
+    for (uint32_t b = 0; (b < PROBE_BUCKETS) && (len > 0) &&
+                         ((size_t)len < buffer_size - 2u);
+         b++) {
+      int entry;
+
+      if (stats.buckets[b] == 0u) {
+        continue;
+      }
+      entry = snprintf(&buffer[len], buffer_size - 2u - (size_t)len,
+                       "%s[%lu,%lu]", (buffer[len - 1] == '[') ? "" : ",",
+                       (unsigned long)b, (unsigned long)stats.buckets[b]);
+      if ((entry < 0) || ((size_t)entry >= buffer_size - 2u - (size_t)len)) {
+        break;
+      }
+      len += entry;
+    }
+    if ((len <= 0) || ((size_t)len >= buffer_size - 2u)) {
+      publisher_cancel(buffer);
+      return;
+    }
+    memcpy(&buffer[len], "]}", 2u);
+    len += 2;
+    if (publisher_commit(MQTT_CLASS_DIAG, buffer, (size_t)len) !=
+        CY_RSLT_SUCCESS) {
+      return;
+    }
+  }
+#endif
+}
+
+/* Clears the probes. A probe recording at the same time may keep a sample. */
+void probe_reset(void) {
+#if PROBE_ENABLE
+  memset(probes, 0, sizeof(probes));
+#endif
+}
@@ -0,0 +1,105 @@
+/*
+ * probe.h
+ *
+ * Latency probes. PROBE_START() and PROBE_STOP() around a hot path record
+ * its duration, from the DWT cycle counter on the board and clock_gettime()
+ * in nanoseconds on the host, into the minimum, maximum, mean and a log2
+ * histogram of the probe. The macros cost two counter reads and a few
+ * additions, and compile to nothing with PROBE_ENABLE set to 0.
+ *
+ * log_timing_start() / log_timing_end() keep feeding the periodic callback
+ * report and the trace trigger; the probes keep the distribution.
+ */
+
+#ifndef SOURCE_PROBE_H_
+#define SOURCE_PROBE_H_
+
+#include <stdint.h>
+#include "cyhal.h"
+#include "log_config.h"
+#if !defined(__CORTEX_M)
+#include <time.h>
+#endif
+
+/*******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Buckets of the histogram. Bucket b counts durations below 2^b, from 2^(b-1)
+ * on; the last one counts everything longer too.
+ */
+#define PROBE_BUCKETS (24u)
+
+/* Unit of probe_now(), and its ticks per microsecond. */
+#if defined(__CORTEX_M)
+#define PROBE_UNIT "cycles"
+#define PROBE_TICKS_PER_US (SystemCoreClock / 1000000u)
+#else
+#define PROBE_UNIT "ns"
+#define PROBE_TICKS_PER_US (1000u)
+#endif
+
+#if PROBE_ENABLE
+/* Starts a probe, in the scope of the matching PROBE_STOP(). */
+#define PROBE_START(id) uint32_t probe_start_##id = probe_now()
+
+/* Starts a probe again, leaving out the time since PROBE_START(). */
+#define PROBE_RESTART(id) (probe_start_##id = probe_now())
+
+#define PROBE_STOP(id) probe_record((id), probe_now() - probe_start_##id)
+#else
+#define PROBE_START(id)                                                        \
+  do {                                                                         \
+  } while (0)
+#define PROBE_RESTART(id)                                                      \
+  do {                                                                         \
+  } while (0)
+#define PROBE_STOP(id)                                                         \
+  do {                                                                         \
+  } while (0)
+#endif
+
+/*******************************************************************************
+ * Data Types
+ ******************************************************************************/
+/* Each probe is fed from one thread or interrupt only, so it is not locked. */
+typedef enum {
+  /* Button interrupt, state.c */
+  PROBE_GPIO_ISR,
+  /* Bluetooth management callback, bt.c */
+  PROBE_BT_MANAGEMENT,
+  /* MQTT event callback, mqtt_task.c */
+  PROBE_MQTT_EVENT,
+  /* One state change of the state task, without the blink delay */
+  PROBE_STATE_TASK,
+  /* coroutine_wake() to the next pass of the coroutine task, coroutine.c */
+  PROBE_COROUTINE_WAKE,
+  /* One pass of the coroutine task over all coroutines */
+  PROBE_COROUTINE_PASS,
+  PROBE_COUNT
+} probe_id_t;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+void probe_record(probe_id_t id, uint32_t duration);
+void probe_print(void);
+void probe_publish(void);
+void probe_reset(void);
+
+/* Time in PROBE_UNIT, wrapping. The DWT counter is started by log_init(),
+ * the CM0+ has none.
+ */
+static inline uint32_t probe_now(void) {
+#if defined(__CORTEX_M) && (__CORTEX_M >= 3)
+  return DWT->CYCCNT;
+#elif defined(__CORTEX_M)
+  return 0u;
+#else
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint32_t)((uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec);
+#endif
+}
+
+#endif /* SOURCE_PROBE_H_ */
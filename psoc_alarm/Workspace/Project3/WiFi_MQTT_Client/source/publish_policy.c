@@ -0,0 +1,327 @@
+/**
+ * This file implements the adaptive publish policy.
+ *
+ * The publisher reports the PUBACK round trip and the retransmissions of
+ * every QoS 1 publish, and the connection manager reports every reconnection.
+ * From these the policy picks one of two profiles for telemetry:
+ *
+ *   good : every record is published at once with QoS 0.
+ *   poor : records are collected into one {"batch":[...]} message, which is
+ *          published every MQTT_TELEMETRY_BATCH_MS with QoS 1. This saves
+ *          the per-message MQTT and TLS framing, and the acknowledged
+ *          batches keep the round trip measured.
+ *
+ * State, events and status do not pass through here: they are always sent
+ * immediately with QoS 1. Each profile switch is published on the
+ * diagnostics topic, together with the metrics that caused it and the mean
+ * telemetry delivery latency of the profile that ends.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+/* FreeRTOS header files */
+#include <FreeRTOS.h>
+#include "semphr.h"
+#include "task.h"
+#include "timers.h"
+
+#include "mqtt_client_config.h"
+#include "publish_policy.h"
+#include "publisher.h"
+
+/******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Room left in a batch for {"batch":[...]} and the sequence number. */
+#define POLICY_BATCH_SIZE (MQTT_PUBLISH_PAYLOAD_MAX - 32)
+
+/* Size of the diagnostics message of a profile switch. */
+#define POLICY_DIAG_SIZE (160)
+
+/******************************************************************************
+ * Types
+ ******************************************************************************/
+typedef enum { POLICY_GOOD, POLICY_POOR } policy_profile_t;
+
+/******************************************************************************
+ * Global Variables
+ ******************************************************************************/
+static const char *const profile_names[] = {"good", "poor"};
+
+static SemaphoreHandle_t policy_mutex;
+static StaticSemaphore_t policy_mutex_buffer;
+static TimerHandle_t batch_timer;
+static StaticTimer_t batch_timer_buffer;
+static policy_profile_t profile;
+static uint32_t profile_since_ms;
+
+/* Averaged PUBACK round trip and share of retransmitted publishes. */
+static uint32_t rtt_avg_ms;
+static uint32_t retx_avg_percent;
+
+/* Times of the last MQTT_POLICY_POOR_RECONNECTS reconnections. */
+static uint32_t reconnect_ms[MQTT_POLICY_POOR_RECONNECTS];
+static uint32_t reconnect_next;
+
+/* Telemetry delivery latency in the current profile. */
+static uint32_t delivery_sum_ms;
+static uint32_t delivery_count;
+
+/* Telemetry records collected in the poor profile. */
+static char batch[POLICY_BATCH_SIZE];
+static size_t batch_len;
+static uint32_t batch_records;
+static uint32_t batch_arrival_sum_ms;
+
+/******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+static void policy_evaluate(void);
+static void policy_switch(policy_profile_t new_profile, uint32_t reconnects);
+static void policy_flush(void);
+static void batch_timer_callback(TimerHandle_t timer);
+static uint32_t policy_now_ms(void);
+
+/******************************************************************************
+ * Function Name: publish_policy_init
+ ******************************************************************************
+ * Summary:
+ *  Starts in the good profile.
+ *
+ * Return:
+ *  cy_rslt_t : CY_RSLT_SUCCESS on success, else an error code
+ *
+ ******************************************************************************/
+cy_rslt_t publish_policy_init(void) {
+  policy_mutex = xSemaphoreCreateMutexStatic(&policy_mutex_buffer);
+  batch_timer = xTimerCreateStatic(
+      "Batch", pdMS_TO_TICKS(MQTT_TELEMETRY_BATCH_MS), pdTRUE, NULL,
+      batch_timer_callback, &batch_timer_buffer);
+  vQueueAddToRegistry(policy_mutex, "Policy");
+
+  profile = POLICY_GOOD;
+  profile_since_ms = policy_now_ms();
+  return CY_RSLT_SUCCESS;
+}
+
+/******************************************************************************
+ * Function Name: publish_policy_record_publish
+ ******************************************************************************
+ * Summary:
+ *  Records the outcome of a QoS 1 publish.
+ *
+ * Parameters:
+ *  uint32_t rtt_ms          : Time of the last attempt up to the PUBACK
+ *  uint32_t retransmissions : Failed attempts before it
+ *
+ ******************************************************************************/
+void publish_policy_record_publish(uint32_t rtt_ms, uint32_t retransmissions) {
+  uint32_t retx_percent = (retransmissions > 0) ? 100u : 0u;
+
+  xSemaphoreTake(policy_mutex, portMAX_DELAY);
+  rtt_avg_ms = (rtt_avg_ms == 0) ? rtt_ms : (7u * rtt_avg_ms + rtt_ms) / 8u;
+  retx_avg_percent = (7u * retx_avg_percent + retx_percent) / 8u;
+  policy_evaluate();
+  xSemaphoreGive(policy_mutex);
+}
+
+/******************************************************************************
+ * Function Name: publish_policy_record_reconnect
+ ******************************************************************************
+ * Summary:
+ *  Records an MQTT reconnection after a lost connection.
+ *
+ ******************************************************************************/
+void publish_policy_record_reconnect(void) {
+  xSemaphoreTake(policy_mutex, portMAX_DELAY);
+  reconnect_ms[reconnect_next] = policy_now_ms();
+  reconnect_next = (reconnect_next + 1u) % MQTT_POLICY_POOR_RECONNECTS;
+  policy_evaluate();
+  xSemaphoreGive(policy_mutex);
+}
+
+/******************************************************************************
+ * Function Name: publish_policy_telemetry
+ ******************************************************************************
+ * Summary:
+ *  Publishes a JSON telemetry record now, or adds it to the current batch.
+ *  The record is dropped while the MQTT connection is down; telemetry is
+ *  QoS 0 and not worth holding through an outage.
+ *
+ * Parameters:
+ *  const char *record : JSON object, copied
+ *  size_t record_len  : Length of the record
+ *
+ * Return:
+ *  cy_rslt_t : CY_RSLT_SUCCESS if published or batched, else an error code
+ *
+ ******************************************************************************/
+cy_rslt_t publish_policy_telemetry(const char *record, size_t record_len) {
+  cy_rslt_t result = CY_RSLT_SUCCESS;
+
+  if ((record_len >= POLICY_BATCH_SIZE) || !publisher_connected()) {
+    return ~CY_RSLT_SUCCESS;
+  }
+
+  xSemaphoreTake(policy_mutex, portMAX_DELAY);
+  if (profile == POLICY_GOOD) {
+    /* QoS 0 takes about half a round trip to the broker. */
+    delivery_sum_ms += rtt_avg_ms / 2u;
+    delivery_count++;
+    result = publisher_send(MQTT_CLASS_TELEMETRY, record, record_len);
+  } else {
+    if (batch_len + record_len + 1u > sizeof(batch)) {
+      policy_flush();
+    }
+    if (batch_len > 0) {
+      batch[batch_len++] = ',';
+    }
+    memcpy(&batch[batch_len], record, record_len);
+    batch_len += record_len;
+    batch_records++;
+    batch_arrival_sum_ms += policy_now_ms();
+  }
+  xSemaphoreGive(policy_mutex);
+
+  return result;
+}
+
+/******************************************************************************
+ * Function Name: policy_evaluate
+ ******************************************************************************
+ * Summary:
+ *  Switches the profile when the metrics cross the thresholds. The good
+ *  thresholds are lower than the poor ones, so the profile does not flap.
+ *  Called with policy_mutex held.
+ *
+ ******************************************************************************/
+static void policy_evaluate(void) {
+  uint32_t now_ms = policy_now_ms();
+  uint32_t reconnects = 0;
+
+  for (uint32_t i = 0; i < MQTT_POLICY_POOR_RECONNECTS; i++) {
+    if ((reconnect_ms[i] != 0) &&
+        ((now_ms - reconnect_ms[i]) < MQTT_POLICY_RECONNECT_WINDOW_MS)) {
+      reconnects++;
+    }
+  }
+
+  if ((profile == POLICY_GOOD) &&
+      ((rtt_avg_ms > MQTT_POLICY_POOR_RTT_MS) ||
+       (retx_avg_percent > MQTT_POLICY_POOR_RETX_PERCENT) ||
+       (reconnects >= MQTT_POLICY_POOR_RECONNECTS))) {
+    policy_switch(POLICY_POOR, reconnects);
+  } else if ((profile == POLICY_POOR) &&
+             (rtt_avg_ms < MQTT_POLICY_GOOD_RTT_MS) &&
+             (retx_avg_percent < MQTT_POLICY_GOOD_RETX_PERCENT) &&
+             (reconnects == 0)) {
+    policy_switch(POLICY_GOOD, reconnects);
+  }
+}
+
+/******************************************************************************
+ * Function Name: policy_switch
+ ******************************************************************************
+ * Summary:
+ *  Changes the profile and publishes the switch as diagnostics. Called with
+ *  policy_mutex held.
+ *
+ * Parameters:
+ *  policy_profile_t new_profile : Profile to switch to
+ *  uint32_t reconnects          : Reconnections within the window
+ *
+ ******************************************************************************/
+static void policy_switch(policy_profile_t new_profile, uint32_t reconnects) {
+  char diag[POLICY_DIAG_SIZE];
+  uint32_t now_ms = policy_now_ms();
+  uint32_t delivery_ms =
+      (delivery_count > 0) ? delivery_sum_ms / delivery_count : 0u;
+  int len;
+
+  len = snprintf(diag, sizeof(diag),
+                 "{\"policy\":\"%s\",\"from\":\"%s\",\"rtt_ms\":%lu,"
+                 "\"retx_pct\":%lu,\"reconnects\":%lu,\"delivery_ms\":%lu,"
+                 "\"duration_s\":%lu}",
+                 profile_names[new_profile], profile_names[profile],
+                 (unsigned long)rtt_avg_ms, (unsigned long)retx_avg_percent,
+                 (unsigned long)reconnects, (unsigned long)delivery_ms,
+                 (unsigned long)((now_ms - profile_since_ms) / 1000u));
+  printf("Publish policy: %s -> %s (RTT %lu ms, retransmissions %lu%%, "
+         "%lu reconnects, telemetry delivery %lu ms)\n",
+         profile_names[profile], profile_names[new_profile],
+         (unsigned long)rtt_avg_ms, (unsigned long)retx_avg_percent,
+         (unsigned long)reconnects, (unsigned long)delivery_ms);
+
+  if (new_profile == POLICY_GOOD) {
+    xTimerStop(batch_timer, 0);
+    policy_flush();
+  } else {
+    xTimerReset(batch_timer, 0);
+  }
+
+  profile = new_profile;
+  profile_since_ms = now_ms;
+  delivery_sum_ms = 0;
+  delivery_count = 0;
+
+  if ((len > 0) && ((size_t)len < sizeof(diag))) {
+    publisher_send(MQTT_CLASS_DIAG, diag, (size_t)len);
+  }
+}
+
+/******************************************************************************
+ * Function Name: policy_flush
+ ******************************************************************************
+ * Summary:
+ *  Publishes the collected telemetry records as one QoS 1 message. Called
+ *  with policy_mutex held.
+ *
+ ******************************************************************************/
+static void policy_flush(void) {
+  char payload[MQTT_PUBLISH_PAYLOAD_MAX];
+  cy_mqtt_publish_info_t publish_info =
+      mqtt_message_classes[MQTT_CLASS_TELEMETRY];
+  int len;
+
+  if (batch_records == 0) {
+    return;
+  }
+
+  len = snprintf(payload, sizeof(payload), "{\"batch\":[%.*s]}",
+                 (int)batch_len, batch);
+  publish_info.qos = CY_MQTT_QOS1;
+  publish_info.payload = payload;
+  publish_info.payload_len = (size_t)len;
+  publisher_enqueue(&publish_info);
+
+  /* Time the records waited in the batch, plus the trip to the broker. */
+  delivery_sum_ms += (batch_records * policy_now_ms() - batch_arrival_sum_ms) +
+                     batch_records * (rtt_avg_ms / 2u);
+  delivery_count += batch_records;
+
+  batch_len = 0;
+  batch_records = 0;
+  batch_arrival_sum_ms = 0;
+}
+
+/******************************************************************************
+ * Function Name: batch_timer_callback
+ ******************************************************************************/
+static void batch_timer_callback(TimerHandle_t timer) {
+  (void)timer;
+
+  /* Skip this period rather than block the timer task. */
+  if (xSemaphoreTake(policy_mutex, 0) == pdTRUE) {
+    policy_flush();
+    xSemaphoreGive(policy_mutex);
+  }
+}
+
+/******************************************************************************
+ * Function Name: policy_now_ms
+ ******************************************************************************/
+static uint32_t policy_now_ms(void) {
+  return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
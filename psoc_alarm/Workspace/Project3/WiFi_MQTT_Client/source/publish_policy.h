@@ -0,0 +1,24 @@
+/*
+ * publish_policy.h
+ *
+ * Link-quality-aware publish policy. Tracks PUBACK round trips,
+ * retransmissions and reconnections, and switches telemetry between sending
+ * immediately and batching.
+ */
+
+#ifndef SOURCE_PUBLISH_POLICY_H_
+#define SOURCE_PUBLISH_POLICY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cy_mqtt_api.h"
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+cy_rslt_t publish_policy_init(void);
+void publish_policy_record_publish(uint32_t rtt_ms, uint32_t retransmissions);
+void publish_policy_record_reconnect(void);
+cy_rslt_t publish_policy_telemetry(const char *record, size_t record_len);
+
+#endif /* SOURCE_PUBLISH_POLICY_H_ */
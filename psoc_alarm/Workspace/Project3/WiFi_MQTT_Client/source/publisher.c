@@ -0,0 +1,604 @@
+/**
+ * This file implements the pipelined MQTT publisher.
+ *
+ * cy_mqtt_publish() returns only once a QoS 1 message is acknowledged, so a
+ * single publishing task pays one broker round trip per message. Here a pool
+ * of MQTT_PUBLISH_WINDOW publisher tasks takes messages from a queue, which
+ * keeps up to that many messages in flight. The MQTT library matches each
+ * PUBACK to the waiting task by packet identifier.
+ *
+ * While the MQTT connection is down the publisher tasks hold their message.
+ * After the reconnection it is published again as a new message: cy_mqtt
+ * gives every cy_mqtt_publish() a fresh packet identifier and offers no
+ * resend with the original one, so the DUP flag would not let the broker
+ * match it and stays clear. Delivery is at least once; a message whose
+ * PUBACK was lost reaches the subscribers twice, with the same "seq".
+ *
+ * Messages may overtake each other within the window. The state and event
+ * classes, and any retained message, therefore go through an ordered lane
+ * instead: one more publisher task that publishes them one at a time, so
+ * the last state published is also the one the broker retains. The window
+ * serves telemetry, diagnostics, trace and record messages. JSON payloads
+ * are tagged with a "seq" member so that subscribers can drop stale or
+ * repeated updates.
+ *
+ * PUBLISHER_ALARM_SLOTS of the slots are kept for the state task, which
+ * takes them with publisher_reserve_alarm(), so that telemetry and
+ * diagnostics cannot crowd out an alarm. QoS 0 messages are dropped while
+ * the MQTT connection is down instead of holding a slot until the
+ * reconnection.
+ *
+ * Producers can format their payload straight into a slot with
+ * publisher_reserve() and publisher_commit(). The slot keeps
+ * PUBLISHER_HEADROOM bytes in front of the payload for the "seq" member, and
+ * the MQTT library sends the payload from the slot, so it is written once.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+/* FreeRTOS header files */
+#include <FreeRTOS.h>
+#include "event_groups.h"
+#include "queue.h"
+#include "task.h"
+
+#include "core_mqtt_config.h"
+#include "cy_utils.h"
+#include "link_monitor.h"
+#include "mqtt_client_config.h"
+#include "mqtt_task.h"
+#include "publish_policy.h"
+#include "publisher.h"
+
+#if (PUBLISHER_TASKS > MQTT_STATE_ARRAY_MAX_COUNT)
+#error "MQTT_PUBLISH_WINDOW exceeds the in-flight records of the MQTT library"
+#endif
+
+/******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Event group bit set while the MQTT connection is up. */
+#define PUBLISHER_CONNECTED (1u << 0)
+
+/* The maximum number of times each PUBLISH is retried while connected. */
+#define PUBLISH_RETRY_LIMIT (10)
+
+/* Delay in milliseconds before a failed PUBLISH is retried. */
+#define PUBLISH_RETRY_MS (1000)
+
+/* Room in front of a reserved payload for the sequence number. Its '{' is
+ * overwritten by the ',' closing the "seq" member.
+ */
+#define PUBLISHER_HEADROOM (sizeof("{\"seq\":4294967295,") - 2)
+
+/******************************************************************************
+ * Types
+ ******************************************************************************/
+typedef struct {
+  cy_mqtt_publish_info_t info;
+  /* Stopped once the message is published, DEADLINE_COUNT for none. */
+  deadline_id_t deadline;
+  char payload[MQTT_PUBLISH_PAYLOAD_MAX];
+} publisher_slot_t;
+
+/******************************************************************************
+ * Global Variables
+ ******************************************************************************/
+static publisher_slot_t slots[PUBLISHER_SLOTS];
+
+/* Indices of free slots, shared and kept for the alarms, and of slots
+ * waiting to be published, in the window or in the ordered lane. The alarm
+ * slots are the last PUBLISHER_ALARM_SLOTS.
+ */
+static QueueHandle_t free_q;
+static QueueHandle_t alarm_free_q;
+static QueueHandle_t send_q;
+static QueueHandle_t ordered_q;
+static StaticQueue_t free_q_buffer;
+static StaticQueue_t alarm_free_q_buffer;
+static StaticQueue_t send_q_buffer;
+static StaticQueue_t ordered_q_buffer;
+static uint8_t free_q_storage[PUBLISHER_SLOTS];
+static uint8_t alarm_free_q_storage[PUBLISHER_ALARM_SLOTS];
+static uint8_t send_q_storage[PUBLISHER_SLOTS];
+static uint8_t ordered_q_storage[PUBLISHER_SLOTS];
+
+static EventGroupHandle_t publisher_events;
+static StaticEventGroup_t publisher_events_buffer;
+
+static StackType_t publisher_stacks[PUBLISHER_TASKS]
+                                   [PUBLISHER_TASK_STACK_SIZE];
+static StaticTask_t publisher_tcbs[PUBLISHER_TASKS];
+
+/* Sequence number of the next JSON payload. */
+static uint32_t publish_seq;
+
+/* Publishes dropped after PUBLISH_RETRY_LIMIT attempts. */
+static uint32_t publish_failures;
+
+/* QoS 0 messages dropped while disconnected, since the last resume. Counted
+ * by the producers and every publisher task, so only updated atomically.
+ */
+static volatile uint32_t qos0_dropped;
+
+/******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+static void publisher_task(void *pvParameters);
+static publisher_slot_t *publisher_slot(const char *payload);
+static char *publisher_take(QueueHandle_t queue, size_t *capacity);
+static void publisher_free(uint8_t index);
+static cy_rslt_t publisher_queue(const cy_mqtt_publish_info_t *policy,
+                                 char *payload, size_t payload_len,
+                                 bool ordered);
+
+/******************************************************************************
+ * Function Name: publisher_init
+ ******************************************************************************
+ * Summary:
+ *  Creates the message queues, the publisher tasks of the window and the
+ *  one of the ordered lane, in static memory.
+ *  Publishing starts with the first publisher_resume().
+ *
+ * Return:
+ *  cy_rslt_t : CY_RSLT_SUCCESS on success, else an error code
+ *
+ ******************************************************************************/
+cy_rslt_t publisher_init(void) {
+  free_q = xQueueCreateStatic(PUBLISHER_SLOTS, sizeof(uint8_t), free_q_storage,
+                              &free_q_buffer);
+  alarm_free_q =
+      xQueueCreateStatic(PUBLISHER_ALARM_SLOTS, sizeof(uint8_t),
+                         alarm_free_q_storage, &alarm_free_q_buffer);
+  send_q = xQueueCreateStatic(PUBLISHER_SLOTS, sizeof(uint8_t), send_q_storage,
+                              &send_q_buffer);
+  ordered_q = xQueueCreateStatic(PUBLISHER_SLOTS, sizeof(uint8_t),
+                                 ordered_q_storage, &ordered_q_buffer);
+  publisher_events = xEventGroupCreateStatic(&publisher_events_buffer);
+  vQueueAddToRegistry(free_q, "Publisher free");
+  vQueueAddToRegistry(alarm_free_q, "Publisher alarm");
+  vQueueAddToRegistry(send_q, "Publisher send");
+  vQueueAddToRegistry(ordered_q, "Publisher ordered");
+
+  for (uint8_t index = 0; index < PUBLISHER_SLOTS; index++) {
+    publisher_free(index);
+  }
+
+  /* The last task is the ordered lane. */
+  for (uint32_t i = 0; i < PUBLISHER_TASKS; i++) {
+    xTaskCreateStatic(publisher_task, "Publisher task",
+                      PUBLISHER_TASK_STACK_SIZE,
+                      (i < MQTT_PUBLISH_WINDOW) ? send_q : ordered_q,
+                      PUBLISHER_TASK_PRIORITY, publisher_stacks[i],
+                      &publisher_tcbs[i]);
+  }
+  return CY_RSLT_SUCCESS;
+}
+
+/******************************************************************************
+ * Function Name: publisher_reserve
+ ******************************************************************************
+ * Summary:
+ *  Takes a free slot for a payload the caller formats in place. Does not
+ *  block. The slot is handed back with publisher_commit() or
+ *  publisher_cancel().
+ *
+ * Parameters:
+ *  size_t *capacity : Set to the usable payload size, 0 if none is free
+ *
+ * Return:
+ *  char* : Payload buffer, NULL when every slot is in use
+ *
+ ******************************************************************************/
+char *publisher_reserve(size_t *capacity) {
+  return publisher_take(free_q, capacity);
+}
+
+/******************************************************************************
+ * Function Name: publisher_reserve_alarm
+ ******************************************************************************
+ * Summary:
+ *  publisher_reserve() for the state and event messages of the state task:
+ *  takes one of the alarm slots, or a shared one when they are all in use.
+ *
+ * Parameters:
+ *  size_t *capacity : Set to the usable payload size, 0 if none is free
+ *
+ * Return:
+ *  char* : Payload buffer, NULL when every slot is in use
+ *
+ ******************************************************************************/
+char *publisher_reserve_alarm(size_t *capacity) {
+  char *payload = publisher_take(alarm_free_q, capacity);
+
+  return (payload != NULL) ? payload : publisher_take(free_q, capacity);
+}
+
+/* Takes a slot from a free queue without blocking. */
+static char *publisher_take(QueueHandle_t queue, size_t *capacity) {
+  uint8_t index;
+
+  if (xQueueReceive(queue, &index, 0) != pdTRUE) {
+    *capacity = 0;
+    return NULL;
+  }
+
+  slots[index].deadline = DEADLINE_COUNT;
+  *capacity = sizeof(slots[index].payload) - PUBLISHER_HEADROOM;
+  return slots[index].payload + PUBLISHER_HEADROOM;
+}
+
+/* Hands a slot back to its free queue. */
+static void publisher_free(uint8_t index) {
+  xQueueSend((index >= PUBLISHER_SLOTS - PUBLISHER_ALARM_SLOTS) ? alarm_free_q
+                                                                 : free_q,
+             &index, 0);
+}
+
+/******************************************************************************
+ * Function Name: publisher_connected
+ ******************************************************************************
+ * Summary:
+ *  Tells whether the MQTT connection is up, between publisher_resume() and
+ *  publisher_pause().
+ *
+ * Return:
+ *  bool : true while connected
+ *
+ ******************************************************************************/
+bool publisher_connected(void) {
+  return (xEventGroupGetBits(publisher_events) & PUBLISHER_CONNECTED) != 0u;
+}
+
+/******************************************************************************
+ * Function Name: publisher_commit
+ ******************************************************************************
+ * Summary:
+ *  Queues a payload formatted into a reserved slot with the topic, QoS and
+ *  retain policy of its class. State and event messages take the ordered
+ *  lane. JSON payloads get their sequence number in the headroom of the
+ *  slot. The payload must not be used afterwards.
+ *
+ * Parameters:
+ *  mqtt_message_class_t message_class : Class of the message
+ *  char *payload                      : Buffer from publisher_reserve()
+ *  size_t payload_len                 : Payload length, as returned by
+ *                                       snprintf()
+ *
+ * Return:
+ *  cy_rslt_t : CY_RSLT_SUCCESS if queued, else an error code when the payload
+ *              was truncated
+ *
+ ******************************************************************************/
+cy_rslt_t publisher_commit(mqtt_message_class_t message_class, char *payload,
+                           size_t payload_len) {
+  return publisher_queue(&mqtt_message_classes[message_class], payload,
+                         payload_len,
+                         (message_class == MQTT_CLASS_STATE) ||
+                             (message_class == MQTT_CLASS_EVENT) ||
+                             mqtt_message_classes[message_class].retain);
+}
+
+/******************************************************************************
+ * Function Name: publisher_queue
+ ******************************************************************************
+ * Summary:
+ *  Queues a reserved slot for the publisher tasks.
+ *
+ * Parameters:
+ *  const cy_mqtt_publish_info_t *policy : Topic, QoS and retain flag
+ *  char *payload                        : Buffer from publisher_reserve()
+ *  size_t payload_len                   : Payload length
+ *  bool ordered                         : true for the ordered lane
+ *
+ * Return:
+ *  cy_rslt_t : CY_RSLT_SUCCESS if queued, else an error code when the payload
+ *              does not fit or a QoS 0 message finds the connection down
+ *
+ ******************************************************************************/
+static cy_rslt_t publisher_queue(const cy_mqtt_publish_info_t *policy,
+                                 char *payload, size_t payload_len,
+                                 bool ordered) {
+  publisher_slot_t *slot = publisher_slot(payload);
+  uint8_t index = (uint8_t)(slot - slots);
+  char prefix[PUBLISHER_HEADROOM + 2];
+  uint32_t seq;
+  int len;
+
+  if (payload_len >= sizeof(slot->payload) - PUBLISHER_HEADROOM) {
+    publisher_free(index);
+    return ~CY_RSLT_SUCCESS;
+  }
+  if ((policy->qos == CY_MQTT_QOS0) && !publisher_connected()) {
+    __atomic_fetch_add(&qos0_dropped, 1u, __ATOMIC_RELAXED);
+    publisher_free(index);
+    return ~CY_RSLT_SUCCESS;
+  }
+
+  slot->info = *policy;
+  slot->info.payload = payload;
+  slot->info.payload_len = payload_len;
+  slot->info.dup = false;
+
+  if ((payload_len > 2) && (payload[0] == '{')) {
+    taskENTER_CRITICAL();
+    seq = publish_seq++;
+    taskEXIT_CRITICAL();
+    len = snprintf(prefix, sizeof(prefix), "{\"seq\":%lu,",
+                   (unsigned long)seq);
+    memcpy(payload + 1 - len, prefix, (size_t)len);
+    slot->info.payload = payload + 1 - len;
+    slot->info.payload_len = payload_len + (size_t)len - 1;
+  }
+
+  xQueueSend(ordered ? ordered_q : send_q, &index, 0);
+  return CY_RSLT_SUCCESS;
+}
+
+/******************************************************************************
+ * Function Name: publisher_cancel
+ ******************************************************************************
+ * Summary:
+ *  Returns a reserved slot without publishing it.
+ *
+ * Parameters:
+ *  char *payload : Buffer from publisher_reserve()
+ *
+ ******************************************************************************/
+void publisher_cancel(char *payload) {
+  publisher_free((uint8_t)(publisher_slot(payload) - slots));
+}
+
+/******************************************************************************
+ * Function Name: publisher_set_deadline
+ ******************************************************************************
+ * Summary:
+ *  Makes the publisher task stop a deadline once cy_mqtt_publish() returns
+ *  for the message, i.e. once the broker has it. Call before
+ *  publisher_commit().
+ *
+ * Parameters:
+ *  char *payload    : Buffer from publisher_reserve()
+ *  deadline_id_t id : Deadline
+ *
+ ******************************************************************************/
+void publisher_set_deadline(char *payload, deadline_id_t id) {
+  publisher_slot(payload)->deadline = id;
+}
+
+/******************************************************************************
+ * Function Name: publisher_enqueue
+ ******************************************************************************
+ * Summary:
+ *  Copies a message into a free slot and queues it for publishing. Does not
+ *  block. The topic must stay valid until the message is published.
+ *  Retained messages take the ordered lane.
+ *
+ * Parameters:
+ *  const cy_mqtt_publish_info_t *publish_info : Message to publish
+ *
+ * Return:
+ *  cy_rslt_t : CY_RSLT_SUCCESS if queued, else an error code when the queue
+ *              is full or the payload too long
+ *
+ ******************************************************************************/
+cy_rslt_t publisher_enqueue(const cy_mqtt_publish_info_t *publish_info) {
+  size_t capacity;
+  char *payload;
+
+  payload = publisher_reserve(&capacity);
+  if (payload == NULL) {
+    return ~CY_RSLT_SUCCESS;
+  }
+  if (publish_info->payload_len >= capacity) {
+    publisher_cancel(payload);
+    return ~CY_RSLT_SUCCESS;
+  }
+  memcpy(payload, publish_info->payload, publish_info->payload_len);
+
+  return publisher_queue(publish_info, payload, publish_info->payload_len,
+                         publish_info->retain);
+}
+
+/******************************************************************************
+ * Function Name: publisher_send
+ ******************************************************************************
+ * Summary:
+ *  Copies a message into a free slot and queues it with the topic, QoS and
+ *  retain policy of its class, like publisher_commit().
+ *
+ * Parameters:
+ *  mqtt_message_class_t message_class : Class of the message
+ *  const char *payload                : Payload, copied
+ *  size_t payload_len                 : Payload length
+ *
+ * Return:
+ *  cy_rslt_t : CY_RSLT_SUCCESS if queued, else an error code when the queue
+ *              is full or the payload too long
+ *
+ ******************************************************************************/
+cy_rslt_t publisher_send(mqtt_message_class_t message_class,
+                         const char *payload, size_t payload_len) {
+  size_t capacity;
+  char *slot_payload;
+
+  slot_payload = publisher_reserve(&capacity);
+  if (slot_payload == NULL) {
+    return ~CY_RSLT_SUCCESS;
+  }
+  if (payload_len >= capacity) {
+    publisher_cancel(slot_payload);
+    return ~CY_RSLT_SUCCESS;
+  }
+  memcpy(slot_payload, payload, payload_len);
+
+  return publisher_commit(message_class, slot_payload, payload_len);
+}
+
+/******************************************************************************
+ * Function Name: publisher_pause
+ ******************************************************************************
+ * Summary:
+ *  Holds new QoS 1 publishes while the MQTT connection is down; QoS 0 ones
+ *  are dropped.
+ *
+ ******************************************************************************/
+void publisher_pause(void) {
+  xEventGroupClearBits(publisher_events, PUBLISHER_CONNECTED);
+}
+
+/******************************************************************************
+ * Function Name: publisher_resume
+ ******************************************************************************
+ * Summary:
+ *  Restarts publishing once the MQTT connection is up. Messages that were in
+ *  flight at the disconnection are published again.
+ *
+ ******************************************************************************/
+void publisher_resume(void) {
+  uint32_t dropped = __atomic_exchange_n(&qos0_dropped, 0u, __ATOMIC_RELAXED);
+
+  if (dropped != 0u) {
+    printf("  Publisher: %lu QoS 0 messages dropped while disconnected\n",
+           (unsigned long)dropped);
+  }
+  xEventGroupSetBits(publisher_events, PUBLISHER_CONNECTED);
+}
+
+/******************************************************************************
+ * Function Name: publisher_benchmark
+ ******************************************************************************
+ * Summary:
+ *  Publishes a burst of QoS 1 messages on MQTT_PUB_TOPIC "/bench" and prints
+ *  the throughput, to compare windows against a broker with added latency.
+ *
+ * Parameters:
+ *  uint32_t count : Number of messages
+ *
+ ******************************************************************************/
+void publisher_benchmark(uint32_t count) {
+  static const char bench_topic[] = MQTT_PUB_TOPIC "/bench";
+  cy_mqtt_publish_info_t bench_info = {.qos = CY_MQTT_QOS1,
+                                       .topic = bench_topic,
+                                       .topic_len = sizeof(bench_topic) - 1,
+                                       .retain = false,
+                                       .dup = false};
+  char payload[24];
+  uint32_t failures = publish_failures;
+  TickType_t start = xTaskGetTickCount();
+
+  for (uint32_t i = 0; i < count;) {
+    bench_info.payload = payload;
+    bench_info.payload_len =
+        snprintf(payload, sizeof(payload), "%lu", (unsigned long)i);
+    if (publisher_enqueue(&bench_info) == CY_RSLT_SUCCESS) {
+      i++;
+    } else {
+      vTaskDelay(1);
+    }
+  }
+
+  /* Done once every slot is back. */
+  while (uxQueueMessagesWaiting(free_q) <
+         PUBLISHER_SLOTS - PUBLISHER_ALARM_SLOTS) {
+    vTaskDelay(1);
+  }
+
+  uint32_t elapsed_ms = (xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+  printf("Publish benchmark: %lu QoS 1 messages in %lu ms (%lu msg/s), "
+         "window %d, %lu failed\n\n",
+         (unsigned long)count, (unsigned long)elapsed_ms,
+         (unsigned long)((elapsed_ms > 0) ? (count * 1000u) / elapsed_ms : 0),
+         MQTT_PUBLISH_WINDOW, (unsigned long)(publish_failures - failures));
+}
+
+/******************************************************************************
+ * Function Name: publisher_task
+ ******************************************************************************
+ * Summary:
+ *  Publishes one message at a time and waits for its acknowledgement. Runs
+ *  MQTT_PUBLISH_WINDOW times on the window and once on the ordered lane.
+ *
+ * Parameters:
+ *  void *pvParameters : Queue of the slots to publish, send_q or ordered_q
+ *
+ ******************************************************************************/
+static void publisher_task(void *pvParameters) {
+  QueueHandle_t queue = (QueueHandle_t)pvParameters;
+  publisher_slot_t *slot;
+  cy_rslt_t result;
+  uint8_t index;
+
+  while (true) {
+    xQueueReceive(queue, &index, portMAX_DELAY);
+    slot = &slots[index];
+
+    for (uint32_t attempt = 0, retransmissions = 0;; retransmissions++) {
+      /* A QoS 0 message is not worth a slot held through an outage. */
+      if ((slot->info.qos == CY_MQTT_QOS0) && !publisher_connected()) {
+        __atomic_fetch_add(&qos0_dropped, 1u, __ATOMIC_RELAXED);
+        break;
+      }
+      xEventGroupWaitBits(publisher_events, PUBLISHER_CONNECTED, pdFALSE,
+                          pdTRUE, portMAX_DELAY);
+
+      TickType_t publish_start = xTaskGetTickCount();
+      result = cy_mqtt_publish(mqtt_connection, &slot->info);
+      uint32_t rtt_ms =
+          (xTaskGetTickCount() - publish_start) * portTICK_PERIOD_MS;
+      if (result == CY_RSLT_SUCCESS) {
+        if (slot->deadline != DEADLINE_COUNT) {
+          deadline_stop(slot->deadline);
+        }
+        link_monitor_publish_latency(rtt_ms);
+        if (slot->info.qos != CY_MQTT_QOS0) {
+          publish_policy_record_publish(rtt_ms, retransmissions);
+        }
+        break;
+      }
+
+      /* Attempts during a disconnection do not count, the message waits
+       * for the reconnection instead.
+       */
+      if (publisher_connected() && (++attempt >= PUBLISH_RETRY_LIMIT)) {
+        printf("  Publisher: MQTT Publish on '%.*s' failed with error "
+               "0x%0X.\n\n",
+               slot->info.topic_len, slot->info.topic, (int)result);
+        publish_failures++;
+        publish_policy_record_publish(rtt_ms, retransmissions + 1u);
+
+        /* Communicate the publish failure with the connection manager, if
+         * it has room: publish_failures counts it either way.
+         */
+        (void)mqtt_task_send(HANDLE_MQTT_PUBLISH_FAILURE, 0);
+        break;
+      }
+
+      vTaskDelay(pdMS_TO_TICKS(PUBLISH_RETRY_MS));
+    }
+
+    publisher_free(index);
+  }
+}
+
+/******************************************************************************
+ * Function Name: publisher_slot
+ ******************************************************************************
+ * Summary:
+ *  Finds the slot of a payload buffer from publisher_reserve().
+ *
+ * Parameters:
+ *  const char *payload : Reserved payload buffer
+ *
+ * Return:
+ *  publisher_slot_t* : Slot holding the buffer
+ *
+ ******************************************************************************/
+static publisher_slot_t *publisher_slot(const char *payload) {
+  size_t offset = (size_t)(payload - (const char *)slots);
+
+  CY_ASSERT(offset < sizeof(slots));
+  return &slots[offset / sizeof(publisher_slot_t)];
+}
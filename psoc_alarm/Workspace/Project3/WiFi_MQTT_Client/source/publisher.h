@@ -0,0 +1,62 @@
+/*
+ * publisher.h
+ *
+ * Pipelined MQTT publisher. Keeps up to MQTT_PUBLISH_WINDOW publishes in
+ * flight, publishes the state and event messages in order on a lane of
+ * their own, and publishes unacknowledged ones again after a reconnection,
+ * at least once. QoS 0 messages are dropped while disconnected.
+ */
+
+#ifndef SOURCE_PUBLISHER_H_
+#define SOURCE_PUBLISHER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "cy_mqtt_api.h"
+#include "deadline.h"
+#include "mqtt_client_config.h"
+
+/*******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Task parameters for the publisher tasks. A publisher task only runs
+ * cy_mqtt_publish(), through coreMQTT and the mbedTLS record layer down to
+ * the lwIP mailbox, and the printf() of a failed publish. 2.5 KB is an
+ * estimate of that path with a margin, pending a stack profile on the board
+ * (see stack_profile.c); there are PUBLISHER_TASKS of them.
+ */
+#define PUBLISHER_TASK_PRIORITY (1)
+#define PUBLISHER_TASK_STACK_SIZE (512 + 128)
+
+/* Publisher tasks: the window and the ordered lane of the state and event
+ * messages.
+ */
+#define PUBLISHER_TASKS (MQTT_PUBLISH_WINDOW + 1)
+
+/* Slots kept for the state and event messages of the state task. */
+#define PUBLISHER_ALARM_SLOTS (4u)
+
+/* Queued plus in-flight messages. */
+#define PUBLISHER_SLOTS \
+  (MQTT_PUBLISH_QUEUE_LENGTH + PUBLISHER_TASKS + PUBLISHER_ALARM_SLOTS)
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+cy_rslt_t publisher_init(void);
+char *publisher_reserve(size_t *capacity);
+char *publisher_reserve_alarm(size_t *capacity);
+cy_rslt_t publisher_commit(mqtt_message_class_t message_class, char *payload,
+                           size_t payload_len);
+void publisher_cancel(char *payload);
+void publisher_set_deadline(char *payload, deadline_id_t id);
+cy_rslt_t publisher_enqueue(const cy_mqtt_publish_info_t *publish_info);
+cy_rslt_t publisher_send(mqtt_message_class_t message_class,
+                         const char *payload, size_t payload_len);
+void publisher_pause(void);
+void publisher_resume(void);
+bool publisher_connected(void);
+void publisher_benchmark(uint32_t count);
+
+#endif /* SOURCE_PUBLISHER_H_ */
@@ -0,0 +1,467 @@
+/**
+ * This file implements the event recorder.
+ *
+ * Records go into a byte ring, each one the tick count (4 bytes), the source
+ * and the payload length (1 byte each) and up to RECORDER_PAYLOAD_MAX bytes
+ * of payload. A button press takes 6 bytes, a Bluetooth state 13 and a
+ * publish 11, so the ring holds several hundred events. It is a flight
+ * recorder and drops the oldest records. Writing a record copies a few bytes
+ * with interrupts disabled, cheap enough to stay on in Release builds.
+ *
+ * The ring is in a no-init section: after a warm reset (watchdog, fault,
+ * CY_ASSERT) the records of the previous boot are still there, followed by a
+ * RECORDER_BOOT record. A ring that does not walk cleanly from its oldest
+ * record to its head is cleared at boot.
+ *
+ * Publishing RECDUMP makes the recorder task publish the ring on
+ * MQTT_RECORD_TOPIC as text lines, read by host/source/replay.c:
+ *
+ *   REC BEGIN <records> <boots>
+ *   R <index> <time_ms> <source> <payload>   (index and payload hexadecimal)
+ *   REC END <records>
+ *
+ * Recording goes on during the dump. The messages of the dump may arrive
+ * out of order, the index orders the records again.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+/* FreeRTOS header files */
+#include <FreeRTOS.h>
+#include "task.h"
+
+#include "cyhal.h"
+
+#include "mqtt_client_config.h"
+#include "publisher.h"
+#include "recorder.h"
+
+#if RECORDER_ENABLE &&                                                         \
+    ((RECORDER_BUFFER_SIZE & (RECORDER_BUFFER_SIZE - 1u)) != 0u)
+#error "RECORDER_BUFFER_SIZE must be a power of two"
+#endif
+
+/******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Marks an initialized ring. */
+#define RECORDER_MAGIC (0x52454331u)
+
+/* Tick count, source and payload length. */
+#define RECORDER_HEADER_SIZE (6u)
+
+/* Wait for a free publisher slot during a dump. */
+#define RECORDER_PUBLISH_RETRY_MS (50u)
+#define RECORDER_PUBLISH_RETRIES (40u)
+
+/* Longest dump line. */
+#define RECORDER_LINE_SIZE (96u)
+
+/******************************************************************************
+ * Types
+ ******************************************************************************/
+typedef struct {
+  uint32_t magic;
+  /* Bytes written since the ring was cleared. */
+  uint32_t head;
+  /* Start of the oldest record. */
+  uint32_t tail;
+  uint32_t boots;
+  uint8_t ring[RECORDER_BUFFER_SIZE];
+} recorder_store_t;
+
+/* Dump in progress. */
+typedef struct {
+  char *buffer;
+  size_t size;
+  size_t len;
+  bool failed;
+} recorder_sink_t;
+
+/******************************************************************************
+ * Global Variables
+ ******************************************************************************/
+#if RECORDER_ENABLE
+static CY_NOINIT recorder_store_t store;
+
+static TaskHandle_t recorder_task_handle;
+#endif
+
+/******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+#if RECORDER_ENABLE
+static bool recorder_walk(void);
+static void recorder_store(recorder_source_t source, const void *data,
+                           size_t len);
+static uint8_t recorder_byte(uint32_t offset);
+static void recorder_dump(void);
+static void recorder_emit(recorder_sink_t *sink, const char *line, int len);
+static void recorder_flush(recorder_sink_t *sink);
+#endif
+
+/******************************************************************************
+ * Function Name: recorder_init
+ ******************************************************************************
+ * Summary:
+ *  Keeps the records of the previous boots if the ring is intact, clears it
+ *  otherwise, and records the boot. Called before the scheduler starts.
+ *
+ ******************************************************************************/
+void recorder_init(void) {
+#if RECORDER_ENABLE
+  if ((store.magic != RECORDER_MAGIC) ||
+      ((store.head - store.tail) > RECORDER_BUFFER_SIZE) || !recorder_walk()) {
+    memset(&store, 0, sizeof(store));
+    store.magic = RECORDER_MAGIC;
+  }
+  store.boots++;
+  recorder_input(RECORDER_BOOT, NULL, 0);
+#endif
+}
+
+/******************************************************************************
+ * Function Name: recorder_input
+ ******************************************************************************
+ * Summary:
+ *  Records an event. Safe from tasks and ISRs.
+ *
+ * Parameters:
+ *  recorder_source_t source : Source of the event
+ *  const void *data         : Payload, may be NULL when len is 0
+ *  size_t len               : Payload length, truncated to
+ *                             RECORDER_PAYLOAD_MAX
+ *
+ ******************************************************************************/
+void recorder_input(recorder_source_t source, const void *data, size_t len) {
+#if RECORDER_ENABLE
+  uint32_t saved_intr = cyhal_system_critical_section_enter();
+
+  recorder_store(source, data,
+                 (len < RECORDER_PAYLOAD_MAX) ? len : RECORDER_PAYLOAD_MAX);
+  cyhal_system_critical_section_exit(saved_intr);
+#else
+  (void)source;
+  (void)data;
+  (void)len;
+#endif
+}
+
+/* Records an event with a one-byte payload, such as a command. */
+void recorder_value(recorder_source_t source, uint32_t value) {
+  uint8_t byte = (uint8_t)value;
+
+  recorder_input(source, &byte, sizeof(byte));
+}
+
+/******************************************************************************
+ * Function Name: recorder_state
+ ******************************************************************************
+ * Summary:
+ *  Records a State posted to the state task. The layout of State depends on
+ *  the enum size of the compiler, so the state is recorded as one byte and
+ *  the meta as RECORDER_STATE_META_SIZE bytes.
+ *
+ * Parameters:
+ *  recorder_source_t source : Source of the state
+ *  uint32_t state           : State.state
+ *  const void *meta         : State.meta
+ *
+ ******************************************************************************/
+void recorder_state(recorder_source_t source, uint32_t state,
+                    const void *meta) {
+  uint8_t data[1u + RECORDER_STATE_META_SIZE];
+
+  data[0] = (uint8_t)state;
+  memcpy(&data[1], meta, RECORDER_STATE_META_SIZE);
+  recorder_input(source, data, sizeof(data));
+}
+
+/******************************************************************************
+ * Function Name: recorder_publish
+ ******************************************************************************
+ * Summary:
+ *  Records a message of the state task as it goes to the publisher: the
+ *  outputs the host replayer compares.
+ *
+ * Parameters:
+ *  uint32_t message_class : mqtt_message_class_t of the message
+ *  const char *payload    : Payload
+ *  size_t len             : Payload length
+ *
+ ******************************************************************************/
+void recorder_publish(uint32_t message_class, const char *payload,
+                      size_t len) {
+  uint32_t hash = recorder_hash(payload, len);
+  uint8_t data[5];
+
+  data[0] = (uint8_t)message_class;
+  memcpy(&data[1], &hash, sizeof(hash));
+  recorder_input(RECORDER_PUBLISH, data, sizeof(data));
+}
+
+/* FNV-1a hash of a payload. */
+uint32_t recorder_hash(const char *payload, size_t len) {
+  uint32_t hash = 2166136261u;
+
+  for (size_t i = 0; i < len; i++) {
+    hash = (hash ^ (uint8_t)payload[i]) * 16777619u;
+  }
+  return hash;
+}
+
+/* Position of the next record, for recorder_read(). */
+uint32_t recorder_cursor(void) {
+#if RECORDER_ENABLE
+  return store.head;
+#else
+  return 0u;
+#endif
+}
+
+/******************************************************************************
+ * Function Name: recorder_read
+ ******************************************************************************
+ * Summary:
+ *  Reads the record at a position and moves to the next one. A position
+ *  whose record was dropped in the meantime moves to the oldest record.
+ *
+ * Parameters:
+ *  uint32_t *cursor           : Position, from recorder_cursor(), or any
+ *                               stale value for the oldest record
+ *  recorder_record_t *record  : Receives the record
+ *
+ * Return:
+ *  bool : false once the cursor reached the newest record
+ *
+ ******************************************************************************/
+bool recorder_read(uint32_t *cursor, recorder_record_t *record) {
+#if RECORDER_ENABLE
+  uint32_t saved_intr = cyhal_system_critical_section_enter();
+  uint32_t offset = *cursor;
+  bool found = false;
+
+  if ((offset - store.tail) > (store.head - store.tail)) {
+    offset = store.tail;
+  }
+  if (offset != store.head) {
+    record->time_ms = 0u;
+    for (uint32_t i = 0; i < 4u; i++) {
+      record->time_ms |= (uint32_t)recorder_byte(offset + i) << (8u * i);
+    }
+    record->source = recorder_byte(offset + 4u);
+    record->len = recorder_byte(offset + 5u);
+    for (uint32_t i = 0; i < record->len; i++) {
+      record->data[i] = recorder_byte(offset + RECORDER_HEADER_SIZE + i);
+    }
+    offset += RECORDER_HEADER_SIZE + record->len;
+    found = true;
+  }
+  *cursor = offset;
+  cyhal_system_critical_section_exit(saved_intr);
+  return found;
+#else
+  (void)cursor;
+  (void)record;
+  return false;
+#endif
+}
+
+/******************************************************************************
+ * Function Name: recorder_request_dump
+ ******************************************************************************
+ * Summary:
+ *  Asks the recorder task to publish the ring on MQTT_RECORD_TOPIC.
+ *
+ ******************************************************************************/
+void recorder_request_dump(void) {
+#if RECORDER_ENABLE
+  if (recorder_task_handle != NULL) {
+    xTaskNotifyGive(recorder_task_handle);
+  }
+#endif
+}
+
+/******************************************************************************
+ * Function Name: recorder_task
+ ******************************************************************************
+ * Summary:
+ *  Publishes the ring when requested.
+ *
+ * Parameters:
+ *  void *pvParameters : Task parameter defined during task creation (unused)
+ *
+ ******************************************************************************/
+void recorder_task(void *pvParameters) {
+  (void)pvParameters;
+
+#if RECORDER_ENABLE
+  recorder_task_handle = xTaskGetCurrentTaskHandle();
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    recorder_dump();
+  }
+#else
+  vTaskDelete(NULL);
+#endif
+}
+
+#if RECORDER_ENABLE
+/******************************************************************************
+ * Function Name: recorder_walk
+ ******************************************************************************
+ * Summary:
+ *  Checks that the records of a kept ring lead from the oldest one to the
+ *  head.
+ *
+ * Return:
+ *  bool : true if the ring is intact
+ *
+ ******************************************************************************/
+static bool recorder_walk(void) {
+  uint32_t offset = store.tail;
+
+  while (offset != store.head) {
+    uint32_t size = RECORDER_HEADER_SIZE + recorder_byte(offset + 5u);
+
+    if ((recorder_byte(offset + 4u) >= RECORDER_SOURCE_COUNT) ||
+        (size > RECORDER_HEADER_SIZE + RECORDER_PAYLOAD_MAX) ||
+        ((store.head - offset) < size)) {
+      return false;
+    }
+    offset += size;
+  }
+  return true;
+}
+
+/******************************************************************************
+ * Function Name: recorder_store
+ ******************************************************************************
+ * Summary:
+ *  Appends a record, dropping the oldest ones to make room. Called with
+ *  interrupts disabled.
+ *
+ ******************************************************************************/
+static void recorder_store(recorder_source_t source, const void *data,
+                           size_t len) {
+  const uint8_t *bytes = data;
+  uint32_t time_ms = xTaskGetTickCountFromISR() * portTICK_PERIOD_MS;
+  uint32_t size = RECORDER_HEADER_SIZE + (uint32_t)len;
+  uint32_t head = store.head;
+
+  while ((head + size - store.tail) > RECORDER_BUFFER_SIZE) {
+    store.tail += RECORDER_HEADER_SIZE + recorder_byte(store.tail + 5u);
+  }
+
+  for (uint32_t i = 0; i < 4u; i++) {
+    store.ring[(head + i) & (RECORDER_BUFFER_SIZE - 1u)] =
+        (uint8_t)(time_ms >> (8u * i));
+  }
+  store.ring[(head + 4u) & (RECORDER_BUFFER_SIZE - 1u)] = (uint8_t)source;
+  store.ring[(head + 5u) & (RECORDER_BUFFER_SIZE - 1u)] = (uint8_t)len;
+  for (uint32_t i = 0; i < len; i++) {
+    store.ring[(head + RECORDER_HEADER_SIZE + i) &
+               (RECORDER_BUFFER_SIZE - 1u)] = bytes[i];
+  }
+  store.head = head + size;
+}
+
+static uint8_t recorder_byte(uint32_t offset) {
+  return store.ring[offset & (RECORDER_BUFFER_SIZE - 1u)];
+}
+
+/******************************************************************************
+ * Function Name: recorder_dump
+ ******************************************************************************
+ * Summary:
+ *  Publishes the records on MQTT_RECORD_TOPIC, see the top of the file.
+ *
+ ******************************************************************************/
+static void recorder_dump(void) {
+  recorder_sink_t sink = {0};
+  recorder_record_t record;
+  uint32_t cursor = 0u;
+  uint32_t count = 0u;
+  char line[RECORDER_LINE_SIZE];
+
+  /* Records written during the dump are not counted in the header. */
+  for (uint32_t counter = 0u; recorder_read(&counter, &record);) {
+    count++;
+  }
+  recorder_emit(&sink, line,
+                snprintf(line, sizeof(line), "REC BEGIN %lu %lu\n",
+                         (unsigned long)count, (unsigned long)store.boots));
+
+  for (uint32_t index = 0; (index < count) && !sink.failed &&
+                           recorder_read(&cursor, &record);
+       index++) {
+    int len = snprintf(line, sizeof(line), "R %lx %lu %u ",
+                       (unsigned long)index, (unsigned long)record.time_ms,
+                       (unsigned)record.source);
+
+    for (uint32_t i = 0; i < record.len; i++) {
+      len += snprintf(&line[len], sizeof(line) - (size_t)len, "%02x",
+                      record.data[i]);
+    }
+    len += snprintf(&line[len], sizeof(line) - (size_t)len, "\n");
+    recorder_emit(&sink, line, len);
+  }
+
+  recorder_emit(&sink, line,
+                snprintf(line, sizeof(line), "REC END %lu\n",
+                         (unsigned long)count));
+  recorder_flush(&sink);
+
+  if (sink.failed) {
+    printf("Recorder: dump incomplete, no publisher slot\n");
+  }
+}
+
+/******************************************************************************
+ * Function Name: recorder_emit
+ ******************************************************************************
+ * Summary:
+ *  Packs a dump line into a publisher slot. A message holds whole lines.
+ *
+ * Parameters:
+ *  recorder_sink_t *sink : Dump
+ *  const char *line      : Line, with its newline
+ *  int len               : Length of the line, as returned by snprintf()
+ *
+ ******************************************************************************/
+static void recorder_emit(recorder_sink_t *sink, const char *line, int len) {
+  if ((len <= 0) || (len >= (int)RECORDER_LINE_SIZE) || sink->failed) {
+    return;
+  }
+
+  if ((sink->buffer != NULL) && ((sink->len + (size_t)len) >= sink->size)) {
+    recorder_flush(sink);
+  }
+  for (uint32_t retry = 0; sink->buffer == NULL; retry++) {
+    if (retry == RECORDER_PUBLISH_RETRIES) {
+      sink->failed = true;
+      return;
+    }
+    sink->buffer = publisher_reserve(&sink->size);
+    sink->len = 0;
+    if (sink->buffer == NULL) {
+      vTaskDelay(pdMS_TO_TICKS(RECORDER_PUBLISH_RETRY_MS));
+    }
+  }
+  memcpy(&sink->buffer[sink->len], line, (size_t)len);
+  sink->len += (size_t)len;
+}
+
+/* Publishes the lines collected so far. */
+static void recorder_flush(recorder_sink_t *sink) {
+  if (sink->buffer == NULL) {
+    return;
+  }
+  if (publisher_commit(MQTT_CLASS_RECORD, sink->buffer, sink->len) !=
+      CY_RSLT_SUCCESS) {
+    sink->failed = true;
+  }
+  sink->buffer = NULL;
+}
+#endif /* RECORDER_ENABLE */
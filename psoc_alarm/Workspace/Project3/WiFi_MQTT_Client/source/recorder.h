@@ -0,0 +1,75 @@
+/*
+ * recorder.h
+ *
+ * Event recorder. Every input of the state task and of the connection manager
+ * queue, and every publish of the state task, is recorded with its tick
+ * count in a RAM ring that survives a warm reset. The ring is published on
+ * request and replayed against the host build, see host/source/replay.c.
+ */
+
+#ifndef SOURCE_RECORDER_H_
+#define SOURCE_RECORDER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "log_config.h"
+
+/*******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Task parameters for the recorder task, which publishes the ring. */
+#define RECORDER_TASK_PRIORITY (0)
+#define RECORDER_TASK_STACK_SIZE (1024 * 1)
+
+/* Longest payload of a record, longer inputs are truncated. */
+#define RECORDER_PAYLOAD_MAX (24u)
+
+/* Payload of a RECORDER_BT record: the state, then the meta bytes. */
+#define RECORDER_STATE_META_SIZE (6u)
+
+/*******************************************************************************
+ * Data Types
+ ******************************************************************************/
+/* Record sources, shared with the dump format and the host replayer. */
+typedef enum {
+  /* Start of a boot, no payload. */
+  RECORDER_BOOT,
+  /* State posted by the Bluetooth callbacks, see recorder_state(). */
+  RECORDER_BT,
+  /* Button interrupt, no payload. */
+  RECORDER_BUTTON,
+  /* Payload of an MQTT message on MQTT_SUB_TOPIC, truncated. */
+  RECORDER_COMMAND,
+  /* Reinitialization of the state task after a reconnection, no payload. */
+  RECORDER_RECONNECT,
+  /* Command to the connection manager, one byte. */
+  RECORDER_MQTT_TASK,
+  /* Output: message class, then the FNV-1a hash of the payload. */
+  RECORDER_PUBLISH,
+  RECORDER_SOURCE_COUNT
+} recorder_source_t;
+
+typedef struct {
+  uint32_t time_ms;
+  uint8_t source;
+  uint8_t len;
+  uint8_t data[RECORDER_PAYLOAD_MAX];
+} recorder_record_t;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+void recorder_init(void);
+void recorder_input(recorder_source_t source, const void *data, size_t len);
+void recorder_value(recorder_source_t source, uint32_t value);
+void recorder_state(recorder_source_t source, uint32_t state,
+                    const void *meta);
+void recorder_publish(uint32_t message_class, const char *payload, size_t len);
+uint32_t recorder_hash(const char *payload, size_t len);
+uint32_t recorder_cursor(void);
+bool recorder_read(uint32_t *cursor, recorder_record_t *record);
+void recorder_request_dump(void);
+void recorder_task(void *pvParameters);
+
+#endif /* SOURCE_RECORDER_H_ */
@@ -0,0 +1,332 @@
+/**
+ * This file implements the stack profile.
+ *
+ * FreeRTOS fills the stack of every task with 0xa5 bytes when it creates
+ * it (configCHECK_FOR_STACK_OVERFLOW 2), and the high water mark is the
+ * part still filled. stack_profile_init() fills the free part of the main
+ * stack the same way before the scheduler starts; from then on the main
+ * stack is the stack of the interrupts, reported as "ISR".
+ *
+ * A profile started by STACKPROFILE runs the worst cases the board can
+ * drive on its own: a trip storm of STACK_PROFILE_STORM_EVENTS trips and
+ * button presses to the state task, then a reconnection of the MQTT client
+ * with a full TLS handshake. It then samples the tasks every
+ * STACK_PROFILE_SAMPLE_MS for STACK_PROFILE_WINDOW_MS; pair a phone in the
+ * meantime for the pairing path of the Bluetooth stack. The least free
+ * stack seen for each task name is kept across profiles, also for tasks
+ * deleted since, printed on the console and published on MQTT_DIAG_TOPIC:
+ *
+ *   {"stacks":[["name",size_bytes,free_bytes],...]}
+ *
+ * The size is 0 for the tasks of the libraries, whose stack sizes are not
+ * known here. The profile leaves the alarm deactivated.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+/* FreeRTOS header files */
+#include <FreeRTOS.h>
+#include "queue.h"
+#include "task.h"
+
+#include "cyhal.h"
+
+#include "bench.h"
+#include "coroutine.h"
+#include "heap.h"
+#include "log.h"
+#include "mqtt_client_config.h"
+#include "mqtt_task.h"
+#include "publisher.h"
+#include "recorder.h"
+#include "stack_profile.h"
+#include "state.h"
+#include "trace.h"
+
+#if STACK_PROFILE_ENABLE
+/******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Tasks kept, the tasks of the libraries included. */
+#define STACK_PROFILE_MAX_TASKS (24u)
+
+/* Fill of an unused stack word, as FreeRTOS fills the task stacks. */
+#define STACK_PROFILE_FILL (0xa5a5a5a5u)
+
+/* Words of the main stack below the stack pointer left unfilled, for the
+ * calls of stack_profile_init() itself.
+ */
+#define STACK_PROFILE_INIT_GUARD_WORDS (64u)
+
+/* Trip storm: events and the gap between them. */
+#define STACK_PROFILE_STORM_EVENTS (20u)
+#define STACK_PROFILE_STORM_GAP_MS (100u)
+
+/******************************************************************************
+ * Types
+ ******************************************************************************/
+typedef struct {
+  char name[configMAX_TASK_NAME_LEN];
+  uint32_t size;
+  uint32_t free;
+} stack_profile_entry_t;
+
+/******************************************************************************
+ * Global Variables
+ ******************************************************************************/
+/* Stack sizes in words of the tasks of the application and the kernel, by
+ * the names they are created with.
+ */
+static const struct {
+  const char *name;
+  uint32_t words;
+} stack_sizes[] = {
+    {"Log task", LOG_TASK_STACK_SIZE},
+    {"Trace task", TRACE_TASK_STACK_SIZE},
+    {"Recorder task", RECORDER_TASK_STACK_SIZE},
+    {"Bench task", BENCH_TASK_STACK_SIZE},
+    {"Heap trace task", HEAP_TRACE_TASK_STACK_SIZE},
+    {"Stack profile", STACK_PROFILE_TASK_STACK_SIZE},
+    {"Coroutine task", COROUTINE_TASK_STACK_SIZE},
+    {"Worker task", COROUTINE_WORKER_STACK_SIZE},
+    {"State task", STATE_TASK_STACK_SIZE},
+    {"Publisher task", PUBLISHER_TASK_STACK_SIZE},
+    {"IDLE", configMINIMAL_STACK_SIZE},
+    {"Tmr Svc", configTIMER_TASK_STACK_DEPTH},
+};
+
+static stack_profile_entry_t entries[STACK_PROFILE_MAX_TASKS];
+static uint32_t entry_count;
+
+static TaskStatus_t task_status[STACK_PROFILE_MAX_TASKS];
+
+static TaskHandle_t stack_profile_task_handle;
+
+#if defined(__CORTEX_M)
+/* Main stack in the linker script. */
+extern uint32_t __StackLimit[];
+extern uint32_t __StackTop[];
+#endif
+
+/******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+static void stack_profile_run(void);
+static void stack_profile_sample(void);
+static void stack_profile_update(const char *name, uint32_t size,
+                                 uint32_t free);
+static void stack_profile_publish(void);
+#endif
+
+/******************************************************************************
+ * Function Name: stack_profile_init
+ ******************************************************************************
+ * Summary:
+ *  Fills the unused part of the main stack. Called from main() before the
+ *  scheduler starts.
+ *
+ ******************************************************************************/
+void stack_profile_init(void) {
+#if STACK_PROFILE_ENABLE && defined(__CORTEX_M)
+  uint32_t *end = (uint32_t *)__get_MSP() - STACK_PROFILE_INIT_GUARD_WORDS;
+
+  for (uint32_t *word = __StackLimit; word < end; word++) {
+    *word = STACK_PROFILE_FILL;
+  }
+#endif
+}
+
+/******************************************************************************
+ * Function Name: stack_profile_request
+ ******************************************************************************
+ * Summary:
+ *  Asks the stack profile task to run a profile.
+ *
+ ******************************************************************************/
+void stack_profile_request(void) {
+#if STACK_PROFILE_ENABLE
+  if (stack_profile_task_handle != NULL) {
+    xTaskNotifyGive(stack_profile_task_handle);
+  }
+#endif
+}
+
+/******************************************************************************
+ * Function Name: stack_profile_task
+ ******************************************************************************
+ * Summary:
+ *  Runs a profile when requested.
+ *
+ * Parameters:
+ *  void *pvParameters : Task parameter defined during task creation (unused)
+ *
+ ******************************************************************************/
+void stack_profile_task(void *pvParameters) {
+  (void)pvParameters;
+
+#if STACK_PROFILE_ENABLE
+  stack_profile_task_handle = xTaskGetCurrentTaskHandle();
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    stack_profile_run();
+  }
+#else
+  vTaskDelete(NULL);
+#endif
+}
+
+#if STACK_PROFILE_ENABLE
+/******************************************************************************
+ * Function Name: stack_profile_run
+ ******************************************************************************
+ * Summary:
+ *  Drives the worst cases, samples the stacks during the window and
+ *  reports them, see the top of the file.
+ *
+ ******************************************************************************/
+static void stack_profile_run(void) {
+  State event = {0};
+
+  printf("Stack profile: trip storm, reconnection, sampling for %lu s\n",
+         (unsigned long)(STACK_PROFILE_WINDOW_MS / 1000u));
+  stack_profile_sample();
+
+  for (uint32_t i = 0; i < STACK_PROFILE_STORM_EVENTS; i++) {
+    event.state = ((i % 2u) == 0u) ? SEC_TRIPPED : SEC_BUTTON;
+    (void)xQueueSend(xStateQueue, &event,
+                     pdMS_TO_TICKS(STACK_PROFILE_STORM_GAP_MS));
+    vTaskDelay(pdMS_TO_TICKS(STACK_PROFILE_STORM_GAP_MS));
+  }
+  stack_profile_sample();
+
+  mqtt_task_request_reconnect();
+  for (uint32_t elapsed_ms = 0; elapsed_ms < STACK_PROFILE_WINDOW_MS;
+       elapsed_ms += STACK_PROFILE_SAMPLE_MS) {
+    vTaskDelay(pdMS_TO_TICKS(STACK_PROFILE_SAMPLE_MS));
+    stack_profile_sample();
+  }
+
+  for (uint32_t i = 0; i < entry_count; i++) {
+    printf("Stack %-16s %6lu B free of %6lu B\n", entries[i].name,
+           (unsigned long)entries[i].free, (unsigned long)entries[i].size);
+  }
+  stack_profile_publish();
+}
+
+/******************************************************************************
+ * Function Name: stack_profile_sample
+ ******************************************************************************
+ * Summary:
+ *  Reads the high water marks of all tasks and of the interrupt stack.
+ *
+ ******************************************************************************/
+static void stack_profile_sample(void) {
+  UBaseType_t task_count =
+      uxTaskGetSystemState(task_status, STACK_PROFILE_MAX_TASKS, NULL);
+
+  for (UBaseType_t i = 0; i < task_count; i++) {
+    uint32_t size = 0u;
+
+    for (uint32_t s = 0; s < sizeof(stack_sizes) / sizeof(stack_sizes[0]);
+         s++) {
+      if (strcmp(task_status[i].pcTaskName, stack_sizes[s].name) == 0) {
+        size = stack_sizes[s].words * (uint32_t)sizeof(StackType_t);
+        break;
+      }
+    }
+    stack_profile_update(task_status[i].pcTaskName, size,
+                         (uint32_t)task_status[i].usStackHighWaterMark *
+                             (uint32_t)sizeof(StackType_t));
+  }
+
+#if defined(__CORTEX_M)
+  const uint32_t *word = __StackLimit;
+
+  while ((word < __StackTop) && (*word == STACK_PROFILE_FILL)) {
+    word++;
+  }
+  stack_profile_update("ISR",
+                       (uint32_t)((__StackTop - __StackLimit) *
+                                  sizeof(uint32_t)),
+                       (uint32_t)((word - __StackLimit) * sizeof(uint32_t)));
+#endif
+}
+
+/* Keeps the least free stack of a task name. */
+static void stack_profile_update(const char *name, uint32_t size,
+                                 uint32_t free) {
+  stack_profile_entry_t *entry = NULL;
+
+  for (uint32_t i = 0; i < entry_count; i++) {
+    if (strncmp(entries[i].name, name, sizeof(entries[i].name)) == 0) {
+      entry = &entries[i];
+      break;
+    }
+  }
+  if (entry == NULL) {
+    if (entry_count == STACK_PROFILE_MAX_TASKS) {
+      return;
+    }
+    entry = &entries[entry_count++];
+    strncpy(entry->name, name, sizeof(entry->name) - 1u);
+    entry->free = free;
+  }
+  entry->size = size;
+  if (free < entry->free) {
+    entry->free = free;
+  }
+}
+
+/******************************************************************************
+ * Function Name: stack_profile_publish
+ ******************************************************************************
+ * Summary:
+ *  Writes the entries straight into publisher slots, starting a new message
+ *  when the next entry does not fit.
+ *
+ ******************************************************************************/
+static void stack_profile_publish(void) {
+  char *buffer = NULL;
+  size_t buffer_size = 0;
+  size_t len = 0;
+  uint32_t i = 0;
+
+  while (i < entry_count) {
+    int entry_len;
+
+    if (buffer == NULL) {
+      buffer = publisher_reserve(&buffer_size);
+      if (buffer == NULL) {
+        printf("Stack profile: no publisher slot\n");
+        return;
+      }
+      len = (size_t)snprintf(buffer, buffer_size, "{\"stacks\":[");
+    }
+
+    /* Room is kept for the closing "]}". */
+    entry_len = snprintf(&buffer[len], buffer_size - len,
+                         "%s[\"%s\",%lu,%lu]",
+                         (buffer[len - 1] == '[') ? "" : ",", entries[i].name,
+                         (unsigned long)entries[i].size,
+                         (unsigned long)entries[i].free);
+    if ((entry_len < 0) || ((len + (size_t)entry_len + 2u) >= buffer_size)) {
+      if (buffer[len - 1] == '[') {
+        publisher_cancel(buffer);
+        return;
+      }
+      memcpy(&buffer[len], "]}", 2);
+      publisher_commit(MQTT_CLASS_DIAG, buffer, len + 2u);
+      buffer = NULL;
+      continue;
+    }
+    len += (size_t)entry_len;
+    i++;
+  }
+
+  if (buffer != NULL) {
+    memcpy(&buffer[len], "]}", 2);
+    publisher_commit(MQTT_CLASS_DIAG, buffer, len + 2u);
+  }
+}
+#endif /* STACK_PROFILE_ENABLE */
@@ -0,0 +1,33 @@
+/*
+ * stack_profile.h
+ *
+ * Stack profile. With STACK_PROFILE_ENABLE the STACKPROFILE command drives
+ * the paths that need the most stack, a TLS reconnection and a trip storm,
+ * samples the high water marks of all tasks and of the interrupt stack and
+ * publishes the worst ones on the diagnostics topic. server_code/
+ * stack_report.py combines them with the static stack usage of the build
+ * and recommends stack sizes.
+ */
+
+#ifndef SOURCE_STACK_PROFILE_H_
+#define SOURCE_STACK_PROFILE_H_
+
+#include "log_config.h"
+
+/*******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Task parameters for the stack profile task, which runs a profile on
+ * request.
+ */
+#define STACK_PROFILE_TASK_PRIORITY (0)
+#define STACK_PROFILE_TASK_STACK_SIZE (1024 * 1)
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+void stack_profile_init(void);
+void stack_profile_request(void);
+void stack_profile_task(void *pvParameters);
+
+#endif /* SOURCE_STACK_PROFILE_H_ */
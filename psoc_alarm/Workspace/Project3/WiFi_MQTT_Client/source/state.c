@@ -14,6 +14,7 @@
 #include <FreeRTOS.h>
 #include <FreeRTOSConfig.h>
 #include <stdbool.h>
+#include <string.h>
 #include "queue.h"
 #include "task.h"
 
@@ -23,8 +24,19 @@
 #include "cybsp.h"
 #include "cyhal.h"
 
+#include "bench.h"
+#include "coroutine.h"
+#include "deadline.h"
+#include "heap.h"
+#include "heap_stats.h"
+#include "log.h"
 #include "mqtt_task.h"
+#include "probe.h"
+#include "publisher.h"
+#include "recorder.h"
+#include "stack_profile.h"
 #include "state.h"
+#include "trace.h"
 #include "app_bt_utils.h"
 
 /* Configuration file for MQTT client */
@@ -41,14 +53,6 @@
 
 #define TRIP_ALARM_DELAY_MS 500
 
-/* The maximum number of times each PUBLISH in this example will be retried. */
-#define PUBLISH_RETRY_LIMIT (10)
-
-/* A PUBLISH message is retried if no response is received within this
- * time (in milliseconds).
- */
-#define PUBLISH_RETRY_MS (1000)
-
 /* Queue length of a message queue that is used to communicate with the
  * publisher task.
  */
@@ -56,20 +60,19 @@
 
 #define GPIO_INTERRUPT_PRIORITY (7u)
 
-/* Maximum number of retries for MQTT subscribe operation */
-#define MAX_SUBSCRIBE_RETRIES (3u)
-
-/* Time interval in milliseconds between MQTT subscribe retries. */
-#define MQTT_SUBSCRIBE_RETRY_INTERVAL_MS (1000)
-
-/* The number of MQTT topics to be subscribed to. */
-#define SUBSCRIPTION_COUNT (1)
-
 /* Queue length of a message queue that is used to communicate with the
  * subscriber task.
  */
 #define SUBSCRIBER_TASK_QUEUE_LENGTH (1u)
 
+/* The alarm path must preempt the network work, see STATE_TASK_PRIORITY. */
+#if (STATE_TASK_PRIORITY <= COROUTINE_TASK_PRIORITY) ||                        \
+    (STATE_TASK_PRIORITY <= COROUTINE_WORKER_PRIORITY) ||                      \
+    (STATE_TASK_PRIORITY <= PUBLISHER_TASK_PRIORITY) ||                        \
+    (STATE_TASK_PRIORITY <= configTIMER_TASK_PRIORITY)
+#error "STATE_TASK_PRIORITY must be the highest application task priority"
+#endif
+
 /*******************************************************************************
  * Global Variables
  *******************************************************************************/
@@ -82,29 +85,18 @@ TaskHandle_t state_task_handle;
 
 /* Queue tasks will use to set new state */
 QueueHandle_t xStateQueue;
-
-/* Structure to store publish message information. */
-cy_mqtt_publish_info_t publish_info = {.qos = (cy_mqtt_qos_t)MQTT_MESSAGES_QOS,
-                                       .topic = MQTT_PUB_TOPIC,
-                                       .topic_len =
-                                           (sizeof(MQTT_PUB_TOPIC) - 1),
-                                       .retain = false,
-                                       .dup = false};
-
-/* Configure the subscription information structure. */
-cy_mqtt_subscribe_info_t subscribe_info = {
-    .qos = (cy_mqtt_qos_t)MQTT_MESSAGES_QOS,
-    .topic = MQTT_SUB_TOPIC,
-    .topic_len = (sizeof(MQTT_SUB_TOPIC) - 1)};
+static StaticQueue_t state_queue_buffer;
+static uint8_t state_queue_storage[STATE_QUEUE_LENGTH * sizeof(State)];
 
 int led_state = CYBSP_LED_STATE_OFF;
 
+/* Publish failure reports the connection manager had no room for. */
+static uint32_t failure_reports_dropped;
+
 /*******************************************************************************
  * Function Prototypes
  *******************************************************************************/
 static void gpio_interrupt_handler(void *handler_arg, cyhal_gpio_event_t event);
-static void subscribe_to_topic(void);
-static void unsubscribe_from_topic(void);
 
 void init_state() {
   cy_rslt_t result;
@@ -134,12 +126,8 @@ void init_state() {
   /* Enable global interrupts */
   //__enable_irq();
 
+  /* The connection manager subscribes to MQTT_SUB_TOPIC, see mqtt_task.c */
   state.state = SEC_UNACTIVE;
-
-  /*
-   * MQTT Subscription init
-   */
-  subscribe_to_topic();
 }
 
 void state_task(void *pvParameters) {
@@ -148,43 +136,56 @@ void state_task(void *pvParameters) {
 
   State newState;
 
-  /* Command to the MQTT client task */
-  mqtt_task_cmd_t mqtt_task_cmd;
+  /* Retained state or transient event, see mqtt_client_config.h */
+  mqtt_message_class_t message_class;
+
+  /* Tripped: blink the LED again after TRIP_ALARM_DELAY_MS */
+  bool blink;
 
   /* To avoid compiler warnings */
   (void)pvParameters;
 
-  char *buffer = malloc(BUFFER_SIZE);
-  if (buffer == NULL) {
-    printf("FATAL - Could not allocate buffer memory\n");
-    return;
-  }
+  /* Payload, formatted straight into a publisher slot */
+  char *buffer;
+  size_t buffer_size;
+  int payload_len;
 
-  xStateQueue = xQueueCreate(2, sizeof(State));
-  if (xStateQueue == NULL) {
-    printf("FATAL - Could not create State Queue!\n");
-    CY_ASSERT(0);
-  }
+  xStateQueue = xQueueCreateStatic(STATE_QUEUE_LENGTH, sizeof(State),
+                                   state_queue_storage, &state_queue_buffer);
+  vQueueAddToRegistry(xStateQueue, "State");
 
   init_state();
 
   for (;;) {
     if (xQueueReceive(xStateQueue, &(newState), (TickType_t)10) == pdPASS) {
+      PROBE_START(PROBE_STATE_TASK);
+
       result = CY_RSLT_SUCCESS;
+      message_class = MQTT_CLASS_STATE;
+      payload_len = 0;
+      blink = false;
 
-      printf("Received: %d\n", newState.state);
+      /* One of the alarm slots, so that telemetry cannot crowd it out. NULL
+       * with a zero size when every slot is in use, snprintf() then only
+       * measures the payload.
+       */
+      buffer = publisher_reserve_alarm(&buffer_size);
+
+      LOG(LOG_MODULE_STATE, LOG_LEVEL_DEBUG, "Received: %d\n", newState.state);
 
       switch (newState.state) {
       case SEC_PAIRING:
         /* Pairing, Display code to MQTT */
         state.state = newState.state;
-        sprintf(buffer, "{\"state\":\"PAIRING\",code:%d}", newState.meta.passkey);
+        message_class = MQTT_CLASS_EVENT;
+        payload_len = snprintf(buffer, buffer_size, "{\"state\":\"PAIRING\",code:%d}",
+                               newState.meta.passkey);
         break;
       case SEC_ACTIVE:
       case SEC_DISCONNETED:
         /* Set new state */
         state.state = newState.state;
-        sprintf(buffer, "{\"state\":\"ACTIVE\"}");
+        payload_len = state_format(&state, buffer, buffer_size);
 
         /* Turn on LED */
         led_state = CYBSP_LED_STATE_ON;
@@ -194,11 +195,7 @@ void state_task(void *pvParameters) {
       
         /* Copy new state */
         memcpy(&state, &newState, sizeof(State));
-        /* Pain but lazy */
-        sprintf(buffer,
-                "{\"state\":\"UNACTIVE\", bdaddr:%02X:%02X:%02X:%02X:%02X:%02X}",
-                newState.meta.bdadr[0], newState.meta.bdadr[1], newState.meta.bdadr[2],
-                newState.meta.bdadr[3], newState.meta.bdadr[4], newState.meta.bdadr[5]);
+        payload_len = state_format(&state, buffer, buffer_size);
         xQueueSend(xStateQueue, &state, (TickType_t)10);
         /* Clear queue if the alarm was tripped */
         xQueueReset(xStateQueue);
@@ -209,70 +206,142 @@ void state_task(void *pvParameters) {
       case SEC_BUTTON:
         /* Clear queue for potential trip */
         xQueueReset(xStateQueue);
-        printf("Alarm disabled\n");
+        LOG(LOG_MODULE_STATE, LOG_LEVEL_INFO, "Alarm disabled\n");
         result = CY_RSLT_TYPE_WARNING; /* Gewoon iets anders */
         State newState;
         newState.state = SEC_UNACTIVE; 
         xQueueSend(xStateQueue, &newState, (TickType_t)10);
         break;
       case SEC_TRIPPED:
+        /* Only entering the tripped state replaces the retained state, the
+         * repeats that blink the LED are events.
+         */
+        message_class =
+            (state.state == SEC_TRIPPED) ? MQTT_CLASS_EVENT : MQTT_CLASS_STATE;
+
         /* Set new state */
         state.state = SEC_TRIPPED;
-        sprintf(buffer, "{\"state\":\"TRIPPED\"}");
+        payload_len = state_format(&state, buffer, buffer_size);
 
         /* Toggle LED */
         led_state = led_state == CYBSP_LED_STATE_OFF ? CYBSP_LED_STATE_ON
                                                      : CYBSP_LED_STATE_OFF;
-        vTaskDelay(pdMS_TO_TICKS(TRIP_ALARM_DELAY_MS));
         /* Report only if LED is on to limit MQTT spam */
         if (led_state == CYBSP_LED_STATE_ON)
           result = CY_RSLT_SUCCESS;
-
-        /* Blink LED by sending this queue itself a message every x ms */
-        xQueueSend(xStateQueue, &state, (TickType_t)10);
+        blink = true;
         break;
       case SEC_INIT:
-        sprintf(buffer, "{\"state\":\"REINITIALIZING\"}");
-        subscribe_to_topic();
+        payload_len =
+            snprintf(buffer, buffer_size, "{\"state\":\"REINITIALIZING\"}");
+        message_class = MQTT_CLASS_EVENT;
+        /* The broker may have changed, so refresh its retained state too */
+        newState.state = SEC_GETSTATE;
+        xQueueSend(xStateQueue, &newState, (TickType_t)10);
         break;
       case SEC_GETSTATE:
-        /* Do nothing excep run the if-statement below /*/
+        payload_len = state_format(&state, buffer, buffer_size);
         break;
       default:
-        sprintf(buffer, "{\"state\":\"ERROR\"}");
+        payload_len = snprintf(buffer, buffer_size, "{\"state\":\"ERROR\"}");
+        message_class = MQTT_CLASS_EVENT;
       }
 
       /* Update LED state */
       cyhal_gpio_write(CYBSP_USER_LED, led_state);
+      if (newState.state == SEC_UNACTIVE) {
+        deadline_stop(DEADLINE_BUTTON_LED);
+      } else if (newState.state == SEC_DISCONNETED) {
+        deadline_stop(DEADLINE_DISCONNECT_ARMED);
+      }
 
-      if (result == CY_RSLT_SUCCESS) {
-        /* Publish the data received over the message queue. */
-        publish_info.payload = buffer;
-        publish_info.payload_len = strlen(publish_info.payload);
-        printf("  Publisher: Publishing '%s' on the topic '%s'\n\n",
-               (char *)publish_info.payload, publish_info.topic);
-
-        result = cy_mqtt_publish(mqtt_connection, &publish_info);
+      if ((result != CY_RSLT_SUCCESS) && (buffer != NULL)) {
+        publisher_cancel(buffer);
+      } else if (result == CY_RSLT_SUCCESS) {
+        /* Hand the slot to the publisher tasks, which keep several messages
+         * in flight and send the payload from the slot itself.
+         */
+        result = ~CY_RSLT_SUCCESS;
+        if (buffer != NULL) {
+          LOG(LOG_MODULE_STATE, LOG_LEVEL_INFO,
+              "  Publisher: Publishing %d bytes on the topic '%s'\n\n",
+              payload_len, LOG_STR(mqtt_message_classes[message_class].topic));
+          recorder_publish(message_class, buffer, (size_t)payload_len);
+          if (state.state == SEC_TRIPPED) {
+            publisher_set_deadline(buffer, DEADLINE_TRIP_PUBLISH);
+          }
+          result = publisher_commit(message_class, buffer, (size_t)payload_len);
+        }
 
         if (result != CY_RSLT_SUCCESS) {
-          printf("  Publisher: MQTT Publish failed with error 0x%0X.\n\n",
-                 (int)result);
+          LOG(LOG_MODULE_STATE, LOG_LEVEL_WARNING,
+              "  Publisher: MQTT Publish queue full or payload too long, "
+              "message dropped.\n\n");
 
-          /* Communicate the publish failure with the the MQTT
-           * client task.
+          /* Communicate the publish failure with the connection manager,
+           * without waiting: the alarm path must not block on it.
            */
-          mqtt_task_cmd = HANDLE_MQTT_PUBLISH_FAILURE;
-          xQueueSend(mqtt_task_q, &mqtt_task_cmd, portMAX_DELAY);
+          if (mqtt_task_send(HANDLE_MQTT_PUBLISH_FAILURE, 0) != pdTRUE) {
+            failure_reports_dropped++;
+            LOG(LOG_MODULE_STATE, LOG_LEVEL_WARNING,
+                "  Publisher: failure report dropped, %lu so far\n",
+                (unsigned long)failure_reports_dropped);
+          }
         }
       }
+      PROBE_STOP(PROBE_STATE_TASK);
+
+      /* Blink LED by sending this queue itself a message every x ms. The
+       * delay comes after the publish, so the tripped state goes out at
+       * once.
+       */
+      if (blink) {
+        vTaskDelay(pdMS_TO_TICKS(TRIP_ALARM_DELAY_MS));
+        xQueueSend(xStateQueue, &state, (TickType_t)10);
+      }
     }
   }
 
-  /* Clean up */
-  free(buffer);
   vTaskDelete(NULL);
 }
 
+/*******************************************************************************
+ * Function Name: state_format
+ ********************************************************************************
+ * Summary:
+ *   Formats the retained state message of a state. It is also republished
+ *   on GETSTATE and after a reconnection, so no copy is kept.
+ *
+ * Parameters:
+ *  const State *state : State, normally the current one
+ *  char *buffer : Output buffer, may be NULL when buffer_size is 0
+ *  size_t buffer_size : Size of the output buffer
+ *
+ * Return:
+ *  int : Length of the message, as returned by snprintf()
+ *
+ *******************************************************************************/
+int state_format(const State *state, char *buffer, size_t buffer_size) {
+  switch (state->state) {
+  case SEC_ACTIVE:
+  case SEC_DISCONNETED:
+    return snprintf(buffer, buffer_size, "{\"state\":\"ACTIVE\"}");
+  case SEC_UNACTIVE:
+  case SEC_CONNECTED:
+    /* Pain but lazy */
+    return snprintf(buffer, buffer_size,
+                    "{\"state\":\"UNACTIVE\", bdaddr:%02X:%02X:%02X:%02X:%02X:%02X}",
+                    state->meta.bdadr[0], state->meta.bdadr[1], state->meta.bdadr[2],
+                    state->meta.bdadr[3], state->meta.bdadr[4], state->meta.bdadr[5]);
+  case SEC_TRIPPED:
+    return snprintf(buffer, buffer_size, "{\"state\":\"TRIPPED\"}");
+  case SEC_PAIRING:
+    return snprintf(buffer, buffer_size, "{\"state\":\"PAIRING\"}");
+  default:
+    return snprintf(buffer, buffer_size, "{\"state\":\"ERROR\"}");
+  }
+}
+
 /*******************************************************************************
  * Function Name: gpio_interrupt_handler
  ********************************************************************************
@@ -290,50 +359,14 @@ static void gpio_interrupt_handler(void *handler_arg,
   State btnState;
   btnState.state = SEC_BUTTON;
 
+  TRACE_ISR_ENTER();
+  PROBE_START(PROBE_GPIO_ISR);
+  recorder_input(RECORDER_BUTTON, NULL, 0);
+  deadline_start_from_isr(DEADLINE_BUTTON_LED);
   if (xStateQueue != NULL)
     xQueueSendFromISR(xStateQueue, &btnState, &xHigherPriorityTaskWoken);
-}
-
-static void subscribe_to_topic(void) {
-  /* Status variable */
-  cy_rslt_t result = CY_RSLT_SUCCESS;
-
-  /* Command to the MQTT client task */
-  mqtt_task_cmd_t mqtt_task_cmd;
-
-  /* Subscribe with the configured parameters. */
-  for (uint32_t retry_count = 0; retry_count < MAX_SUBSCRIBE_RETRIES;
-       retry_count++) {
-    result =
-        cy_mqtt_subscribe(mqtt_connection, &subscribe_info, SUBSCRIPTION_COUNT);
-    if (result == CY_RSLT_SUCCESS) {
-      printf("MQTT client subscribed to the topic '%.*s' successfully.\n\n",
-             subscribe_info.topic_len, subscribe_info.topic);
-      break;
-    }
-
-    vTaskDelay(pdMS_TO_TICKS(MQTT_SUBSCRIBE_RETRY_INTERVAL_MS));
-  }
-
-  if (result != CY_RSLT_SUCCESS) {
-    printf("MQTT Subscribe failed with error 0x%0X after %d retries...\n\n",
-           (int)result, MAX_SUBSCRIBE_RETRIES);
-
-    /* Notify the MQTT client task about the subscription failure */
-    mqtt_task_cmd = HANDLE_MQTT_SUBSCRIBE_FAILURE;
-    xQueueSend(mqtt_task_q, &mqtt_task_cmd, portMAX_DELAY);
-  }
-}
-
-static void unsubscribe_from_topic(void) {
-  cy_rslt_t result = cy_mqtt_unsubscribe(
-      mqtt_connection, (cy_mqtt_unsubscribe_info_t *)&subscribe_info,
-      SUBSCRIPTION_COUNT);
-
-  if (result != CY_RSLT_SUCCESS) {
-    printf("MQTT Unsubscribe operation failed with error 0x%0X!\n",
-           (int)result);
-  }
+  PROBE_STOP(PROBE_GPIO_ISR);
+  TRACE_ISR_EXIT();
 }
 
 void mqtt_subscription_callback(cy_mqtt_publish_info_t *received_msg_info) {
@@ -341,32 +374,144 @@ void mqtt_subscription_callback(cy_mqtt_publish_info_t *received_msg_info) {
   const char *received_msg = received_msg_info->payload;
   int received_msg_len = received_msg_info->payload_len;
 
-  printf("  Subsciber: Incoming MQTT message received:\n"
-         "    Publish topic name: %.*s\n"
-         "    Publish QoS: %d\n"
-         "    Publish payload: %.*s\n\n",
-         received_msg_info->topic_len, received_msg_info->topic,
-         (int)received_msg_info->qos, (int)received_msg_info->payload_len,
-         (const char *)received_msg_info->payload);
-
-  /*
-   * Decode received MQTT message and send to state handler through queue
-   * Possible commands:
-   ? - GETSTATE - Forces the PSOC to retransmit its state
-   ? - TRIPALARM - Trips the alarm for testing-purposes
+  /* Runs in the MQTT callback, and the payload is gone once it returns, so
+   * only its size is logged.
    */
+  LOG(LOG_MODULE_MQTT, LOG_LEVEL_INFO,
+      "  Subsciber: Incoming MQTT message received, QoS %d, %d bytes\n\n",
+      (int)received_msg_info->qos, received_msg_len);
+  recorder_input(RECORDER_COMMAND, received_msg, (size_t)received_msg_len);
+
   State cmdState;
-  cmdState.state = SEC_INIT;
 
-  if (strncmp(received_msg, "GETSTATE", 8) == 0)
+  switch (state_parse_command(received_msg, (size_t)received_msg_len)) {
+  case STATE_COMMAND_LOGLEVEL: {
+    /* LOGLEVEL <module> <level> */
+    uint32_t module;
+    uint32_t level;
+
+    if (received_msg_len < 12) {
+      return;
+    }
+    module = (uint32_t)(received_msg[9] - '0');
+    level = (uint32_t)(received_msg[11] - '0');
+    if (log_set_level((log_module_t)module, (log_level_t)level)) {
+      LOG(LOG_MODULE_APP, LOG_LEVEL_INFO, "Log level of module %lu set to %lu\n",
+          module, level);
+    }
+    return;
+  }
+  case STATE_COMMAND_HEAPSTATS:
+    heap_stats_publish();
+    return;
+  case STATE_COMMAND_HEAPTRACE:
+    heap_trace_request_dump();
+    return;
+  case STATE_COMMAND_TRACEDUMP:
+    trace_request_dump();
+    return;
+  case STATE_COMMAND_TRACEARM:
+    trace_arm();
+    return;
+  case STATE_COMMAND_RECDUMP:
+    recorder_request_dump();
+    return;
+  case STATE_COMMAND_BENCH:
+    bench_request();
+    return;
+  case STATE_COMMAND_PROBEDUMP:
+    probe_publish();
+    return;
+  case STATE_COMMAND_PROBERESET:
+    probe_reset();
+    return;
+  case STATE_COMMAND_STACKPROFILE:
+    stack_profile_request();
+    return;
+  case STATE_COMMAND_DEADLINES:
+    deadline_publish();
+    return;
+  case STATE_COMMAND_GETSTATE:
     cmdState.state = SEC_GETSTATE;
-  if (strncmp(received_msg, "TRIPALARM", 9) == 0)
+    break;
+  case STATE_COMMAND_TRIPALARM:
     cmdState.state = SEC_TRIPPED;
-  if (strncmp(received_msg, "DEACTIVATEALARM", 15) == 0)
+    deadline_start(DEADLINE_TRIP_PUBLISH);
+    break;
+  case STATE_COMMAND_DEACTIVATEALARM:
     cmdState.state = SEC_UNACTIVE;
-  if (strncmp(received_msg, "ACTIVATEALARM", 13) == 0)
+    break;
+  case STATE_COMMAND_ACTIVATEALARM:
     cmdState.state = SEC_ACTIVE;
+    break;
+  default:
+    return;
+  }
 
-  if (cmdState.state != SEC_INIT)
+  if (xStateQueue != NULL)
     xQueueSend(xStateQueue, &cmdState, (TickType_t)10);
 }
+
+/*******************************************************************************
+ * Function Name: state_parse_command
+ ********************************************************************************
+ * Summary:
+ *   Decodes a message received on MQTT_SUB_TOPIC. Possible commands:
+ *   ? - GETSTATE - Forces the PSOC to retransmit its state
+ *   ? - TRIPALARM - Trips the alarm for testing-purposes
+ *   ? - ACTIVATEALARM / DEACTIVATEALARM - Arms and disarms the alarm
+ *   ? - LOGLEVEL <module> <level> - Sets the log level of a module, see log.h
+ *   ? - HEAPSTATS - Publishes a heap snapshot on the diagnostics topic
+ *   ? - HEAPTRACE - Publishes the heap trace on the diagnostics topic
+ *   ? - TRACEDUMP - Publishes the kernel event trace on the trace topic
+ *   ? - TRACEARM - Restarts the kernel event trace after a trigger
+ *   ? - RECDUMP - Publishes the event recorder on the record topic
+ *   ? - BENCH - Runs the microbenchmarks, results on the diagnostics topic
+ *   ? - PROBEDUMP - Prints the latency probes and publishes them on the
+ *       diagnostics topic
+ *   ? - PROBERESET - Clears the latency probes
+ *   ? - STACKPROFILE - Runs the stack profile, results on the diagnostics
+ *       topic
+ *   ? - DEADLINES - Publishes the response-time deadlines and their misses
+ *       on the diagnostics topic
+ *   A command matches as a prefix of the message.
+ *
+ * Parameters:
+ *  const char *msg : Message, not terminated
+ *  size_t len : Length of the message
+ *
+ * Return:
+ *  state_command_t : Command, STATE_COMMAND_NONE if there is none
+ *
+ *******************************************************************************/
+state_command_t state_parse_command(const char *msg, size_t len) {
+  static const struct {
+    const char *text;
+    size_t len;
+    state_command_t command;
+  } commands[] = {
+      {"LOGLEVEL ", 9u, STATE_COMMAND_LOGLEVEL},
+      {"HEAPSTATS", 9u, STATE_COMMAND_HEAPSTATS},
+      {"HEAPTRACE", 9u, STATE_COMMAND_HEAPTRACE},
+      {"TRACEDUMP", 9u, STATE_COMMAND_TRACEDUMP},
+      {"TRACEARM", 8u, STATE_COMMAND_TRACEARM},
+      {"RECDUMP", 7u, STATE_COMMAND_RECDUMP},
+      {"BENCH", 5u, STATE_COMMAND_BENCH},
+      {"PROBEDUMP", 9u, STATE_COMMAND_PROBEDUMP},
+      {"PROBERESET", 10u, STATE_COMMAND_PROBERESET},
+      {"STACKPROFILE", 12u, STATE_COMMAND_STACKPROFILE},
+      {"DEADLINES", 9u, STATE_COMMAND_DEADLINES},
+      {"GETSTATE", 8u, STATE_COMMAND_GETSTATE},
+      {"TRIPALARM", 9u, STATE_COMMAND_TRIPALARM},
+      {"DEACTIVATEALARM", 15u, STATE_COMMAND_DEACTIVATEALARM},
+      {"ACTIVATEALARM", 13u, STATE_COMMAND_ACTIVATEALARM},
+  };
+
+  for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+    if ((len >= commands[i].len) &&
+        (memcmp(msg, commands[i].text, commands[i].len) == 0)) {
+      return commands[i].command;
+    }
+  }
+  return STATE_COMMAND_NONE;
+}
@@ -5,10 +5,17 @@
 #include "cy_mqtt_api.h"
 #include "wiced_bt_dev.h"
 
-/* Task parameters for Button TaTasksk. */
-#define STATE_TASK_PRIORITY (1)
+/* Task parameters for the state task. It runs the alarm path and has the
+ * highest priority of the application tasks, above the coroutine task with
+ * the TLS handshake and the publisher tasks, so that a reconnection does not
+ * delay the button, the disarm or the trip. See "Priorities and deadlines"
+ * in README.md.
+ */
+#define STATE_TASK_PRIORITY (3)
 #define STATE_TASK_STACK_SIZE (1024 * 1)
-#define BUFFER_SIZE (128)
+
+/* Length of xStateQueue. */
+#define STATE_QUEUE_LENGTH (2u)
 
 /* enum for state machine */
 enum States {
@@ -35,6 +42,26 @@ typedef struct {
   StateMeta meta;
 }State;
 
+/* Commands received on MQTT_SUB_TOPIC, see state_parse_command() */
+typedef enum {
+  STATE_COMMAND_NONE,
+  STATE_COMMAND_LOGLEVEL,
+  STATE_COMMAND_HEAPSTATS,
+  STATE_COMMAND_HEAPTRACE,
+  STATE_COMMAND_TRACEDUMP,
+  STATE_COMMAND_TRACEARM,
+  STATE_COMMAND_RECDUMP,
+  STATE_COMMAND_BENCH,
+  STATE_COMMAND_PROBEDUMP,
+  STATE_COMMAND_PROBERESET,
+  STATE_COMMAND_STACKPROFILE,
+  STATE_COMMAND_DEADLINES,
+  STATE_COMMAND_GETSTATE,
+  STATE_COMMAND_TRIPALARM,
+  STATE_COMMAND_DEACTIVATEALARM,
+  STATE_COMMAND_ACTIVATEALARM,
+} state_command_t;
+
 /* FreeRTOS task handle for this task. */
 extern TaskHandle_t state_task_handle;
 
@@ -45,9 +72,9 @@ extern QueueHandle_t xStateQueue;
  * Function Prototypes
  ********************************************************************************/
 void state_task(void *pvParameters);
-static void subscribe_to_topic(void);
-static void unsubscribe_from_topic(void);
 void mqtt_subscription_callback(cy_mqtt_publish_info_t *received_msg_info);
+int state_format(const State *state, char *buffer, size_t buffer_size);
+state_command_t state_parse_command(const char *msg, size_t len);
 
 
 #endif /* PUBLISHER_TASK_H_ */
@@ -0,0 +1,272 @@
+/**
+ * This file implements the task statistics.
+ *
+ * FreeRTOS accumulates the run time of each task in units of the run time
+ * counter, here a 32-bit TCPWM timer at SYS_STATS_TIMER_HZ, independent of
+ * the tick. Every MQTT_DIAG_INTERVAL_MS the statistics task reads the state
+ * of all tasks, turns the run time since the previous sample into a CPU
+ * share in permille and reads the stack high water mark; it is a coroutine
+ * on the coroutine task. The result is
+ * published on the diagnostics topic as
+ *
+ *   {"tasks":[["name",cpu_permille,stack_free_bytes],...]}
+ *
+ * split over several messages when the tasks do not fit in one payload.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+/* FreeRTOS header files */
+#include <FreeRTOS.h>
+#include "task.h"
+
+#include "cyhal.h"
+
+#include "coroutine.h"
+#include "log.h"
+#include "mqtt_client_config.h"
+#include "publisher.h"
+#include "sys_stats.h"
+
+/******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Frequency of the run time counter. The 32-bit counter wraps after about
+ * 11.9 hours, the differences between two samples are not affected.
+ */
+#define SYS_STATS_TIMER_HZ (100000u)
+
+/* Maximum number of tasks sampled. */
+#define SYS_STATS_MAX_TASKS (24u)
+
+/* Free stack below which a task is reported on the console. */
+#define SYS_STATS_STACK_WARNING_BYTES (128u)
+
+/******************************************************************************
+ * Types
+ ******************************************************************************/
+typedef struct {
+  UBaseType_t task_number;
+  uint32_t run_time;
+} sys_stats_sample_t;
+
+/******************************************************************************
+ * Global Variables
+ ******************************************************************************/
+static cyhal_timer_t run_time_timer;
+static bool run_time_timer_ready;
+
+static TaskStatus_t task_status[SYS_STATS_MAX_TASKS];
+
+/* Run time of each task at the previous sample. */
+static sys_stats_sample_t previous[SYS_STATS_MAX_TASKS];
+static UBaseType_t previous_count;
+static uint32_t previous_total;
+
+static coroutine_t sys_stats_co;
+
+/* The first sample only sets the reference for the next one. */
+static bool first;
+
+/******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+static coroutine_status_t sys_stats_run(coroutine_t *co);
+static uint32_t sys_stats_previous_run_time(UBaseType_t task_number);
+static void sys_stats_publish(UBaseType_t task_count, uint32_t total_delta);
+
+/******************************************************************************
+ * Function Name: sys_stats_timer_init
+ ******************************************************************************
+ * Summary:
+ *  Starts the run time counter. Called by the scheduler through
+ *  portCONFIGURE_TIMER_FOR_RUN_TIME_STATS(). Without a free TCPWM the run
+ *  times stay 0.
+ *
+ ******************************************************************************/
+void sys_stats_timer_init(void) {
+  const cyhal_timer_cfg_t timer_cfg = {
+      .compare_value = 0,
+      .period = 0xFFFFFFFFu,
+      .direction = CYHAL_TIMER_DIR_UP,
+      .is_compare = false,
+      .is_continuous = true,
+      .value = 0,
+  };
+
+  if ((cyhal_timer_init(&run_time_timer, NC, NULL) != CY_RSLT_SUCCESS) ||
+      (cyhal_timer_configure(&run_time_timer, &timer_cfg) != CY_RSLT_SUCCESS) ||
+      (cyhal_timer_set_frequency(&run_time_timer, SYS_STATS_TIMER_HZ) !=
+       CY_RSLT_SUCCESS) ||
+      (cyhal_timer_start(&run_time_timer) != CY_RSLT_SUCCESS)) {
+    printf("Run time counter initialization failed!\n");
+    return;
+  }
+  run_time_timer_ready = true;
+}
+
+/******************************************************************************
+ * Function Name: sys_stats_timer_read
+ ******************************************************************************
+ * Summary:
+ *  Reads the run time counter, portGET_RUN_TIME_COUNTER_VALUE().
+ *
+ * Return:
+ *  uint32_t : Counter value in 1 / SYS_STATS_TIMER_HZ seconds
+ *
+ ******************************************************************************/
+uint32_t sys_stats_timer_read(void) {
+  return run_time_timer_ready ? cyhal_timer_read(&run_time_timer) : 0u;
+}
+
+/******************************************************************************
+ * Function Name: sys_stats_start
+ ******************************************************************************
+ * Summary:
+ *  Starts the statistics on the coroutine task.
+ *
+ ******************************************************************************/
+void sys_stats_start(void) {
+  first = true;
+  coroutine_start(&sys_stats_co, sys_stats_run);
+}
+
+/******************************************************************************
+ * Function Name: sys_stats_run
+ ******************************************************************************
+ * Summary:
+ *  Coroutine that samples the tasks every MQTT_DIAG_INTERVAL_MS and
+ *  publishes their CPU share and free stack.
+ *
+ * Parameters:
+ *  coroutine_t *co : State of the coroutine, sys_stats_co
+ *
+ * Return:
+ *  coroutine_status_t : Never COROUTINE_DONE
+ *
+ ******************************************************************************/
+static coroutine_status_t sys_stats_run(coroutine_t *co) {
+  CORO_BEGIN(co);
+
+  while (true) {
+    uint32_t total;
+    UBaseType_t task_count =
+        uxTaskGetSystemState(task_status, SYS_STATS_MAX_TASKS, &total);
+
+    if (task_count == 0u) {
+      LOG(LOG_MODULE_APP, LOG_LEVEL_WARNING,
+          "Task statistics: more than %u tasks\n", SYS_STATS_MAX_TASKS);
+    } else {
+      if (!first) {
+        sys_stats_publish(task_count, total - previous_total);
+      }
+      first = false;
+
+      for (UBaseType_t i = 0; i < task_count; i++) {
+        previous[i].task_number = task_status[i].xTaskNumber;
+        previous[i].run_time = task_status[i].ulRunTimeCounter;
+      }
+      previous_count = task_count;
+      previous_total = total;
+    }
+
+    CORO_DELAY(co, MQTT_DIAG_INTERVAL_MS);
+  }
+
+  CORO_END(co);
+}
+
+/******************************************************************************
+ * Function Name: sys_stats_previous_run_time
+ ******************************************************************************
+ * Summary:
+ *  Looks up the run time of a task at the previous sample.
+ *
+ * Parameters:
+ *  UBaseType_t task_number : xTaskNumber of the task
+ *
+ * Return:
+ *  uint32_t : Run time, 0 for a task created since
+ *
+ ******************************************************************************/
+static uint32_t sys_stats_previous_run_time(UBaseType_t task_number) {
+  for (UBaseType_t i = 0; i < previous_count; i++) {
+    if (previous[i].task_number == task_number) {
+      return previous[i].run_time;
+    }
+  }
+  return 0u;
+}
+
+/******************************************************************************
+ * Function Name: sys_stats_publish
+ ******************************************************************************
+ * Summary:
+ *  Writes the sampled tasks straight into publisher slots, starting a new
+ *  message when the next task does not fit.
+ *
+ * Parameters:
+ *  UBaseType_t task_count : Number of entries in task_status[]
+ *  uint32_t total_delta   : Run time counter ticks since the previous sample
+ *
+ ******************************************************************************/
+static void sys_stats_publish(UBaseType_t task_count, uint32_t total_delta) {
+  char *buffer = NULL;
+  size_t buffer_size = 0;
+  size_t len = 0;
+  UBaseType_t i = 0;
+
+  while (i < task_count) {
+    TaskStatus_t *status = &task_status[i];
+    uint32_t stack_free =
+        (uint32_t)status->usStackHighWaterMark * sizeof(StackType_t);
+    uint32_t run_delta = status->ulRunTimeCounter -
+                         sys_stats_previous_run_time(status->xTaskNumber);
+    uint32_t permille =
+        (total_delta > 0u)
+            ? (uint32_t)(((uint64_t)run_delta * 1000u) / total_delta)
+            : 0u;
+    int entry_len;
+
+    if (buffer == NULL) {
+      buffer = publisher_reserve(&buffer_size);
+      if (buffer == NULL) {
+        LOG(LOG_MODULE_APP, LOG_LEVEL_WARNING,
+            "Task statistics: no publisher slot\n");
+        return;
+      }
+      len = (size_t)snprintf(buffer, buffer_size, "{\"tasks\":[");
+    }
+
+    /* Room is kept for the closing "]}". */
+    entry_len = snprintf(&buffer[len], buffer_size - len, "%s[\"%s\",%lu,%lu]",
+                         (buffer[len - 1] == '[') ? "" : ",",
+                         status->pcTaskName, (unsigned long)permille,
+                         (unsigned long)stack_free);
+    if ((entry_len < 0) || ((len + (size_t)entry_len + 2u) >= buffer_size)) {
+      if (buffer[len - 1] == '[') {
+        /* A single task does not fit, should not happen. */
+        publisher_cancel(buffer);
+        return;
+      }
+      memcpy(&buffer[len], "]}", 2);
+      publisher_commit(MQTT_CLASS_DIAG, buffer, len + 2u);
+      buffer = NULL;
+      continue;
+    }
+    len += (size_t)entry_len;
+
+    /* Printed at once, the task name is in RAM. */
+    if (stack_free < SYS_STATS_STACK_WARNING_BYTES) {
+      printf("Task statistics: %s has %lu bytes of stack left\n",
+             status->pcTaskName, (unsigned long)stack_free);
+    }
+    i++;
+  }
+
+  if (buffer != NULL) {
+    memcpy(&buffer[len], "]}", 2);
+    publisher_commit(MQTT_CLASS_DIAG, buffer, len + 2u);
+  }
+}
@@ -0,0 +1,20 @@
+/*
+ * sys_stats.h
+ *
+ * Task statistics. Samples the CPU share and the free stack of every task and
+ * publishes them on the diagnostics topic.
+ */
+
+#ifndef SOURCE_SYS_STATS_H_
+#define SOURCE_SYS_STATS_H_
+
+#include <stdint.h>
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+void sys_stats_timer_init(void);
+uint32_t sys_stats_timer_read(void);
+void sys_stats_start(void);
+
+#endif /* SOURCE_SYS_STATS_H_ */
@@ -0,0 +1,222 @@
+/**
+ * This file hands a dedicated static arena to the mbedTLS buffer allocator.
+ * Every TLS allocation of the MQTT connection comes from this arena, so a
+ * reconnect always starts from the same, unfragmented memory layout.
+ *
+ * With HEAP_TLSF_ENABLE the arena is a TLSF arena of heap.c instead, listed
+ * with the heap pools.
+ *
+ * The worker task (handshake, disconnect), the MQTT receive thread and the
+ * publisher tasks all run TLS records at the same time, so every allocation
+ * and every walk of the arena is done with the scheduler suspended, like
+ * heap.c does for the system heap.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "FreeRTOS.h"
+#include "cy_utils.h"
+#include "mbedtls/memory_buffer_alloc.h"
+#include "mbedtls/platform.h"
+#include "task.h"
+
+#include "heap.h"
+#include "mqtt_client_config.h"
+#include "tls_memory.h"
+
+/*******************************************************************************
+ * Global Variables
+ ******************************************************************************/
+/* Backing store for all mbedTLS allocations. */
+static uint8_t tls_heap[MQTT_TLS_HEAP_SIZE] CY_ALIGN(8);
+
+#if HEAP_TLSF_ENABLE
+static heap_arena_t tls_arena;
+#else
+/* calloc()/free() of the buffer allocator, called under the lock. */
+static void *(*buffer_calloc)(size_t count, size_t size);
+static void (*buffer_free)(void *ptr);
+#endif
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+static void tls_lock(void);
+static void tls_unlock(void);
+static void *tls_memory_calloc(size_t count, size_t size);
+static void tls_memory_free(void *ptr);
+
+/******************************************************************************
+ * Function Name: tls_memory_init
+ ******************************************************************************
+ * Summary:
+ *  Redirects mbedtls_calloc()/mbedtls_free() to the static arena. Must run
+ *  before the first mbedTLS allocation, i.e. before cy_wcm_init() and
+ *  cy_mqtt_init().
+ *
+ ******************************************************************************/
+void tls_memory_init(void) {
+#if HEAP_TLSF_ENABLE
+  if (!heap_arena_init(&tls_arena, "tls", tls_heap, sizeof(tls_heap))) {
+    return;
+  }
+#else
+  /* Installs the buffer allocator, which is then wrapped in the lock. */
+  mbedtls_memory_buffer_alloc_init(tls_heap, sizeof(tls_heap));
+  buffer_calloc = mbedtls_calloc;
+  buffer_free = mbedtls_free;
+#endif
+  mbedtls_platform_set_calloc_free(tls_memory_calloc, tls_memory_free);
+}
+
+/* The arena lock, a no-op before the scheduler runs. */
+static void tls_lock(void) {
+  if (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED) {
+    vTaskSuspendAll();
+  }
+}
+
+static void tls_unlock(void) {
+  if (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED) {
+    (void)xTaskResumeAll();
+  }
+}
+
+/* mbedtls_calloc() and mbedtls_free() on the arena. */
+static void *tls_memory_calloc(size_t count, size_t size) {
+  void *ptr;
+
+  tls_lock();
+#if HEAP_TLSF_ENABLE
+  ptr = heap_arena_calloc(&tls_arena, count, size);
+#else
+  ptr = buffer_calloc(count, size);
+#endif
+  tls_unlock();
+  return ptr;
+}
+
+static void tls_memory_free(void *ptr) {
+  tls_lock();
+#if HEAP_TLSF_ENABLE
+  heap_arena_free(&tls_arena, ptr);
+#else
+  buffer_free(ptr);
+#endif
+  tls_unlock();
+}
+
+/******************************************************************************
+ * Function Name: tls_memory_reset_peak
+ ******************************************************************************
+ * Summary:
+ *  Restarts peak tracking, typically right before a TLS handshake.
+ *
+ ******************************************************************************/
+void tls_memory_reset_peak(void) {
+  tls_lock();
+#if HEAP_TLSF_ENABLE
+  heap_arena_reset_peak(&tls_arena);
+#else
+  mbedtls_memory_buffer_alloc_max_reset();
+#endif
+  tls_unlock();
+}
+
+/******************************************************************************
+ * Function Name: tls_memory_current
+ ******************************************************************************
+ * Return:
+ *  size_t : Bytes currently allocated from the arena.
+ *
+ ******************************************************************************/
+size_t tls_memory_current(void) {
+  size_t used;
+#if !HEAP_TLSF_ENABLE
+  size_t blocks;
+#endif
+
+  tls_lock();
+#if HEAP_TLSF_ENABLE
+  used = tls_arena.tlsf.stats.used;
+#else
+  mbedtls_memory_buffer_alloc_cur_get(&used, &blocks);
+#endif
+  tls_unlock();
+  return used;
+}
+
+/******************************************************************************
+ * Function Name: tls_memory_peak
+ ******************************************************************************
+ * Return:
+ *  size_t : Highest number of bytes allocated since the last peak reset.
+ *
+ ******************************************************************************/
+size_t tls_memory_peak(void) {
+  size_t peak;
+#if !HEAP_TLSF_ENABLE
+  size_t blocks;
+#endif
+
+  tls_lock();
+#if HEAP_TLSF_ENABLE
+  peak = tls_arena.tlsf.stats.peak;
+#else
+  mbedtls_memory_buffer_alloc_max_get(&peak, &blocks);
+#endif
+  tls_unlock();
+  return peak;
+}
+
+/******************************************************************************
+ * Function Name: tls_memory_report
+ ******************************************************************************
+ * Summary:
+ *  Prints current (steady-state) and peak arena usage.
+ *
+ * Parameters:
+ *  const char *label : Short description of the point of measurement
+ *
+ ******************************************************************************/
+void tls_memory_report(const char *label) {
+#if HEAP_TLSF_ENABLE
+  tlsf_stats_t stats;
+  bool intact;
+
+  tls_lock();
+  tlsf_get_stats(&tls_arena.tlsf, &stats);
+  intact = heap_arena_check(&tls_arena);
+  tls_unlock();
+
+  printf("TLS heap [%s]: current %u B in %u blocks, peak %u B, largest "
+         "allocation %u B, arena %u B\n",
+         label, (unsigned)stats.used, (unsigned)stats.blocks,
+         (unsigned)stats.peak, (unsigned)stats.largest_free,
+         (unsigned)sizeof(tls_heap));
+
+  if (!intact) {
+    printf("TLS heap [%s]: arena corrupted!\n", label);
+  }
+#else
+  size_t used, used_blocks, peak, peak_blocks;
+  bool intact;
+
+  tls_lock();
+  mbedtls_memory_buffer_alloc_cur_get(&used, &used_blocks);
+  mbedtls_memory_buffer_alloc_max_get(&peak, &peak_blocks);
+  intact = (mbedtls_memory_buffer_alloc_verify() == 0);
+  tls_unlock();
+
+  printf("TLS heap [%s]: current %u B in %u blocks, peak %u B in %u blocks, "
+         "arena %u B\n",
+         label, (unsigned)used, (unsigned)used_blocks, (unsigned)peak,
+         (unsigned)peak_blocks, (unsigned)sizeof(tls_heap));
+
+  if (!intact) {
+    printf("TLS heap [%s]: arena corrupted!\n", label);
+  }
+#endif
+}
@@ -0,0 +1,22 @@
+/*
+ * tls_memory.h
+ *
+ * Static memory arena for mbedTLS. Keeps the TLS record buffers and handshake
+ * allocations out of the heap shared with the BT stack and lwIP.
+ */
+
+#ifndef SOURCE_TLS_MEMORY_H_
+#define SOURCE_TLS_MEMORY_H_
+
+#include <stddef.h>
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+void tls_memory_init(void);
+void tls_memory_reset_peak(void);
+void tls_memory_report(const char *label);
+size_t tls_memory_current(void);
+size_t tls_memory_peak(void);
+
+#endif /* SOURCE_TLS_MEMORY_H_ */
@@ -0,0 +1,604 @@
+/**
+ * This file implements the TLSF allocator, see tlsf.h.
+ *
+ * Every block starts with a header of two TLSF_ALIGN slots: the previous
+ * physical block, which is only valid while that block is free and lies in
+ * its last bytes, and the size of the payload with two flags, this block
+ * free and the previous block free. A free block keeps its free list links
+ * in the payload. A used block thus costs TLSF_ALIGN bytes, and the header
+ * of the next block tells in constant time whether neighbours can merge.
+ *
+ * A request is rounded up to the next size class, so that the first block of
+ * the list found by the bitmaps always fits. The rest of a block is split
+ * off when it can hold a block of its own.
+ *
+ * The pool ends with an empty used block, the end marker, that stops the
+ * merges.
+ */
+
+#include <string.h>
+
+#include "tlsf.h"
+
+#if (TLSF_FL_COUNT > 32u) || (TLSF_SL_COUNT > 32u)
+#error "The TLSF bitmaps are 32 bits"
+#endif
+
+/******************************************************************************
+ * Macros
+ ******************************************************************************/
+#define TLSF_BLOCK_FREE ((size_t)1u)
+#define TLSF_BLOCK_PREV_FREE ((size_t)2u)
+#define TLSF_BLOCK_FLAGS (TLSF_BLOCK_FREE | TLSF_BLOCK_PREV_FREE)
+
+/* Bytes a used block costs on top of its payload. */
+#define TLSF_OVERHEAD ((size_t)TLSF_ALIGN)
+
+/* Offset of the payload in the block. */
+#define TLSF_PAYLOAD_OFFSET (offsetof(tlsf_block_t, next_free))
+
+/* Smallest payload, room for the free list links and the previous block
+ * slot of the next block.
+ */
+#define TLSF_BLOCK_MIN                                                         \
+  (((sizeof(tlsf_block_t) - TLSF_OVERHEAD) + TLSF_ALIGN - 1u) &                \
+   ~(size_t)(TLSF_ALIGN - 1u))
+
+#define TLSF_BLOCK_MAX ((size_t)1u << TLSF_FL_MAX)
+
+/* Blocks below this size are spread linearly over the lists of level 0. */
+#define TLSF_SMALL_BLOCK ((size_t)1u << TLSF_FL_SHIFT)
+
+/******************************************************************************
+ * Types
+ ******************************************************************************/
+struct tlsf_block {
+  union {
+    tlsf_block_t *prev_phys;
+    uint8_t prev_phys_slot[TLSF_ALIGN];
+  };
+  union {
+    size_t size;
+    uint8_t size_slot[TLSF_ALIGN];
+  };
+  /* Free list links, in the payload. */
+  tlsf_block_t *next_free;
+  tlsf_block_t *prev_free;
+};
+
+_Static_assert(offsetof(tlsf_block_t, next_free) == 2u * TLSF_ALIGN,
+               "The TLSF block header must be two TLSF_ALIGN slots");
+
+/******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+static void tlsf_block_insert(tlsf_t *tlsf, tlsf_block_t *block);
+static void tlsf_block_remove(tlsf_t *tlsf, tlsf_block_t *block);
+
+/******************************************************************************
+ * Block helpers
+ ******************************************************************************/
+static inline size_t block_size(const tlsf_block_t *block) {
+  return block->size & ~TLSF_BLOCK_FLAGS;
+}
+
+static inline void block_set_size(tlsf_block_t *block, size_t size) {
+  block->size = size | (block->size & TLSF_BLOCK_FLAGS);
+}
+
+static inline bool block_is_free(const tlsf_block_t *block) {
+  return (block->size & TLSF_BLOCK_FREE) != 0u;
+}
+
+static inline bool block_is_prev_free(const tlsf_block_t *block) {
+  return (block->size & TLSF_BLOCK_PREV_FREE) != 0u;
+}
+
+static inline void block_set_prev_free(tlsf_block_t *block, bool prev_free) {
+  block->size = prev_free ? (block->size | TLSF_BLOCK_PREV_FREE)
+                          : (block->size & ~TLSF_BLOCK_PREV_FREE);
+}
+
+static inline void *block_to_ptr(const tlsf_block_t *block) {
+  return (char *)block + TLSF_PAYLOAD_OFFSET;
+}
+
+static inline tlsf_block_t *block_from_ptr(const void *ptr) {
+  return (tlsf_block_t *)((char *)ptr - TLSF_PAYLOAD_OFFSET);
+}
+
+/* The next block starts in the last slot of the payload. */
+static inline tlsf_block_t *block_next(const tlsf_block_t *block) {
+  return (tlsf_block_t *)((char *)block_to_ptr(block) + block_size(block) -
+                          TLSF_OVERHEAD);
+}
+
+static inline tlsf_block_t *block_link_next(tlsf_block_t *block) {
+  tlsf_block_t *next = block_next(block);
+
+  next->prev_phys = block;
+  return next;
+}
+
+static inline void block_mark_as_free(tlsf_block_t *block) {
+  block_set_prev_free(block_link_next(block), true);
+  block->size |= TLSF_BLOCK_FREE;
+}
+
+static inline void block_mark_as_used(tlsf_block_t *block) {
+  block_set_prev_free(block_next(block), false);
+  block->size &= ~TLSF_BLOCK_FREE;
+}
+
+/******************************************************************************
+ * Size classes
+ ******************************************************************************/
+static inline uint32_t tlsf_fls(size_t value) {
+  return 63u - (uint32_t)__builtin_clzll((unsigned long long)value);
+}
+
+/* List of a block of this size. */
+static void mapping_insert(size_t size, uint32_t *fl, uint32_t *sl) {
+  if (size < TLSF_SMALL_BLOCK) {
+    *fl = 0;
+    *sl = (uint32_t)(size / (TLSF_SMALL_BLOCK / TLSF_SL_COUNT));
+  } else {
+    uint32_t bit = tlsf_fls(size);
+
+    *sl = (uint32_t)(size >> (bit - TLSF_SL_COUNT_LOG2)) ^ TLSF_SL_COUNT;
+    *fl = bit - (TLSF_FL_SHIFT - 1u);
+  }
+}
+
+/* Smallest block size of a list, which is also the largest request that
+ * mapping_search() sends to it.
+ */
+static size_t mapping_floor(uint32_t fl, uint32_t sl) {
+  if (fl == 0u) {
+    return (size_t)sl * (TLSF_SMALL_BLOCK / TLSF_SL_COUNT);
+  }
+  return ((size_t)TLSF_SL_COUNT + sl)
+         << (fl + TLSF_FL_SHIFT - 1u - TLSF_SL_COUNT_LOG2);
+}
+
+/* First list whose blocks all fit this size. */
+static void mapping_search(size_t size, uint32_t *fl, uint32_t *sl) {
+  if (size >= TLSF_SMALL_BLOCK) {
+    size += ((size_t)1u << (tlsf_fls(size) - TLSF_SL_COUNT_LOG2)) - 1u;
+  }
+  mapping_insert(size, fl, sl);
+}
+
+/* Payload for a request, 0 if it cannot be served. */
+static size_t adjust_request(size_t size) {
+  size_t aligned = (size + TLSF_ALIGN - 1u) & ~(size_t)(TLSF_ALIGN - 1u);
+
+  if ((aligned < size) || (aligned >= TLSF_BLOCK_MAX)) {
+    return 0u;
+  }
+  return (aligned < TLSF_BLOCK_MIN) ? TLSF_BLOCK_MIN : aligned;
+}
+
+/******************************************************************************
+ * Free lists
+ ******************************************************************************/
+static void remove_free_block(tlsf_t *tlsf, tlsf_block_t *block, uint32_t fl,
+                              uint32_t sl) {
+  tlsf_block_t *prev = block->prev_free;
+  tlsf_block_t *next = block->next_free;
+
+  if (next != NULL) {
+    next->prev_free = prev;
+  }
+  if (prev != NULL) {
+    prev->next_free = next;
+  } else {
+    tlsf->blocks[fl][sl] = next;
+    if (next == NULL) {
+      tlsf->sl_bitmap[fl] &= ~(1u << sl);
+      if (tlsf->sl_bitmap[fl] == 0u) {
+        tlsf->fl_bitmap &= ~(1u << fl);
+      }
+    }
+  }
+}
+
+static void insert_free_block(tlsf_t *tlsf, tlsf_block_t *block, uint32_t fl,
+                              uint32_t sl) {
+  tlsf_block_t *current = tlsf->blocks[fl][sl];
+
+  block->next_free = current;
+  block->prev_free = NULL;
+  if (current != NULL) {
+    current->prev_free = block;
+  }
+  tlsf->blocks[fl][sl] = block;
+  tlsf->fl_bitmap |= 1u << fl;
+  tlsf->sl_bitmap[fl] |= 1u << sl;
+}
+
+static void tlsf_block_remove(tlsf_t *tlsf, tlsf_block_t *block) {
+  uint32_t fl, sl;
+
+  mapping_insert(block_size(block), &fl, &sl);
+  remove_free_block(tlsf, block, fl, sl);
+}
+
+static void tlsf_block_insert(tlsf_t *tlsf, tlsf_block_t *block) {
+  uint32_t fl, sl;
+
+  mapping_insert(block_size(block), &fl, &sl);
+  insert_free_block(tlsf, block, fl, sl);
+}
+
+/* Head of the first non-empty list from fl, sl on, NULL if there is none. */
+static tlsf_block_t *search_suitable_block(const tlsf_t *tlsf, uint32_t *fl,
+                                           uint32_t *sl) {
+  uint32_t sl_map = tlsf->sl_bitmap[*fl] & (~0u << *sl);
+
+  if (sl_map == 0u) {
+    uint32_t fl_map =
+        (*fl + 1u < 32u) ? (tlsf->fl_bitmap & (~0u << (*fl + 1u))) : 0u;
+
+    if (fl_map == 0u) {
+      return NULL;
+    }
+    *fl = (uint32_t)__builtin_ctz(fl_map);
+    sl_map = tlsf->sl_bitmap[*fl];
+  }
+  *sl = (uint32_t)__builtin_ctz(sl_map);
+  return tlsf->blocks[*fl][*sl];
+}
+
+/******************************************************************************
+ * Split and merge
+ ******************************************************************************/
+static bool block_can_split(const tlsf_block_t *block, size_t size) {
+  return block_size(block) >= sizeof(tlsf_block_t) + size;
+}
+
+/* Splits the payload after size bytes, returns the free remainder. */
+static tlsf_block_t *block_split(tlsf_block_t *block, size_t size) {
+  tlsf_block_t *remaining =
+      (tlsf_block_t *)((char *)block_to_ptr(block) + size - TLSF_OVERHEAD);
+
+  remaining->size = block_size(block) - (size + TLSF_OVERHEAD);
+  block_set_size(block, size);
+  block_mark_as_free(remaining);
+  return remaining;
+}
+
+static tlsf_block_t *block_absorb(tlsf_block_t *prev, tlsf_block_t *block) {
+  prev->size += block_size(block) + TLSF_OVERHEAD;
+  (void)block_link_next(prev);
+  return prev;
+}
+
+static tlsf_block_t *block_merge_prev(tlsf_t *tlsf, tlsf_block_t *block) {
+  if (block_is_prev_free(block)) {
+    tlsf_block_t *prev = block->prev_phys;
+
+    tlsf_block_remove(tlsf, prev);
+    block = block_absorb(prev, block);
+  }
+  return block;
+}
+
+static tlsf_block_t *block_merge_next(tlsf_t *tlsf, tlsf_block_t *block) {
+  tlsf_block_t *next = block_next(block);
+
+  if (block_is_free(next)) {
+    tlsf_block_remove(tlsf, next);
+    block = block_absorb(block, next);
+  }
+  return block;
+}
+
+/* Gives the rest of a free block about to be used back to the lists. */
+static void block_trim_free(tlsf_t *tlsf, tlsf_block_t *block, size_t size) {
+  if (block_can_split(block, size)) {
+    tlsf_block_t *remaining = block_split(block, size);
+
+    (void)block_link_next(block);
+    block_set_prev_free(remaining, true);
+    tlsf_block_insert(tlsf, remaining);
+  }
+}
+
+/* Gives the rest of a used block back to the lists. */
+static void block_trim_used(tlsf_t *tlsf, tlsf_block_t *block, size_t size) {
+  if (block_can_split(block, size)) {
+    tlsf_block_t *remaining = block_split(block, size);
+
+    block_set_prev_free(remaining, false);
+    remaining = block_merge_next(tlsf, remaining);
+    tlsf_block_insert(tlsf, remaining);
+  }
+}
+
+static void tlsf_count_used(tlsf_t *tlsf, size_t bytes) {
+  tlsf->stats.used += (uint32_t)bytes;
+  if (tlsf->stats.used > tlsf->stats.peak) {
+    tlsf->stats.peak = tlsf->stats.used;
+  }
+}
+
+/******************************************************************************
+ * Function Name: tlsf_init
+ ******************************************************************************
+ * Summary:
+ *  Makes a region of memory one free block. A region larger than the largest
+ *  block is only used up to it.
+ *
+ * Parameters:
+ *  tlsf_t *tlsf : Pool
+ *  void *mem    : Region
+ *  size_t size  : Size of the region in bytes
+ *
+ * Return:
+ *  bool : false if the region is too small
+ *
+ ******************************************************************************/
+bool tlsf_init(tlsf_t *tlsf, void *mem, size_t size) {
+  uintptr_t start = ((uintptr_t)mem + TLSF_ALIGN - 1u) &
+                    ~(uintptr_t)(TLSF_ALIGN - 1u);
+  size_t skipped = (size_t)(start - (uintptr_t)mem);
+  size_t pool_bytes;
+  tlsf_block_t *block;
+
+  memset(tlsf, 0, sizeof(*tlsf));
+  if (size < skipped + 2u * TLSF_OVERHEAD + TLSF_BLOCK_MIN) {
+    return false;
+  }
+  pool_bytes = (size - skipped - 2u * TLSF_OVERHEAD) &
+               ~(size_t)(TLSF_ALIGN - 1u);
+  if (pool_bytes >= TLSF_BLOCK_MAX) {
+    pool_bytes = TLSF_BLOCK_MAX - TLSF_ALIGN;
+  }
+
+  /* The previous block slot of the first block lies before the region and
+   * is never read, the previous block being marked used.
+   */
+  block = (tlsf_block_t *)(start - TLSF_OVERHEAD);
+  block->size = pool_bytes | TLSF_BLOCK_FREE;
+  tlsf_block_insert(tlsf, block);
+
+  tlsf->first = block;
+  tlsf->last = block_link_next(block);
+  tlsf->last->size = TLSF_BLOCK_PREV_FREE;
+
+  tlsf->stats.size = (uint32_t)(pool_bytes + TLSF_OVERHEAD);
+  return true;
+}
+
+/******************************************************************************
+ * Function Name: tlsf_malloc
+ ******************************************************************************
+ * Return:
+ *  void * : TLSF_ALIGN aligned block of at least size bytes, NULL if no
+ *           free block is large enough. A size of 0 gets the smallest block.
+ *
+ ******************************************************************************/
+void *tlsf_malloc(tlsf_t *tlsf, size_t size) {
+  size_t adjusted = adjust_request(size);
+  tlsf_block_t *block = NULL;
+  uint32_t fl, sl;
+
+  if (adjusted != 0u) {
+    mapping_search(adjusted, &fl, &sl);
+    if (fl < TLSF_FL_COUNT) {
+      block = search_suitable_block(tlsf, &fl, &sl);
+    }
+  }
+  if (block == NULL) {
+    tlsf->stats.failures++;
+    return NULL;
+  }
+
+  remove_free_block(tlsf, block, fl, sl);
+  block_trim_free(tlsf, block, adjusted);
+  block_mark_as_used(block);
+
+  tlsf->stats.allocs++;
+  tlsf->stats.blocks++;
+  tlsf_count_used(tlsf, block_size(block) + TLSF_OVERHEAD);
+  return block_to_ptr(block);
+}
+
+/******************************************************************************
+ * Function Name: tlsf_free
+ ******************************************************************************
+ * Summary:
+ *  Frees a block and merges it with its free neighbours. NULL is ignored.
+ *
+ ******************************************************************************/
+void tlsf_free(tlsf_t *tlsf, void *ptr) {
+  tlsf_block_t *block;
+
+  if (ptr == NULL) {
+    return;
+  }
+  block = block_from_ptr(ptr);
+  tlsf->stats.used -= (uint32_t)(block_size(block) + TLSF_OVERHEAD);
+  tlsf->stats.blocks--;
+  tlsf->stats.frees++;
+
+  block_mark_as_free(block);
+  block = block_merge_prev(tlsf, block);
+  block = block_merge_next(tlsf, block);
+  tlsf_block_insert(tlsf, block);
+}
+
+/******************************************************************************
+ * Function Name: tlsf_realloc
+ ******************************************************************************
+ * Summary:
+ *  Resizes a block, in place when it shrinks or the next block is free and
+ *  large enough, else by a new allocation and a copy. On failure the block
+ *  is left as it was and NULL is returned.
+ *
+ ******************************************************************************/
+void *tlsf_realloc(tlsf_t *tlsf, void *ptr, size_t size) {
+  tlsf_block_t *block;
+  tlsf_block_t *next;
+  size_t current;
+  size_t adjusted;
+
+  if (ptr == NULL) {
+    return tlsf_malloc(tlsf, size);
+  }
+  if (size == 0u) {
+    tlsf_free(tlsf, ptr);
+    return NULL;
+  }
+
+  block = block_from_ptr(ptr);
+  next = block_next(block);
+  current = block_size(block);
+  adjusted = adjust_request(size);
+  if (adjusted == 0u) {
+    tlsf->stats.failures++;
+    return NULL;
+  }
+
+  if ((adjusted > current) &&
+      (!block_is_free(next) ||
+       (adjusted > current + block_size(next) + TLSF_OVERHEAD))) {
+    void *moved = tlsf_malloc(tlsf, size);
+
+    if (moved != NULL) {
+      memcpy(moved, ptr, current);
+      tlsf_free(tlsf, ptr);
+    }
+    return moved;
+  }
+
+  tlsf->stats.used -= (uint32_t)(current + TLSF_OVERHEAD);
+  if (adjusted > current) {
+    (void)block_merge_next(tlsf, block);
+    block_mark_as_used(block);
+  }
+  block_trim_used(tlsf, block, adjusted);
+  tlsf_count_used(tlsf, block_size(block) + TLSF_OVERHEAD);
+  return ptr;
+}
+
+/* Usable size of an allocated block. */
+size_t tlsf_block_size(const void *ptr) {
+  return block_size(block_from_ptr(ptr));
+}
+
+/* Whether a pointer lies in the pool. */
+bool tlsf_owns(const tlsf_t *tlsf, const void *ptr) {
+  return ((const char *)ptr > (const char *)tlsf->first) &&
+         ((const char *)ptr < (const char *)tlsf->last);
+}
+
+/******************************************************************************
+ * Function Name: tlsf_get_stats
+ ******************************************************************************
+ * Summary:
+ *  Copies the statistics of the pool, with the free bytes, the largest free
+ *  block and the largest allocation that succeeds. Finding the largest block
+ *  walks one free list.
+ *
+ *  An allocation searches the lists whose blocks all fit it, so one larger
+ *  than the smallest size of the last list fails even when a block of that
+ *  list would hold it: a single free block of 199984 bytes serves at most
+ *  196608.
+ *
+ ******************************************************************************/
+void tlsf_get_stats(const tlsf_t *tlsf, tlsf_stats_t *stats) {
+  *stats = tlsf->stats;
+  stats->free = tlsf->stats.size - tlsf->stats.used;
+  stats->largest_block = 0;
+  stats->largest_free = 0;
+
+  if (tlsf->fl_bitmap != 0u) {
+    uint32_t fl = tlsf_fls(tlsf->fl_bitmap);
+    uint32_t sl = tlsf_fls(tlsf->sl_bitmap[fl]);
+
+    for (const tlsf_block_t *block = tlsf->blocks[fl][sl]; block != NULL;
+         block = block->next_free) {
+      if (block_size(block) > stats->largest_block) {
+        stats->largest_block = (uint32_t)block_size(block);
+      }
+    }
+    stats->largest_free = (uint32_t)mapping_floor(fl, sl);
+  }
+}
+
+/* Restarts the peak from the bytes in use. */
+void tlsf_reset_peak(tlsf_t *tlsf) { tlsf->stats.peak = tlsf->stats.used; }
+
+/******************************************************************************
+ * Function Name: tlsf_check
+ ******************************************************************************
+ * Summary:
+ *  Walks the pool and the free lists and checks that they agree: the flags
+ *  of neighbours, no two free blocks in a row, every free block in the list
+ *  of its size and the byte counts. Takes time in the number of blocks.
+ *
+ * Return:
+ *  bool : true if the pool is consistent
+ *
+ ******************************************************************************/
+bool tlsf_check(const tlsf_t *tlsf) {
+  const tlsf_block_t *block = tlsf->first;
+  bool prev_free = false;
+  uint32_t free_blocks = 0;
+  uint32_t listed_blocks = 0;
+  size_t used = 0;
+  size_t total = 0;
+
+  if (block == NULL) {
+    return false;
+  }
+  while (block != tlsf->last) {
+    if (((const char *)block > (const char *)tlsf->last) ||
+        (block_size(block) < TLSF_BLOCK_MIN) ||
+        (block_is_prev_free(block) != prev_free) ||
+        (block_is_free(block) && prev_free)) {
+      return false;
+    }
+    prev_free = block_is_free(block);
+    if (prev_free) {
+      free_blocks++;
+      if (block_next(block)->prev_phys != block) {
+        return false;
+      }
+    } else {
+      used += block_size(block) + TLSF_OVERHEAD;
+    }
+    total += block_size(block) + TLSF_OVERHEAD;
+    block = block_next(block);
+  }
+  if ((block_is_prev_free(block) != prev_free) || (total != tlsf->stats.size) ||
+      (used != tlsf->stats.used)) {
+    return false;
+  }
+
+  for (uint32_t fl = 0; fl < TLSF_FL_COUNT; fl++) {
+    if (((tlsf->fl_bitmap >> fl) & 1u) != (tlsf->sl_bitmap[fl] != 0u)) {
+      return false;
+    }
+    for (uint32_t sl = 0; sl < TLSF_SL_COUNT; sl++) {
+      const tlsf_block_t *head = tlsf->blocks[fl][sl];
+
+      if (((tlsf->sl_bitmap[fl] >> sl) & 1u) != (head != NULL)) {
+        return false;
+      }
+      for (const tlsf_block_t *free_block = head; free_block != NULL;
+           free_block = free_block->next_free) {
+        uint32_t block_fl, block_sl;
+
+        mapping_insert(block_size(free_block), &block_fl, &block_sl);
+        if (!block_is_free(free_block) || (block_fl != fl) ||
+            (block_sl != sl) || (++listed_blocks > free_blocks)) {
+          return false;
+        }
+      }
+    }
+  }
+  return listed_blocks == free_blocks;
+}
@@ -0,0 +1,84 @@
+/*
+ * tlsf.h
+ *
+ * Two-level segregated fit allocator. Free blocks are kept in lists by size
+ * class, a first level per power of two and TLSF_SL_COUNT second levels in
+ * between, with a bitmap of the non-empty lists. Allocation and free find
+ * their list with a count leading zeros and take or merge a block in
+ * constant time, whatever the state of the pool.
+ *
+ * A pool is one region of memory with its own control structure. The
+ * functions do not lock; heap.c locks the pools of the application.
+ */
+
+#ifndef SOURCE_TLSF_H_
+#define SOURCE_TLSF_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Second level lists per power of two, as log2. */
+#define TLSF_SL_COUNT_LOG2 (4u)
+#define TLSF_SL_COUNT (1u << TLSF_SL_COUNT_LOG2)
+
+/* Alignment of the blocks, as log2. */
+#define TLSF_ALIGN_LOG2 (3u)
+#define TLSF_ALIGN (1u << TLSF_ALIGN_LOG2)
+
+/* Blocks and pools up to 2^TLSF_FL_MAX bytes. */
+#define TLSF_FL_MAX (20u)
+
+/* Blocks below 2^TLSF_FL_SHIFT bytes share the first level list 0. */
+#define TLSF_FL_SHIFT (TLSF_SL_COUNT_LOG2 + TLSF_ALIGN_LOG2)
+#define TLSF_FL_COUNT (TLSF_FL_MAX - TLSF_FL_SHIFT + 1u)
+
+/*******************************************************************************
+ * Data Types
+ ******************************************************************************/
+typedef struct tlsf_block tlsf_block_t;
+
+typedef struct {
+  /* Bytes of the pool and bytes in use, block headers included. */
+  uint32_t size;
+  uint32_t used;
+  uint32_t peak;
+  uint32_t free;
+  /* Largest free block, and the largest allocation that succeeds, which is
+   * smaller: see tlsf_get_stats().
+   */
+  uint32_t largest_block;
+  uint32_t largest_free;
+  uint32_t blocks;
+  uint32_t allocs;
+  uint32_t frees;
+  uint32_t failures;
+} tlsf_stats_t;
+
+typedef struct {
+  uint32_t fl_bitmap;
+  uint32_t sl_bitmap[TLSF_FL_COUNT];
+  tlsf_block_t *blocks[TLSF_FL_COUNT][TLSF_SL_COUNT];
+  /* First block and end marker of the pool. */
+  tlsf_block_t *first;
+  tlsf_block_t *last;
+  tlsf_stats_t stats;
+} tlsf_t;
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+bool tlsf_init(tlsf_t *tlsf, void *mem, size_t size);
+void *tlsf_malloc(tlsf_t *tlsf, size_t size);
+void *tlsf_realloc(tlsf_t *tlsf, void *ptr, size_t size);
+void tlsf_free(tlsf_t *tlsf, void *ptr);
+size_t tlsf_block_size(const void *ptr);
+bool tlsf_owns(const tlsf_t *tlsf, const void *ptr);
+void tlsf_get_stats(const tlsf_t *tlsf, tlsf_stats_t *stats);
+void tlsf_reset_peak(tlsf_t *tlsf);
+bool tlsf_check(const tlsf_t *tlsf);
+
+#endif /* SOURCE_TLSF_H_ */
@@ -0,0 +1,496 @@
+/**
+ * This file implements the kernel event trace.
+ *
+ * The FreeRTOS trace hooks (see trace.h) and the application interrupt
+ * handlers write 12-byte records into a RAM ring: the DWT cycle count, the
+ * event, the task or exception it ran in and an argument, the queue address
+ * or the exception number. The ring is a flight recorder and overwrites the
+ * oldest records.
+ *
+ * A trace_trigger() call, made by log_timing_end() when a Bluetooth or MQTT
+ * callback takes longer than TRACE_TRIGGER_LATENCY_US, lets the recorder run
+ * for TRACE_POST_TRIGGER_EVENTS more records and freezes the ring. The trace
+ * task then prints it on the console; it stays frozen until trace_arm(). On
+ * request the ring is also published on MQTT_TRACE_TOPIC. Both dumps are
+ * text lines that trace_to_chrome.py in server_code converts to Chrome trace
+ * JSON, for chrome://tracing or https://ui.perfetto.dev.
+ *
+ * The cycle counter wraps every 2^32 cycles, the converter unwraps it as
+ * long as records are closer than that. It stops in deep sleep.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+/* FreeRTOS header files */
+#include <FreeRTOS.h>
+#include "queue.h"
+#include "task.h"
+
+#include "cyhal.h"
+
+#include "mqtt_client_config.h"
+#include "publisher.h"
+#include "trace.h"
+
+#if TRACE_ENABLE && ((TRACE_BUFFER_EVENTS & (TRACE_BUFFER_EVENTS - 1u)) != 0u)
+#error "TRACE_BUFFER_EVENTS must be a power of two"
+#endif
+
+/******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Context of the records written in exception handlers. */
+#define TRACE_CONTEXT_ISR (0x8000u)
+
+/* Records written after a trigger before the ring freezes. */
+#define TRACE_POST_TRIGGER_EVENTS (TRACE_BUFFER_EVENTS / 4u)
+
+/* Delay of the trace task between checks of the ring. */
+#define TRACE_POLL_MS (100u)
+
+/* Console dump pace, below the 115200 baud of the debug UART. */
+#define TRACE_CONSOLE_BATCH_LINES (8u)
+#define TRACE_CONSOLE_BATCH_MS (20u)
+
+/* Wait for a free publisher slot during an MQTT dump. */
+#define TRACE_PUBLISH_RETRY_MS (50u)
+#define TRACE_PUBLISH_RETRIES (40u)
+
+/* Tasks and queues named in a dump. */
+#define TRACE_MAX_TASKS (24u)
+#define TRACE_MAX_QUEUES (16u)
+
+/* Longest dump line. */
+#define TRACE_LINE_SIZE (64u)
+
+/******************************************************************************
+ * Types
+ ******************************************************************************/
+typedef struct {
+  uint32_t timestamp;
+  uint32_t arg;
+  /* Task number, or TRACE_CONTEXT_ISR | exception number. */
+  uint16_t context;
+  uint8_t event;
+  uint8_t reserved;
+} trace_record_t;
+
+/* Destination of a dump. */
+typedef struct {
+  bool mqtt;
+  char *buffer;
+  size_t size;
+  size_t len;
+  uint32_t lines;
+  bool failed;
+} trace_sink_t;
+
+/******************************************************************************
+ * Global Variables
+ ******************************************************************************/
+#if TRACE_ENABLE
+static trace_record_t trace_ring[TRACE_BUFFER_EVENTS];
+
+/* Records written since boot. */
+static uint32_t trace_head;
+static uint16_t trace_current_task;
+
+static volatile bool trace_frozen;
+static volatile bool trace_triggered;
+static volatile uint32_t trace_stop_at;
+static volatile bool trace_dump_requested;
+
+static TaskStatus_t trace_tasks[TRACE_MAX_TASKS];
+#endif
+
+/******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+#if TRACE_ENABLE
+static void trace_store(uint32_t event, uint32_t context, uint32_t arg);
+static uint32_t trace_context(void);
+static void trace_dump(bool mqtt);
+static void trace_emit(trace_sink_t *sink, const char *line, int len);
+static void trace_flush(trace_sink_t *sink);
+#endif
+
+/******************************************************************************
+ * Function Name: trace_task_switched_in
+ ******************************************************************************
+ * Summary:
+ *  traceTASK_SWITCHED_IN() hook, called by the scheduler.
+ *
+ * Parameters:
+ *  uint32_t task_number : Number of the task switched in
+ *
+ ******************************************************************************/
+void trace_task_switched_in(uint32_t task_number) {
+#if TRACE_ENABLE
+  uint32_t saved_intr = cyhal_system_critical_section_enter();
+
+  trace_current_task = (uint16_t)task_number;
+  trace_store(TRACE_EVENT_TASK_SWITCH, task_number, task_number);
+  cyhal_system_critical_section_exit(saved_intr);
+#else
+  (void)task_number;
+#endif
+}
+
+/******************************************************************************
+ * Function Name: trace_queue
+ ******************************************************************************
+ * Summary:
+ *  Queue hooks, called by queue.c from tasks and ISRs.
+ *
+ * Parameters:
+ *  uint32_t event    : TRACE_EVENT_QUEUE_*
+ *  const void *queue : Queue, semaphore or mutex
+ *
+ ******************************************************************************/
+void trace_queue(uint32_t event, const void *queue) {
+#if TRACE_ENABLE
+  uint32_t saved_intr = cyhal_system_critical_section_enter();
+
+  trace_store(event, trace_context(), (uint32_t)(uintptr_t)queue);
+  cyhal_system_critical_section_exit(saved_intr);
+#else
+  (void)event;
+  (void)queue;
+#endif
+}
+
+/******************************************************************************
+ * Function Name: trace_isr_enter
+ ******************************************************************************
+ * Summary:
+ *  Start of an interrupt handler, see TRACE_ISR_ENTER().
+ *
+ ******************************************************************************/
+void trace_isr_enter(void) {
+#if TRACE_ENABLE
+  uint32_t saved_intr = cyhal_system_critical_section_enter();
+
+  trace_store(TRACE_EVENT_ISR_ENTER, trace_context(), __get_IPSR());
+  cyhal_system_critical_section_exit(saved_intr);
+#endif
+}
+
+/******************************************************************************
+ * Function Name: trace_isr_exit
+ ******************************************************************************
+ * Summary:
+ *  End of an interrupt handler, see TRACE_ISR_EXIT().
+ *
+ ******************************************************************************/
+void trace_isr_exit(void) {
+#if TRACE_ENABLE
+  uint32_t saved_intr = cyhal_system_critical_section_enter();
+
+  trace_store(TRACE_EVENT_ISR_EXIT, trace_context(), __get_IPSR());
+  cyhal_system_critical_section_exit(saved_intr);
+#endif
+}
+
+/******************************************************************************
+ * Function Name: trace_trigger
+ ******************************************************************************
+ * Summary:
+ *  Marks a latency spike. The ring freezes TRACE_POST_TRIGGER_EVENTS records
+ *  later. Ignored while a trigger is pending or the ring is frozen. Safe from
+ *  tasks and ISRs.
+ *
+ ******************************************************************************/
+void trace_trigger(void) {
+#if TRACE_ENABLE
+  uint32_t saved_intr = cyhal_system_critical_section_enter();
+
+  if (!trace_triggered && !trace_frozen) {
+    trace_store(TRACE_EVENT_TRIGGER, trace_context(), 0);
+    trace_triggered = true;
+    trace_stop_at = trace_head + TRACE_POST_TRIGGER_EVENTS;
+  }
+  cyhal_system_critical_section_exit(saved_intr);
+#endif
+}
+
+/******************************************************************************
+ * Function Name: trace_arm
+ ******************************************************************************
+ * Summary:
+ *  Restarts the recording after a trigger froze the ring.
+ *
+ ******************************************************************************/
+void trace_arm(void) {
+#if TRACE_ENABLE
+  uint32_t saved_intr = cyhal_system_critical_section_enter();
+
+  trace_triggered = false;
+  trace_frozen = false;
+  cyhal_system_critical_section_exit(saved_intr);
+#endif
+}
+
+/******************************************************************************
+ * Function Name: trace_request_dump
+ ******************************************************************************
+ * Summary:
+ *  Asks the trace task to publish the ring on MQTT_TRACE_TOPIC. Recording
+ *  pauses during the dump.
+ *
+ ******************************************************************************/
+void trace_request_dump(void) {
+#if TRACE_ENABLE
+  trace_dump_requested = true;
+#endif
+}
+
+/******************************************************************************
+ * Function Name: trace_task
+ ******************************************************************************
+ * Summary:
+ *  Prints the ring on the console once a trigger froze it, and publishes it
+ *  when requested.
+ *
+ * Parameters:
+ *  void *pvParameters : Task parameter defined during task creation (unused)
+ *
+ ******************************************************************************/
+void trace_task(void *pvParameters) {
+#if TRACE_ENABLE
+  bool printed = false;
+
+  (void)pvParameters;
+
+  while (true) {
+    vTaskDelay(pdMS_TO_TICKS(TRACE_POLL_MS));
+
+    if (trace_frozen && trace_triggered && !printed) {
+      printf("Trace: latency trigger, ring frozen\n");
+      trace_dump(false);
+      printed = true;
+    } else if (!trace_frozen) {
+      printed = false;
+    }
+
+    if (trace_dump_requested) {
+      bool was_frozen = trace_frozen;
+
+      trace_dump_requested = false;
+      trace_frozen = true;
+      trace_dump(true);
+      if (!was_frozen) {
+        trace_frozen = false;
+      }
+    }
+  }
+#else
+  (void)pvParameters;
+  vTaskDelete(NULL);
+#endif
+}
+
+#if TRACE_ENABLE
+/******************************************************************************
+ * Function Name: trace_store
+ ******************************************************************************
+ * Summary:
+ *  Writes a record unless the ring is frozen. Called with interrupts
+ *  disabled.
+ *
+ * Parameters:
+ *  uint32_t event   : TRACE_EVENT_*
+ *  uint32_t context : Task number or TRACE_CONTEXT_ISR | exception number
+ *  uint32_t arg     : Argument of the event
+ *
+ ******************************************************************************/
+static void trace_store(uint32_t event, uint32_t context, uint32_t arg) {
+  trace_record_t *record;
+
+  if (trace_frozen) {
+    return;
+  }
+
+  record = &trace_ring[trace_head & (TRACE_BUFFER_EVENTS - 1u)];
+#if defined(__CORTEX_M) && (__CORTEX_M >= 3)
+  record->timestamp = DWT->CYCCNT;
+#else
+  record->timestamp = 0;
+#endif
+  record->arg = arg;
+  record->context = (uint16_t)context;
+  record->event = (uint8_t)event;
+  trace_head++;
+
+  if (trace_triggered && (trace_head == trace_stop_at)) {
+    trace_frozen = true;
+  }
+}
+
+/******************************************************************************
+ * Function Name: trace_context
+ ******************************************************************************
+ * Summary:
+ *  Context of the caller.
+ *
+ * Return:
+ *  uint32_t : Running task number, or TRACE_CONTEXT_ISR | exception number
+ *
+ ******************************************************************************/
+static uint32_t trace_context(void) {
+  uint32_t exception = __get_IPSR();
+
+  return (exception != 0u) ? (TRACE_CONTEXT_ISR | exception)
+                           : trace_current_task;
+}
+
+/******************************************************************************
+ * Function Name: trace_dump
+ ******************************************************************************
+ * Summary:
+ *  Writes the frozen ring as text lines:
+ *
+ *   TRACE BEGIN <cycles per us> <records>
+ *   TASK <number> <name>
+ *   QUEUE <address> <name>             (queues in the queue registry)
+ *   E <index> <timestamp> <event> <context> <arg>    (hexadecimal)
+ *   TRACE END <records>
+ *
+ * Parameters:
+ *  bool mqtt : Publish on MQTT_TRACE_TOPIC instead of printing
+ *
+ ******************************************************************************/
+static void trace_dump(bool mqtt) {
+  trace_sink_t sink = {.mqtt = mqtt};
+  uint32_t count = (trace_head < TRACE_BUFFER_EVENTS) ? trace_head
+                                                      : TRACE_BUFFER_EVENTS;
+  uint32_t first = trace_head - count;
+  uintptr_t queues[TRACE_MAX_QUEUES];
+  uint32_t queue_count = 0;
+  UBaseType_t task_count;
+  char line[TRACE_LINE_SIZE];
+
+  trace_emit(&sink, line,
+             snprintf(line, sizeof(line), "TRACE BEGIN %lu %lu\n",
+                      (unsigned long)(SystemCoreClock / 1000000u),
+                      (unsigned long)count));
+
+  task_count = uxTaskGetSystemState(trace_tasks, TRACE_MAX_TASKS, NULL);
+  for (UBaseType_t i = 0; i < task_count; i++) {
+    trace_emit(&sink, line,
+               snprintf(line, sizeof(line), "TASK %lu %s\n",
+                        (unsigned long)trace_tasks[i].xTaskNumber,
+                        trace_tasks[i].pcTaskName));
+  }
+
+  for (uint32_t i = first; i != trace_head; i++) {
+    const trace_record_t *record = &trace_ring[i & (TRACE_BUFFER_EVENTS - 1u)];
+    const char *name;
+    uint32_t j;
+
+    if ((record->event < TRACE_EVENT_QUEUE_SEND) ||
+        (record->event > TRACE_EVENT_QUEUE_BLOCK_RECEIVE)) {
+      continue;
+    }
+    for (j = 0; (j < queue_count) && (queues[j] != record->arg); j++) {
+    }
+    if ((j < queue_count) || (queue_count == TRACE_MAX_QUEUES)) {
+      continue;
+    }
+    queues[queue_count++] = record->arg;
+    name = pcQueueGetName((QueueHandle_t)(uintptr_t)record->arg);
+    if (name != NULL) {
+      trace_emit(&sink, line,
+                 snprintf(line, sizeof(line), "QUEUE %08lx %s\n",
+                          (unsigned long)record->arg, name));
+    }
+  }
+
+  for (uint32_t i = first; (i != trace_head) && !sink.failed; i++) {
+    const trace_record_t *record = &trace_ring[i & (TRACE_BUFFER_EVENTS - 1u)];
+
+    trace_emit(&sink, line,
+               snprintf(line, sizeof(line), "E %lx %08lx %x %x %08lx\n",
+                        (unsigned long)(i - first),
+                        (unsigned long)record->timestamp,
+                        (unsigned)record->event, (unsigned)record->context,
+                        (unsigned long)record->arg));
+  }
+
+  trace_emit(&sink, line,
+             snprintf(line, sizeof(line), "TRACE END %lu\n",
+                      (unsigned long)count));
+  trace_flush(&sink);
+
+  if (sink.failed) {
+    printf("Trace: dump incomplete, no publisher slot\n");
+  }
+}
+
+/******************************************************************************
+ * Function Name: trace_emit
+ ******************************************************************************
+ * Summary:
+ *  Writes a dump line. On the console the lines are paced so that the
+ *  console ring does not overflow. Over MQTT they are packed into publisher
+ *  slots; a message holds whole lines, as the messages of the dump may
+ *  arrive out of order.
+ *
+ * Parameters:
+ *  trace_sink_t *sink : Destination
+ *  const char *line   : Line, with its newline
+ *  int len            : Length of the line, as returned by snprintf()
+ *
+ ******************************************************************************/
+static void trace_emit(trace_sink_t *sink, const char *line, int len) {
+  if ((len <= 0) || (len >= (int)TRACE_LINE_SIZE) || sink->failed) {
+    return;
+  }
+
+  if (!sink->mqtt) {
+    printf("%s", line);
+    if ((++sink->lines % TRACE_CONSOLE_BATCH_LINES) == 0u) {
+      vTaskDelay(pdMS_TO_TICKS(TRACE_CONSOLE_BATCH_MS));
+    }
+    return;
+  }
+
+  if ((sink->buffer != NULL) && ((sink->len + (size_t)len) >= sink->size)) {
+    trace_flush(sink);
+  }
+  for (uint32_t retry = 0; sink->buffer == NULL; retry++) {
+    if (retry == TRACE_PUBLISH_RETRIES) {
+      sink->failed = true;
+      return;
+    }
+    sink->buffer = publisher_reserve(&sink->size);
+    sink->len = 0;
+    if (sink->buffer == NULL) {
+      vTaskDelay(pdMS_TO_TICKS(TRACE_PUBLISH_RETRY_MS));
+    }
+  }
+  memcpy(&sink->buffer[sink->len], line, (size_t)len);
+  sink->len += (size_t)len;
+}
+
+/******************************************************************************
+ * Function Name: trace_flush
+ ******************************************************************************
+ * Summary:
+ *  Publishes the lines collected for MQTT.
+ *
+ * Parameters:
+ *  trace_sink_t *sink : Destination
+ *
+ ******************************************************************************/
+static void trace_flush(trace_sink_t *sink) {
+  if (sink->buffer == NULL) {
+    return;
+  }
+  if (publisher_commit(MQTT_CLASS_TRACE, sink->buffer, sink->len) !=
+      CY_RSLT_SUCCESS) {
+    sink->failed = true;
+  }
+  sink->buffer = NULL;
+}
+#endif /* TRACE_ENABLE */
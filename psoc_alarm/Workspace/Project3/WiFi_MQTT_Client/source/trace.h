@@ -0,0 +1,75 @@
+/*
+ * trace.h
+ *
+ * Kernel event trace. Task switches, queue operations and interrupts are
+ * recorded with a cycle counter timestamp in a RAM ring, dumped on the
+ * console or over MQTT and converted to Chrome trace JSON on the host by
+ * server_code/trace_to_chrome.py.
+ *
+ * Included by FreeRTOSConfig.h for the trace hooks: must not include the
+ * FreeRTOS headers.
+ */
+
+#ifndef SOURCE_TRACE_H_
+#define SOURCE_TRACE_H_
+
+#include <stdint.h>
+#include "log_config.h"
+
+/*******************************************************************************
+ * Macros
+ ******************************************************************************/
+/* Task parameters for the trace task, which dumps the ring. */
+#define TRACE_TASK_PRIORITY (0)
+#define TRACE_TASK_STACK_SIZE (1024 * 1)
+
+/* Event types, shared with trace_to_chrome.py. */
+#define TRACE_EVENT_TASK_SWITCH (1u)
+#define TRACE_EVENT_QUEUE_SEND (2u)
+#define TRACE_EVENT_QUEUE_RECEIVE (3u)
+#define TRACE_EVENT_QUEUE_BLOCK_SEND (4u)
+#define TRACE_EVENT_QUEUE_BLOCK_RECEIVE (5u)
+#define TRACE_EVENT_ISR_ENTER (6u)
+#define TRACE_EVENT_ISR_EXIT (7u)
+#define TRACE_EVENT_TRIGGER (8u)
+
+#if TRACE_ENABLE
+/* Marks the application interrupt handlers. */
+#define TRACE_ISR_ENTER() trace_isr_enter()
+#define TRACE_ISR_EXIT() trace_isr_exit()
+
+/* FreeRTOS trace hooks, expanded in tasks.c and queue.c. Semaphores and
+ * mutexes are queues and show up as queue operations.
+ */
+#define traceTASK_SWITCHED_IN()                                                \
+  trace_task_switched_in((uint32_t)pxCurrentTCB->uxTCBNumber)
+#define traceQUEUE_SEND(pxQueue)                                               \
+  trace_queue(TRACE_EVENT_QUEUE_SEND, (pxQueue))
+#define traceQUEUE_SEND_FROM_ISR(pxQueue)                                      \
+  trace_queue(TRACE_EVENT_QUEUE_SEND, (pxQueue))
+#define traceQUEUE_RECEIVE(pxQueue)                                            \
+  trace_queue(TRACE_EVENT_QUEUE_RECEIVE, (pxQueue))
+#define traceQUEUE_RECEIVE_FROM_ISR(pxQueue)                                   \
+  trace_queue(TRACE_EVENT_QUEUE_RECEIVE, (pxQueue))
+#define traceBLOCKING_ON_QUEUE_SEND(pxQueue)                                   \
+  trace_queue(TRACE_EVENT_QUEUE_BLOCK_SEND, (pxQueue))
+#define traceBLOCKING_ON_QUEUE_RECEIVE(pxQueue)                                \
+  trace_queue(TRACE_EVENT_QUEUE_BLOCK_RECEIVE, (pxQueue))
+#else
+#define TRACE_ISR_ENTER()
+#define TRACE_ISR_EXIT()
+#endif
+
+/*******************************************************************************
+ * Function Prototypes
+ ******************************************************************************/
+void trace_task_switched_in(uint32_t task_number);
+void trace_queue(uint32_t event, const void *queue);
+void trace_isr_enter(void);
+void trace_isr_exit(void);
+void trace_trigger(void);
+void trace_arm(void);
+void trace_request_dump(void);
+void trace_task(void *pvParameters);
+
+#endif /* SOURCE_TRACE_H_ */
@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+"""Compare microbenchmark results of the board or the host with a baseline.
+
+The results are the BENCH lines printed by the host build (make bench) or
+published on security/diag after a BENCH command, e.g.
+
+    mosquitto_sub -h <broker> -t security/diag > bench.txt
+
+Other lines in the input are ignored. A case slower than the baseline by
+more than the threshold fails, as does a case missing from the results.
+Without a baseline the results are only printed; --save writes them as the
+new baseline.
+
+    python3 bench_compare.py baseline.txt bench.txt -t 10
+"""
+
+import argparse
+import os
+import re
+import sys
+
+LINE = re.compile(r'^BENCH (\S+) (\d+) ([0-9.]+) (\S+)$')
+BEGIN = re.compile(r'^BENCH BEGIN (\S+)$')
+
+
+def parse(lines):
+    """Collect the time per iteration of every case, and the unit."""
+    unit = None
+    cases = {}
+
+    for line in lines:
+        line = line.rstrip('\r\n')
+        match = BEGIN.match(line)
+        if match:
+            unit = match.group(1)
+            continue
+        match = LINE.match(line)
+        if match:
+            name, _, per_op, case_unit = match.groups()
+            cases[name] = float(per_op)
+            unit = case_unit
+    return unit, cases
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('baseline', help='baseline results')
+    parser.add_argument('results', help='new results')
+    parser.add_argument('-t', '--threshold', type=float, default=10.0,
+                        help='allowed slowdown in percent (default 10)')
+    parser.add_argument('--save', action='store_true',
+                        help='write the results as the new baseline')
+    args = parser.parse_args()
+
+    with open(args.results) as results_file:
+        lines = results_file.readlines()
+    unit, results = parse(lines)
+    if not results:
+        sys.exit('No BENCH lines in ' + args.results)
+
+    if args.save:
+        with open(args.baseline, 'w') as baseline_file:
+            baseline_file.writelines(line for line in lines
+                                     if line.startswith('BENCH '))
+        print('Baseline %s written, %d cases' % (args.baseline, len(results)))
+        return
+
+    baseline = {}
+    if os.path.exists(args.baseline):
+        with open(args.baseline) as baseline_file:
+            base_unit, baseline = parse(baseline_file)
+        if base_unit != unit:
+            sys.exit('The baseline is in %s, the results in %s'
+                     % (base_unit, unit))
+    else:
+        print('No baseline %s, run with --save to create it' % args.baseline)
+
+    failed = []
+    print('%-24s %12s %12s %8s' % ('case', 'baseline', unit, 'change'))
+    for name in sorted(set(baseline) | set(results)):
+        old = baseline.get(name)
+        new = results.get(name)
+        if new is None:
+            print('%-24s %12.2f %12s %8s' % (name, old, '-', 'MISSING'))
+            failed.append(name)
+            continue
+        if old is None:
+            print('%-24s %12s %12.2f %8s' % (name, '-', new, 'new'))
+            continue
+        change = (new - old) * 100.0 / old if old > 0 else 0.0
+        regressed = change > args.threshold
+        print('%-24s %12.2f %12.2f %+7.1f%%%s' % (
+            name, old, new, change, ' REGRESSED' if regressed else ''))
+        if regressed:
+            failed.append(name)
+
+    if failed:
+        sys.exit('%d of %d cases regressed or missing: %s'
+                 % (len(failed), len(results), ' '.join(failed)))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,167 @@
+#!/usr/bin/env python3
+"""Report the RAM use of the board firmware from the linker map file.
+
+ModusToolbox writes the GNU ld map next to the firmware, e.g.
+
+    build/APP_CY8CPROTO-062-4343W/Debug/WiFi_MQTT_Client.map
+
+The report lists the use of each memory region, the RAM per object file
+and the largest variables, the application objects (the files of the
+source/ directory) marked with '*'. With -b the RAM of the application
+objects is checked against a budget, as source/memory_plan.h does at
+compile time for the planned tasks, queues and buffers.
+
+    python3 map_report.py WiFi_MQTT_Client.map -n 20 -b 163840
+"""
+
+import argparse
+import collections
+import os
+import re
+import sys
+
+REGION = re.compile(r'^(\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)')
+OUTPUT = re.compile(r'^(\.\S+)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+))?')
+INPUT = re.compile(r'^ (\S+)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(.+))?$')
+CONTINUATION = re.compile(r'^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(.+)$')
+
+
+def parse(lines):
+    """Collect the regions, the output sections and the input sections."""
+    regions = []
+    sections = []
+    inputs = []
+    in_regions = False
+    in_map = False
+    pending = None
+    current = None
+
+    for line in lines:
+        line = line.rstrip('\r\n')
+        if line.startswith('Memory Configuration'):
+            in_regions = True
+            continue
+        if line.startswith('Linker script and memory map'):
+            in_regions = False
+            in_map = True
+            continue
+        if in_regions:
+            match = REGION.match(line)
+            if match and match.group(1) not in ('Name', '*default*'):
+                regions.append((match.group(1), int(match.group(2), 16),
+                                int(match.group(3), 16)))
+            continue
+        if not in_map:
+            continue
+
+        # Names longer than the column put the numbers on the next line.
+        if pending is not None:
+            match = CONTINUATION.match(line)
+            kind, name = pending
+            pending = None
+            if match:
+                address, size = int(match.group(1), 16), int(match.group(2), 16)
+                if kind == 'output':
+                    current = (name, address, size)
+                    sections.append(current)
+                elif current is not None:
+                    inputs.append((current[0], name, address, size,
+                                   match.group(3).strip()))
+                continue
+
+        match = OUTPUT.match(line)
+        if match:
+            if match.group(2) is None:
+                pending = ('output', match.group(1))
+            else:
+                current = (match.group(1), int(match.group(2), 16),
+                           int(match.group(3), 16))
+                sections.append(current)
+            continue
+        match = INPUT.match(line)
+        if match and current is not None and match.group(1).startswith(
+                ('.', 'COMMON')):
+            if match.group(2) is None:
+                pending = ('input', match.group(1))
+            else:
+                inputs.append((current[0], match.group(1),
+                               int(match.group(2), 16),
+                               int(match.group(3), 16),
+                               match.group(4).strip()))
+    return regions, sections, inputs
+
+
+def region_of(regions, address):
+    for name, origin, length in regions:
+        if origin <= address < origin + length:
+            return name
+    return None
+
+
+def is_ram(region):
+    """The RAM regions of the linker scripts have ram in their name."""
+    return region is not None and 'ram' in region.lower()
+
+
+def variable(section):
+    """Variable name of a -fdata-sections input section, e.g. .bss.log_ring."""
+    for prefix in ('.bss.', '.data.', '.noinit.'):
+        if section.startswith(prefix):
+            return section[len(prefix):]
+    return section
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('map', help='linker map file')
+    parser.add_argument('-n', '--top', type=int, default=15,
+                        help='object files and variables listed (default 15)')
+    parser.add_argument('-b', '--budget', type=int,
+                        help='RAM budget of the application objects in bytes')
+    parser.add_argument('--app', default='/source/',
+                        help='path part of the application objects '
+                             '(default /source/)')
+    args = parser.parse_args()
+
+    with open(args.map) as map_file:
+        regions, sections, inputs = parse(map_file)
+    if not sections:
+        sys.exit('No memory map in ' + args.map)
+
+    print('%-16s %10s %10s %6s' % ('region', 'used', 'size', 'use'))
+    for name, origin, length in regions:
+        used = sum(size for _, address, size in sections
+                   if size and region_of(regions, address) == name)
+        print('%-16s %10d %10d %5.1f%%' % (name, used, length,
+                                          used * 100.0 / length))
+
+    per_object = collections.Counter()
+    variables = []
+    for _, section, address, size, path in inputs:
+        if size == 0 or not is_ram(region_of(regions, address)):
+            continue
+        per_object[path] += size
+        variables.append((size, variable(section), path))
+
+    def mark(path):
+        return '*' if args.app in path.replace('\\', '/') else ' '
+
+    print('\n%-40s %10s' % ('RAM per object file', 'bytes'))
+    for path, size in per_object.most_common(args.top):
+        print('%s%-39s %10d' % (mark(path), os.path.basename(path)[:39], size))
+
+    print('\n%-32s %-20s %10s' % ('Largest variables', 'object', 'bytes'))
+    for size, name, path in sorted(variables, reverse=True)[:args.top]:
+        print('%s%-31s %-20s %10d' % (mark(path), name[:31],
+                                       os.path.basename(path)[:20], size))
+
+    app_ram = sum(size for path, size in per_object.items()
+                  if mark(path) == '*')
+    print('\nApplication RAM: %d bytes' % app_ram)
+    if args.budget is not None and app_ram > args.budget:
+        sys.exit('The application RAM exceeds the budget of %d bytes'
+                 % args.budget)
+
+
+if __name__ == '__main__':
+    main()
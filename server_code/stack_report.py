@@ -0,0 +1,233 @@
+#!/usr/bin/env python3
+"""Recommend the task stack sizes from the stack profile and the build.
+
+A STACK_PROFILE=1 build (see the Makefile of the application) writes, next
+to every object, the stack usage of its functions (.su) and its call graph
+(.ci, GCC 10 or later). The deepest path from the entry function of each
+task gives its static stack need. The STACKPROFILE command publishes the
+measured need on the diagnostics topic:
+
+    mosquitto_sub -t security/diag > stacks.txt
+
+For each task the report prints the stack size, the measured and static
+needs and the recommendation: the larger need plus the exception frame, a
+margin and rounded up. The static need is a lower bound when the path has
+recursion, calls through pointers, calls into code built without the call
+graph (the libraries) or variable frames; these are flagged. Tasks with
+only one of the two needs get their recommendation from that one.
+
+    python3 stack_report.py build/APP_CY8CPROTO-062-4343W/Debug stacks.txt
+"""
+
+import argparse
+import json
+import os
+import re
+import sys
+
+# Entry function of each task of the application, by task name.
+TASK_ENTRIES = {
+    'Log task': 'log_task',
+    'Trace task': 'trace_task',
+    'Recorder task': 'recorder_task',
+    'Bench task': 'bench_task',
+    'Heap trace task': 'heap_trace_task',
+    'Stack profile': 'stack_profile_task',
+    'Coroutine task': 'coroutine_task',
+    'Worker task': 'coroutine_worker_task',
+    'State task': 'state_task',
+    'Publisher task': 'publisher_task',
+}
+
+# Functions called through pointers by a function, by its name: the
+# coroutines of source/coroutine.c.
+INDIRECT_CALLEES = {
+    'coroutine_task': ('mqtt_client_run', 'link_monitor_run',
+                       'sys_stats_run'),
+}
+
+NODE = re.compile(r'^node:\s*\{\s*title:\s*"([^"]+)"\s*label:\s*"([^"]*)"')
+EDGE = re.compile(r'^edge:\s*\{\s*sourcename:\s*"([^"]+)"\s*'
+                  r'targetname:\s*"([^"]+)"')
+FRAME = re.compile(r'(\d+) bytes \(([a-z,]+)\)')
+SU = re.compile(r'^(.+):\d+:\d+:([^\t]+)\t(\d+)\t(\S+)')
+
+# Flags of a path.
+RECURSION = 'R'
+INDIRECT = 'I'
+UNKNOWN = 'U'
+DYNAMIC = 'D'
+
+
+def parse_build(build_dir):
+    """Collect the frames and calls of the .ci files, the frames of the .su
+    files without a call graph."""
+    frames = {}
+    dynamic = set()
+    calls = {}
+
+    for root, _, files in os.walk(build_dir):
+        for name in files:
+            path = os.path.join(root, name)
+            if name.endswith('.ci'):
+                with open(path) as ci_file:
+                    for line in ci_file:
+                        match = NODE.match(line.strip())
+                        if match:
+                            frame = FRAME.search(match.group(2))
+                            if frame:
+                                frames[match.group(1)] = int(frame.group(1))
+                                if frame.group(2) != 'static':
+                                    dynamic.add(match.group(1))
+                            continue
+                        match = EDGE.match(line.strip())
+                        if match:
+                            calls.setdefault(match.group(1), set()).add(
+                                match.group(2))
+            elif name.endswith('.su'):
+                with open(path) as su_file:
+                    for line in su_file:
+                        match = SU.match(line)
+                        if match and match.group(2) not in frames:
+                            frames[match.group(2)] = int(match.group(3))
+                            if match.group(4) != 'static':
+                                dynamic.add(match.group(2))
+    return frames, dynamic, calls
+
+
+def resolve(name, frames):
+    """Node of a function; static functions are known as file:name."""
+    if name in frames:
+        return name
+    for title in frames:
+        if title.endswith(':' + name):
+            return title
+    return name
+
+
+def deepest(function, frames, dynamic, calls, memo, path):
+    """Stack of the deepest path from a function and the flags of the path."""
+    if function in memo:
+        return memo[function]
+    if function in path:
+        return 0, {RECURSION}
+    if function == '__indirect_call':
+        return 0, {INDIRECT}
+    if function not in frames:
+        return 0, {UNKNOWN}
+
+    path.add(function)
+    worst, flags = 0, set()
+    callees = set(calls.get(function, ()))
+    known = INDIRECT_CALLEES.get(function.split(':')[-1])
+    if known and '__indirect_call' in callees:
+        callees.discard('__indirect_call')
+        callees.update(resolve(name, frames) for name in known)
+    for callee in sorted(callees):
+        depth, callee_flags = deepest(callee, frames, dynamic, calls, memo,
+                                      path)
+        flags |= callee_flags
+        worst = max(worst, depth)
+    path.discard(function)
+
+    if function in dynamic:
+        flags.add(DYNAMIC)
+    result = (frames[function] + worst, flags)
+    # A result cut short by recursion depends on the path it was reached by.
+    if RECURSION not in flags:
+        memo[function] = result
+    return result
+
+
+def parse_stacks(lines):
+    """Sizes and least free bytes of the {"stacks":...} messages."""
+    stacks = {}
+    for line in lines:
+        line = line.strip()
+        if not line.startswith('{"stacks"'):
+            continue
+        try:
+            entries = json.loads(line)['stacks']
+        except (ValueError, KeyError):
+            continue
+        for name, size, free in entries:
+            old_size, old_free = stacks.get(name, (size, free))
+            stacks[name] = (size or old_size, min(free, old_free))
+    return stacks
+
+
+def round_up(value, granule):
+    return (value + granule - 1) // granule * granule
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('build', help='build directory of a STACK_PROFILE=1 '
+                                      'build')
+    parser.add_argument('stacks', nargs='?',
+                        help='diagnostics capture with the stack profile')
+    parser.add_argument('-m', '--margin', type=int, default=25,
+                        help='margin in percent (default 25)')
+    parser.add_argument('-c', '--context', type=int, default=208,
+                        help='bytes of the exception frame with the FPU '
+                             'context, not in the static need (default 208)')
+    parser.add_argument('-g', '--granule', type=int, default=64,
+                        help='recommendations rounded up to bytes '
+                             '(default 64)')
+    parser.add_argument('-e', '--entry', action='append', default=[],
+                        metavar='TASK=FUNCTION',
+                        help='entry function of another task')
+    args = parser.parse_args()
+
+    entries = dict(TASK_ENTRIES)
+    for entry in args.entry:
+        task, _, function = entry.partition('=')
+        if not function:
+            sys.exit('Bad entry ' + entry)
+        entries[task] = function
+
+    frames, dynamic, calls = parse_build(args.build)
+    if not frames:
+        sys.exit('No .su or .ci files in ' + args.build)
+    stacks = {}
+    if args.stacks:
+        with open(args.stacks) as stacks_file:
+            stacks = parse_stacks(stacks_file)
+
+    memo = {}
+    print('%-18s %7s %8s %7s %5s %11s %6s %7s' % (
+        'task', 'size', 'measured', 'static', 'flags', 'recommended',
+        'words', 'saving'))
+    reclaimable = 0
+    for task in sorted(set(entries) | set(stacks)):
+        size, free = stacks.get(task, (0, None))
+        measured = size - free if free is not None and size else None
+        static, flags = None, set()
+        if task in entries:
+            entry = resolve(entries[task], frames)
+            static, flags = deepest(entry, frames, dynamic, calls, memo,
+                                    set())
+            if entry not in frames:
+                static = None
+
+        if measured is None and static is None:
+            continue
+        need = max(measured or 0,
+                   static + args.context if static is not None else 0)
+        recommended = round_up(need * (100 + args.margin) // 100,
+                               args.granule)
+        saving = size - recommended if size else 0
+        if saving > 0:
+            reclaimable += saving
+        print('%-18s %7s %8s %7s %5s %11d %6d %7s' % (
+            task[:18], size or '-', '-' if measured is None else measured,
+            '-' if static is None else static, ''.join(sorted(flags)) or '-',
+            recommended, recommended // 4, saving if size else '-'))
+
+    print('\nFlags: R recursion, I call through a pointer, U callee without '
+          'stack usage, D variable frame')
+    print('Reclaimable: %d bytes' % reclaimable)
+
+
+if __name__ == '__main__':
+    main()
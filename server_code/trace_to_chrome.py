@@ -0,0 +1,162 @@
+#!/usr/bin/env python3
+"""Convert a kernel event trace dump of the board to Chrome trace JSON.
+
+The dump is the text printed on the debug console after a latency trigger,
+or the messages published on security/trace after a TRACEDUMP command, e.g.
+
+    mosquitto_sub -h <broker> -t security/trace > trace.txt
+
+Other lines in the input are ignored. Open the output in chrome://tracing or
+https://ui.perfetto.dev.
+
+    python3 trace_to_chrome.py trace.txt -o trace.json
+"""
+
+import argparse
+import json
+import re
+import sys
+
+# Event types, see TRACE_EVENT_* in source/trace.h.
+TASK_SWITCH = 1
+QUEUE_SEND = 2
+QUEUE_RECEIVE = 3
+QUEUE_BLOCK_SEND = 4
+QUEUE_BLOCK_RECEIVE = 5
+ISR_ENTER = 6
+ISR_EXIT = 7
+TRIGGER = 8
+
+QUEUE_EVENT_NAMES = {
+    QUEUE_SEND: 'send',
+    QUEUE_RECEIVE: 'receive',
+    QUEUE_BLOCK_SEND: 'block on send',
+    QUEUE_BLOCK_RECEIVE: 'block on receive',
+}
+
+CONTEXT_ISR = 0x8000
+
+# Thread ids of the exception handlers, after the task numbers.
+ISR_TID_BASE = 1000
+
+LINE = re.compile(r'^(TRACE BEGIN|TRACE END|TASK|QUEUE|E) (.*)$')
+
+
+def parse(lines):
+    """Collect the dump lines. Records are keyed by index, since MQTT
+    messages can arrive out of order."""
+    cycles_per_us = None
+    tasks = {}
+    queues = {}
+    records = {}
+
+    for line in lines:
+        match = LINE.match(line.rstrip('\r\n'))
+        if not match:
+            continue
+        kind, rest = match.groups()
+        if kind == 'TRACE BEGIN':
+            cycles_per_us = int(rest.split()[0])
+        elif kind == 'TASK':
+            number, _, name = rest.partition(' ')
+            tasks[int(number)] = name
+        elif kind == 'QUEUE':
+            address, _, name = rest.partition(' ')
+            queues[int(address, 16)] = name
+        elif kind == 'E':
+            fields = rest.split()
+            if len(fields) != 5:
+                continue
+            index, timestamp, event, context, arg = (int(f, 16) for f in fields)
+            records[index] = (timestamp, event, context, arg)
+
+    if cycles_per_us is None:
+        sys.exit('No TRACE BEGIN line in the input')
+    return cycles_per_us, tasks, queues, [records[i] for i in sorted(records)]
+
+
+def context_tid(context):
+    if context & CONTEXT_ISR:
+        return ISR_TID_BASE + (context & ~CONTEXT_ISR)
+    return context
+
+
+def exception_name(exception):
+    if exception >= 16:
+        return 'IRQ %d' % (exception - 16)
+    return {11: 'SVCall', 14: 'PendSV', 15: 'SysTick'}.get(
+        exception, 'exception %d' % exception)
+
+
+def convert(cycles_per_us, tasks, queues, records):
+    events = []
+    threads = {}
+    running = None
+    now = 0
+    last = None
+
+    def queue_name(address):
+        return queues.get(address, '0x%08x' % address)
+
+    for timestamp, event, context, arg in records:
+        # Unwrap the 32-bit cycle counter.
+        if last is not None:
+            now += (timestamp - last) & 0xFFFFFFFF
+        last = timestamp
+        ts = now / cycles_per_us
+        tid = context_tid(context)
+
+        if context & CONTEXT_ISR:
+            threads[tid] = exception_name(context & ~CONTEXT_ISR)
+        else:
+            threads[tid] = tasks.get(context, 'task %d' % context)
+
+        if event == TASK_SWITCH:
+            if running is not None:
+                events.append({'ph': 'E', 'pid': 1, 'tid': running, 'ts': ts})
+            running = tid
+            events.append({'ph': 'B', 'pid': 1, 'tid': tid, 'ts': ts,
+                           'name': threads[tid]})
+        elif event == ISR_ENTER:
+            events.append({'ph': 'B', 'pid': 1, 'tid': tid, 'ts': ts,
+                           'name': threads[tid]})
+        elif event == ISR_EXIT:
+            events.append({'ph': 'E', 'pid': 1, 'tid': tid, 'ts': ts})
+        elif event in QUEUE_EVENT_NAMES:
+            events.append({'ph': 'i', 'pid': 1, 'tid': tid, 'ts': ts, 's': 't',
+                           'name': '%s %s' % (QUEUE_EVENT_NAMES[event],
+                                              queue_name(arg))})
+        elif event == TRIGGER:
+            events.append({'ph': 'i', 'pid': 1, 'tid': tid, 'ts': ts, 's': 'g',
+                           'name': 'latency trigger'})
+
+    # A slice still open at the end of the dump is closed there.
+    if running is not None:
+        events.append({'ph': 'E', 'pid': 1, 'tid': running, 'ts': now /
+                       cycles_per_us})
+
+    events.append({'ph': 'M', 'pid': 1, 'name': 'process_name',
+                   'args': {'name': 'PSoC 6 CM4'}})
+    for tid, name in threads.items():
+        events.append({'ph': 'M', 'pid': 1, 'tid': tid, 'name': 'thread_name',
+                       'args': {'name': name}})
+        events.append({'ph': 'M', 'pid': 1, 'tid': tid,
+                       'name': 'thread_sort_index', 'args': {'sort_index': tid}})
+    return {'traceEvents': events, 'displayTimeUnit': 'ms'}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('input', nargs='?', type=argparse.FileType('r'),
+                        default=sys.stdin, help='dump (default: stdin)')
+    parser.add_argument('-o', '--output', type=argparse.FileType('w'),
+                        default=sys.stdout, help='JSON file (default: stdout)')
+    args = parser.parse_args()
+
+    cycles_per_us, tasks, queues, records = parse(args.input)
+    json.dump(convert(cycles_per_us, tasks, queues, records), args.output)
+    print('%d records, %d tasks' % (len(records), len(tasks)), file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()